@@ -165,7 +165,7 @@ RS_SPEC_TABLES :=	\
 LOCAL_SRC_FILES :=	\
 	llvm-rs-cc.cpp	\
 	slang_rs.cpp	\
-	slang_rs_ast_replace.cpp	\
+	slang_rs_ast_pass.cpp	\
 	slang_rs_check_ast.cpp	\
 	slang_rs_context.cpp	\
 	slang_rs_pragma_handler.cpp	\
@@ -176,7 +176,15 @@ LOCAL_SRC_FILES :=	\
 	slang_rs_export_var.cpp	\
 	slang_rs_export_func.cpp	\
 	slang_rs_export_foreach.cpp \
+	slang_rs_export_blob.cpp	\
+	slang_rs_export_layout.cpp	\
+	slang_rs_metadata_spec_encoder.cpp	\
+	slang_rs_metadata_spec_decoder.cpp	\
+	slang_rs_metadata_utils.cpp	\
 	slang_rs_object_ref_count.cpp	\
+	slang_rs_object_slots.cpp	\
+	slang_rs_odr_store.cpp	\
+	slang_rs_refcount_elision.cpp	\
 	slang_rs_reflection.cpp \
 	slang_rs_reflection_base.cpp \
 	slang_rs_reflection_cpp.cpp \
@@ -211,6 +219,46 @@ include $(CLANG_HOST_BUILD_MK)
 include $(CLANG_TBLGEN_RULES_MK)
 include $(BUILD_HOST_EXECUTABLE)
 
+# Executable slang-bitwriter-bench for host
+# ========================================================
+# Benchmarks and round-trip checks the three bitcode writers. It forks to
+# measure each writer's peak memory, so it is not built for Windows.
+ifneq ($(HOST_OS),windows)
+
+include $(CLEAR_VARS)
+
+LLVM_ROOT_PATH := external/llvm
+
+LOCAL_IS_HOST_MODULE := true
+LOCAL_MODULE := slang-bitwriter-bench
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE_CLASS := EXECUTABLES
+
+LOCAL_CFLAGS += $(local_cflags_for_slang)
+
+LOCAL_SRC_FILES :=	\
+	slang_bitwriter_bench.cpp	\
+	slang_rs_export_blob.cpp	\
+	slang_rs_metadata_spec_decoder.cpp	\
+	slang_rs_metadata_utils.cpp	\
+	slang_rs_object_slots.cpp
+
+LOCAL_STATIC_LIBRARIES :=	\
+	$(static_libraries_needed_by_slang)
+
+LOCAL_SHARED_LIBRARIES := \
+	libLLVM
+
+LOCAL_LDLIBS := -ldl -lpthread
+
+include $(LLVM_ROOT_PATH)/llvm.mk
+include $(LLVM_HOST_BUILD_MK)
+include $(LLVM_GEN_INTRINSICS_MK)
+include $(BUILD_HOST_EXECUTABLE)
+
+endif  # HOST_OS != windows
+
 endif  # TARGET_BUILD_APPS
 
 #=====================================================================
@@ -13,6 +13,7 @@
 
 #include "ReaderWriter_2_9.h"
 #include "ValueEnumerator.h"
+#include "../BitWriter_common/BitcodeWriterCommon.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -30,6 +31,7 @@
 #include <cctype>
 #include <map>
 using namespace llvm;
+using namespace bitwriter_common;
 
 // Redefine older bitcode opcodes for use here. Note that these come from
 // LLVM 2.7 (which is what HC shipped with).
@@ -51,11 +53,7 @@ using namespace llvm;
 enum {
   CurVersion = 0,
 
-  // VALUE_SYMTAB_BLOCK abbrev id's.
-  VST_ENTRY_8_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
-  VST_ENTRY_7_ABBREV,
-  VST_ENTRY_6_ABBREV,
-  VST_BBENTRY_6_ABBREV,
+  // VALUE_SYMTAB_BLOCK abbrev id's are shared, see BitcodeWriterCommon.h.
 
   // CONSTANTS_BLOCK abbrev id's.
   CONSTANTS_SETTYPE_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
@@ -74,84 +72,7 @@ enum {
 };
 
 
-static unsigned GetEncodedCastOpcode(unsigned Opcode) {
-  switch (Opcode) {
-  default: llvm_unreachable("Unknown cast instruction!");
-  case Instruction::Trunc   : return bitc::CAST_TRUNC;
-  case Instruction::ZExt    : return bitc::CAST_ZEXT;
-  case Instruction::SExt    : return bitc::CAST_SEXT;
-  case Instruction::FPToUI  : return bitc::CAST_FPTOUI;
-  case Instruction::FPToSI  : return bitc::CAST_FPTOSI;
-  case Instruction::UIToFP  : return bitc::CAST_UITOFP;
-  case Instruction::SIToFP  : return bitc::CAST_SITOFP;
-  case Instruction::FPTrunc : return bitc::CAST_FPTRUNC;
-  case Instruction::FPExt   : return bitc::CAST_FPEXT;
-  case Instruction::PtrToInt: return bitc::CAST_PTRTOINT;
-  case Instruction::IntToPtr: return bitc::CAST_INTTOPTR;
-  case Instruction::BitCast : return bitc::CAST_BITCAST;
-  }
-}
-
-static unsigned GetEncodedBinaryOpcode(unsigned Opcode) {
-  switch (Opcode) {
-  default: llvm_unreachable("Unknown binary instruction!");
-  case Instruction::Add:
-  case Instruction::FAdd: return bitc::BINOP_ADD;
-  case Instruction::Sub:
-  case Instruction::FSub: return bitc::BINOP_SUB;
-  case Instruction::Mul:
-  case Instruction::FMul: return bitc::BINOP_MUL;
-  case Instruction::UDiv: return bitc::BINOP_UDIV;
-  case Instruction::FDiv:
-  case Instruction::SDiv: return bitc::BINOP_SDIV;
-  case Instruction::URem: return bitc::BINOP_UREM;
-  case Instruction::FRem:
-  case Instruction::SRem: return bitc::BINOP_SREM;
-  case Instruction::Shl:  return bitc::BINOP_SHL;
-  case Instruction::LShr: return bitc::BINOP_LSHR;
-  case Instruction::AShr: return bitc::BINOP_ASHR;
-  case Instruction::And:  return bitc::BINOP_AND;
-  case Instruction::Or:   return bitc::BINOP_OR;
-  case Instruction::Xor:  return bitc::BINOP_XOR;
-  }
-}
-
-static void WriteStringRecord(unsigned Code, StringRef Str,
-                              unsigned AbbrevToUse, BitstreamWriter &Stream) {
-  SmallVector<unsigned, 64> Vals;
-
-  // Code: [strchar x N]
-  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
-    if (AbbrevToUse && !BitCodeAbbrevOp::isChar6(Str[i]))
-      AbbrevToUse = 0;
-    Vals.push_back(Str[i]);
-  }
-
-  // Emit the finished record.
-  Stream.EmitRecord(Code, Vals, AbbrevToUse);
-}
-
 // Emit information about parameter attributes.
-static void WriteAttributeTable(const llvm_2_9::ValueEnumerator &VE,
-                                BitstreamWriter &Stream) {
-  const std::vector<AttributeSet> &Attrs = VE.getAttributes();
-  if (Attrs.empty()) return;
-
-  Stream.EnterSubblock(bitc::PARAMATTR_BLOCK_ID, 3);
-
-  SmallVector<uint64_t, 64> Record;
-  for (unsigned i = 0, e = Attrs.size(); i != e; ++i) {
-    const AttributeSet &A = Attrs[i];
-    for (unsigned i = 0, e = A.getNumSlots(); i != e; ++i)
-      Record.push_back(VE.getAttributeGroupID(A.getSlotAttributes(i)));
-
-    Stream.EmitRecord(bitc::PARAMATTR_CODE_ENTRY, Record);
-    Record.clear();
-  }
-
-  Stream.ExitBlock();
-}
-
 static void WriteTypeSymbolTable(const llvm_2_9::ValueEnumerator &VE,
                                  BitstreamWriter &Stream) {
   const llvm_2_9::ValueEnumerator::TypeList &TypeList = VE.getTypes();
@@ -383,37 +304,6 @@ static void WriteTypeTable(const llvm_2_9::ValueEnumerator &VE,
   WriteTypeSymbolTable(VE, Stream);
 }
 
-static unsigned getEncodedLinkage(const GlobalValue *GV) {
-  switch (GV->getLinkage()) {
-  case GlobalValue::ExternalLinkage:                 return 0;
-  case GlobalValue::WeakAnyLinkage:                  return 1;
-  case GlobalValue::AppendingLinkage:                return 2;
-  case GlobalValue::InternalLinkage:                 return 3;
-  case GlobalValue::LinkOnceAnyLinkage:              return 4;
-  case GlobalValue::DLLImportLinkage:                return 5;
-  case GlobalValue::DLLExportLinkage:                return 6;
-  case GlobalValue::ExternalWeakLinkage:             return 7;
-  case GlobalValue::CommonLinkage:                   return 8;
-  case GlobalValue::PrivateLinkage:                  return 9;
-  case GlobalValue::WeakODRLinkage:                  return 10;
-  case GlobalValue::LinkOnceODRLinkage:              return 11;
-  case GlobalValue::AvailableExternallyLinkage:      return 12;
-  case GlobalValue::LinkerPrivateLinkage:            return 13;
-  case GlobalValue::LinkerPrivateWeakLinkage:        return 14;
-  case GlobalValue::LinkOnceODRAutoHideLinkage:      return 15;
-  }
-  llvm_unreachable("Invalid linkage");
-}
-
-static unsigned getEncodedVisibility(const GlobalValue *GV) {
-  switch (GV->getVisibility()) {
-  default: llvm_unreachable("Invalid visibility!");
-  case GlobalValue::DefaultVisibility:   return 0;
-  case GlobalValue::HiddenVisibility:    return 1;
-  case GlobalValue::ProtectedVisibility: return 2;
-  }
-}
-
 // Emit top-level description of module, including target triple, inline asm,
 // descriptors for global variables, and function prototype info.
 static void WriteModuleInfo(const Module *M,
@@ -717,30 +607,6 @@ static void WriteMetadataAttachment(const Function &F,
   Stream.ExitBlock();
 }
 
-static void WriteModuleMetadataStore(const Module *M, BitstreamWriter &Stream) {
-  SmallVector<uint64_t, 64> Record;
-
-  // Write metadata kinds
-  // METADATA_KIND - [n x [id, name]]
-  SmallVector<StringRef, 4> Names;
-  M->getMDKindNames(Names);
-
-  if (Names.empty()) return;
-
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
-
-  for (unsigned MDKindID = 0, e = Names.size(); MDKindID != e; ++MDKindID) {
-    Record.push_back(MDKindID);
-    StringRef KName = Names[MDKindID];
-    Record.append(KName.begin(), KName.end());
-
-    Stream.EmitRecord(bitc::METADATA_KIND, Record, 0);
-    Record.clear();
-  }
-
-  Stream.ExitBlock();
-}
-
 static void WriteConstants(unsigned FirstVal, unsigned LastVal,
                            const llvm_2_9::ValueEnumerator &VE,
                            BitstreamWriter &Stream, bool isGlobal) {
@@ -1013,26 +879,6 @@ static void WriteModuleConstants(const llvm_2_9::ValueEnumerator &VE,
   }
 }
 
-/// PushValueAndType - The file has to encode both the value and type id for
-/// many values, because we need to know what type to create for forward
-/// references.  However, most operands are not forward references, so this type
-/// field is not needed.
-///
-/// This function adds V's value ID to Vals.  If the value ID is higher than the
-/// instruction ID, then it is a forward reference, and it also includes the
-/// type ID.
-static bool PushValueAndType(const Value *V, unsigned InstID,
-                             SmallVector<unsigned, 64> &Vals,
-                             llvm_2_9::ValueEnumerator &VE) {
-  unsigned ValID = VE.getValueID(V);
-  Vals.push_back(ValID);
-  if (ValID >= InstID) {
-    Vals.push_back(VE.getTypeID(V->getType()));
-    return true;
-  }
-  return false;
-}
-
 /// WriteInstruction - Emit an instruction to the specified stream.
 static void WriteInstruction(const Instruction &I, unsigned InstID,
                              llvm_2_9::ValueEnumerator &VE,
@@ -1281,63 +1127,6 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
 }
 
 // Emit names for globals/functions etc.
-static void WriteValueSymbolTable(const ValueSymbolTable &VST,
-                                  const llvm_2_9::ValueEnumerator &VE,
-                                  BitstreamWriter &Stream) {
-  if (VST.empty()) return;
-  Stream.EnterSubblock(bitc::VALUE_SYMTAB_BLOCK_ID, 4);
-
-  // FIXME: Set up the abbrev, we know how many values there are!
-  // FIXME: We know if the type names can use 7-bit ascii.
-  SmallVector<unsigned, 64> NameVals;
-
-  for (ValueSymbolTable::const_iterator SI = VST.begin(), SE = VST.end();
-       SI != SE; ++SI) {
-
-    const ValueName &Name = *SI;
-
-    // Figure out the encoding to use for the name.
-    bool is7Bit = true;
-    bool isChar6 = true;
-    for (const char *C = Name.getKeyData(), *E = C+Name.getKeyLength();
-         C != E; ++C) {
-      if (isChar6)
-        isChar6 = BitCodeAbbrevOp::isChar6(*C);
-      if ((unsigned char)*C & 128) {
-        is7Bit = false;
-        break;  // don't bother scanning the rest.
-      }
-    }
-
-    unsigned AbbrevToUse = VST_ENTRY_8_ABBREV;
-
-    // VST_ENTRY:   [valueid, namechar x N]
-    // VST_BBENTRY: [bbid, namechar x N]
-    unsigned Code;
-    if (isa<BasicBlock>(SI->getValue())) {
-      Code = bitc::VST_CODE_BBENTRY;
-      if (isChar6)
-        AbbrevToUse = VST_BBENTRY_6_ABBREV;
-    } else {
-      Code = bitc::VST_CODE_ENTRY;
-      if (isChar6)
-        AbbrevToUse = VST_ENTRY_6_ABBREV;
-      else if (is7Bit)
-        AbbrevToUse = VST_ENTRY_7_ABBREV;
-    }
-
-    NameVals.push_back(VE.getValueID(SI->getValue()));
-    for (const char *P = Name.getKeyData(),
-         *E = Name.getKeyData()+Name.getKeyLength(); P != E; ++P)
-      NameVals.push_back((unsigned char)*P);
-
-    // Emit the finished record.
-    Stream.EmitRecord(Code, NameVals, AbbrevToUse);
-    NameVals.clear();
-  }
-  Stream.ExitBlock();
-}
-
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, llvm_2_9::ValueEnumerator &VE,
                           BitstreamWriter &Stream) {
@@ -1620,79 +1409,6 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
-/// EmitDarwinBCHeader - If generating a bc file on darwin, we have to emit a
-/// header and trailer to make it compatible with the system archiver.  To do
-/// this we emit the following header, and then emit a trailer that pads the
-/// file out to be a multiple of 16 bytes.
-///
-/// struct bc_header {
-///   uint32_t Magic;         // 0x0B17C0DE
-///   uint32_t Version;       // Version, currently always 0.
-///   uint32_t BitcodeOffset; // Offset to traditional bitcode file.
-///   uint32_t BitcodeSize;   // Size of traditional bitcode file.
-///   uint32_t CPUType;       // CPU specifier.
-///   ... potentially more later ...
-/// };
-enum {
-  DarwinBCSizeFieldOffset = 3*4, // Offset to bitcode_size.
-  DarwinBCHeaderSize = 5*4
-};
-
-static void WriteInt32ToBuffer(uint32_t Value, SmallVectorImpl<char> &Buffer,
-                               uint32_t &Position) {
-  Buffer[Position + 0] = (unsigned char) (Value >>  0);
-  Buffer[Position + 1] = (unsigned char) (Value >>  8);
-  Buffer[Position + 2] = (unsigned char) (Value >> 16);
-  Buffer[Position + 3] = (unsigned char) (Value >> 24);
-  Position += 4;
-}
-
-static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
-                                         const Triple &TT) {
-  unsigned CPUType = ~0U;
-
-  // Match x86_64-*, i[3-9]86-*, powerpc-*, powerpc64-*, arm-*, thumb-*,
-  // armv[0-9]-*, thumbv[0-9]-*, armv5te-*, or armv6t2-*. The CPUType is a magic
-  // number from /usr/include/mach/machine.h.  It is ok to reproduce the
-  // specific constants here because they are implicitly part of the Darwin ABI.
-  enum {
-    DARWIN_CPU_ARCH_ABI64      = 0x01000000,
-    DARWIN_CPU_TYPE_X86        = 7,
-    DARWIN_CPU_TYPE_ARM        = 12,
-    DARWIN_CPU_TYPE_POWERPC    = 18
-  };
-
-  Triple::ArchType Arch = TT.getArch();
-  if (Arch == Triple::x86_64)
-    CPUType = DARWIN_CPU_TYPE_X86 | DARWIN_CPU_ARCH_ABI64;
-  else if (Arch == Triple::x86)
-    CPUType = DARWIN_CPU_TYPE_X86;
-  else if (Arch == Triple::ppc)
-    CPUType = DARWIN_CPU_TYPE_POWERPC;
-  else if (Arch == Triple::ppc64)
-    CPUType = DARWIN_CPU_TYPE_POWERPC | DARWIN_CPU_ARCH_ABI64;
-  else if (Arch == Triple::arm || Arch == Triple::thumb)
-    CPUType = DARWIN_CPU_TYPE_ARM;
-
-  // Traditional Bitcode starts after header.
-  assert(Buffer.size() >= DarwinBCHeaderSize &&
-         "Expected header size to be reserved");
-  unsigned BCOffset = DarwinBCHeaderSize;
-  unsigned BCSize = Buffer.size()-DarwinBCHeaderSize;
-
-  // Write the magic and version.
-  unsigned Position = 0;
-  WriteInt32ToBuffer(0x0B17C0DE , Buffer, Position);
-  WriteInt32ToBuffer(0          , Buffer, Position); // Version.
-  WriteInt32ToBuffer(BCOffset   , Buffer, Position);
-  WriteInt32ToBuffer(BCSize     , Buffer, Position);
-  WriteInt32ToBuffer(CPUType    , Buffer, Position);
-
-  // If the file is not a multiple of 16 bytes, insert dummy padding.
-  while (Buffer.size() & 15)
-    Buffer.push_back(0);
-}
-
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm_2_9::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
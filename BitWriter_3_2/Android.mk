@@ -8,6 +8,7 @@ LOCAL_CFLAGS += $(local_cflags_for_slang)
 bitcode_writer_3_2_SRC_FILES :=	\
 	BitcodeWriter.cpp	\
 	BitcodeWriterPass.cpp	\
+	FunctionIndexReader.cpp	\
 	ValueEnumerator.cpp
 
 # For the host
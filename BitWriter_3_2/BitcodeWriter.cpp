@@ -13,6 +13,9 @@
 
 #include "ReaderWriter_3_2.h"
 #include "ValueEnumerator.h"
+#include "../BitWriter_common/BitcodeWriterCommon.h"
+#include "../BitWriter_common/ExportMetadataNames.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -31,6 +34,7 @@
 #include <cctype>
 #include <map>
 using namespace llvm;
+using namespace bitwriter_common;
 
 static cl::opt<bool>
 EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
@@ -43,17 +47,14 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
 enum {
   CurVersion = 0,
 
-  // VALUE_SYMTAB_BLOCK abbrev id's.
-  VST_ENTRY_8_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
-  VST_ENTRY_7_ABBREV,
-  VST_ENTRY_6_ABBREV,
-  VST_BBENTRY_6_ABBREV,
+  // VALUE_SYMTAB_BLOCK abbrev id's are shared, see BitcodeWriterCommon.h.
 
   // CONSTANTS_BLOCK abbrev id's.
   CONSTANTS_SETTYPE_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
   CONSTANTS_INTEGER_ABBREV,
   CONSTANTS_CE_CAST_Abbrev,
   CONSTANTS_NULL_Abbrev,
+  CONSTANTS_SMALL_INTEGER_ABBREV,
 
   // FUNCTION_BLOCK abbrev id's.
   FUNCTION_INST_LOAD_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
@@ -64,68 +65,28 @@ enum {
   FUNCTION_INST_RET_VAL_ABBREV,
   FUNCTION_INST_UNREACHABLE_ABBREV,
 
+  // METADATA_BLOCK abbrev id's (module-level block only, emitted inline).
+  METADATA_STRING_8_ABBREV = bitc::FIRST_APPLICATION_ABBREV,
+  METADATA_STRING_7_ABBREV,
+  METADATA_STRING_6_ABBREV,
+  METADATA_NODE_ABBREV,
+  METADATA_NAME_ABBREV,
+  METADATA_NAMED_NODE_ABBREV,
+
   // SwitchInst Magic
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
 
-static unsigned GetEncodedCastOpcode(unsigned Opcode) {
-  switch (Opcode) {
-  default: llvm_unreachable("Unknown cast instruction!");
-  case Instruction::Trunc   : return bitc::CAST_TRUNC;
-  case Instruction::ZExt    : return bitc::CAST_ZEXT;
-  case Instruction::SExt    : return bitc::CAST_SEXT;
-  case Instruction::FPToUI  : return bitc::CAST_FPTOUI;
-  case Instruction::FPToSI  : return bitc::CAST_FPTOSI;
-  case Instruction::UIToFP  : return bitc::CAST_UITOFP;
-  case Instruction::SIToFP  : return bitc::CAST_SITOFP;
-  case Instruction::FPTrunc : return bitc::CAST_FPTRUNC;
-  case Instruction::FPExt   : return bitc::CAST_FPEXT;
-  case Instruction::PtrToInt: return bitc::CAST_PTRTOINT;
-  case Instruction::IntToPtr: return bitc::CAST_INTTOPTR;
-  case Instruction::BitCast : return bitc::CAST_BITCAST;
-  }
-}
-
-static unsigned GetEncodedBinaryOpcode(unsigned Opcode) {
-  switch (Opcode) {
-  default: llvm_unreachable("Unknown binary instruction!");
-  case Instruction::Add:
-  case Instruction::FAdd: return bitc::BINOP_ADD;
-  case Instruction::Sub:
-  case Instruction::FSub: return bitc::BINOP_SUB;
-  case Instruction::Mul:
-  case Instruction::FMul: return bitc::BINOP_MUL;
-  case Instruction::UDiv: return bitc::BINOP_UDIV;
-  case Instruction::FDiv:
-  case Instruction::SDiv: return bitc::BINOP_SDIV;
-  case Instruction::URem: return bitc::BINOP_UREM;
-  case Instruction::FRem:
-  case Instruction::SRem: return bitc::BINOP_SREM;
-  case Instruction::Shl:  return bitc::BINOP_SHL;
-  case Instruction::LShr: return bitc::BINOP_LSHR;
-  case Instruction::AShr: return bitc::BINOP_ASHR;
-  case Instruction::And:  return bitc::BINOP_AND;
-  case Instruction::Or:   return bitc::BINOP_OR;
-  case Instruction::Xor:  return bitc::BINOP_XOR;
-  }
-}
+/// FunctionIndex - Entries for the optional FUNCTION_INDEX_BLOCK. While the
+/// module is being written, BitOffset holds the absolute bit position in the
+/// output buffer; WriteFunctionIndex rebases it onto the start of the bitcode.
+typedef SmallVector<llvm_3_2::FunctionIndexEntry, 16> FunctionIndex;
 
-static unsigned GetEncodedRMWOperation(AtomicRMWInst::BinOp Op) {
-  switch (Op) {
-  default: llvm_unreachable("Unknown RMW operation!");
-  case AtomicRMWInst::Xchg: return bitc::RMW_XCHG;
-  case AtomicRMWInst::Add: return bitc::RMW_ADD;
-  case AtomicRMWInst::Sub: return bitc::RMW_SUB;
-  case AtomicRMWInst::And: return bitc::RMW_AND;
-  case AtomicRMWInst::Nand: return bitc::RMW_NAND;
-  case AtomicRMWInst::Or: return bitc::RMW_OR;
-  case AtomicRMWInst::Xor: return bitc::RMW_XOR;
-  case AtomicRMWInst::Max: return bitc::RMW_MAX;
-  case AtomicRMWInst::Min: return bitc::RMW_MIN;
-  case AtomicRMWInst::UMax: return bitc::RMW_UMAX;
-  case AtomicRMWInst::UMin: return bitc::RMW_UMIN;
-  }
-}
+/// Largest (sign-rotated) integer constant that fits in
+/// CONSTANTS_SMALL_INTEGER_ABBREV. RS modules are full of small constants
+/// (vector indices, element counts, 0/1 flags) that would otherwise take a
+/// full VBR8 chunk.
+static const uint64_t SmallIntegerLimit = 1 << 4;
 
 static unsigned GetEncodedOrdering(AtomicOrdering Ordering) {
   switch (Ordering) {
@@ -148,42 +109,7 @@ static unsigned GetEncodedSynchScope(SynchronizationScope SynchScope) {
   llvm_unreachable("Invalid synch scope");
 }
 
-static void WriteStringRecord(unsigned Code, StringRef Str,
-                              unsigned AbbrevToUse, BitstreamWriter &Stream) {
-  SmallVector<unsigned, 64> Vals;
-
-  // Code: [strchar x N]
-  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
-    if (AbbrevToUse && !BitCodeAbbrevOp::isChar6(Str[i]))
-      AbbrevToUse = 0;
-    Vals.push_back(Str[i]);
-  }
-
-  // Emit the finished record.
-  Stream.EmitRecord(Code, Vals, AbbrevToUse);
-}
-
 // Emit information about parameter attributes.
-static void WriteAttributeTable(const llvm_3_2::ValueEnumerator &VE,
-                                BitstreamWriter &Stream) {
-  const std::vector<AttributeSet> &Attrs = VE.getAttributes();
-  if (Attrs.empty()) return;
-
-  Stream.EnterSubblock(bitc::PARAMATTR_BLOCK_ID, 3);
-
-  SmallVector<uint64_t, 64> Record;
-  for (unsigned i = 0, e = Attrs.size(); i != e; ++i) {
-    const AttributeSet &A = Attrs[i];
-    for (unsigned i = 0, e = A.getNumSlots(); i != e; ++i)
-      Record.push_back(VE.getAttributeGroupID(A.getSlotAttributes(i)));
-
-    Stream.EmitRecord(bitc::PARAMATTR_CODE_ENTRY, Record);
-    Record.clear();
-  }
-
-  Stream.ExitBlock();
-}
-
 /// WriteTypeTable - Write out the type table for a module.
 static void WriteTypeTable(const llvm_3_2::ValueEnumerator &VE,
                            BitstreamWriter &Stream) {
@@ -346,37 +272,6 @@ static void WriteTypeTable(const llvm_3_2::ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
-static unsigned getEncodedLinkage(const GlobalValue *GV) {
-  switch (GV->getLinkage()) {
-  case GlobalValue::ExternalLinkage:                 return 0;
-  case GlobalValue::WeakAnyLinkage:                  return 1;
-  case GlobalValue::AppendingLinkage:                return 2;
-  case GlobalValue::InternalLinkage:                 return 3;
-  case GlobalValue::LinkOnceAnyLinkage:              return 4;
-  case GlobalValue::DLLImportLinkage:                return 5;
-  case GlobalValue::DLLExportLinkage:                return 6;
-  case GlobalValue::ExternalWeakLinkage:             return 7;
-  case GlobalValue::CommonLinkage:                   return 8;
-  case GlobalValue::PrivateLinkage:                  return 9;
-  case GlobalValue::WeakODRLinkage:                  return 10;
-  case GlobalValue::LinkOnceODRLinkage:              return 11;
-  case GlobalValue::AvailableExternallyLinkage:      return 12;
-  case GlobalValue::LinkerPrivateLinkage:            return 13;
-  case GlobalValue::LinkerPrivateWeakLinkage:        return 14;
-  case GlobalValue::LinkOnceODRAutoHideLinkage:      return 15;
-  }
-  llvm_unreachable("Invalid linkage");
-}
-
-static unsigned getEncodedVisibility(const GlobalValue *GV) {
-  switch (GV->getVisibility()) {
-  case GlobalValue::DefaultVisibility:   return 0;
-  case GlobalValue::HiddenVisibility:    return 1;
-  case GlobalValue::ProtectedVisibility: return 2;
-  }
-  llvm_unreachable("Invalid visibility");
-}
-
 static unsigned getEncodedThreadLocalMode(const GlobalVariable *GV) {
   switch (GV->getThreadLocalMode()) {
     case GlobalVariable::NotThreadLocal:         return 0;
@@ -392,7 +287,8 @@ static unsigned getEncodedThreadLocalMode(const GlobalVariable *GV) {
 // descriptors for global variables, and function prototype info.
 static void WriteModuleInfo(const Module *M,
                             const llvm_3_2::ValueEnumerator &VE,
-                            BitstreamWriter &Stream) {
+                            BitstreamWriter &Stream,
+                            FunctionIndex *Index) {
   // Emit various pieces of data attached to a module.
   if (!M->getTargetTriple().empty())
     WriteStringRecord(bitc::MODULE_CODE_TRIPLE, M->getTargetTriple(),
@@ -500,8 +396,19 @@ static void WriteModuleInfo(const Module *M,
       AbbrevToUse = SimpleGVarAbbrev;
     }
 
+    uint64_t RecordStart = Stream.GetCurrentBitNo();
     Stream.EmitRecord(bitc::MODULE_CODE_GLOBALVAR, Vals, AbbrevToUse);
     Vals.clear();
+
+    if (Index) {
+      llvm_3_2::FunctionIndexEntry Entry;
+      Entry.Kind = llvm_3_2::FIK_GlobalVariable;
+      Entry.Flags = 0;
+      Entry.BitOffset = RecordStart;
+      Entry.BitSize = Stream.GetCurrentBitNo() - RecordStart;
+      Entry.Name = GV->getName().str();
+      Index->push_back(Entry);
+    }
   }
 
   // Emit the function proto information.
@@ -574,7 +481,8 @@ static uint64_t GetOptimizationFlags(const Value *V) {
 static void WriteMDNode(const MDNode *N,
                         const llvm_3_2::ValueEnumerator &VE,
                         BitstreamWriter &Stream,
-                        SmallVector<uint64_t, 64> &Record) {
+                        SmallVector<uint64_t, 64> &Record,
+                        unsigned NodeAbbrev = 0) {
   for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i) {
     if (N->getOperand(i)) {
       Record.push_back(VE.getTypeID(N->getOperand(i)->getType()));
@@ -586,42 +494,106 @@ static void WriteMDNode(const MDNode *N,
   }
   unsigned MDCode = N->isFunctionLocal() ? bitc::METADATA_FN_NODE :
                                            bitc::METADATA_NODE;
-  Stream.EmitRecord(MDCode, Record, 0);
+  Stream.EmitRecord(MDCode, Record,
+                    MDCode == bitc::METADATA_NODE ? NodeAbbrev : 0);
   Record.clear();
 }
 
+// Enter the module-level METADATA_BLOCK and define its abbreviations. The
+// export metadata emitted by RSBackend is nothing but named nodes of
+// MDStrings (identifiers, type names and small decimal numbers), so strings
+// get 8/7/6-bit variants and node operands are VBR6 rather than the
+// unabbreviated VBR6-plus-length-per-field default.
+static void EnterModuleMetadataBlock(BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+
+  // Abbrev for METADATA_STRING.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_STRING_8_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+
+  // 7-bit METADATA_STRING.
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 7));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_STRING_7_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+
+  // char6 METADATA_STRING.
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_STRING_6_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+
+  // METADATA_NODE: [n x [type num, value num]]
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_NODE));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_NODE_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+
+  // METADATA_NAME: [values]
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_NAME));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_NAME_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+
+  // METADATA_NAMED_NODE: [n x mdnodes]
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_NAMED_NODE));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+  if (Stream.EmitAbbrev(Abbv) != METADATA_NAMED_NODE_ABBREV)
+    llvm_unreachable("Unexpected abbrev ordering!");
+}
+
 static void WriteModuleMetadata(const Module *M,
                                 const llvm_3_2::ValueEnumerator &VE,
                                 BitstreamWriter &Stream) {
   const llvm_3_2::ValueEnumerator::ValueList &Vals = VE.getMDValues();
   bool StartedMetadataBlock = false;
-  unsigned MDSAbbrev = 0;
   SmallVector<uint64_t, 64> Record;
   for (unsigned i = 0, e = Vals.size(); i != e; ++i) {
 
     if (const MDNode *N = dyn_cast<MDNode>(Vals[i].first)) {
       if (!N->isFunctionLocal() || !N->getFunction()) {
         if (!StartedMetadataBlock) {
-          Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+          EnterModuleMetadataBlock(Stream);
           StartedMetadataBlock = true;
         }
-        WriteMDNode(N, VE, Stream, Record);
+        WriteMDNode(N, VE, Stream, Record, METADATA_NODE_ABBREV);
       }
     } else if (const MDString *MDS = dyn_cast<MDString>(Vals[i].first)) {
       if (!StartedMetadataBlock)  {
-        Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
-
-        // Abbrev for METADATA_STRING.
-        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
-        Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
-        MDSAbbrev = Stream.EmitAbbrev(Abbv);
+        EnterModuleMetadataBlock(Stream);
         StartedMetadataBlock = true;
       }
 
       // Code: [strchar x N]
-      Record.append(MDS->begin(), MDS->end());
+      bool isStr7 = true;
+      bool isStrChar6 = true;
+      for (MDString::iterator I = MDS->begin(), E = MDS->end(); I != E; ++I) {
+        unsigned char C = *I;
+        Record.push_back(C);
+        isStr7 &= (C & 128) == 0;
+        if (isStrChar6)
+          isStrChar6 = BitCodeAbbrevOp::isChar6(C);
+      }
+
+      unsigned MDSAbbrev = METADATA_STRING_8_ABBREV;
+      if (isStrChar6)
+        MDSAbbrev = METADATA_STRING_6_ABBREV;
+      else if (isStr7)
+        MDSAbbrev = METADATA_STRING_7_ABBREV;
 
       // Emit the finished record.
       Stream.EmitRecord(bitc::METADATA_STRING, Record, MDSAbbrev);
@@ -634,21 +606,22 @@ static void WriteModuleMetadata(const Module *M,
        E = M->named_metadata_end(); I != E; ++I) {
     const NamedMDNode *NMD = I;
     if (!StartedMetadataBlock)  {
-      Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+      EnterModuleMetadataBlock(Stream);
       StartedMetadataBlock = true;
     }
 
     // Write name.
     StringRef Str = NMD->getName();
     for (unsigned i = 0, e = Str.size(); i != e; ++i)
-      Record.push_back(Str[i]);
-    Stream.EmitRecord(bitc::METADATA_NAME, Record, 0/*TODO*/);
+      Record.push_back((unsigned char) Str[i]);
+    Stream.EmitRecord(bitc::METADATA_NAME, Record, METADATA_NAME_ABBREV);
     Record.clear();
 
     // Write named metadata operands.
     for (unsigned i = 0, e = NMD->getNumOperands(); i != e; ++i)
       Record.push_back(VE.getValueID(NMD->getOperand(i)));
-    Stream.EmitRecord(bitc::METADATA_NAMED_NODE, Record, 0);
+    Stream.EmitRecord(bitc::METADATA_NAMED_NODE, Record,
+                      METADATA_NAMED_NODE_ABBREV);
     Record.clear();
   }
 
@@ -709,30 +682,6 @@ static void WriteMetadataAttachment(const Function &F,
   Stream.ExitBlock();
 }
 
-static void WriteModuleMetadataStore(const Module *M, BitstreamWriter &Stream) {
-  SmallVector<uint64_t, 64> Record;
-
-  // Write metadata kinds
-  // METADATA_KIND - [n x [id, name]]
-  SmallVector<StringRef, 4> Names;
-  M->getMDKindNames(Names);
-
-  if (Names.empty()) return;
-
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
-
-  for (unsigned MDKindID = 0, e = Names.size(); MDKindID != e; ++MDKindID) {
-    Record.push_back(MDKindID);
-    StringRef KName = Names[MDKindID];
-    Record.append(KName.begin(), KName.end());
-
-    Stream.EmitRecord(bitc::METADATA_KIND, Record, 0);
-    Record.clear();
-  }
-
-  Stream.ExitBlock();
-}
-
 static void EmitAPInt(SmallVectorImpl<uint64_t> &Vals,
                       unsigned &Code, unsigned &AbbrevToUse, const APInt &Val,
                       bool EmitSizeForWideNumbers = false
@@ -744,7 +693,8 @@ static void EmitAPInt(SmallVectorImpl<uint64_t> &Vals,
     else
       Vals.push_back((-V << 1) | 1);
     Code = bitc::CST_CODE_INTEGER;
-    AbbrevToUse = CONSTANTS_INTEGER_ABBREV;
+    AbbrevToUse = Vals.back() < SmallIntegerLimit ?
+                  CONSTANTS_SMALL_INTEGER_ABBREV : CONSTANTS_INTEGER_ABBREV;
   } else {
     // Wide integers, > 64 bits in size.
     // We have an arbitrary precision integer value to write whose
@@ -1029,26 +979,6 @@ static void WriteModuleConstants(const llvm_3_2::ValueEnumerator &VE,
   }
 }
 
-/// PushValueAndType - The file has to encode both the value and type id for
-/// many values, because we need to know what type to create for forward
-/// references.  However, most operands are not forward references, so this type
-/// field is not needed.
-///
-/// This function adds V's value ID to Vals.  If the value ID is higher than the
-/// instruction ID, then it is a forward reference, and it also includes the
-/// type ID.
-static bool PushValueAndType(const Value *V, unsigned InstID,
-                             SmallVector<unsigned, 64> &Vals,
-                             llvm_3_2::ValueEnumerator &VE) {
-  unsigned ValID = VE.getValueID(V);
-  Vals.push_back(ValID);
-  if (ValID >= InstID) {
-    Vals.push_back(VE.getTypeID(V->getType()));
-    return true;
-  }
-  return false;
-}
-
 /// WriteInstruction - Emit an instruction to the specified stream.
 static void WriteInstruction(const Instruction &I, unsigned InstID,
                              llvm_3_2::ValueEnumerator &VE,
@@ -1394,63 +1324,6 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
 }
 
 // Emit names for globals/functions etc.
-static void WriteValueSymbolTable(const ValueSymbolTable &VST,
-                                  const llvm_3_2::ValueEnumerator &VE,
-                                  BitstreamWriter &Stream) {
-  if (VST.empty()) return;
-  Stream.EnterSubblock(bitc::VALUE_SYMTAB_BLOCK_ID, 4);
-
-  // FIXME: Set up the abbrev, we know how many values there are!
-  // FIXME: We know if the type names can use 7-bit ascii.
-  SmallVector<unsigned, 64> NameVals;
-
-  for (ValueSymbolTable::const_iterator SI = VST.begin(), SE = VST.end();
-       SI != SE; ++SI) {
-
-    const ValueName &Name = *SI;
-
-    // Figure out the encoding to use for the name.
-    bool is7Bit = true;
-    bool isChar6 = true;
-    for (const char *C = Name.getKeyData(), *E = C+Name.getKeyLength();
-         C != E; ++C) {
-      if (isChar6)
-        isChar6 = BitCodeAbbrevOp::isChar6(*C);
-      if ((unsigned char)*C & 128) {
-        is7Bit = false;
-        break;  // don't bother scanning the rest.
-      }
-    }
-
-    unsigned AbbrevToUse = VST_ENTRY_8_ABBREV;
-
-    // VST_ENTRY:   [valueid, namechar x N]
-    // VST_BBENTRY: [bbid, namechar x N]
-    unsigned Code;
-    if (isa<BasicBlock>(SI->getValue())) {
-      Code = bitc::VST_CODE_BBENTRY;
-      if (isChar6)
-        AbbrevToUse = VST_BBENTRY_6_ABBREV;
-    } else {
-      Code = bitc::VST_CODE_ENTRY;
-      if (isChar6)
-        AbbrevToUse = VST_ENTRY_6_ABBREV;
-      else if (is7Bit)
-        AbbrevToUse = VST_ENTRY_7_ABBREV;
-    }
-
-    NameVals.push_back(VE.getValueID(SI->getValue()));
-    for (const char *P = Name.getKeyData(),
-         *E = Name.getKeyData()+Name.getKeyLength(); P != E; ++P)
-      NameVals.push_back((unsigned char)*P);
-
-    // Emit the finished record.
-    Stream.EmitRecord(Code, NameVals, AbbrevToUse);
-    NameVals.clear();
-  }
-  Stream.ExitBlock();
-}
-
 /// WriteFunction - Emit a function body to the module stream.
 static void WriteFunction(const Function &F, llvm_3_2::ValueEnumerator &VE,
                           BitstreamWriter &Stream) {
@@ -1613,6 +1486,15 @@ static void WriteBlockInfo(const llvm_3_2::ValueEnumerator &VE,
                                    Abbv) != CONSTANTS_NULL_Abbrev)
       llvm_unreachable("Unexpected abbrev ordering!");
   }
+  { // Small INTEGER abbrev for CONSTANTS_BLOCK.
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::CST_CODE_INTEGER));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,
+                              Log2_32_Ceil(SmallIntegerLimit)));
+    if (Stream.EmitBlockInfoAbbrev(bitc::CONSTANTS_BLOCK_ID,
+                                   Abbv) != CONSTANTS_SMALL_INTEGER_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
 
   // FIXME: This should only use space for first class types!
 
@@ -1783,8 +1665,73 @@ static void WriteModuleUseLists(const Module *M, llvm_3_2::ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
+/// CollectFunctionIndexFlags - Set Flag for every name listed (as the first
+/// operand of each node) in the RS export metadata MDName.
+static void CollectFunctionIndexFlags(const Module *M, const char *MDName,
+                                      unsigned Flag,
+                                      StringMap<unsigned> &Flags) {
+  const NamedMDNode *NMD = M->getNamedMetadata(MDName);
+  if (!NMD)
+    return;
+  for (unsigned i = 0, e = NMD->getNumOperands(); i != e; ++i) {
+    const MDNode *N = NMD->getOperand(i);
+    if (N->getNumOperands() == 0)
+      continue;
+    if (const MDString *Name = dyn_cast_or_null<MDString>(N->getOperand(0)))
+      Flags[Name->getString()] |= Flag;
+  }
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX_BLOCK for the function bodies
+/// and global variables recorded while writing the module.
+static void WriteFunctionIndex(const Module *M, FunctionIndex &Index,
+                               uint64_t BitcodeStartBit,
+                               BitstreamWriter &Stream) {
+  StringMap<unsigned> Flags;
+  CollectFunctionIndexFlags(M, RS_EXPORT_FUNC_MN, llvm_3_2::FIF_ExportedFunc,
+                            Flags);
+  CollectFunctionIndexFlags(M, RS_EXPORT_FOREACH_NAME_MN,
+                            llvm_3_2::FIF_ForEachKernel, Flags);
+  CollectFunctionIndexFlags(M, RS_EXPORT_VAR_MN, llvm_3_2::FIF_ExportedVar,
+                            Flags);
+
+  Stream.EnterSubblock(llvm_3_2::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  // ENTRY: [kind, flags, bitoffset, bitsize, namechar x N]
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(llvm_3_2::FUNCTION_INDEX_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 1));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 3));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 64> Vals;
+  for (unsigned i = 0, e = Index.size(); i != e; ++i) {
+    llvm_3_2::FunctionIndexEntry &Entry = Index[i];
+    Entry.BitOffset -= BitcodeStartBit;
+    StringMap<unsigned>::const_iterator I = Flags.find(Entry.Name);
+    if (I != Flags.end())
+      Entry.Flags = I->getValue();
+
+    Vals.push_back(Entry.Kind);
+    Vals.push_back(Entry.Flags);
+    Vals.push_back(Entry.BitOffset);
+    Vals.push_back(Entry.BitSize);
+    for (unsigned j = 0, je = Entry.Name.size(); j != je; ++j)
+      Vals.push_back((unsigned char) Entry.Name[j]);
+    Stream.EmitRecord(llvm_3_2::FUNCTION_INDEX_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
 /// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        bool EmitFunctionIndex, uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   // Emit the version number if it is non-zero.
@@ -1797,6 +1744,9 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // Analyze the module, enumerating globals, functions, etc.
   llvm_3_2::ValueEnumerator VE(M);
 
+  FunctionIndex Index;
+  FunctionIndex *IndexToFill = EmitFunctionIndex ? &Index : NULL;
+
   // Emit blockinfo, which defines the standard abbreviations etc.
   WriteBlockInfo(VE, Stream);
 
@@ -1808,7 +1758,7 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
 
   // Emit top-level description of module, including target triple, inline asm,
   // descriptors for global variables, and function prototype info.
-  WriteModuleInfo(M, VE, Stream);
+  WriteModuleInfo(M, VE, Stream, IndexToFill);
 
   // Emit constants.
   WriteModuleConstants(VE, Stream);
@@ -1827,89 +1777,35 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
     WriteModuleUseLists(M, VE, Stream);
 
   // Emit function bodies.
-  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
-
-  Stream.ExitBlock();
-}
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
 
-/// EmitDarwinBCHeader - If generating a bc file on darwin, we have to emit a
-/// header and trailer to make it compatible with the system archiver.  To do
-/// this we emit the following header, and then emit a trailer that pads the
-/// file out to be a multiple of 16 bytes.
-///
-/// struct bc_header {
-///   uint32_t Magic;         // 0x0B17C0DE
-///   uint32_t Version;       // Version, currently always 0.
-///   uint32_t BitcodeOffset; // Offset to traditional bitcode file.
-///   uint32_t BitcodeSize;   // Size of traditional bitcode file.
-///   uint32_t CPUType;       // CPU specifier.
-///   ... potentially more later ...
-/// };
-enum {
-  DarwinBCSizeFieldOffset = 3*4, // Offset to bitcode_size.
-  DarwinBCHeaderSize = 5*4
-};
+    uint64_t BlockStart = Stream.GetCurrentBitNo();
+    WriteFunction(*F, VE, Stream);
+
+    if (IndexToFill) {
+      llvm_3_2::FunctionIndexEntry Entry;
+      Entry.Kind = llvm_3_2::FIK_Function;
+      Entry.Flags = 0;
+      Entry.BitOffset = BlockStart;
+      Entry.BitSize = Stream.GetCurrentBitNo() - BlockStart;
+      Entry.Name = F->getName().str();
+      IndexToFill->push_back(Entry);
+    }
+  }
 
-static void WriteInt32ToBuffer(uint32_t Value, SmallVectorImpl<char> &Buffer,
-                               uint32_t &Position) {
-  Buffer[Position + 0] = (unsigned char) (Value >>  0);
-  Buffer[Position + 1] = (unsigned char) (Value >>  8);
-  Buffer[Position + 2] = (unsigned char) (Value >> 16);
-  Buffer[Position + 3] = (unsigned char) (Value >> 24);
-  Position += 4;
-}
+  // Emit the function index last, once every offset is known.
+  if (IndexToFill)
+    WriteFunctionIndex(M, Index, BitcodeStartBit, Stream);
 
-static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
-                                         const Triple &TT) {
-  unsigned CPUType = ~0U;
-
-  // Match x86_64-*, i[3-9]86-*, powerpc-*, powerpc64-*, arm-*, thumb-*,
-  // armv[0-9]-*, thumbv[0-9]-*, armv5te-*, or armv6t2-*. The CPUType is a magic
-  // number from /usr/include/mach/machine.h.  It is ok to reproduce the
-  // specific constants here because they are implicitly part of the Darwin ABI.
-  enum {
-    DARWIN_CPU_ARCH_ABI64      = 0x01000000,
-    DARWIN_CPU_TYPE_X86        = 7,
-    DARWIN_CPU_TYPE_ARM        = 12,
-    DARWIN_CPU_TYPE_POWERPC    = 18
-  };
-
-  Triple::ArchType Arch = TT.getArch();
-  if (Arch == Triple::x86_64)
-    CPUType = DARWIN_CPU_TYPE_X86 | DARWIN_CPU_ARCH_ABI64;
-  else if (Arch == Triple::x86)
-    CPUType = DARWIN_CPU_TYPE_X86;
-  else if (Arch == Triple::ppc)
-    CPUType = DARWIN_CPU_TYPE_POWERPC;
-  else if (Arch == Triple::ppc64)
-    CPUType = DARWIN_CPU_TYPE_POWERPC | DARWIN_CPU_ARCH_ABI64;
-  else if (Arch == Triple::arm || Arch == Triple::thumb)
-    CPUType = DARWIN_CPU_TYPE_ARM;
-
-  // Traditional Bitcode starts after header.
-  assert(Buffer.size() >= DarwinBCHeaderSize &&
-         "Expected header size to be reserved");
-  unsigned BCOffset = DarwinBCHeaderSize;
-  unsigned BCSize = Buffer.size()-DarwinBCHeaderSize;
-
-  // Write the magic and version.
-  unsigned Position = 0;
-  WriteInt32ToBuffer(0x0B17C0DE , Buffer, Position);
-  WriteInt32ToBuffer(0          , Buffer, Position); // Version.
-  WriteInt32ToBuffer(BCOffset   , Buffer, Position);
-  WriteInt32ToBuffer(BCSize     , Buffer, Position);
-  WriteInt32ToBuffer(CPUType    , Buffer, Position);
-
-  // If the file is not a multiple of 16 bytes, insert dummy padding.
-  while (Buffer.size() & 15)
-    Buffer.push_back(0);
+  Stream.ExitBlock();
 }
 
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
-void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
+void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
+                                  bool EmitFunctionIndex) {
   SmallVector<char, 1024> Buffer;
   Buffer.reserve(256*1024);
 
@@ -1922,6 +1818,7 @@ void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -1932,7 +1829,7 @@ void llvm_3_2::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, Stream, EmitFunctionIndex, BitcodeStartBit);
   }
 
   if (TT.isOSDarwin())
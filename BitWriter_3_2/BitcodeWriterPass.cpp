@@ -18,15 +18,16 @@ using namespace llvm;
 namespace {
   class WriteBitcodePass : public ModulePass {
     raw_ostream &OS; // raw_ostream to print on
+    bool EmitFunctionIndex;
   public:
     static char ID; // Pass identification, replacement for typeid
-    explicit WriteBitcodePass(raw_ostream &o)
-      : ModulePass(ID), OS(o) {}
+    explicit WriteBitcodePass(raw_ostream &o, bool EmitIndex)
+      : ModulePass(ID), OS(o), EmitFunctionIndex(EmitIndex) {}
     
     const char *getPassName() const { return "Bitcode Writer"; }
     
     bool runOnModule(Module &M) {
-      llvm_3_2::WriteBitcodeToFile(&M, OS);
+      llvm_3_2::WriteBitcodeToFile(&M, OS, EmitFunctionIndex);
       return false;
     }
   };
@@ -36,6 +37,7 @@ char WriteBitcodePass::ID = 0;
 
 /// createBitcodeWriterPass - Create and return a pass that writes the module
 /// to the specified ostream.
-ModulePass *llvm_3_2::createBitcodeWriterPass(raw_ostream &Str) {
-  return new WriteBitcodePass(Str);
+ModulePass *llvm_3_2::createBitcodeWriterPass(raw_ostream &Str,
+                                              bool EmitFunctionIndex) {
+  return new WriteBitcodePass(Str, EmitFunctionIndex);
 }
@@ -0,0 +1,309 @@
+//===-- FunctionIndexReader.cpp - Read back the RS function index ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Host-side reader for the optional FUNCTION_INDEX_BLOCK written by
+// llvm_3_2::WriteBitcodeToFile, and a verifier that checks the index against
+// the layout of the module block it describes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ReaderWriter_3_2.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
+using namespace llvm;
+
+namespace {
+
+/// ModuleLayout - Where the module block actually put each global variable
+/// record and function body, as found by walking the bitstream.
+struct ModuleLayout {
+  struct Range {
+    uint64_t BitOffset;
+    uint64_t BitSize;
+    unsigned ValueID;
+  };
+
+  std::vector<Range> GlobalVars;
+  std::vector<Range> FunctionBodies;
+  DenseMap<unsigned, std::string> ValueNames;
+};
+
+}  // end anonymous namespace
+
+static bool Error(std::string *ErrMsg, const std::string &Message) {
+  if (ErrMsg)
+    *ErrMsg = Message;
+  return true;
+}
+
+static bool ReadIndexBlock(BitstreamCursor &Stream,
+                           std::vector<llvm_3_2::FunctionIndexEntry> &Index,
+                           std::string *ErrMsg) {
+  if (Stream.EnterSubBlock(llvm_3_2::FUNCTION_INDEX_BLOCK_ID))
+    return Error(ErrMsg, "Malformed function index block");
+
+  SmallVector<uint64_t, 64> Vals;
+  while (true) {
+    BitstreamEntry Entry = Stream.advance();
+    switch (Entry.Kind) {
+      case BitstreamEntry::EndBlock:
+        return false;
+      case BitstreamEntry::Record:
+        break;
+      default:
+        return Error(ErrMsg, "Malformed function index block");
+    }
+
+    Vals.clear();
+    if (Stream.readRecord(Entry.ID, Vals) != llvm_3_2::FUNCTION_INDEX_ENTRY)
+      continue;
+    if (Vals.size() < 4)
+      return Error(ErrMsg, "Invalid function index entry");
+
+    llvm_3_2::FunctionIndexEntry IE;
+    IE.Kind = Vals[0];
+    IE.Flags = Vals[1];
+    IE.BitOffset = Vals[2];
+    IE.BitSize = Vals[3];
+    for (unsigned i = 4, e = Vals.size(); i != e; ++i)
+      IE.Name += (char) Vals[i];
+    Index.push_back(IE);
+  }
+}
+
+static bool ReadValueSymbolTable(BitstreamCursor &Stream, ModuleLayout &Layout,
+                                 std::string *ErrMsg) {
+  if (Stream.EnterSubBlock(bitc::VALUE_SYMTAB_BLOCK_ID))
+    return Error(ErrMsg, "Malformed value symbol table block");
+
+  SmallVector<uint64_t, 64> Vals;
+  while (true) {
+    BitstreamEntry Entry = Stream.advance();
+    switch (Entry.Kind) {
+      case BitstreamEntry::EndBlock:
+        return false;
+      case BitstreamEntry::Record:
+        break;
+      default:
+        return Error(ErrMsg, "Malformed value symbol table block");
+    }
+
+    Vals.clear();
+    // VST_ENTRY: [valueid, namechar x N]
+    if (Stream.readRecord(Entry.ID, Vals) != bitc::VST_CODE_ENTRY ||
+        Vals.empty())
+      continue;
+    std::string &Name = Layout.ValueNames[Vals[0]];
+    for (unsigned i = 1, e = Vals.size(); i != e; ++i)
+      Name += (char) Vals[i];
+  }
+}
+
+/// ScanModule - Walk the module block of the bitcode in [BufPtr, BufEnd),
+/// filling in Layout (if non-null) and the function index (if present).
+static bool ScanModule(const unsigned char *BufPtr,
+                       const unsigned char *BufEnd,
+                       ModuleLayout *Layout,
+                       std::vector<llvm_3_2::FunctionIndexEntry> &Index,
+                       bool &FoundIndex,
+                       std::string *ErrMsg) {
+  FoundIndex = false;
+
+  unsigned char *Ptr = const_cast<unsigned char*>(BufPtr);
+  unsigned char *End = const_cast<unsigned char*>(BufEnd);
+  if (llvm_3_2::isBitcodeWrapper(Ptr, End) &&
+      llvm_3_2::SkipBitcodeWrapperHeader(Ptr, End))
+    return Error(ErrMsg, "Invalid bitcode wrapper header");
+  if (!llvm_3_2::isRawBitcode(Ptr, End))
+    return Error(ErrMsg, "Invalid bitcode signature");
+
+  BitstreamReader Reader(Ptr, End);
+  BitstreamCursor Stream(Reader);
+
+  // Skip the 'BC' 0xC0DE magic.
+  Stream.Read(16);
+  Stream.Read(16);
+
+  while (!Stream.AtEndOfStream()) {
+    BitstreamEntry Entry = Stream.advance();
+    if (Entry.Kind != BitstreamEntry::SubBlock)
+      return Error(ErrMsg, "Malformed bitcode");
+    if (Entry.ID != bitc::MODULE_BLOCK_ID) {
+      if (Stream.SkipBlock())
+        return Error(ErrMsg, "Malformed bitcode");
+      continue;
+    }
+    if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+      return Error(ErrMsg, "Malformed module block");
+
+    unsigned NextValueID = 0;
+    SmallVector<uint64_t, 64> Vals;
+    // Value IDs of the functions that have bodies, in module order.
+    std::vector<unsigned> DefinedFunctions;
+    while (true) {
+      // Abbreviations are processed by hand so that EntryStart is exactly
+      // where the next block or record begins.
+      uint64_t EntryStart = Stream.GetCurrentBitNo();
+      Entry = Stream.advance(BitstreamCursor::AF_DontAutoprocessAbbrevs);
+
+      if (Entry.Kind == BitstreamEntry::EndBlock)
+        return false;
+      if (Entry.Kind == BitstreamEntry::Error)
+        return Error(ErrMsg, "Malformed module block");
+
+      if (Entry.Kind == BitstreamEntry::SubBlock) {
+        bool Failed = false;
+        switch (Entry.ID) {
+          case bitc::BLOCKINFO_BLOCK_ID:
+            // The value symbol table uses abbreviations from here.
+            Failed = Stream.ReadBlockInfoBlock();
+            break;
+          case bitc::VALUE_SYMTAB_BLOCK_ID:
+            if (Layout) {
+              if (ReadValueSymbolTable(Stream, *Layout, ErrMsg))
+                return true;
+            } else {
+              Failed = Stream.SkipBlock();
+            }
+            break;
+          case bitc::FUNCTION_BLOCK_ID: {
+            Failed = Stream.SkipBlock();
+            if (Layout && !Failed) {
+              unsigned Body = Layout->FunctionBodies.size();
+              if (Body >= DefinedFunctions.size())
+                return Error(ErrMsg, "Function body without a prototype");
+              ModuleLayout::Range R;
+              R.BitOffset = EntryStart;
+              R.BitSize = Stream.GetCurrentBitNo() - EntryStart;
+              R.ValueID = DefinedFunctions[Body];
+              Layout->FunctionBodies.push_back(R);
+            }
+            break;
+          }
+          case llvm_3_2::FUNCTION_INDEX_BLOCK_ID:
+            if (ReadIndexBlock(Stream, Index, ErrMsg))
+              return true;
+            FoundIndex = true;
+            break;
+          default:
+            Failed = Stream.SkipBlock();
+            break;
+        }
+        if (Failed)
+          return Error(ErrMsg, "Malformed block in module");
+        continue;
+      }
+
+      // A record in the module block.
+      if (Entry.ID == bitc::DEFINE_ABBREV) {
+        Stream.ReadAbbrevRecord();
+        continue;
+      }
+
+      Vals.clear();
+      unsigned Code = Stream.readRecord(Entry.ID, Vals);
+      switch (Code) {
+        case bitc::MODULE_CODE_GLOBALVAR: {
+          if (Layout) {
+            ModuleLayout::Range R;
+            R.BitOffset = EntryStart;
+            R.BitSize = Stream.GetCurrentBitNo() - EntryStart;
+            R.ValueID = NextValueID;
+            Layout->GlobalVars.push_back(R);
+          }
+          NextValueID++;
+          break;
+        }
+        case bitc::MODULE_CODE_FUNCTION: {
+          // FUNCTION: [type, callingconv, isproto, ...]
+          if (Vals.size() < 3)
+            return Error(ErrMsg, "Invalid function record");
+          if (!Vals[2])
+            DefinedFunctions.push_back(NextValueID);
+          NextValueID++;
+          break;
+        }
+        case bitc::MODULE_CODE_ALIAS:
+          NextValueID++;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  return Error(ErrMsg, "No module block in bitcode");
+}
+
+bool llvm_3_2::ReadFunctionIndex(const unsigned char *BufPtr,
+                                 const unsigned char *BufEnd,
+                                 std::vector<FunctionIndexEntry> &Index,
+                                 std::string *ErrMsg) {
+  bool FoundIndex;
+  if (ScanModule(BufPtr, BufEnd, NULL, Index, FoundIndex, ErrMsg))
+    return true;
+  if (!FoundIndex)
+    return Error(ErrMsg, "Bitcode has no function index");
+  return false;
+}
+
+/// CheckRanges - Compare the index entries of the given kind, in order, with
+/// the ranges found in the bitstream.
+static bool CheckRanges(const std::vector<llvm_3_2::FunctionIndexEntry> &Index,
+                        unsigned Kind,
+                        const std::vector<ModuleLayout::Range> &Ranges,
+                        const ModuleLayout &Layout,
+                        std::string *ErrMsg) {
+  const char *What = (Kind == llvm_3_2::FIK_Function) ? "function"
+                                                      : "global variable";
+  unsigned Next = 0;
+  for (unsigned i = 0, e = Index.size(); i != e; ++i) {
+    const llvm_3_2::FunctionIndexEntry &IE = Index[i];
+    if (IE.Kind != Kind)
+      continue;
+    if (Next >= Ranges.size())
+      return Error(ErrMsg, std::string("Index lists more ") + What +
+                           "s than the module has (" + IE.Name + ")");
+
+    const ModuleLayout::Range &R = Ranges[Next++];
+    if (IE.BitOffset != R.BitOffset || IE.BitSize != R.BitSize)
+      return Error(ErrMsg, std::string("Wrong offset or size for ") + What +
+                           " " + IE.Name);
+
+    DenseMap<unsigned, std::string>::const_iterator I =
+        Layout.ValueNames.find(R.ValueID);
+    std::string Name = (I != Layout.ValueNames.end()) ? I->second : "";
+    if (Name != IE.Name)
+      return Error(ErrMsg, std::string("Index entry ") + IE.Name +
+                           " points at " + What + " '" + Name + "'");
+  }
+
+  if (Next != Ranges.size())
+    return Error(ErrMsg, std::string("Index is missing some ") + What + "s");
+  return false;
+}
+
+bool llvm_3_2::VerifyFunctionIndex(const unsigned char *BufPtr,
+                                   const unsigned char *BufEnd,
+                                   std::string *ErrMsg) {
+  ModuleLayout Layout;
+  std::vector<FunctionIndexEntry> Index;
+  bool FoundIndex;
+  if (ScanModule(BufPtr, BufEnd, &Layout, Index, FoundIndex, ErrMsg))
+    return true;
+  if (!FoundIndex)
+    return Error(ErrMsg, "Bitcode has no function index");
+
+  if (CheckRanges(Index, FIK_Function, Layout.FunctionBodies, Layout, ErrMsg))
+    return true;
+  return CheckRanges(Index, FIK_GlobalVariable, Layout.GlobalVars, Layout,
+                     ErrMsg);
+}
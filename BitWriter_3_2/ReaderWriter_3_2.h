@@ -14,7 +14,9 @@
 #ifndef LLVM_BITCODE_3_2_H
 #define LLVM_BITCODE_3_2_H
 
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace llvm {
   class Module;
@@ -53,11 +55,69 @@ namespace llvm_3_2 {
   /// WriteBitcodeToFile - Write the specified module to the specified
   /// raw output stream.  For streams where it matters, the given stream
   /// should be in "binary" mode.
-  void WriteBitcodeToFile(const llvm::Module *M, llvm::raw_ostream &Out);
+  /// If EmitFunctionIndex is set, a FUNCTION_INDEX_BLOCK is appended to the
+  /// module block (see below).
+  void WriteBitcodeToFile(const llvm::Module *M, llvm::raw_ostream &Out,
+                          bool EmitFunctionIndex = false);
 
   /// createBitcodeWriterPass - Create and return a pass that writes the module
   /// to the specified ostream.
-  llvm::ModulePass *createBitcodeWriterPass(llvm::raw_ostream &Str);
+  llvm::ModulePass *createBitcodeWriterPass(llvm::raw_ostream &Str,
+                                            bool EmitFunctionIndex = false);
+
+  /// The function index is an optional sub-block at the end of the
+  /// MODULE_BLOCK. It maps every function body and global variable record to
+  /// its position in the bitstream so that a loader can jump straight to the
+  /// functions it needs. Readers that do not know the block ID skip it.
+  ///
+  /// Offsets and sizes are in bits, counted from the start of the raw
+  /// bitcode (the 'BC' magic), not from the start of any wrapper header. For a
+  /// function the range covers its whole FUNCTION_BLOCK, starting at the
+  /// ENTER_SUBBLOCK abbreviation ID; for a global variable it covers its
+  /// MODULE_CODE_GLOBALVAR record.
+  enum {
+    FUNCTION_INDEX_BLOCK_ID = 100
+  };
+
+  enum FunctionIndexCodes {
+    // ENTRY: [kind, flags, bitoffset, bitsize, namechar x N]
+    FUNCTION_INDEX_ENTRY = 1
+  };
+
+  enum FunctionIndexKind {
+    FIK_Function = 0,
+    FIK_GlobalVariable = 1
+  };
+
+  enum FunctionIndexFlags {
+    FIF_ExportedFunc = 1 << 0,    // Listed in #rs_export_func
+    FIF_ForEachKernel = 1 << 1,   // Listed in #rs_export_foreach_name
+    FIF_ExportedVar = 1 << 2      // Listed in #rs_export_var
+  };
+
+  struct FunctionIndexEntry {
+    unsigned Kind;
+    unsigned Flags;
+    uint64_t BitOffset;
+    uint64_t BitSize;
+    std::string Name;
+  };
+
+  /// ReadFunctionIndex - Find the FUNCTION_INDEX_BLOCK in the given (raw or
+  /// wrapped) bitcode and decode it into Index. Returns true on error, or if
+  /// the bitcode carries no index, and fills in *ErrMsg if it is non-null.
+  bool ReadFunctionIndex(const unsigned char *BufPtr,
+                         const unsigned char *BufEnd,
+                         std::vector<FunctionIndexEntry> &Index,
+                         std::string *ErrMsg = 0);
+
+  /// VerifyFunctionIndex - Read the function index of the given bitcode and
+  /// check that every entry points at what it claims to: a FUNCTION_BLOCK of
+  /// exactly the recorded size, or a single MODULE_CODE_GLOBALVAR record.
+  /// Returns true on error and fills in *ErrMsg if it is non-null.
+  bool VerifyFunctionIndex(const unsigned char *BufPtr,
+                           const unsigned char *BufEnd,
+                           std::string *ErrMsg = 0);
 
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
@@ -0,0 +1,353 @@
+//===-- BitWriter_common/BitcodeWriterCommon.h - Shared code --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Encoding helpers and blocks that are identical in every versioned bitcode
+// writer. Code that differs between bitcode versions stays in each writer's
+// BitcodeWriter.cpp.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef BITWRITER_COMMON_BITCODE_WRITER_COMMON_H
+#define BITWRITER_COMMON_BITCODE_WRITER_COMMON_H
+
+#include "ValueEnumerator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <vector>
+
+namespace bitwriter_common {
+
+/// VALUE_SYMTAB_BLOCK abbrev id's. Every writer registers these abbrevs in
+/// its BLOCKINFO block in this order.
+enum {
+  VST_ENTRY_8_ABBREV = llvm::bitc::FIRST_APPLICATION_ABBREV,
+  VST_ENTRY_7_ABBREV,
+  VST_ENTRY_6_ABBREV,
+  VST_BBENTRY_6_ABBREV
+};
+
+inline unsigned GetEncodedCastOpcode(unsigned Opcode) {
+  switch (Opcode) {
+  default: llvm_unreachable("Unknown cast instruction!");
+  case llvm::Instruction::Trunc   : return llvm::bitc::CAST_TRUNC;
+  case llvm::Instruction::ZExt    : return llvm::bitc::CAST_ZEXT;
+  case llvm::Instruction::SExt    : return llvm::bitc::CAST_SEXT;
+  case llvm::Instruction::FPToUI  : return llvm::bitc::CAST_FPTOUI;
+  case llvm::Instruction::FPToSI  : return llvm::bitc::CAST_FPTOSI;
+  case llvm::Instruction::UIToFP  : return llvm::bitc::CAST_UITOFP;
+  case llvm::Instruction::SIToFP  : return llvm::bitc::CAST_SITOFP;
+  case llvm::Instruction::FPTrunc : return llvm::bitc::CAST_FPTRUNC;
+  case llvm::Instruction::FPExt   : return llvm::bitc::CAST_FPEXT;
+  case llvm::Instruction::PtrToInt: return llvm::bitc::CAST_PTRTOINT;
+  case llvm::Instruction::IntToPtr: return llvm::bitc::CAST_INTTOPTR;
+  case llvm::Instruction::BitCast : return llvm::bitc::CAST_BITCAST;
+  }
+}
+
+inline unsigned GetEncodedBinaryOpcode(unsigned Opcode) {
+  switch (Opcode) {
+  default: llvm_unreachable("Unknown binary instruction!");
+  case llvm::Instruction::Add:
+  case llvm::Instruction::FAdd: return llvm::bitc::BINOP_ADD;
+  case llvm::Instruction::Sub:
+  case llvm::Instruction::FSub: return llvm::bitc::BINOP_SUB;
+  case llvm::Instruction::Mul:
+  case llvm::Instruction::FMul: return llvm::bitc::BINOP_MUL;
+  case llvm::Instruction::UDiv: return llvm::bitc::BINOP_UDIV;
+  case llvm::Instruction::FDiv:
+  case llvm::Instruction::SDiv: return llvm::bitc::BINOP_SDIV;
+  case llvm::Instruction::URem: return llvm::bitc::BINOP_UREM;
+  case llvm::Instruction::FRem:
+  case llvm::Instruction::SRem: return llvm::bitc::BINOP_SREM;
+  case llvm::Instruction::Shl:  return llvm::bitc::BINOP_SHL;
+  case llvm::Instruction::LShr: return llvm::bitc::BINOP_LSHR;
+  case llvm::Instruction::AShr: return llvm::bitc::BINOP_ASHR;
+  case llvm::Instruction::And:  return llvm::bitc::BINOP_AND;
+  case llvm::Instruction::Or:   return llvm::bitc::BINOP_OR;
+  case llvm::Instruction::Xor:  return llvm::bitc::BINOP_XOR;
+  }
+}
+
+inline unsigned GetEncodedRMWOperation(llvm::AtomicRMWInst::BinOp Op) {
+  switch (Op) {
+  default: llvm_unreachable("Unknown RMW operation!");
+  case llvm::AtomicRMWInst::Xchg: return llvm::bitc::RMW_XCHG;
+  case llvm::AtomicRMWInst::Add: return llvm::bitc::RMW_ADD;
+  case llvm::AtomicRMWInst::Sub: return llvm::bitc::RMW_SUB;
+  case llvm::AtomicRMWInst::And: return llvm::bitc::RMW_AND;
+  case llvm::AtomicRMWInst::Nand: return llvm::bitc::RMW_NAND;
+  case llvm::AtomicRMWInst::Or: return llvm::bitc::RMW_OR;
+  case llvm::AtomicRMWInst::Xor: return llvm::bitc::RMW_XOR;
+  case llvm::AtomicRMWInst::Max: return llvm::bitc::RMW_MAX;
+  case llvm::AtomicRMWInst::Min: return llvm::bitc::RMW_MIN;
+  case llvm::AtomicRMWInst::UMax: return llvm::bitc::RMW_UMAX;
+  case llvm::AtomicRMWInst::UMin: return llvm::bitc::RMW_UMIN;
+  }
+}
+
+inline void WriteStringRecord(unsigned Code, llvm::StringRef Str,
+                              unsigned AbbrevToUse,
+                              llvm::BitstreamWriter &Stream) {
+  llvm::SmallVector<unsigned, 64> Vals;
+
+  // Code: [strchar x N]
+  for (unsigned i = 0, e = Str.size(); i != e; ++i) {
+    if (AbbrevToUse && !llvm::BitCodeAbbrevOp::isChar6(Str[i]))
+      AbbrevToUse = 0;
+    Vals.push_back(Str[i]);
+  }
+
+  // Emit the finished record.
+  Stream.EmitRecord(Code, Vals, AbbrevToUse);
+}
+
+template <typename Traits>
+void WriteAttributeTable(const ValueEnumerator<Traits> &VE,
+                         llvm::BitstreamWriter &Stream) {
+  const std::vector<llvm::AttributeSet> &Attrs = VE.getAttributes();
+  if (Attrs.empty()) return;
+
+  Stream.EnterSubblock(llvm::bitc::PARAMATTR_BLOCK_ID, 3);
+
+  llvm::SmallVector<uint64_t, 64> Record;
+  for (unsigned i = 0, e = Attrs.size(); i != e; ++i) {
+    const llvm::AttributeSet &A = Attrs[i];
+    for (unsigned i = 0, e = A.getNumSlots(); i != e; ++i)
+      Record.push_back(VE.getAttributeGroupID(A.getSlotAttributes(i)));
+
+    Stream.EmitRecord(llvm::bitc::PARAMATTR_CODE_ENTRY, Record);
+    Record.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+inline unsigned getEncodedLinkage(const llvm::GlobalValue *GV) {
+  switch (GV->getLinkage()) {
+  case llvm::GlobalValue::ExternalLinkage:          return 0;
+  case llvm::GlobalValue::WeakAnyLinkage:           return 1;
+  case llvm::GlobalValue::AppendingLinkage:         return 2;
+  case llvm::GlobalValue::InternalLinkage:          return 3;
+  case llvm::GlobalValue::LinkOnceAnyLinkage:       return 4;
+  case llvm::GlobalValue::DLLImportLinkage:         return 5;
+  case llvm::GlobalValue::DLLExportLinkage:         return 6;
+  case llvm::GlobalValue::ExternalWeakLinkage:      return 7;
+  case llvm::GlobalValue::CommonLinkage:            return 8;
+  case llvm::GlobalValue::PrivateLinkage:           return 9;
+  case llvm::GlobalValue::WeakODRLinkage:           return 10;
+  case llvm::GlobalValue::LinkOnceODRLinkage:       return 11;
+  case llvm::GlobalValue::AvailableExternallyLinkage: return 12;
+  case llvm::GlobalValue::LinkerPrivateLinkage:     return 13;
+  case llvm::GlobalValue::LinkerPrivateWeakLinkage: return 14;
+  case llvm::GlobalValue::LinkOnceODRAutoHideLinkage: return 15;
+  }
+  llvm_unreachable("Invalid linkage");
+}
+
+inline unsigned getEncodedVisibility(const llvm::GlobalValue *GV) {
+  switch (GV->getVisibility()) {
+  case llvm::GlobalValue::DefaultVisibility:   return 0;
+  case llvm::GlobalValue::HiddenVisibility:    return 1;
+  case llvm::GlobalValue::ProtectedVisibility: return 2;
+  }
+  llvm_unreachable("Invalid visibility");
+}
+
+inline void WriteModuleMetadataStore(const llvm::Module *M,
+                                     llvm::BitstreamWriter &Stream) {
+  llvm::SmallVector<uint64_t, 64> Record;
+
+  // Write metadata kinds
+  // METADATA_KIND - [n x [id, name]]
+  llvm::SmallVector<llvm::StringRef, 4> Names;
+  M->getMDKindNames(Names);
+
+  if (Names.empty()) return;
+
+  Stream.EnterSubblock(llvm::bitc::METADATA_BLOCK_ID, 3);
+
+  for (unsigned MDKindID = 0, e = Names.size(); MDKindID != e; ++MDKindID) {
+    Record.push_back(MDKindID);
+    llvm::StringRef KName = Names[MDKindID];
+    Record.append(KName.begin(), KName.end());
+
+    Stream.EmitRecord(llvm::bitc::METADATA_KIND, Record, 0);
+    Record.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+/// PushValueAndType - The file has to encode both the value and type id for
+/// many values, because we need to know what type to create for forward
+/// references.  However, most operands are not forward references, so this type
+/// field is not needed.
+///
+/// This function adds V's value ID to Vals.  If the value ID is higher than the
+/// instruction ID, then it is a forward reference, and it also includes the
+/// type ID.
+template <typename Traits>
+bool PushValueAndType(const llvm::Value *V, unsigned InstID,
+                      llvm::SmallVector<unsigned, 64> &Vals,
+                      ValueEnumerator<Traits> &VE) {
+  unsigned ValID = VE.getValueID(V);
+  Vals.push_back(ValID);
+  if (ValID >= InstID) {
+    Vals.push_back(VE.getTypeID(V->getType()));
+    return true;
+  }
+  return false;
+}
+
+template <typename Traits>
+void WriteValueSymbolTable(const llvm::ValueSymbolTable &VST,
+                           const ValueEnumerator<Traits> &VE,
+                           llvm::BitstreamWriter &Stream) {
+  if (VST.empty()) return;
+  Stream.EnterSubblock(llvm::bitc::VALUE_SYMTAB_BLOCK_ID, 4);
+
+  // FIXME: Set up the abbrev, we know how many values there are!
+  // FIXME: We know if the type names can use 7-bit ascii.
+  llvm::SmallVector<unsigned, 64> NameVals;
+
+  for (llvm::ValueSymbolTable::const_iterator SI = VST.begin(),
+           SE = VST.end();
+       SI != SE; ++SI) {
+
+    const llvm::ValueName &Name = *SI;
+
+    // Figure out the encoding to use for the name.
+    bool is7Bit = true;
+    bool isChar6 = true;
+    for (const char *C = Name.getKeyData(), *E = C+Name.getKeyLength();
+         C != E; ++C) {
+      if (isChar6)
+        isChar6 = llvm::BitCodeAbbrevOp::isChar6(*C);
+      if ((unsigned char)*C & 128) {
+        is7Bit = false;
+        break;  // don't bother scanning the rest.
+      }
+    }
+
+    unsigned AbbrevToUse = VST_ENTRY_8_ABBREV;
+
+    // VST_ENTRY:   [valueid, namechar x N]
+    // VST_BBENTRY: [bbid, namechar x N]
+    unsigned Code;
+    if (llvm::isa<llvm::BasicBlock>(SI->getValue())) {
+      Code = llvm::bitc::VST_CODE_BBENTRY;
+      if (isChar6)
+        AbbrevToUse = VST_BBENTRY_6_ABBREV;
+    } else {
+      Code = llvm::bitc::VST_CODE_ENTRY;
+      if (isChar6)
+        AbbrevToUse = VST_ENTRY_6_ABBREV;
+      else if (is7Bit)
+        AbbrevToUse = VST_ENTRY_7_ABBREV;
+    }
+
+    NameVals.push_back(VE.getValueID(SI->getValue()));
+    for (const char *P = Name.getKeyData(),
+         *E = Name.getKeyData()+Name.getKeyLength(); P != E; ++P)
+      NameVals.push_back((unsigned char)*P);
+
+    // Emit the finished record.
+    Stream.EmitRecord(Code, NameVals, AbbrevToUse);
+    NameVals.clear();
+  }
+  Stream.ExitBlock();
+}
+
+/// EmitDarwinBCHeader - If generating a bc file on darwin, we have to emit a
+/// header and trailer to make it compatible with the system archiver.  To do
+/// this we emit the following header, and then emit a trailer that pads the
+/// file out to be a multiple of 16 bytes.
+///
+/// struct bc_header {
+///   uint32_t Magic;         // 0x0B17C0DE
+///   uint32_t Version;       // Version, currently always 0.
+///   uint32_t BitcodeOffset; // Offset to traditional bitcode file.
+///   uint32_t BitcodeSize;   // Size of traditional bitcode file.
+///   uint32_t CPUType;       // CPU specifier.
+///   ... potentially more later ...
+/// };
+enum {
+  DarwinBCSizeFieldOffset = 3*4, // Offset to bitcode_size.
+  DarwinBCHeaderSize = 5*4
+};
+
+inline void WriteInt32ToBuffer(uint32_t Value,
+                               llvm::SmallVectorImpl<char> &Buffer,
+                               uint32_t &Position) {
+  Buffer[Position + 0] = (unsigned char) (Value >>  0);
+  Buffer[Position + 1] = (unsigned char) (Value >>  8);
+  Buffer[Position + 2] = (unsigned char) (Value >> 16);
+  Buffer[Position + 3] = (unsigned char) (Value >> 24);
+  Position += 4;
+}
+
+inline void EmitDarwinBCHeaderAndTrailer(llvm::SmallVectorImpl<char> &Buffer,
+                                         const llvm::Triple &TT) {
+  unsigned CPUType = ~0U;
+
+  // Match x86_64-*, i[3-9]86-*, powerpc-*, powerpc64-*, arm-*, thumb-*,
+  // armv[0-9]-*, thumbv[0-9]-*, armv5te-*, or armv6t2-*. The CPUType is a magic
+  // number from /usr/include/mach/machine.h.  It is ok to reproduce the
+  // specific constants here because they are implicitly part of the Darwin ABI.
+  enum {
+    DARWIN_CPU_ARCH_ABI64      = 0x01000000,
+    DARWIN_CPU_TYPE_X86        = 7,
+    DARWIN_CPU_TYPE_ARM        = 12,
+    DARWIN_CPU_TYPE_POWERPC    = 18
+  };
+
+  llvm::Triple::ArchType Arch = TT.getArch();
+  if (Arch == llvm::Triple::x86_64)
+    CPUType = DARWIN_CPU_TYPE_X86 | DARWIN_CPU_ARCH_ABI64;
+  else if (Arch == llvm::Triple::x86)
+    CPUType = DARWIN_CPU_TYPE_X86;
+  else if (Arch == llvm::Triple::ppc)
+    CPUType = DARWIN_CPU_TYPE_POWERPC;
+  else if (Arch == llvm::Triple::ppc64)
+    CPUType = DARWIN_CPU_TYPE_POWERPC | DARWIN_CPU_ARCH_ABI64;
+  else if (Arch == llvm::Triple::arm || Arch == llvm::Triple::thumb)
+    CPUType = DARWIN_CPU_TYPE_ARM;
+
+  // Traditional Bitcode starts after header.
+  assert(Buffer.size() >= DarwinBCHeaderSize &&
+         "Expected header size to be reserved");
+  unsigned BCOffset = DarwinBCHeaderSize;
+  unsigned BCSize = Buffer.size()-DarwinBCHeaderSize;
+
+  // Write the magic and version.
+  unsigned Position = 0;
+  WriteInt32ToBuffer(0x0B17C0DE , Buffer, Position);
+  WriteInt32ToBuffer(0          , Buffer, Position); // Version.
+  WriteInt32ToBuffer(BCOffset   , Buffer, Position);
+  WriteInt32ToBuffer(BCSize     , Buffer, Position);
+  WriteInt32ToBuffer(CPUType    , Buffer, Position);
+
+  // If the file is not a multiple of 16 bytes, insert dummy padding.
+  while (Buffer.size() & 15)
+    Buffer.push_back(0);
+}
+
+}  // end bitwriter_common namespace
+
+#endif  // BITWRITER_COMMON_BITCODE_WRITER_COMMON_H
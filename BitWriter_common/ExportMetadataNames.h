@@ -0,0 +1,27 @@
+//===-- BitWriter_common/ExportMetadataNames.h - RS MD names --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Names of the named metadata that list the exported functions, kernels and
+// variables of a Renderscript module. The bitcode writers read them to flag
+// the entries of the FUNCTION_INDEX_BLOCK; slang_rs_metadata.h includes this
+// file so that the front end emits the same names.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef BITWRITER_COMMON_EXPORT_METADATA_NAMES_H
+#define BITWRITER_COMMON_EXPORT_METADATA_NAMES_H
+
+// MN stands for "metadata name"
+#define RS_EXPORT_VAR_MN  "#rs_export_var"
+
+#define RS_EXPORT_FUNC_MN "#rs_export_func"
+
+#define RS_EXPORT_FOREACH_NAME_MN "#rs_export_foreach_name"
+
+#endif  // BITWRITER_COMMON_EXPORT_METADATA_NAMES_H
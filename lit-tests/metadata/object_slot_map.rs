@@ -0,0 +1,28 @@
+// RUN: %Slang -emit-object-slot-map %s
+// RUN: %FileCheck %s -check-prefix=MAP -input-file %OutDir/object_slot_map.ll
+// RUN: %Slang %s
+// RUN: %FileCheck %s -check-prefix=LEGACY -input-file %OutDir/object_slot_map.ll
+
+// At the default target API (above 18), -emit-object-slot-map replaces the
+// per-slot #rs_object_slots nodes with the single compact map:
+// !{i32 Encoding, i32 NumVars, <data>}. gIn and gOut are slots 0 and 2 of
+// the 3 exported variables, so the bitmap (encoding 0) is the byte 0x05.
+// The '#' of the names is printed escaped, as \23.
+// MAP-NOT: rs_object_slots =
+// MAP: rs_object_slot_map = !{![[MAP:[0-9]+]]}
+// MAP-NOT: rs_object_slots =
+// MAP: ![[MAP]] = metadata !{i32 0, i32 3, metadata !"\05"}
+
+// Without the flag, the slots are still emitted in the legacy form.
+// LEGACY-NOT: rs_object_slot_map =
+// LEGACY: rs_object_slots = !{![[S0:[0-9]+]], ![[S1:[0-9]+]]}
+// LEGACY-NOT: rs_object_slot_map =
+// LEGACY: ![[S0]] = metadata !{metadata !"0"}
+// LEGACY: ![[S1]] = metadata !{metadata !"2"}
+
+#pragma version(1)
+#pragma rs java_package_name(object_slot_map)
+
+rs_allocation gIn;
+int gCount;
+rs_allocation gOut;
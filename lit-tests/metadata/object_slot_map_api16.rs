@@ -0,0 +1,18 @@
+// RUN: %Slang -emit-object-slot-map -target-api 16 %s
+// RUN: %FileCheck %s -input-file %OutDir/object_slot_map_api16.ll
+
+// Runtimes up to API 18 only read the legacy #rs_object_slots, so at API 16
+// -emit-object-slot-map is ignored: the per-slot nodes are emitted and the
+// compact map is not. The '#' of the names is printed escaped, as \23.
+// CHECK-NOT: rs_object_slot_map =
+// CHECK: rs_object_slots = !{![[S0:[0-9]+]], ![[S1:[0-9]+]]}
+// CHECK-NOT: rs_object_slot_map =
+// CHECK: ![[S0]] = metadata !{metadata !"0"}
+// CHECK: ![[S1]] = metadata !{metadata !"2"}
+
+#pragma version(1)
+#pragma rs java_package_name(object_slot_map_api16)
+
+rs_allocation gIn;
+int gCount;
+rs_allocation gOut;
@@ -0,0 +1,9 @@
+#pragma version(1)
+#pragma rs java_package_name(odr_inputs)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point;
+
+Point gPoint;
@@ -0,0 +1,22 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %Slang -odr-type-db %t/types.db %S/Inputs/point_float.rs
+// RUN: %Slang -odr-type-db %t/types.db %s 2> %t/err || true
+// RUN: %FileCheck %s -input-file %t/err
+// RUN: %FileCheck %s -check-prefix=DB -input-file %t/types.db
+
+// CHECK: error: type 'Point' in different translation unit ({{.*}}conflict.rs v.s. {{/.*}}/Inputs/point_float.rs) has incompatible type definition
+
+// The database is left as it was.
+// DB: # llvm-rs-cc ODR type database 2
+// DB-NEXT: Point {{/.*}}/Inputs/point_float.rs
+// DB-NOT: conflict.rs
+
+#pragma version(1)
+#pragma rs java_package_name(odr_conflict)
+
+typedef struct Point {
+  int x;
+  int y;
+} Point;
+
+Point gOrigin;
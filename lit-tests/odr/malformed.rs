@@ -0,0 +1,21 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %S/Inputs/malformed.db %t/types.db
+// RUN: %Slang -odr-type-db %t/types.db %s 2> %t/err || true
+// RUN: %FileCheck %s -input-file %t/err
+// RUN: %FileCheck %s -check-prefix=DB -input-file %t/types.db
+
+// CHECK: error: cannot update the type database '{{.*}}/types.db': malformed line 2
+
+// The database is left as it was.
+// DB: this is not an entry
+// DB-NOT: malformed.rs
+
+#pragma version(1)
+#pragma rs java_package_name(odr_malformed)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point;
+
+Point gOrigin;
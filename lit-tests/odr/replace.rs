@@ -0,0 +1,25 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %S/Inputs/point_float.rs %t/point.rs
+// RUN: %Slang -odr-type-db %t/types.db %t/point.rs
+// RUN: cp %S/Inputs/point_int.rs %t/point.rs
+// RUN: %Slang -odr-type-db %t/types.db %t/point.rs
+// RUN: %Slang -odr-type-db %t/types.db %s
+// RUN: %FileCheck %s -input-file %t/types.db
+// RUN: test ! -e %t/types.db.tmp
+
+// Recompiling point.rs replaces its entry, even though Point changed, and
+// this file shares the database with it.
+// CHECK: # llvm-rs-cc ODR type database 2
+// CHECK-NEXT: {{[0-9a-f]+}} {{[0-9]+}} Point {{/.*}}/point.rs
+// CHECK-NEXT: {{[0-9a-f]+}} {{[0-9]+}} Point {{/.*}}/replace.rs
+// CHECK-NOT: Point
+
+#pragma version(1)
+#pragma rs java_package_name(odr_replace)
+
+typedef struct Point {
+  int x;
+  int y;
+} Point;
+
+Point gOrigin;
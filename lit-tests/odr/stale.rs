@@ -0,0 +1,21 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %S/Inputs/stale.db %t/types.db
+// RUN: %Slang -odr-type-db %t/types.db %s
+// RUN: %FileCheck %s -input-file %t/types.db
+
+// The entry of removed.rs conflicts, but the file is gone, so the entry is
+// dropped without being checked.
+// CHECK: # llvm-rs-cc ODR type database 2
+// CHECK-NOT: removed.rs
+// CHECK: Point {{/.*}}/stale.rs
+// CHECK-NOT: removed.rs
+
+#pragma version(1)
+#pragma rs java_package_name(odr_stale)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point;
+
+Point gOrigin;
@@ -0,0 +1,125 @@
+// RUN: %Slang -O 0 %s
+// RUN: %FileCheck %s -check-prefix=REFCOUNTED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=DEADCOUNTED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=UNUSEDCOUNTED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=ESCAPES -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=ESCAPEDSTORE -input-file %OutDir/elision.ll
+// RUN: %Slang -O 0 -elide-redundant-refcount %s
+// RUN: %FileCheck %s -check-prefix=BORROWED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=DEADELIDED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=UNUSEDELIDED -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=ESCAPES -input-file %OutDir/elision.ll
+// RUN: %FileCheck %s -check-prefix=ESCAPEDSTORE -input-file %OutDir/elision.ll
+
+// Each function is checked by its own FileCheck run, as the order in which
+// they are emitted is up to clang.
+
+// Without the flag, 'copy' takes and drops its own reference.
+// REFCOUNTED: define internal i32 @count(
+// REFCOUNTED: call void @_Z{{[0-9]+}}rsSetObject
+// REFCOUNTED-NOT: rs{{Set|Clear}}Object
+// REFCOUNTED: call void @_Z{{[0-9]+}}rsClearObject
+// REFCOUNTED-NOT: rs{{Set|Clear}}Object
+// REFCOUNTED: ret i32
+
+// With it, 'copy' borrows the reference of 'a', so both calls are gone.
+// BORROWED: define internal i32 @count(
+// BORROWED-NOT: rs{{Set|Clear}}Object
+// BORROWED: ret i32
+
+// Without the flag, the initialization and both assignments of 'x' each
+// call rsSetObject().
+// DEADCOUNTED: define internal i32 @overwritten(
+// DEADCOUNTED: call void @_Z{{[0-9]+}}rsSetObject
+// DEADCOUNTED-NOT: rs{{Set|Clear}}Object
+// DEADCOUNTED: call void @_Z{{[0-9]+}}rsSetObject
+// DEADCOUNTED-NOT: rs{{Set|Clear}}Object
+// DEADCOUNTED: call void @_Z{{[0-9]+}}rsSetObject
+// DEADCOUNTED-NOT: rs{{Set|Clear}}Object
+// DEADCOUNTED: call void @_Z{{[0-9]+}}rsClearObject
+// DEADCOUNTED-NOT: rs{{Set|Clear}}Object
+// DEADCOUNTED: ret i32
+
+// With it, the initialization and the first assignment are overwritten
+// before any use, so only the last assignment is left.
+// DEADELIDED: define internal i32 @overwritten(
+// DEADELIDED: call void @_Z{{[0-9]+}}rsSetObject
+// DEADELIDED-NOT: rs{{Set|Clear}}Object
+// DEADELIDED: call void @_Z{{[0-9]+}}rsClearObject
+// DEADELIDED-NOT: rs{{Set|Clear}}Object
+// DEADELIDED: ret i32
+
+// Without the flag, the never read 'x' is initialized and destroyed.
+// UNUSEDCOUNTED: define internal i32 @unusedInit(
+// UNUSEDCOUNTED: call void @_Z{{[0-9]+}}rsSetObject
+// UNUSEDCOUNTED-NOT: rs{{Set|Clear}}Object
+// UNUSEDCOUNTED: call void @_Z{{[0-9]+}}rsClearObject
+// UNUSEDCOUNTED-NOT: rs{{Set|Clear}}Object
+// UNUSEDCOUNTED: ret i32
+
+// With it, 'x' takes no reference at all.
+// UNUSEDELIDED: define internal i32 @unusedInit(
+// UNUSEDELIDED-NOT: rs{{Set|Clear}}Object
+// UNUSEDELIDED: ret i32
+
+// 'mine' has its address taken, so either way its calls stay balanced, one
+// of each.
+// ESCAPES: define internal i32 @escapes(
+// ESCAPES: call void @_Z{{[0-9]+}}rsSetObject
+// ESCAPES-NOT: rs{{Set|Clear}}Object
+// ESCAPES: call void @_Z{{[0-9]+}}rsClearObject
+// ESCAPES-NOT: rs{{Set|Clear}}Object
+// ESCAPES: ret i32
+
+// 'x = a' is read back through 'p', so either way it is not removed as a
+// dead store: both assignments call rsSetObject().
+// ESCAPEDSTORE: define internal i32 @escapedStore(
+// ESCAPEDSTORE: call void @_Z{{[0-9]+}}rsSetObject
+// ESCAPEDSTORE-NOT: rs{{Set|Clear}}Object
+// ESCAPEDSTORE: call void @_Z{{[0-9]+}}rsSetObject
+// ESCAPEDSTORE-NOT: rs{{Set|Clear}}Object
+// ESCAPEDSTORE: call void @_Z{{[0-9]+}}rsClearObject
+// ESCAPEDSTORE-NOT: rs{{Set|Clear}}Object
+// ESCAPEDSTORE: ret i32
+
+#pragma version(1)
+#pragma rs java_package_name(elision)
+
+rs_allocation gAlloc;
+rs_allocation gOther;
+
+static uint32_t count(rs_allocation a) {
+    rs_allocation copy = a;
+    return rsAllocationGetDimX(copy);
+}
+
+static uint32_t overwritten(rs_allocation a, rs_allocation b) {
+    rs_allocation x = a;
+    x = b;
+    x = a;
+    return rsAllocationGetDimX(x);
+}
+
+static uint32_t unusedInit(rs_allocation a) {
+    rs_allocation x = a;
+    return rsAllocationGetDimX(a);
+}
+
+static uint32_t escapes(rs_allocation p) {
+    rs_allocation mine = p;
+    rs_allocation *ptr = &mine;
+    return rsAllocationGetDimX(*ptr);
+}
+
+static uint32_t escapedStore(rs_allocation a) {
+    rs_allocation x;
+    rs_allocation *p = &x;
+    x = a;
+    x = *p;
+    return rsAllocationGetDimX(x);
+}
+
+uint32_t run() {
+    return count(gAlloc) + overwritten(gAlloc, gOther) + unusedInit(gAlloc) +
+           escapes(gAlloc) + escapedStore(gAlloc);
+}
@@ -0,0 +1,22 @@
+// RUN: %Slang -s jc %s
+// RUN: %FileCheck %s -input-file %OutDir/bitcode_accessor_shared/bitcode_accessor_sharedBitCode.java
+
+// getBitCode() hands out the cached array itself, without allocating;
+// getBitCodeBuffer() is the read-only view for callers that want one.
+// CHECK: // callers must not modify it.
+// CHECK-NEXT: public static byte[] getBitCode() {
+// CHECK-NEXT: return BitCodeHolder.BITCODE;
+// CHECK-NOT: clone()
+// CHECK: public static java.nio.ByteBuffer getBitCodeBuffer() {
+// CHECK-NEXT: return java.nio.ByteBuffer.wrap(BitCodeHolder.BITCODE).asReadOnlyBuffer();
+// CHECK: private static class BitCodeHolder {
+// CHECK-NEXT: static final byte[] BITCODE = getBitCodeInternal();
+
+#pragma version(1)
+#pragma rs java_package_name(bitcode_accessor_shared)
+
+float gScale;
+
+void scale(float f) {
+  gScale *= f;
+}
@@ -0,0 +1,22 @@
+// RUN: %Slang %s
+// RUN: %FileCheck %s -input-file %OutDir/bulk_copy_bytebuffer/ScriptField_Particle.java
+
+// copyFrom(ByteBuffer) stages the bytes in a scratch array kept across calls.
+// CHECK: private byte[] mCopyBuffer;
+// CHECK: public synchronized void copyFrom(java.nio.ByteBuffer src, int offset, int count) {
+// CHECK-NEXT: int size = count * Item.sizeof;
+// CHECK-NEXT: if (mCopyBuffer == null || mCopyBuffer.length < size) mCopyBuffer = new byte[size];
+// CHECK-NEXT: src.get(mCopyBuffer, 0, size);
+// CHECK-NEXT: copyFrom(mCopyBuffer, offset, count);
+// CHECK-NEXT: }
+
+#pragma version(1)
+#pragma rs java_package_name(bulk_copy_bytebuffer)
+
+typedef struct Particle {
+  float2 position;
+  float2 velocity;
+  int age;
+} Particle_t;
+
+Particle_t *particles;
@@ -0,0 +1,67 @@
+// RUN: %Slang %s
+// RUN: %FileCheck %s -input-file %OutDir/bulk_copy_items/ScriptField_Sample.java
+
+// Sample is laid out as accel (float3, 16 bytes with padding) at 0,
+// timestamp at 16 and flags at 20, 24 bytes in all.
+// CHECK: public static final int sizeof = 24;
+
+// get_*() read the Item of the element; copyFrom() has to keep it up to date.
+// CHECK: public synchronized int get_timestamp(int index) {
+// CHECK-NEXT: if (mItemArray == null) return 0;
+// CHECK-NEXT: return mItemArray[index].timestamp;
+
+// copyAll() only repacks elements that have an Item.
+// CHECK: public synchronized void copyAll() {
+// CHECK-NEXT: for (int ct = 0; ct < mItemArray.length; ct++)
+// CHECK-NEXT: if (mItemArray[ct] != null) copyToArray(mItemArray[ct], ct);
+// CHECK-NEXT: mAllocation.setFromFieldPacker(0, mIOBuffer);
+
+// The Items of the copied elements are created or refreshed from the item
+// buffer packer, field by field.
+// CHECK: private void unpackItems(int offset, int count) {
+// CHECK-NEXT: if (mItemArray == null) mItemArray = new Item[getType().getX() /* count */];
+// CHECK-NEXT: java.nio.ByteBuffer b = getItemBufferRange(offset, count);
+// CHECK-NEXT: for (int ct = 0; ct < count; ct++) {
+// CHECK-NEXT: if (mItemArray[offset + ct] == null) mItemArray[offset + ct] = new Item();
+// CHECK-NEXT: Item i = mItemArray[offset + ct];
+// CHECK-NEXT: int base = ct * Item.sizeof;
+// CHECK-NEXT: i.accel.x = b.getFloat(base);
+// CHECK-NEXT: i.accel.y = b.getFloat(base + 4);
+// CHECK-NEXT: i.accel.z = b.getFloat(base + 8);
+// CHECK-NEXT: i.timestamp = b.getInt(base + 16);
+// CHECK-NEXT: i.flags = (b.getInt(base + 20) & 0xffffffffL);
+// CHECK-NEXT: }
+
+// Every copyFrom() overload updates the packer and then the Items; none of
+// them drops the Items, which would leave get() returning null, get_*()
+// throwing and set_*() followed by copyAll() uploading a zeroed element.
+// CHECK-NOT: Arrays.fill
+// CHECK: public synchronized void copyFrom(float[] d, int offset, int count) {
+// CHECK-NEXT: mAllocation.copy1DRangeFromUnchecked(offset, count, d);
+// CHECK-NEXT: getItemBufferRange(offset, count).asFloatBuffer().put(d, 0, count * 6);
+// CHECK-NEXT: unpackItems(offset, count);
+// CHECK-NEXT: }
+// CHECK-NOT: Arrays.fill
+// CHECK: public synchronized void copyFrom(int[] d, int offset, int count) {
+// CHECK-NEXT: mAllocation.copy1DRangeFromUnchecked(offset, count, d);
+// CHECK-NEXT: getItemBufferRange(offset, count).asIntBuffer().put(d, 0, count * 6);
+// CHECK-NEXT: unpackItems(offset, count);
+// CHECK-NEXT: }
+// CHECK-NOT: Arrays.fill
+// CHECK: public synchronized void copyFrom(byte[] d, int offset, int count) {
+// CHECK-NEXT: mAllocation.copy1DRangeFromUnchecked(offset, count, d);
+// CHECK-NEXT: getItemBufferRange(offset, count).put(d, 0, count * Item.sizeof);
+// CHECK-NEXT: unpackItems(offset, count);
+// CHECK-NEXT: }
+// CHECK-NOT: Arrays.fill
+
+#pragma version(1)
+#pragma rs java_package_name(bulk_copy_items)
+
+typedef struct Sample {
+    float3 accel;
+    int timestamp;
+    uint flags;
+} Sample_t;
+
+Sample_t *samples;
@@ -0,0 +1,62 @@
+// RUN: %Slang %s
+// RUN: %FileCheck %s -input-file %OutDir/field_packer_reuse/ScriptC_field_packer_reuse.java
+// RUN: %FileCheck %s -check-prefix=FIELD -input-file %OutDir/field_packer_reuse/ScriptField_Point.java
+
+// The synchronized setter caches its packer in a plain member.
+// CHECK: private FieldPacker mExportVarFP_m;
+// CHECK: public synchronized void set_m(Matrix4f v) {
+// CHECK: if (mExportVarFP_m != null) {
+// CHECK-NEXT: mExportVarFP_m.reset();
+// CHECK-NEXT: } else {
+// CHECK-NEXT: mExportVarFP_m = new FieldPacker(64);
+// CHECK-NEXT: }
+// CHECK-NEXT: FieldPacker fp = mExportVarFP_m;
+
+// CHECK: private FieldPacker mExportVarFP_pt;
+// CHECK: public synchronized void set_pt(ScriptField_Point.Item v) {
+// CHECK: if (mExportVarFP_pt != null) {
+// CHECK-NEXT: mExportVarFP_pt.reset();
+// CHECK-NEXT: } else {
+// CHECK-NEXT: mExportVarFP_pt = new FieldPacker(8);
+// CHECK-NEXT: }
+// CHECK-NEXT: FieldPacker fp = mExportVarFP_pt;
+// CHECK-NEXT: fp.addF32(v.x);
+// CHECK-NEXT: fp.addF32(v.y);
+
+// The unsynchronized invokable keeps one packer per thread.
+// CHECK: private final ThreadLocal<FieldPacker> mExportFuncFP_move = new ThreadLocal<FieldPacker>();
+// CHECK: public void invoke_move(float dx, float dy) {
+// CHECK-NEXT: FieldPacker move_fp = mExportFuncFP_move.get();
+// CHECK-NEXT: if (move_fp != null) {
+// CHECK-NEXT: move_fp.reset();
+// CHECK-NEXT: } else {
+// CHECK-NEXT: move_fp = new FieldPacker(8);
+// CHECK-NEXT: mExportFuncFP_move.set(move_fp);
+// CHECK-NEXT: }
+// CHECK-NEXT: move_fp.addF32(dx);
+// CHECK-NEXT: move_fp.addF32(dy);
+// CHECK-NEXT: invoke(mExportFuncIdx_move, move_fp);
+// CHECK-NOT: new FieldPacker
+
+// The ScriptField_ class still packs each Item into its shared I/O buffer.
+// FIELD: class ScriptField_Point extends
+// FIELD: private FieldPacker mIOBuffer;
+// FIELD: private void copyToArrayLocal(Item i, FieldPacker fp) {
+// FIELD-NEXT: fp.addF32(i.x);
+// FIELD-NEXT: fp.addF32(i.y);
+
+#pragma version(1)
+#pragma rs java_package_name(field_packer_reuse)
+
+typedef struct Point {
+  float x;
+  float y;
+} Point_t;
+
+rs_matrix4x4 m;
+Point_t pt;
+
+void move(float dx, float dy) {
+  pt.x += dx;
+  pt.y += dy;
+}
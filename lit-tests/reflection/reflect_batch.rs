@@ -0,0 +1,81 @@
+// RUN: %Slang -O 0 %s
+// RUN: cat %OutDir/reflect_batch/ScriptC_reflect_batch.java %OutDir/reflect_batch.ll > %t
+// RUN: %FileCheck %s -input-file %t
+
+// The Java side and the script side are checked in one FileCheck run, so
+// that each packet offset taken from the reflected Batch class has to be the
+// one that .rs.batch_update copies the variable from.
+
+// .rs.batch_update is exported after all the user functions (there are none).
+// CHECK: private final static int mExportBatchFuncIdx = 0;
+// CHECK: public class Batch {
+// CHECK: private FieldPacker mPacket = new FieldPacker({{[0-9]+}});
+// CHECK-NEXT: private int mDirty0;
+
+// One dirty bit per variable, in export order. The constant and the RS
+// object are left out.
+// CHECK: public Batch set_gain(float v) {
+// CHECK-NEXT: mExportVar_gain = v;
+// CHECK-NEXT: mPacket.reset([[GAIN:[0-9]+]]);
+// CHECK-NEXT: mPacket.addF32(v);
+// CHECK-NEXT: mDirty0 |= (1 << 0);
+// CHECK-NEXT: return this;
+// CHECK: public Batch set_offset(Int2 v) {
+// CHECK: mPacket.reset([[OFFSET:[0-9]+]]);
+// CHECK: mDirty0 |= (1 << 1);
+// CHECK: public Batch set_transform(Matrix4f v) {
+// CHECK: mPacket.reset([[TRANSFORM:[0-9]+]]);
+// CHECK: mDirty0 |= (1 << 2);
+// CHECK: public Batch set_light(ScriptField_Light.Item v) {
+// CHECK: mPacket.reset([[LIGHT:[0-9]+]]);
+// CHECK: mDirty0 |= (1 << 3);
+// CHECK: public Batch set_weights(float[] v) {
+// CHECK: mPacket.reset([[WEIGHTS:[0-9]+]]);
+// CHECK: mDirty0 |= (1 << 4);
+// CHECK-NOT: set_kMode
+// CHECK-NOT: set_output
+
+// apply() sends the dirty mask first and then the whole packet.
+// CHECK: public void apply() {
+// CHECK-NEXT: if ((mDirty0) == 0) {
+// CHECK: mPacket.reset();
+// CHECK-NEXT: mPacket.addI32(mDirty0);
+// CHECK-NEXT: invoke(mExportBatchFuncIdx, mPacket);
+
+// CHECK: define void @.rs.batch_update(i8*
+// CHECK: load i32*
+// CHECK: and i32 %{{[0-9]+}}, 1
+// CHECK: getelementptr inbounds i8* %0, i32 [[GAIN]]
+// CHECK-NEXT: call void @llvm.memcpy.p0i8.p0i8.i32(i8* bitcast (float* @gain to i8*), i8* %{{[0-9]+}}, i32 4, i32 1, i1 false)
+// CHECK: and i32 %{{[0-9]+}}, 2
+// CHECK: getelementptr inbounds i8* %0, i32 [[OFFSET]]
+// CHECK-NEXT: call void @llvm.memcpy.p0i8.p0i8.i32(i8* bitcast (<2 x i32>* @offset to i8*), i8* %{{[0-9]+}}, i32 8, i32 1, i1 false)
+// CHECK: and i32 %{{[0-9]+}}, 4
+// CHECK: getelementptr inbounds i8* %0, i32 [[TRANSFORM]]
+// CHECK-NEXT: call void @llvm.memcpy.p0i8.p0i8.i32(i8* bitcast (%struct.rs_matrix4x4* @transform to i8*), i8* %{{[0-9]+}}, i32 64, i32 1, i1 false)
+// CHECK: and i32 %{{[0-9]+}}, 8
+// CHECK: getelementptr inbounds i8* %0, i32 [[LIGHT]]
+// CHECK-NEXT: call void @llvm.memcpy.p0i8.p0i8.i32(i8* bitcast (%struct.Light* @light to i8*), i8* %{{[0-9]+}}, i32 {{[0-9]+}}, i32 1, i1 false)
+// CHECK: and i32 %{{[0-9]+}}, 16
+// CHECK: getelementptr inbounds i8* %0, i32 [[WEIGHTS]]
+// CHECK-NEXT: call void @llvm.memcpy.p0i8.p0i8.i32(i8* bitcast ([5 x float]* @weights to i8*), i8* %{{[0-9]+}}, i32 20, i32 1, i1 false)
+// CHECK: ret void
+
+// CHECK: !{metadata !".rs.batch_update"}
+
+#pragma version(1)
+#pragma rs java_package_name(reflect_batch)
+#pragma rs reflect_batch
+
+typedef struct Light {
+  float3 position;
+  uchar4 color;
+} Light_t;
+
+float gain;
+int2 offset;
+rs_matrix4x4 transform;
+Light_t light;
+float weights[5];
+const int kMode = 1;
+rs_allocation output;
@@ -0,0 +1,52 @@
+// RUN: %Slang %s
+// RUN: %FileCheck %s -input-file %OutDir/reflect_unsynchronized/ScriptField_Point.java
+
+// The synchronized accessors are reflected as without the pragma.
+// CHECK: public synchronized void set(Item i, int index, boolean copyNow) {
+// CHECK-NEXT: if (mItemArray == null) mItemArray = new Item[getType().getX() /* count */];
+// CHECK-NEXT: mItemArray[index] = i;
+// CHECK: public synchronized Item get(int index) {
+// CHECK-NEXT: if (mItemArray == null) return null;
+// CHECK-NEXT: return mItemArray[index];
+// CHECK: public synchronized void set_id(int index, int v, boolean copyNow) {
+// CHECK: mIOBuffer.reset(index * Item.sizeof + 12);
+// CHECK-NEXT: mIOBuffer.addI32(v);
+// CHECK-NEXT: FieldPacker fp = new FieldPacker(4);
+// CHECK-NEXT: fp.addI32(v);
+// CHECK-NEXT: mAllocation.setFromFieldPacker(index, 2, fp);
+// CHECK: public synchronized int get_id(int index) {
+// CHECK-NEXT: if (mItemArray == null) return 0;
+// CHECK-NEXT: return mItemArray[index].id;
+
+// Followed by the same accessors without the monitor.
+// CHECK: NOT thread-safe: does not take the monitor of this ScriptField_Point.
+// CHECK: public void unsyncSet(Item i, int index, boolean copyNow) {
+// CHECK-NEXT: if (mItemArray == null) mItemArray = new Item[getType().getX() /* count */];
+// CHECK-NEXT: mItemArray[index] = i;
+// CHECK: public Item unsyncGet(int index) {
+// CHECK-NEXT: if (mItemArray == null) return null;
+// CHECK-NEXT: return mItemArray[index];
+// CHECK: public void unsyncSet_id(int index, int v, boolean copyNow) {
+// CHECK: mIOBuffer.reset(index * Item.sizeof + 12);
+// CHECK-NEXT: mIOBuffer.addI32(v);
+// CHECK-NEXT: FieldPacker fp = new FieldPacker(4);
+// CHECK-NEXT: fp.addI32(v);
+// CHECK-NEXT: mAllocation.setFromFieldPacker(index, 2, fp);
+// CHECK: public int unsyncGet_id(int index) {
+// CHECK-NEXT: if (mItemArray == null) return 0;
+// CHECK-NEXT: return mItemArray[index].id;
+
+// copyAll() stays synchronized.
+// CHECK: public synchronized void copyAll() {
+
+#pragma version(1)
+#pragma rs java_package_name(reflect_unsynchronized)
+#pragma rs reflect_unsynchronized
+
+typedef struct Point {
+  float2 position;
+  uchar4 color;
+  int id;
+} Point_t;
+
+Point_t *points;
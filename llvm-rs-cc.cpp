@@ -147,6 +147,13 @@ class RSCCOptions {
 
   slang::BitCodeStorageType mBitcodeStorage;
 
+  slang::BitCodeJavaEncoding mBitcodeAccessorEncoding;
+
+  slang::BitCodeCppEmbedding mBitcodeCppEmbedding;
+
+  // <ABI name, target triple> of the ABIs to bundle with the default bitcode
+  std::vector<std::pair<std::string, std::string> > mBundledABIs;
+
   unsigned mOutputDep : 1;
 
   std::string mOutputDepDir;
@@ -164,6 +171,38 @@ class RSCCOptions {
   // The optimization level used in CodeGen, and encoded in emitted bitcode
   llvm::CodeGenOpt::Level mOptimizationLevel;
 
+  // Run the size-focused pipeline (-Oz)
+  unsigned mMinBitcode : 1;
+
+  // Report the size of each kind of block of the bitcode
+  unsigned mPrintBitcodeSize : 1;
+
+  // Append a function index block to the emitted bitcode
+  unsigned mEmitFunctionIndex : 1;
+
+  // Emit the export metadata as a binary blob as well
+  unsigned mEmitExportBlob : 1;
+
+  // Emit the export metadata with shared string and type tables as well
+  unsigned mEmitSpecMetadata : 1;
+
+  // Emit the layout table of the exports as well
+  unsigned mEmitExportLayout : 1;
+
+  // Emit the object slots in one node instead of one node per slot
+  unsigned mEmitObjectSlotMap : 1;
+
+  // Don't fuse the RSCheckAST and RSObjectRefCount walks
+  unsigned mSeparateASTPasses : 1;
+
+  // Leave out redundant reference counting of local RS objects (and report
+  // where)
+  unsigned mElideRedundantRefCount : 1;
+  unsigned mReportRefCountElision : 1;
+
+  // Type database shared with other invocations for the ODR check
+  std::string mODRTypeDB;
+
   RSCCOptions() {
     mOutputType = slang::Slang::OT_Bitcode;
     // Triple/CPU/Features must be hard-coded to our chosen portable ABI.
@@ -172,12 +211,24 @@ class RSCCOptions {
     slangAssert(mFeatures.empty());
     mFeatures.push_back("+long64");
     mBitcodeStorage = slang::BCST_APK_RESOURCE;
+    mBitcodeAccessorEncoding = slang::BCJE_BYTE_ARRAY;
+    mBitcodeCppEmbedding = slang::BCCE_ARRAY;
     mOutputDep = 0;
     mShowHelp = 0;
     mShowVersion = 0;
     mTargetAPI = RS_VERSION;
     mDebugEmission = 0;
     mOptimizationLevel = llvm::CodeGenOpt::Aggressive;
+    mMinBitcode = 0;
+    mPrintBitcodeSize = 0;
+    mEmitFunctionIndex = 0;
+    mEmitExportBlob = 0;
+    mEmitSpecMetadata = 0;
+    mEmitExportLayout = 0;
+    mEmitObjectSlotMap = 0;
+    mSeparateASTPasses = 0;
+    mElideRedundantRefCount = 0;
+    mReportRefCountElision = 0;
   }
 };
 
@@ -290,6 +341,19 @@ static void ParseArguments(llvm::SmallVectorImpl<const char*> &ArgVector,
           << OptParser->getOptionName(OPT_bitcode_storage)
           << BitcodeStorageValue;
 
+    llvm::StringRef EncodingValue =
+        Args->getLastArgValue(OPT_bitcode_accessor_encoding);
+    if (EncodingValue == "bytes")
+      Opts.mBitcodeAccessorEncoding = slang::BCJE_BYTE_ARRAY;
+    else if (EncodingValue == "latin1")
+      Opts.mBitcodeAccessorEncoding = slang::BCJE_LATIN1;
+    else if (EncodingValue == "deflate")
+      Opts.mBitcodeAccessorEncoding = slang::BCJE_DEFLATE;
+    else if (!EncodingValue.empty())
+      DiagEngine.Report(clang::diag::err_drv_invalid_value)
+          << OptParser->getOptionName(OPT_bitcode_accessor_encoding)
+          << EncodingValue;
+
     if (Args->hasArg(OPT_reflect_cpp)) {
       Opts.mBitcodeStorage = slang::BCST_CPP_CODE;
       // mJavaReflectionPathBase isn't set for C++ reflected builds
@@ -298,6 +362,60 @@ static void ParseArguments(llvm::SmallVectorImpl<const char*> &ArgVector,
       Opts.mJavaReflectionPathBase = Opts.mOutputDir;
     }
 
+    std::vector<std::string> BundledABIs =
+        Args->getAllArgValues(OPT_bundle_abi);
+    for (std::vector<std::string>::const_iterator I = BundledABIs.begin(),
+            E = BundledABIs.end();
+         I != E;
+         I++) {
+      size_t Eq = I->find('=');
+      if ((Eq == 0) || (Eq == std::string::npos) || (Eq + 1 == I->size())) {
+        DiagEngine.Report(clang::diag::err_drv_invalid_value)
+            << OptParser->getOptionName(OPT_bundle_abi) << *I;
+        continue;
+      }
+      // The ABI name is used as is in the names of the bundled bitcode files
+      // and of the reflected Java/C++ symbols, and in string literals. Only
+      // allow characters that are valid in all of them.
+      std::string ABI = I->substr(0, Eq);
+      if (!RSSlangReflectUtils::IsValidABIName(ABI)) {
+        DiagEngine.Report(DiagEngine.getCustomDiagID(
+            clang::DiagnosticsEngine::Error,
+            "invalid ABI name '%0' in '%1 %2': only letters, digits and '_' "
+            "are allowed"))
+            << ABI << OptParser->getOptionName(OPT_bundle_abi) << *I;
+        continue;
+      }
+      // The bundled bitcode files of two ABIs must not collide on a
+      // case-insensitive file system either.
+      bool Duplicate = false;
+      for (size_t i = 0; i < Opts.mBundledABIs.size(); i++) {
+        if (llvm::StringRef(Opts.mBundledABIs[i].first).equals_lower(ABI)) {
+          DiagEngine.Report(DiagEngine.getCustomDiagID(
+              clang::DiagnosticsEngine::Error,
+              "ABI name '%0' in '%1 %2' clashes with the bundled ABI '%3'"))
+              << ABI << OptParser->getOptionName(OPT_bundle_abi) << *I
+              << Opts.mBundledABIs[i].first;
+          Duplicate = true;
+          break;
+        }
+      }
+      if (Duplicate)
+        continue;
+      Opts.mBundledABIs.push_back(std::make_pair(ABI, I->substr(Eq + 1)));
+    }
+
+    llvm::StringRef EmbeddingValue =
+        Args->getLastArgValue(OPT_reflect_cpp_bitcode);
+    if (EmbeddingValue == "array")
+      Opts.mBitcodeCppEmbedding = slang::BCCE_ARRAY;
+    else if (EmbeddingValue == "incbin")
+      Opts.mBitcodeCppEmbedding = slang::BCCE_INCBIN;
+    else if (!EmbeddingValue.empty())
+      DiagEngine.Report(clang::diag::err_drv_invalid_value)
+          << OptParser->getOptionName(OPT_reflect_cpp_bitcode)
+          << EmbeddingValue;
+
     Opts.mOutputDepDir =
         Args->getLastArgValue(OPT_output_dep_dir, Opts.mOutputDir);
     Opts.mAdditionalDepTargets =
@@ -313,6 +431,18 @@ static void ParseArguments(llvm::SmallVectorImpl<const char*> &ArgVector,
 
     Opts.mOptimizationLevel = OptLevel == 0 ? llvm::CodeGenOpt::None
                                             : llvm::CodeGenOpt::Aggressive;
+    Opts.mMinBitcode = Args->hasArg(OPT_min_bitcode);
+    Opts.mPrintBitcodeSize = Args->hasArg(OPT_print_bitcode_size);
+    Opts.mEmitFunctionIndex = Args->hasArg(OPT_emit_function_index);
+    Opts.mEmitExportBlob = Args->hasArg(OPT_emit_export_blob);
+    Opts.mEmitSpecMetadata = Args->hasArg(OPT_emit_spec_metadata);
+    Opts.mEmitExportLayout = Args->hasArg(OPT_emit_export_layout);
+    Opts.mEmitObjectSlotMap = Args->hasArg(OPT_emit_object_slot_map);
+    Opts.mSeparateASTPasses = Args->hasArg(OPT_separate_ast_passes);
+    Opts.mElideRedundantRefCount =
+        Args->hasArg(OPT_elide_redundant_refcount);
+    Opts.mReportRefCountElision = Args->hasArg(OPT_report_refcount_elision);
+    Opts.mODRTypeDB = Args->getLastArgValue(OPT_odr_type_db);
 
     Opts.mTargetAPI = Args->getLastArgIntValue(OPT_target_api,
                                                RS_VERSION,
@@ -456,6 +586,19 @@ int main(int argc, const char **argv) {
 
   Compiler->init(Opts.mTriple, Opts.mCPU, Opts.mFeatures, &DiagEngine,
                  DiagClient);
+  Compiler->setBitcodeAccessorEncoding(Opts.mBitcodeAccessorEncoding);
+  Compiler->setBitcodeCppEmbedding(Opts.mBitcodeCppEmbedding);
+  Compiler->setMinimizeBitcode(Opts.mMinBitcode);
+  Compiler->setPrintBitcodeSize(Opts.mPrintBitcodeSize);
+  Compiler->setEmitFunctionIndex(Opts.mEmitFunctionIndex);
+  Compiler->setEmitExportBlob(Opts.mEmitExportBlob);
+  Compiler->setEmitSpecMetadata(Opts.mEmitSpecMetadata);
+  Compiler->setEmitExportLayout(Opts.mEmitExportLayout);
+  Compiler->setEmitObjectSlotMap(Opts.mEmitObjectSlotMap);
+  Compiler->setFuseASTPasses(!Opts.mSeparateASTPasses);
+  Compiler->setElideRedundantRefCount(Opts.mElideRedundantRefCount);
+  Compiler->setReportRefCountElision(Opts.mReportRefCountElision);
+  Compiler->setODRTypeDB(Opts.mODRTypeDB);
 
   for (int i = 0, e = Inputs.size(); i != e; i++) {
     const char *InputFile = Inputs[i];
@@ -488,6 +631,66 @@ int main(int argc, const char **argv) {
     IOFiles.push_back(std::make_pair(InputFile, OutputFile));
   }
 
+  // Compile the bundled ABIs first, so that their bitcode is there when the
+  // accessors of the default bitcode are generated. Those passes only emit
+  // bitcode (no reflection, no dependency files).
+  if ((Opts.mOutputType == slang::Slang::OT_Bitcode) &&
+      !Opts.mBundledABIs.empty()) {
+    std::vector<std::string> ABIs;
+    for (size_t i = 0; i < Opts.mBundledABIs.size(); i++) {
+      const std::string &ABI = Opts.mBundledABIs[i].first;
+      const std::string &Triple = Opts.mBundledABIs[i].second;
+
+      std::list<std::pair<const char*, const char*> > ABIIOFiles;
+      for (std::list<std::pair<const char*, const char*> >::const_iterator
+               I = IOFiles.begin(), E = IOFiles.end();
+           I != E;
+           I++) {
+        ABIIOFiles.push_back(std::make_pair(I->first,
+            SaveStringInSet(SavedStrings,
+                slang::RSSlangReflectUtils::BundledBCFileName(I->second,
+                                                              ABI.c_str()))));
+      }
+
+      // The target features (+long64) are those of the default ARM target.
+      std::vector<std::string> Features;
+      if (llvm::StringRef(Triple).startswith("arm"))
+        Features = Opts.mFeatures;
+
+      llvm::OwningPtr<slang::SlangRS> ABICompiler(new slang::SlangRS());
+      ABICompiler->init(Triple, "", Features, &DiagEngine, DiagClient);
+      ABICompiler->setSkipReflection(true);
+      ABICompiler->setEmitExportBlob(Opts.mEmitExportBlob);
+      ABICompiler->setEmitSpecMetadata(Opts.mEmitSpecMetadata);
+      ABICompiler->setEmitExportLayout(Opts.mEmitExportLayout);
+      ABICompiler->setEmitObjectSlotMap(Opts.mEmitObjectSlotMap);
+      ABICompiler->setFuseASTPasses(!Opts.mSeparateASTPasses);
+      // The sites were already reported for the main compilation.
+      ABICompiler->setElideRedundantRefCount(Opts.mElideRedundantRefCount);
+      bool ABICompiled = ABICompiler->compile(ABIIOFiles,
+                                              DepFiles,
+                                              Opts.mIncludePaths,
+                                              Opts.mAdditionalDepTargets,
+                                              slang::Slang::OT_Bitcode,
+                                              Opts.mBitcodeStorage,
+                                              Opts.mAllowRSPrefix,
+                                              /* OutputDep = */false,
+                                              Opts.mTargetAPI,
+                                              Opts.mDebugEmission,
+                                              Opts.mOptimizationLevel,
+                                              Opts.mJavaReflectionPathBase,
+                                              Opts.mJavaReflectionPackageName,
+                                              Opts.mRSPackageName);
+      ABICompiler->reset();
+      if (!ABICompiled) {
+        llvm::errs() << DiagClient->str();
+        return 1;
+      }
+      ABIs.push_back(ABI);
+    }
+    Compiler->setBundledABIs(ABIs);
+  }
+
   // Let's rock!
   int CompileFailed = !Compiler->compile(IOFiles,
                                          DepFiles,
@@ -256,11 +256,15 @@ void Slang::createASTContext() {
 clang::ASTConsumer *
 Slang::createBackend(const clang::CodeGenOptions& CodeGenOpts,
                      llvm::raw_ostream *OS, OutputType OT) {
-  return new Backend(mDiagEngine, CodeGenOpts, getTargetOptions(),
-                     &mPragmas, OS, OT);
+  Backend *B = new Backend(mDiagEngine, CodeGenOpts, getTargetOptions(),
+                           &mPragmas, OS, OT);
+  B->setEmitFunctionIndex(mEmitFunctionIndex);
+  B->setPrintBitcodeSize(mPrintBitcodeSize);
+  return B;
 }
 
-Slang::Slang() : mInitialized(false), mDiagClient(NULL), mOT(OT_Default) {
+Slang::Slang() : mInitialized(false), mDiagClient(NULL), mOT(OT_Default),
+                 mEmitFunctionIndex(false), mPrintBitcodeSize(false) {
   mTargetOpts = new clang::TargetOptions();
   GlobalInitialization();
 }
@@ -472,6 +476,10 @@ void Slang::setOptimizationLevel(llvm::CodeGenOpt::Level OptimizationLevel) {
   CodeGenOpts.OptimizationLevel = OptimizationLevel;
 }
 
+void Slang::setMinimizeBitcode(bool MinimizeBitcode) {
+  CodeGenOpts.OptimizeSize = MinimizeBitcode ? 2 : 0;
+}
+
 void Slang::reset() {
   llvm::errs() << mDiagClient->str();
   mDiagEngine->Reset();
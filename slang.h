@@ -144,6 +144,12 @@ class Slang : public clang::ModuleLoader {
  protected:
   PragmaList mPragmas;
 
+  // Append a function index block to the emitted bitcode
+  bool mEmitFunctionIndex;
+
+  // Report the size of each kind of block of the emitted bitcode
+  bool mPrintBitcodeSize;
+
   clang::DiagnosticsEngine &getDiagnostics() { return *mDiagEngine; }
   clang::TargetInfo const &getTargetInfo() const { return *mTarget; }
   clang::FileManager &getFileManager() { return *mFileMgr; }
@@ -225,6 +231,19 @@ class Slang : public clang::ModuleLoader {
 
   void setOptimizationLevel(llvm::CodeGenOpt::Level OptimizationLevel);
 
+  // Optimize for bitcode size (-Oz)
+  void setMinimizeBitcode(bool MinimizeBitcode);
+
+  // Report the size of each kind of block of the emitted bitcode
+  void setPrintBitcodeSize(bool PrintBitcodeSize) {
+    mPrintBitcodeSize = PrintBitcodeSize;
+  }
+
+  // Append a function index block to the emitted bitcode
+  void setEmitFunctionIndex(bool EmitFunctionIndex) {
+    mEmitFunctionIndex = EmitFunctionIndex;
+  }
+
   // Reset the slang compiler state such that it can be reused to compile
   // another file
   virtual void reset();
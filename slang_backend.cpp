@@ -36,6 +36,8 @@
 
 #include "llvm/Assembly/PrintModulePass.h"
 
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 
 #include "llvm/CodeGen/RegAllocRegistry.h"
@@ -45,12 +47,14 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Metadata.h"
 
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "llvm/MC/SubtargetFeature.h"
 
@@ -61,6 +65,37 @@
 
 namespace slang {
 
+// Drop the names of function arguments, basic blocks and instructions, and of
+// globals with local linkage. Unlike llvm::createStripSymbolsPass(), this
+// keeps the names of named struct types (e.g. struct.rs_allocation), which
+// the runtime uses to recognize RS object types, and leaves debug info alone.
+static void StripLocalValueNames(llvm::Module &M) {
+  for (llvm::Module::global_iterator I = M.global_begin(),
+           E = M.global_end();
+       I != E;
+       I++)
+    if (I->hasLocalLinkage())
+      I->setName("");
+
+  for (llvm::Module::iterator F = M.begin(), FE = M.end(); F != FE; F++) {
+    if (F->hasLocalLinkage())
+      F->setName("");
+    for (llvm::Function::arg_iterator A = F->arg_begin(), AE = F->arg_end();
+         A != AE;
+         A++)
+      A->setName("");
+    for (llvm::Function::iterator BB = F->begin(), BBE = F->end();
+         BB != BBE;
+         BB++) {
+      BB->setName("");
+      for (llvm::BasicBlock::iterator I = BB->begin(), IE = BB->end();
+           I != IE;
+           I++)
+        I->setName("");
+    }
+  }
+}
+
 void Backend::CreateFunctionPasses() {
   if (!mPerFunctionPasses) {
     mPerFunctionPasses = new llvm::FunctionPassManager(mpModule);
@@ -81,7 +116,6 @@ void Backend::CreateModulePasses() {
     llvm::PassManagerBuilder PMBuilder;
     PMBuilder.OptLevel = mCodeGenOpts.OptimizationLevel;
     PMBuilder.SizeLevel = mCodeGenOpts.OptimizeSize;
-    PMBuilder.SizeLevel = mCodeGenOpts.OptimizeSize;
     if (mCodeGenOpts.UnitAtATime) {
       PMBuilder.DisableUnitAtATime = 0;
     } else {
@@ -96,6 +130,16 @@ void Backend::CreateModulePasses() {
 
     PMBuilder.DisableSimplifyLibCalls = false;
     PMBuilder.populateModulePassManager(*mPerModulePasses);
+
+    // -Oz / --min-bitcode: drop whatever the driver will never look at before
+    // the BitcodeWriter runs. Exported symbols have external linkage and are
+    // referenced by name from the export metadata, so they are left alone.
+    // Local value names are stripped after these passes have run, see
+    // HandleTranslationUnit().
+    if (mCodeGenOpts.OptimizeSize == 2) {
+      mPerModulePasses->add(llvm::createGlobalDCEPass());
+      mPerModulePasses->add(llvm::createStripDeadPrototypesPass());
+    }
   }
   return;
 }
@@ -213,6 +257,8 @@ Backend::Backend(clang::DiagnosticsEngine *DiagEngine,
       mpModule(NULL),
       mpOS(OS),
       mOT(OT),
+      mEmitFunctionIndex(false),
+      mPrintBitcodeSize(false),
       mGen(NULL),
       mPerFunctionPasses(NULL),
       mPerModulePasses(NULL),
@@ -253,6 +299,119 @@ void Backend::WrapBitcode(llvm::raw_string_ostream &Bitcode) {
   return;
 }
 
+void Backend::ReportBitcodeSize(const std::string &Bitcode) {
+  enum {
+    BS_FunctionBodies,
+    BS_Constants,
+    BS_Metadata,
+    BS_SymbolTable,
+    BS_TypeTable,
+    BS_Other,
+    BS_Max
+  };
+  static const char *const BlockSizeNames[BS_Max] = {
+    "function bodies",
+    "constants",
+    "metadata",
+    "symbol table",
+    "type table",
+    "other"
+  };
+  uint64_t BlockBits[BS_Max] = { 0 };
+
+  const unsigned char *Start =
+      reinterpret_cast<const unsigned char*>(Bitcode.data());
+  llvm::BitstreamReader Reader(Start, Start + Bitcode.size());
+  llvm::BitstreamCursor Stream(Reader);
+
+  // Skip the 'BC' 0xC0DE magic.
+  if (Bitcode.size() < 4)
+    return;
+  Stream.Read(32);
+
+  while (!Stream.AtEndOfStream()) {
+    llvm::BitstreamEntry Entry = Stream.advance();
+    if (Entry.Kind != llvm::BitstreamEntry::SubBlock)
+      break;
+    if (Entry.ID != llvm::bitc::MODULE_BLOCK_ID) {
+      Stream.SkipBlock();
+      continue;
+    }
+    if (Stream.EnterSubBlock(llvm::bitc::MODULE_BLOCK_ID))
+      break;
+
+    // Only the direct children of the module block are attributed. Nested
+    // blocks (e.g. the constants and symbol table local to a function) are
+    // counted with the block containing them.
+    bool Done = false;
+    while (!Done) {
+      Entry = Stream.advance();
+      switch (Entry.Kind) {
+        case llvm::BitstreamEntry::SubBlock: {
+          uint64_t BlockStart = Stream.GetCurrentBitNo();
+          if (Stream.SkipBlock()) {
+            Done = true;
+            break;
+          }
+          uint64_t Bits = Stream.GetCurrentBitNo() - BlockStart;
+          switch (Entry.ID) {
+            case llvm::bitc::FUNCTION_BLOCK_ID:
+              BlockBits[BS_FunctionBodies] += Bits;
+              break;
+            case llvm::bitc::CONSTANTS_BLOCK_ID:
+              BlockBits[BS_Constants] += Bits;
+              break;
+            case llvm::bitc::METADATA_BLOCK_ID:
+            case llvm::bitc::METADATA_ATTACHMENT_ID:
+              BlockBits[BS_Metadata] += Bits;
+              break;
+            case llvm::bitc::VALUE_SYMTAB_BLOCK_ID:
+              BlockBits[BS_SymbolTable] += Bits;
+              break;
+            case llvm::bitc::TYPE_BLOCK_ID_NEW:
+            // The LLVM 2.9 writers still use the pre-3.0 type (10) and type
+            // symbol table (13) blocks.
+            case 10:
+            case 13:
+              BlockBits[BS_TypeTable] += Bits;
+              break;
+            default:
+              BlockBits[BS_Other] += Bits;
+              break;
+          }
+          break;
+        }
+        case llvm::BitstreamEntry::Record: {
+          // Global variables, function prototypes and the like
+          uint64_t RecordStart = Stream.GetCurrentBitNo();
+          Stream.skipRecord(Entry.ID);
+          BlockBits[BS_Other] += Stream.GetCurrentBitNo() - RecordStart;
+          break;
+        }
+        default: {
+          Done = true;
+          break;
+        }
+      }
+    }
+    break;
+  }
+
+  // Report through the diagnostics engine, so that the breakdown goes to
+  // stderr next to the other compiler messages and never into stdout.
+  std::string Breakdown;
+  llvm::raw_string_ostream OS(Breakdown);
+  for (unsigned i = 0; i < BS_Max; i++)
+    OS << BlockSizeNames[i] << " " << ((BlockBits[i] + 7) / 8) << ", ";
+  OS << "total " << Bitcode.size();
+  OS.flush();
+
+  mDiagEngine.Report(mDiagEngine.getCustomDiagID(
+      clang::DiagnosticsEngine::Note, "bitcode size (bytes): %0"))
+      << Breakdown;
+  return;
+}
+
 bool Backend::HandleTopLevelDecl(clang::DeclGroupRef D) {
   return mGen->HandleTopLevelDecl(D);
 }
@@ -322,6 +481,11 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
   if (mPerModulePasses)
     mPerModulePasses->run(*mpModule);
 
+  // Keep the names for -g, where they help reading the debug info.
+  if (mCodeGenOpts.OptimizeSize == 2 &&
+      mCodeGenOpts.getDebugInfo() == clang::CodeGenOptions::NoDebugInfo)
+    StripLocalValueNames(*mpModule);
+
   switch (mOT) {
     case Slang::OT_Assembly:
     case Slang::OT_Object: {
@@ -371,13 +535,29 @@ void Backend::HandleTranslationUnit(clang::ASTContext &Ctx) {
           }
           // Switch to the 3.2 BitcodeWriter by default, and don't use
           // LLVM's included BitcodeWriter at all (for now).
-          BCEmitPM->add(llvm_3_2::createBitcodeWriterPass(Bitcode));
+          BCEmitPM->add(llvm_3_2::createBitcodeWriterPass(Bitcode,
+                                                          mEmitFunctionIndex));
           //BCEmitPM->add(llvm::createBitcodeWriterPass(Bitcode));
           break;
         }
       }
 
       BCEmitPM->run(*mpModule);
+      if (mEmitFunctionIndex && TargetAPI > SLANG_ICS_MR1_TARGET_API) {
+        // Check the index against the bitcode we just wrote.
+        const std::string &BC = Bitcode.str();
+        const unsigned char *BCStart =
+            reinterpret_cast<const unsigned char*>(BC.data());
+        std::string ErrMsg;
+        if (llvm_3_2::VerifyFunctionIndex(BCStart, BCStart + BC.size(),
+                                          &ErrMsg)) {
+          mDiagEngine.Report(clang::diag::err_fe_error_backend)
+              << ("invalid function index: " + ErrMsg);
+          return;
+        }
+      }
+      if (mPrintBitcodeSize)
+        ReportBitcodeSize(Bitcode.str());
       WrapBitcode(Bitcode);
       break;
     }
@@ -56,6 +56,12 @@ class Backend : public clang::ASTConsumer {
   llvm::raw_ostream *mpOS;
   Slang::OutputType mOT;
 
+  // Append a function index block to the emitted bitcode (3.2 writer only)
+  bool mEmitFunctionIndex;
+
+  // Report the size of each kind of block of the emitted bitcode
+  bool mPrintBitcodeSize;
+
   // This helps us translate Clang AST using into LLVM IR
   clang::CodeGenerator *mGen;
 
@@ -76,6 +82,10 @@ class Backend : public clang::ASTConsumer {
 
   void WrapBitcode(llvm::raw_string_ostream &Bitcode);
 
+  // Report how many bytes of the encoded bitcode each kind of block takes
+  // (-print-bitcode-size)
+  void ReportBitcodeSize(const std::string &Bitcode);
+
  protected:
   llvm::LLVMContext &mLLVMContext;
   clang::DiagnosticsEngine &mDiagEngine;
@@ -108,6 +118,14 @@ class Backend : public clang::ASTConsumer {
           llvm::raw_ostream *OS,
           Slang::OutputType OT);
 
+  void setEmitFunctionIndex(bool EmitFunctionIndex) {
+    mEmitFunctionIndex = EmitFunctionIndex;
+  }
+
+  void setPrintBitcodeSize(bool PrintBitcodeSize) {
+    mPrintBitcodeSize = PrintBitcodeSize;
+  }
+
   // Initialize - This is called to initialize the consumer, providing the
   // ASTContext.
   virtual void Initialize(clang::ASTContext &Ctx);
@@ -0,0 +1,818 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark for the bitcode writers used by llvm-rs-cc.
+//
+// Each module (loaded from the command line, or generated to look like a
+// large RS script) is written with llvm_2_9::, llvm_2_9_func:: and
+// llvm_3_2::WriteBitcodeToFile. For every writer the tool reports the size of
+// the bitcode, the throughput, and the peak memory the writer needed on top
+// of the loaded module. Each output is also read back with the LLVM bitcode
+// reader and compared with the original module.
+//
+// For modules that carry the binary export blob (llvm-rs-cc
+// -emit-export-blob), the tool also compares the time to load the export
+// information from the blob with the time to parse the legacy string
+// metadata, and checks that both give the same result. Likewise, modules
+// compiled with -emit-spec-metadata get the size of that encoding compared
+// with the legacy metadata, and the time to decode each. The object slots of
+// every module are re-encoded as a bitmap and as runs (see RSObjectSlots),
+// and both have to decode to the slots the module holds.
+//
+// -save-baseline=<dir> and -baseline=<dir> compare two builds of the writers
+// (before/after a change to them): the first run stores, for every module and
+// writer, the bitcode and the throughput in <dir>; the second run reports the
+// throughput of both and fails if the bitcode is not byte-for-byte the same.
+// For the writers as they were before BitWriter_common/, build this tool with
+// the BitWriter_2_9, BitWriter_2_9_func and BitWriter_3_2 directories of the
+// commit before "Share one ValueEnumerator and common writer helpers across
+// writers" and run it with -save-baseline, then rerun the current build with
+// -baseline on the same inputs and options.
+//
+// With -compare-legacy=<file>, the tool only checks that the object slots and
+// export blob of each input decode to the same export information as the
+// legacy metadata of <file>. tests/test.py uses this for the tests marked
+// with a COMPARE_LEGACY file.
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/IRReader.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+#include "BitWriter_2_9/ReaderWriter_2_9.h"
+#include "BitWriter_2_9_func/ReaderWriter_2_9_func.h"
+#include "BitWriter_3_2/ReaderWriter_3_2.h"
+
+#include "slang_rs_export_blob.h"
+#include "slang_rs_metadata.h"
+#include "slang_rs_metadata_spec.h"
+#include "slang_rs_object_slots.h"
+
+static llvm::cl::list<std::string>
+InputFilenames(llvm::cl::Positional, llvm::cl::ZeroOrMore,
+               llvm::cl::desc("[<input .bc or .ll files>]"));
+
+static llvm::cl::opt<unsigned>
+Iterations("iterations", llvm::cl::init(20),
+           llvm::cl::desc("Number of times each module is written"));
+
+static llvm::cl::opt<unsigned>
+NumKernels("kernels", llvm::cl::init(256),
+           llvm::cl::desc("Kernels in the generated module"));
+
+static llvm::cl::opt<unsigned>
+TableSize("table-size", llvm::cl::init(65536),
+          llvm::cl::desc("Elements in each constant table of the generated "
+                         "module"));
+
+static llvm::cl::opt<unsigned>
+NumMetadataNodes("metadata-nodes", llvm::cl::init(8192),
+                 llvm::cl::desc("Metadata nodes in the generated module"));
+
+static llvm::cl::opt<bool>
+EmitFunctionIndex("function-index",
+                  llvm::cl::desc("Emit the function index from the llvm_3_2 "
+                                 "writer"));
+
+static llvm::cl::opt<bool>
+MetadataOnly("metadata-only",
+             llvm::cl::desc("Only compare the export metadata encodings"));
+
+static llvm::cl::opt<std::string>
+CompareLegacy("compare-legacy", llvm::cl::value_desc("file"),
+              llvm::cl::desc("Only check that the object slots and export "
+                             "blob of each input decode to the legacy "
+                             "metadata of <file>, the same script compiled "
+                             "without the new encodings"));
+
+static llvm::cl::opt<std::string>
+SaveBaseline("save-baseline", llvm::cl::value_desc("dir"),
+             llvm::cl::desc("Store the bitcode and throughput of every writer "
+                            "in <dir>, for a later run with -baseline"));
+
+static llvm::cl::opt<std::string>
+Baseline("baseline", llvm::cl::value_desc("dir"),
+         llvm::cl::desc("Compare the bitcode and throughput of every writer "
+                        "with those stored by -save-baseline in <dir>"));
+
+namespace {
+
+typedef void (*WriterFn)(const llvm::Module *M, llvm::raw_ostream &Out);
+
+void Write_2_9(const llvm::Module *M, llvm::raw_ostream &Out) {
+  llvm_2_9::WriteBitcodeToFile(M, Out);
+}
+
+void Write_2_9_func(const llvm::Module *M, llvm::raw_ostream &Out) {
+  llvm_2_9_func::WriteBitcodeToFile(M, Out);
+}
+
+void Write_3_2(const llvm::Module *M, llvm::raw_ostream &Out) {
+  llvm_3_2::WriteBitcodeToFile(M, Out, EmitFunctionIndex);
+}
+
+struct Writer {
+  const char *Name;
+  WriterFn Write;
+};
+
+const Writer Writers[] = {
+  { "llvm_2_9",      Write_2_9 },
+  { "llvm_2_9_func", Write_2_9_func },
+  { "llvm_3_2",      Write_3_2 },
+};
+
+// What a timed run in the child process reports back to the parent.
+struct RunResult {
+  double Seconds;
+  uint64_t Bytes;
+};
+
+// Add a kernel in the style of a RS forEach root to M.
+void GenerateKernel(llvm::Module *M, unsigned Index,
+                    llvm::GlobalVariable *Table, unsigned BenchMDKind,
+                    llvm::MDNode *Scope) {
+  llvm::LLVMContext &C = M->getContext();
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(C);
+  llvm::Type *FloatTy = llvm::Type::getFloatTy(C);
+  llvm::Type *Float4Ty = llvm::VectorType::get(FloatTy, 4);
+
+  llvm::Type *Params[] = {
+    Float4Ty->getPointerTo(),                // in
+    Float4Ty->getPointerTo(),                // out
+    llvm::Type::getInt8PtrTy(C),             // usrData
+    Int32Ty,                                 // x
+    Int32Ty                                  // y
+  };
+  llvm::FunctionType *FT =
+      llvm::FunctionType::get(llvm::Type::getVoidTy(C), Params, false);
+  std::string Name = "root_" + llvm::utostr(Index);
+  llvm::Function *F = llvm::Function::Create(
+      FT, llvm::GlobalValue::ExternalLinkage, Name, M);
+
+  llvm::Function::arg_iterator AI = F->arg_begin();
+  llvm::Value *In = AI++;
+  llvm::Value *Out = AI++;
+  AI++;
+  llvm::Value *X = AI++;
+  llvm::Value *Y = AI++;
+
+  llvm::IRBuilder<> B(llvm::BasicBlock::Create(C, "entry", F));
+  llvm::Value *V = B.CreateLoad(In, "in");
+  llvm::Value *Idx = B.CreateMul(Y, B.getInt32(Index + 1));
+  Idx = B.CreateAnd(B.CreateAdd(X, Idx), B.getInt32(TableSize - 1));
+  llvm::Value *GEPIdx[] = { B.getInt32(0), Idx };
+  llvm::Value *Scale = B.CreateLoad(B.CreateInBoundsGEP(Table, GEPIdx));
+  for (unsigned i = 0; i < 4; i++) {
+    llvm::Value *E = B.CreateExtractElement(V, B.getInt32(i));
+    E = B.CreateFMul(E, Scale);
+    E = B.CreateFAdd(E, llvm::ConstantFP::get(FloatTy, Index + i * 0.25));
+    V = B.CreateInsertElement(V, E, B.getInt32(i));
+  }
+  B.CreateStore(V, Out);
+  B.CreateRetVoid();
+
+  // Give every instruction its own location node, as debug info would.
+  unsigned Line = 1;
+  for (llvm::BasicBlock::iterator I = F->begin()->begin(),
+           E = F->begin()->end(); I != E; ++I) {
+    llvm::Value *Loc[] = { B.getInt32(Line++), B.getInt32(Index), Scope };
+    I->setMetadata(BenchMDKind, llvm::MDNode::get(C, Loc));
+  }
+}
+
+// Build a module that stresses the parts of the writers that RS scripts
+// exercise: many kernels, large structs, big constant tables and a lot of
+// metadata.
+llvm::Module *GenerateModule(llvm::LLVMContext &C) {
+  llvm::Module *M = new llvm::Module("generated", C);
+  M->setTargetTriple("armv7-none-linux-gnueabi");
+  M->setDataLayout("e-p:32:32:32-i1:8:8-i8:8:8-i16:16:16-i32:32:32-"
+                   "i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:64:128-"
+                   "a0:0:64-n32-S64");
+
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(C);
+  llvm::Type *FloatTy = llvm::Type::getFloatTy(C);
+
+  // Big constant tables.
+  std::vector<float> Floats(TableSize);
+  std::vector<uint32_t> Ints(TableSize);
+  for (unsigned i = 0; i < TableSize; i++) {
+    Floats[i] = i * 0.5f;
+    Ints[i] = i * 2654435761u;
+  }
+  llvm::GlobalVariable *FloatTable = new llvm::GlobalVariable(
+      *M, llvm::ArrayType::get(FloatTy, TableSize), true,
+      llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantDataArray::get(C, Floats), "float_table");
+  new llvm::GlobalVariable(
+      *M, llvm::ArrayType::get(Int32Ty, TableSize), true,
+      llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantDataArray::get(C, Ints), "int_table");
+
+  // A large struct and an initialized array of it.
+  std::vector<llvm::Type*> Fields;
+  for (unsigned i = 0; i < 64; i++) {
+    switch (i % 4) {
+      case 0: Fields.push_back(Int32Ty); break;
+      case 1: Fields.push_back(FloatTy); break;
+      case 2: Fields.push_back(llvm::VectorType::get(FloatTy, 4)); break;
+      case 3: Fields.push_back(llvm::ArrayType::get(Int32Ty, 8)); break;
+    }
+  }
+  llvm::StructType *ST = llvm::StructType::create(C, Fields, "struct.big");
+  unsigned NumStructs = TableSize / 64 + 1;
+  std::vector<llvm::Constant*> Structs;
+  for (unsigned s = 0; s < NumStructs; s++) {
+    std::vector<llvm::Constant*> Vals;
+    for (unsigned i = 0; i < Fields.size(); i++) {
+      unsigned Seed = s * 64 + i;
+      switch (i % 4) {
+        case 0:
+          Vals.push_back(llvm::ConstantInt::get(Int32Ty, Seed));
+          break;
+        case 1:
+          Vals.push_back(llvm::ConstantFP::get(FloatTy, Seed * 0.125));
+          break;
+        case 2:
+          Vals.push_back(llvm::ConstantVector::getSplat(
+              4, llvm::ConstantFP::get(FloatTy, Seed)));
+          break;
+        case 3: {
+          uint32_t Elts[8];
+          for (unsigned e = 0; e < 8; e++)
+            Elts[e] = Seed + e;
+          Vals.push_back(llvm::ConstantDataArray::get(C, Elts));
+          break;
+        }
+      }
+    }
+    Structs.push_back(llvm::ConstantStruct::get(ST, Vals));
+  }
+  new llvm::GlobalVariable(
+      *M, llvm::ArrayType::get(ST, NumStructs), false,
+      llvm::GlobalValue::ExternalLinkage,
+      llvm::ConstantArray::get(llvm::ArrayType::get(ST, NumStructs), Structs),
+      "structs");
+
+  // Metadata: a deep chain of scope-like nodes, plus the named nodes the
+  // RS backend emits for exported functions.
+  llvm::Value *Root[] = { llvm::MDString::get(C, "generated.rs") };
+  llvm::MDNode *Scope = llvm::MDNode::get(C, Root);
+  llvm::NamedMDNode *Scopes = M->getOrInsertNamedMetadata("bench.scopes");
+  for (unsigned i = 0; i < NumMetadataNodes; i++) {
+    llvm::Value *Ops[] = {
+      llvm::MDString::get(C, "scope_" + llvm::utostr(i)),
+      llvm::ConstantInt::get(Int32Ty, i),
+      Scope
+    };
+    Scope = llvm::MDNode::get(C, Ops);
+  }
+  Scopes->addOperand(Scope);
+
+  unsigned BenchMDKind = C.getMDKindID("rs.bench");
+  llvm::NamedMDNode *ExportForEachName =
+      M->getOrInsertNamedMetadata("#rs_export_foreach_name");
+  llvm::NamedMDNode *ExportForEach =
+      M->getOrInsertNamedMetadata("#rs_export_foreach");
+  for (unsigned i = 0; i < NumKernels; i++) {
+    GenerateKernel(M, i, FloatTable, BenchMDKind, Scope);
+    llvm::Value *Name[] = { llvm::MDString::get(C, "root_" +
+                                                   llvm::utostr(i)) };
+    ExportForEachName->addOperand(llvm::MDNode::get(C, Name));
+    llvm::Value *Sig[] = { llvm::MDString::get(C, "27") };
+    ExportForEach->addOperand(llvm::MDNode::get(C, Sig));
+  }
+
+  // Carry the same information as an export blob.
+  slang::RSExportBlob Blob;
+  std::string Err;
+  if (Blob.readLegacyMetadata(M, &Err))
+    Blob.writeToModule(M);
+
+  return M;
+}
+
+std::string PrintModule(const llvm::Module *M) {
+  std::string S;
+  llvm::raw_string_ostream OS(S);
+  M->print(OS, NULL);
+  return OS.str();
+}
+
+// Read Bitcode back and compare it with the textual form of the original
+// module. Returns an empty string if they match, or a description of the
+// first difference.
+std::string RoundTrip(const std::string &Bitcode, const llvm::Module *M,
+                      const std::string &Expected) {
+  llvm::LLVMContext Context;
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer(
+      llvm::MemoryBuffer::getMemBuffer(Bitcode, M->getModuleIdentifier(),
+                                       false));
+  std::string Err;
+  llvm::OwningPtr<llvm::Module> ReadBack(
+      llvm::ParseBitcodeFile(Buffer.get(), Context, &Err));
+  if (!ReadBack)
+    return "unreadable: " + Err;
+
+  std::string Actual = PrintModule(ReadBack.get());
+  if (Actual == Expected)
+    return "";
+
+  // Find the first line that differs.
+  size_t Pos = 0;
+  unsigned Line = 1;
+  while (Pos < Actual.size() && Pos < Expected.size() &&
+         Actual[Pos] == Expected[Pos]) {
+    if (Actual[Pos] == '\n')
+      Line++;
+    Pos++;
+  }
+  return "differs at line " + llvm::utostr(Line);
+}
+
+long MaxRSSInKB(const struct rusage &Usage) {
+#if defined(__APPLE__)
+  return Usage.ru_maxrss / 1024;
+#else
+  return Usage.ru_maxrss;
+#endif
+}
+
+// Write M Iterations times with W in a child process, so that the child's
+// peak resident set size reflects this writer alone. On success, fills in
+// Result and the child's peak RSS above the parent's current peak.
+bool TimedRun(const llvm::Module *M, const Writer &W, RunResult &Result,
+              long &PeakKB) {
+  struct rusage Usage;
+  getrusage(RUSAGE_SELF, &Usage);
+  long BaselineKB = MaxRSSInKB(Usage);
+
+  int Pipe[2];
+  if (pipe(Pipe))
+    return false;
+
+  pid_t Child = fork();
+  if (Child < 0) {
+    close(Pipe[0]);
+    close(Pipe[1]);
+    return false;
+  }
+
+  if (Child == 0) {
+    close(Pipe[0]);
+    RunResult R;
+    R.Bytes = 0;
+    llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime(true);
+    for (unsigned i = 0; i < Iterations; i++) {
+      std::string Bitcode;
+      llvm::raw_string_ostream OS(Bitcode);
+      W.Write(M, OS);
+      R.Bytes += OS.str().size();
+    }
+    llvm::TimeRecord End = llvm::TimeRecord::getCurrentTime(false);
+    R.Seconds = End.getWallTime() - Start.getWallTime();
+    ssize_t Written = write(Pipe[1], &R, sizeof(R));
+    close(Pipe[1]);
+    _exit(Written == sizeof(R) ? 0 : 1);
+  }
+
+  close(Pipe[1]);
+  ssize_t Read = read(Pipe[0], &Result, sizeof(Result));
+  close(Pipe[0]);
+
+  int Status;
+  if (wait4(Child, &Status, 0, &Usage) != Child)
+    return false;
+  if (!WIFEXITED(Status) || WEXITSTATUS(Status) != 0 ||
+      Read != sizeof(Result))
+    return false;
+
+  PeakKB = MaxRSSInKB(Usage) - BaselineKB;
+  if (PeakKB < 0)
+    PeakKB = 0;
+  return true;
+}
+
+// Time loading the export information of M from the legacy metadata and from
+// the export blob. Returns the number of failures.
+unsigned BenchmarkExportLoad(const llvm::Module *M) {
+  if (M->getNamedMetadata(RS_EXPORT_BLOB_MN) == NULL)
+    return 0;
+
+  slang::RSExportBlob Legacy, Blob;
+  std::string Err;
+  double Seconds[2];
+  for (unsigned Form = 0; Form < 2; Form++) {
+    llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime(true);
+    for (unsigned i = 0; i < Iterations; i++) {
+      bool Loaded = (Form == 0) ? Legacy.readLegacyMetadata(M, &Err)
+                                : Blob.readFromModule(M, &Err);
+      if (!Loaded) {
+        llvm::outs() << M->getModuleIdentifier() << ": "
+                     << ((Form == 0) ? "legacy metadata" : "export blob")
+                     << ": " << Err << "\n";
+        return 1;
+      }
+    }
+    llvm::TimeRecord End = llvm::TimeRecord::getCurrentTime(false);
+    Seconds[Form] = (End.getWallTime() - Start.getWallTime()) / Iterations;
+  }
+
+  llvm::outs() << llvm::format("%-24s export load: legacy %.2f us, "
+                               "blob %.2f us  ",
+                               M->getModuleIdentifier().c_str(),
+                               Seconds[0] * 1e6, Seconds[1] * 1e6);
+  if (Legacy != Blob) {
+    llvm::outs() << "MISMATCH\n";
+    return 1;
+  }
+  llvm::outs() << "ok\n";
+  return 0;
+}
+
+// Total size of the strings in the named metadata of M that Pred selects, and
+// the number of nodes holding them.
+void MeasureNamedMetadata(const llvm::Module *M,
+                          bool (*Pred)(llvm::StringRef Name),
+                          uint64_t &Bytes, unsigned &Nodes) {
+  Bytes = 0;
+  Nodes = 0;
+  for (llvm::Module::const_named_metadata_iterator
+           I = M->named_metadata_begin(), E = M->named_metadata_end();
+       I != E; ++I) {
+    if (!Pred(I->getName()))
+      continue;
+    for (unsigned i = 0, e = I->getNumOperands(); i != e; i++) {
+      const llvm::MDNode *N = I->getOperand(i);
+      Nodes++;
+      for (unsigned o = 0, oe = N->getNumOperands(); o != oe; o++)
+        if (const llvm::MDString *S =
+                llvm::dyn_cast_or_null<llvm::MDString>(N->getOperand(o)))
+          Bytes += S->getLength();
+    }
+  }
+}
+
+// The legacy metadata that the spec encoding can replace.
+bool IsLegacyTypeMetadata(llvm::StringRef Name) {
+  return Name == RS_EXPORT_VAR_MN || Name == RS_EXPORT_FUNC_MN ||
+         Name == RS_EXPORT_TYPE_MN || Name.startswith("%");
+}
+
+bool IsSpecMetadata(llvm::StringRef Name) {
+  return Name == RS_SPEC_STRTAB_MN || Name == RS_SPEC_TYPE_INFO_MN ||
+         Name.startswith("#rs_spec_");
+}
+
+// Compare the size and decoding time of the spec encoding and the legacy
+// metadata in M. Returns the number of failures.
+unsigned BenchmarkSpecMetadata(const llvm::Module *M) {
+  if (M->getNamedMetadata(RS_SPEC_TYPE_INFO_MN) == NULL &&
+      M->getNamedMetadata(RS_SPEC_EXPORT_FUNC_MN) == NULL)
+    return 0;
+
+  uint64_t LegacyBytes, SpecBytes;
+  unsigned LegacyNodes, SpecNodes;
+  MeasureNamedMetadata(M, IsLegacyTypeMetadata, LegacyBytes, LegacyNodes);
+  MeasureNamedMetadata(M, IsSpecMetadata, SpecBytes, SpecNodes);
+
+  slang::RSExportBlob Legacy;
+  std::string Err;
+  llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0; i < Iterations; i++) {
+    if (!Legacy.readLegacyMetadata(M, &Err)) {
+      llvm::outs() << M->getModuleIdentifier() << ": legacy metadata: "
+                   << Err << "\n";
+      return 1;
+    }
+  }
+  llvm::TimeRecord Mid = llvm::TimeRecord::getCurrentTime(false);
+  for (unsigned i = 0; i < Iterations; i++) {
+    RSMetadata *MD = RSDecodeMetadata(M);
+    if (MD == NULL) {
+      llvm::outs() << M->getModuleIdentifier()
+                   << ": malformed spec metadata\n";
+      return 1;
+    }
+    RSReleaseMetadata(MD);
+  }
+  llvm::TimeRecord End = llvm::TimeRecord::getCurrentTime(false);
+
+  llvm::outs() << llvm::format("%-24s spec metadata: legacy %llu bytes in %u "
+                               "nodes, %.2f us; spec %llu bytes in %u nodes, "
+                               "%.2f us\n",
+                               M->getModuleIdentifier().c_str(),
+                               (unsigned long long) LegacyBytes, LegacyNodes,
+                               (Mid.getWallTime() - Start.getWallTime()) /
+                                   Iterations * 1e6,
+                               (unsigned long long) SpecBytes, SpecNodes,
+                               (End.getWallTime() - Mid.getWallTime()) /
+                                   Iterations * 1e6);
+  return 0;
+}
+
+// Check that both encodings of the object slot map give back the object
+// slots of M (in whichever form M has them). Returns the number of failures.
+unsigned CheckObjectSlots(const llvm::Module *M) {
+  slang::RSObjectSlots Slots;
+  std::string Err;
+  if (!Slots.readFromModule(M, &Err)) {
+    llvm::outs() << M->getModuleIdentifier() << ": object slots: " << Err
+                 << "\n";
+    return 1;
+  }
+  if (Slots.NumVars == 0)
+    return 0;
+
+  static const slang::RSObjectSlots::Encoding Encodings[] = {
+    slang::RSObjectSlots::ENC_Bitmap,
+    slang::RSObjectSlots::ENC_Runs
+  };
+  size_t Sizes[2];
+  bool Agree = true;
+  for (unsigned i = 0; i < 2; i++) {
+    std::string Data;
+    slang::RSObjectSlots Decoded;
+    Slots.encode(Encodings[i], Data);
+    Sizes[i] = Data.size();
+    if (!Decoded.decode(Encodings[i], Slots.NumVars, Data, &Err) ||
+        Decoded != Slots)
+      Agree = false;
+  }
+
+  llvm::outs() << llvm::format("%-24s object slots: %u of %u vars, "
+                               "bitmap %u bytes, runs %u bytes  %s\n",
+                               M->getModuleIdentifier().c_str(),
+                               (unsigned) Slots.Slots.size(), Slots.NumVars,
+                               (unsigned) Sizes[0], (unsigned) Sizes[1],
+                               Agree ? "ok" : "MISMATCH");
+  return Agree ? 0 : 1;
+}
+
+// Check that the object slots of M, and its export blob if it has one, decode
+// to the export information in the legacy metadata of Legacy. Returns the
+// number of failures.
+unsigned CompareWithLegacy(const llvm::Module *M, const llvm::Module *Legacy) {
+  std::string Err;
+  slang::RSObjectSlots Slots, LegacySlots;
+  if (!Slots.readFromModule(M, &Err) ||
+      !LegacySlots.readFromModule(Legacy, &Err)) {
+    llvm::outs() << M->getModuleIdentifier() << ": object slots: " << Err
+                 << "\n";
+    return 1;
+  }
+  bool SlotsAgree = (Slots == LegacySlots);
+  llvm::outs() << llvm::format("%-24s object slots vs legacy: %u of %u vars  "
+                               "%s\n",
+                               M->getModuleIdentifier().c_str(),
+                               (unsigned) Slots.Slots.size(), Slots.NumVars,
+                               SlotsAgree ? "ok" : "MISMATCH");
+  unsigned Failures = SlotsAgree ? 0 : 1;
+
+  if (M->getNamedMetadata(RS_EXPORT_BLOB_MN) != NULL) {
+    slang::RSExportBlob Blob, LegacyBlob;
+    if (!Blob.readFromModule(M, &Err) ||
+        !LegacyBlob.readLegacyMetadata(Legacy, &Err)) {
+      llvm::outs() << M->getModuleIdentifier() << ": export blob: " << Err
+                   << "\n";
+      return Failures + 1;
+    }
+    bool BlobAgrees = (Blob == LegacyBlob);
+    llvm::outs() << llvm::format("%-24s export blob vs legacy: %u vars, "
+                                 "%u funcs, %u records  %s\n",
+                                 M->getModuleIdentifier().c_str(),
+                                 (unsigned) Blob.Vars.size(),
+                                 (unsigned) Blob.Funcs.size(),
+                                 (unsigned) Blob.Records.size(),
+                                 BlobAgrees ? "ok" : "MISMATCH");
+    if (!BlobAgrees)
+      Failures++;
+  }
+  return Failures;
+}
+
+// Path of the baseline file of writer W on M in Dir, with extension Ext.
+std::string BaselinePath(const std::string &Dir, const llvm::Module *M,
+                         const Writer &W, const char *Ext) {
+  std::string Name =
+      llvm::sys::path::filename(M->getModuleIdentifier()).str();
+  Name = Name + "." + W.Name + Ext;
+  llvm::SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, Name);
+  return Path.str().str();
+}
+
+bool WriteFile(const std::string &Path, llvm::StringRef Data) {
+  std::string Err;
+  llvm::raw_fd_ostream OS(Path.c_str(), Err, llvm::raw_fd_ostream::F_Binary);
+  if (!Err.empty()) {
+    llvm::outs() << Path << ": " << Err << "\n";
+    return false;
+  }
+  OS << Data;
+  return true;
+}
+
+bool ReadFile(const std::string &Path, std::string &Data) {
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::error_code EC = llvm::MemoryBuffer::getFile(Path, Buffer)) {
+    llvm::outs() << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+  Data = Buffer->getBuffer();
+  return true;
+}
+
+// Store Bitcode and the throughput of W on M for a later -baseline run.
+// Returns the number of failures.
+unsigned SaveToBaseline(const llvm::Module *M, const Writer &W,
+                        const std::string &Bitcode, double MBPerSec) {
+  std::string Stats;
+  llvm::raw_string_ostream OS(Stats);
+  OS << llvm::format("%f\n", MBPerSec);
+  if (!WriteFile(BaselinePath(SaveBaseline, M, W, ".bc"), Bitcode) ||
+      !WriteFile(BaselinePath(SaveBaseline, M, W, ".txt"), OS.str()))
+    return 1;
+  return 0;
+}
+
+// Compare Bitcode and the throughput of W on M with the ones stored by
+// -save-baseline. Returns the number of failures.
+unsigned CompareWithBaseline(const llvm::Module *M, const Writer &W,
+                             const std::string &Bitcode, double MBPerSec) {
+  std::string OldBitcode, OldStats;
+  if (!ReadFile(BaselinePath(Baseline, M, W, ".bc"), OldBitcode) ||
+      !ReadFile(BaselinePath(Baseline, M, W, ".txt"), OldStats))
+    return 1;
+  double OldMBPerSec = strtod(OldStats.c_str(), NULL);
+
+  llvm::outs() << llvm::format("%-24s %-14s baseline %10.2f MB/s, now "
+                               "%10.2f MB/s",
+                               "", W.Name, OldMBPerSec, MBPerSec);
+  if (OldMBPerSec > 0)
+    llvm::outs() << llvm::format(" (%+.1f%%)",
+                                 (MBPerSec / OldMBPerSec - 1) * 100);
+  if (Bitcode == OldBitcode) {
+    llvm::outs() << "  same bitcode\n";
+    return 0;
+  }
+  llvm::outs() << llvm::format("  DIFFERENT bitcode (%llu vs %llu bytes)\n",
+                               (unsigned long long) OldBitcode.size(),
+                               (unsigned long long) Bitcode.size());
+  return 1;
+}
+
+// Benchmark every writer on M. Returns the number of failures.
+unsigned BenchmarkModule(const llvm::Module *M) {
+  unsigned Failures = 0;
+  std::string Expected = PrintModule(M);
+
+  for (unsigned w = 0; w < sizeof(Writers) / sizeof(Writers[0]); w++) {
+    const Writer &W = Writers[w];
+    llvm::outs() << llvm::format("%-24s %-14s ",
+                                 M->getModuleIdentifier().c_str(), W.Name);
+
+    RunResult R;
+    long PeakKB;
+    if (!TimedRun(M, W, R, PeakKB)) {
+      llvm::outs() << "FAILED to run\n";
+      Failures++;
+      continue;
+    }
+
+    double MBPerSec = 0;
+    if (R.Seconds > 0)
+      MBPerSec = R.Bytes / R.Seconds / (1024.0 * 1024.0);
+    llvm::outs() << llvm::format("%10llu %10.2f %10ld  ",
+                                 (unsigned long long) (R.Bytes / Iterations),
+                                 MBPerSec, PeakKB);
+
+    std::string Bitcode;
+    {
+      llvm::raw_string_ostream OS(Bitcode);
+      W.Write(M, OS);
+    }
+    std::string Diff = RoundTrip(Bitcode, M, Expected);
+    if (Diff.empty()) {
+      llvm::outs() << "ok\n";
+    } else {
+      llvm::outs() << "MISMATCH (" << Diff << ")\n";
+      Failures++;
+    }
+    if (!SaveBaseline.empty())
+      Failures += SaveToBaseline(M, W, Bitcode, MBPerSec);
+    if (!Baseline.empty())
+      Failures += CompareWithBaseline(M, W, Bitcode, MBPerSec);
+    llvm::outs().flush();
+  }
+
+  return Failures;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  atexit(llvm::llvm_shutdown);
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "Renderscript bitcode writer benchmark\n");
+  if (Iterations == 0)
+    Iterations = 1;
+  // The generated kernels index the float table with a mask.
+  if (TableSize == 0 || (TableSize & (TableSize - 1)) != 0) {
+    llvm::errs() << argv[0] << ": -table-size must be a power of two\n";
+    return 1;
+  }
+
+  llvm::LLVMContext Context;
+  std::vector<llvm::Module*> Modules;
+
+  if (InputFilenames.empty()) {
+    Modules.push_back(GenerateModule(Context));
+  } else {
+    for (unsigned i = 0, e = InputFilenames.size(); i != e; i++) {
+      llvm::SMDiagnostic Err;
+      llvm::Module *M = llvm::ParseIRFile(InputFilenames[i], Err, Context);
+      if (!M) {
+        Err.print(argv[0], llvm::errs());
+        return 1;
+      }
+      Modules.push_back(M);
+    }
+  }
+
+  llvm::OwningPtr<llvm::Module> Legacy;
+  if (!CompareLegacy.empty()) {
+    llvm::SMDiagnostic Err;
+    Legacy.reset(llvm::ParseIRFile(CompareLegacy, Err, Context));
+    if (!Legacy) {
+      Err.print(argv[0], llvm::errs());
+      return 1;
+    }
+  }
+
+  unsigned Failures = 0;
+  if (!MetadataOnly && !Legacy)
+    llvm::outs() << llvm::format("%-24s %-14s %10s %10s %10s  %s\n",
+                                 "Module", "Writer", "Bytes", "MB/s",
+                                 "Peak KB", "Round-trip");
+  for (unsigned i = 0, e = Modules.size(); i != e; i++) {
+    std::string Err;
+    if (llvm::verifyModule(*Modules[i], llvm::ReturnStatusAction, &Err)) {
+      llvm::errs() << Modules[i]->getModuleIdentifier()
+                   << ": invalid module: " << Err << "\n";
+      Failures++;
+    } else if (Legacy) {
+      Failures += CompareWithLegacy(Modules[i], Legacy.get());
+    } else {
+      if (!MetadataOnly)
+        Failures += BenchmarkModule(Modules[i]);
+      Failures += BenchmarkExportLoad(Modules[i]);
+      Failures += BenchmarkSpecMetadata(Modules[i]);
+      Failures += CheckObjectSlots(Modules[i]);
+    }
+    delete Modules[i];
+  }
+
+  return Failures != 0;
+}
@@ -94,11 +94,32 @@ bool SlangRS::generateBitcodeAccessor(const std::string &OutputPathBase,
   BCAccessorContext.reflectPath = OutputPathBase.c_str();
   BCAccessorContext.packageName = PackageName.c_str();
   BCAccessorContext.bcStorage = BCST_JAVA_CODE;   // Must be BCST_JAVA_CODE
+  BCAccessorContext.bcEncoding = mBitcodeAccessorEncoding;
+
+  std::vector<std::pair<std::string, std::string> > BundledBitcode =
+      getBundledBitcode();
+  BCAccessorContext.bundledBitCode =
+      BundledBitcode.empty() ? NULL : &BundledBitcode;
 
   return RSSlangReflectUtils::GenerateBitCodeAccessor(BCAccessorContext);
 }
 
+std::vector<std::pair<std::string, std::string> >
+SlangRS::getBundledBitcode() {
+  std::vector<std::pair<std::string, std::string> > BundledBitcode;
+  for (std::vector<std::string>::const_iterator I = mBundledABIs.begin(),
+          E = mBundledABIs.end();
+       I != E;
+       I++) {
+    BundledBitcode.push_back(std::make_pair(*I,
+        RSSlangReflectUtils::BundledBCFileName(getOutputFileName().c_str(),
+                                               I->c_str())));
+  }
+  return BundledBitcode;
+}
+
 bool SlangRS::checkODR(const char *CurInputFile) {
+  mODRStore.addFile(CurInputFile);
   for (RSContext::ExportableList::iterator I = mRSContext->exportable_begin(),
           E = mRSContext->exportable_end();
        I != E;
@@ -118,72 +139,38 @@ bool SlangRS::checkODR(const char *CurInputFile) {
     if (ERT->isArtificial())
       continue;
 
-    // Key to lookup ERT in ReflectedDefinitions
-    llvm::StringRef RDKey(ERT->getName());
-    ReflectedDefinitionListTy::const_iterator RD =
-        ReflectedDefinitions.find(RDKey);
-
-    if (RD != ReflectedDefinitions.end()) {
-      const RSExportRecordType *Reflected = RD->getValue().first;
-      // There's a record (struct) with the same name reflected before. Enforce
-      // ODR checking - the Reflected must hold *exactly* the same "definition"
-      // as the one defined previously. We say two record types A and B have the
-      // same definition iff:
-      //
-      //  struct A {              struct B {
-      //    Type(a1) a1,            Type(b1) b1,
-      //    Type(a2) a2,            Type(b1) b2,
-      //    ...                     ...
-      //    Type(aN) aN             Type(b3) b3,
-      //  };                      }
-      //  Cond. #1. They have same number of fields, i.e., N = M;
-      //  Cond. #2. for (i := 1 to N)
-      //              Type(ai) = Type(bi) must hold;
-      //  Cond. #3. for (i := 1 to N)
-      //              Name(ai) = Name(bi) must hold;
-      //
-      // where,
-      //  Type(F) = the type of field F and
-      //  Name(F) = the field name.
-
-      bool PassODR = false;
-      // Cond. #1 and Cond. #2
-      if (Reflected->equals(ERT)) {
-        // Cond #3.
-        RSExportRecordType::const_field_iterator AI = Reflected->fields_begin(),
-                                                 BI = ERT->fields_begin();
-
-        for (unsigned i = 0, e = Reflected->getFields().size(); i != e; i++) {
-          if ((*AI)->getName() != (*BI)->getName())
-            break;
-          AI++;
-          BI++;
-        }
-        PassODR = (AI == (Reflected->fields_end()));
-      }
-
-      if (!PassODR) {
-        getDiagnostics().Report(mDiagErrorODR) << Reflected->getName()
-                                               << getInputFileName()
-                                               << RD->getValue().second;
-        return false;
-      }
-    } else {
-      llvm::StringMapEntry<ReflectedDefinitionTy> *ME =
-          llvm::StringMapEntry<ReflectedDefinitionTy>::Create(RDKey.begin(),
-                                                              RDKey.end());
-      ME->setValue(std::make_pair(ERT, CurInputFile));
-
-      if (!ReflectedDefinitions.insert(ME))
-        delete ME;
-
-      // Take the ownership of ERT such that it won't be freed in ~RSContext().
-      ERT->keep();
+    // There may be a record (struct) with the same name reflected before.
+    // Enforce ODR checking - it must hold *exactly* the same "definition" as
+    // ERT (see RSODRStore::GetLayout()).
+    const RSODRStore::Definition *Reflected = NULL;
+    if (!mODRStore.check(ERT, CurInputFile, &Reflected)) {
+      getDiagnostics().Report(mDiagErrorODR) << ERT->getName()
+                                             << getInputFileName()
+                                             << Reflected->File;
+      return false;
     }
   }
   return true;
 }
 
+bool SlangRS::checkODRTypeDB() {
+  std::vector<RSODRStore::Conflict> Conflicts;
+  std::string ErrMsg;
+  if (!mODRStore.sync(mODRTypeDB, Conflicts, &ErrMsg)) {
+    getDiagnostics().Report(mDiagErrorODRTypeDB) << mODRTypeDB << ErrMsg;
+    return false;
+  }
+
+  for (std::vector<RSODRStore::Conflict>::const_iterator
+           I = Conflicts.begin(), E = Conflicts.end();
+       I != E;
+       I++) {
+    getDiagnostics().Report(mDiagErrorODR) << I->Name << I->File
+                                           << I->OtherFile;
+  }
+  return Conflicts.empty();
+}
+
 void SlangRS::initDiagnostic() {
   clang::DiagnosticsEngine &DiagEngine = getDiagnostics();
 
@@ -208,6 +195,11 @@ void SlangRS::initDiagnostic() {
       "type '%0' in different translation unit (%1 v.s. %2) "
       "has incompatible type definition");
 
+  mDiagErrorODRTypeDB =
+    DiagEngine.getCustomDiagID(
+      clang::DiagnosticsEngine::Error,
+      "cannot update the type database '%0': %1");
+
   mDiagErrorTargetAPIRange =
     DiagEngine.getCustomDiagID(
       clang::DiagnosticsEngine::Error,
@@ -236,16 +228,26 @@ clang::ASTConsumer
 *SlangRS::createBackend(const clang::CodeGenOptions& CodeGenOpts,
                         llvm::raw_ostream *OS,
                         Slang::OutputType OT) {
-    return new RSBackend(mRSContext,
-                         &getDiagnostics(),
-                         CodeGenOpts,
-                         getTargetOptions(),
-                         &mPragmas,
-                         OS,
-                         OT,
-                         getSourceManager(),
-                         mAllowRSPrefix,
-                         mIsFilterscript);
+    RSBackend *B = new RSBackend(mRSContext,
+                                 &getDiagnostics(),
+                                 CodeGenOpts,
+                                 getTargetOptions(),
+                                 &mPragmas,
+                                 OS,
+                                 OT,
+                                 getSourceManager(),
+                                 mAllowRSPrefix,
+                                 mIsFilterscript);
+    B->setEmitFunctionIndex(mEmitFunctionIndex);
+    B->setPrintBitcodeSize(mPrintBitcodeSize);
+    B->setEmitExportBlob(mEmitExportBlob);
+    B->setEmitSpecMetadata(mEmitSpecMetadata);
+    B->setEmitExportLayout(mEmitExportLayout);
+    B->setEmitObjectSlotMap(mEmitObjectSlotMap);
+    B->setFuseASTPasses(mFuseASTPasses);
+    B->setElideRedundantRefCount(mElideRedundantRefCount);
+    B->setReportRefCountElision(mReportRefCountElision);
+    return B;
 }
 
 bool SlangRS::IsRSHeaderFile(const char *File) {
@@ -272,7 +274,12 @@ bool SlangRS::IsLocInRSHeaderFile(const clang::SourceLocation &Loc,
 
 SlangRS::SlangRS()
   : Slang(), mRSContext(NULL), mAllowRSPrefix(false), mTargetAPI(0),
-    mIsFilterscript(false) {
+    mIsFilterscript(false), mBitcodeAccessorEncoding(BCJE_BYTE_ARRAY),
+    mBitcodeCppEmbedding(BCCE_ARRAY), mSkipReflection(false),
+    mEmitExportBlob(false), mEmitSpecMetadata(false),
+    mEmitExportLayout(false), mEmitObjectSlotMap(false),
+    mFuseASTPasses(true), mElideRedundantRefCount(false),
+    mReportRefCountElision(false) {
 }
 
 bool SlangRS::compile(
@@ -347,10 +354,13 @@ bool SlangRS::compile(
     if (Slang::compile() > 0)
       return false;
 
-    if (OutputType != Slang::OT_Dependency) {
+    if ((OutputType != Slang::OT_Dependency) && !mSkipReflection) {
 
       if (BitcodeStorage == BCST_CPP_CODE) {
-          RSReflectionCpp R(mRSContext);
+          std::vector<std::pair<std::string, std::string> > BundledBitcode =
+              getBundledBitcode();
+          RSReflectionCpp R(mRSContext, mBitcodeCppEmbedding,
+                            BundledBitcode.empty() ? NULL : &BundledBitcode);
           bool ret = R.reflect(JavaReflectionPathBase, getInputFileName(), getOutputFileName());
           if (!ret) {
             return false;
@@ -410,6 +420,9 @@ bool SlangRS::compile(
     IOFileIter++;
   }
 
+  if (!mODRTypeDB.empty() && !checkODRTypeDB())
+    return false;
+
   return true;
 }
 
@@ -423,12 +436,6 @@ void SlangRS::reset() {
 
 SlangRS::~SlangRS() {
   delete mRSContext;
-  for (ReflectedDefinitionListTy::iterator I = ReflectedDefinitions.begin(),
-          E = ReflectedDefinitions.end();
-       I != E;
-       I++) {
-    delete I->getValue().first;
-  }
   return;
 }
 
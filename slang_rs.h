@@ -24,14 +24,12 @@
 #include <utility>
 #include <vector>
 
-#include "llvm/ADT/StringMap.h"
-
+#include "slang_rs_odr_store.h"
 #include "slang_rs_reflect_utils.h"
 #include "slang_version.h"
 
 namespace slang {
   class RSContext;
-  class RSExportRecordType;
 
 class SlangRS : public Slang {
  private:
@@ -44,23 +42,54 @@ class SlangRS : public Slang {
 
   bool mIsFilterscript;
 
+  BitCodeJavaEncoding mBitcodeAccessorEncoding;
+
+  BitCodeCppEmbedding mBitcodeCppEmbedding;
+
+  // ABIs whose bitcode is bundled into the accessor of the default one
+  std::vector<std::string> mBundledABIs;
+
+  // Only emit the bitcode (used to compile the bundled ABIs)
+  bool mSkipReflection;
+
+  // Also emit the export information as a binary blob (see RSExportBlob)
+  bool mEmitExportBlob;
+
+  // Also emit the export information through RSMetadataEncoder
+  bool mEmitSpecMetadata;
+
+  // Also emit the layout table of the exports (see RSExportLayout)
+  bool mEmitExportLayout;
+
+  // Emit the object slots in one node (see RSObjectSlots)
+  bool mEmitObjectSlotMap;
+
+  // Validate and annotate static functions in one walk (see RSFusedASTPass)
+  bool mFuseASTPasses;
+
+  // Leave out redundant reference counting (see RSRefCountElision), and
+  // report where
+  bool mElideRedundantRefCount;
+  bool mReportRefCountElision;
+
+  // Type database shared with other invocations for the ODR check (see
+  // RSODRStore), if any
+  std::string mODRTypeDB;
+
+  // <ABI, bitcode file> for mBundledABIs and the current output file.
+  std::vector<std::pair<std::string, std::string> > getBundledBitcode();
+
   // Custom diagnostic identifiers
   unsigned mDiagErrorInvalidOutputDepParameter;
   unsigned mDiagErrorODR;
+  unsigned mDiagErrorODRTypeDB;
   unsigned mDiagErrorTargetAPIRange;
 
   // Collect generated filenames (without the .java) for dependency generation
   std::vector<std::string> mGeneratedFileNames;
 
-  // FIXME: Should be std::list<RSExportable *> here. But currently we only
-  //        check ODR on record type.
-  //
-  // ReflectedDefinitions maps record type name to a pair:
-  //  <its RSExportRecordType instance,
-  //   the first file contains this record type definition>
-  typedef std::pair<RSExportRecordType*, const char*> ReflectedDefinitionTy;
-  typedef llvm::StringMap<ReflectedDefinitionTy> ReflectedDefinitionListTy;
-  ReflectedDefinitionListTy ReflectedDefinitions;
+  // FIXME: Only the record types are checked against the ODR.
+  RSODRStore mODRStore;
 
   // The package name that's really applied will be filled in RealPackageName.
   bool reflectToJava(const std::string &OutputPathBase,
@@ -75,6 +104,9 @@ class SlangRS : public Slang {
   // and is valid before compile() ends.
   bool checkODR(const char *CurInputFile);
 
+  // Check the records of all input files against mODRTypeDB and add them.
+  bool checkODRTypeDB();
+
   // Returns true if this is a Filterscript file.
   static bool isFilterscript(const char *Filename);
 
@@ -147,6 +179,58 @@ class SlangRS : public Slang {
                const std::string &JavaReflectionPackageName,
                const std::string &RSPackageName);
 
+  // How generateBitcodeAccessor() encodes the bitcode (-s jc only).
+  void setBitcodeAccessorEncoding(BitCodeJavaEncoding Encoding) {
+    mBitcodeAccessorEncoding = Encoding;
+  }
+
+  // Make the reflected bitcode accessors also return the bitcode compiled for
+  // each of @ABIs (see RSSlangReflectUtils::BundledBCFileName()).
+  void setBundledABIs(const std::vector<std::string> &ABIs) {
+    mBundledABIs = ABIs;
+  }
+
+  void setSkipReflection(bool Skip) {
+    mSkipReflection = Skip;
+  }
+
+  void setEmitExportBlob(bool EmitExportBlob) {
+    mEmitExportBlob = EmitExportBlob;
+  }
+
+  void setEmitSpecMetadata(bool EmitSpecMetadata) {
+    mEmitSpecMetadata = EmitSpecMetadata;
+  }
+
+  void setEmitExportLayout(bool EmitExportLayout) {
+    mEmitExportLayout = EmitExportLayout;
+  }
+
+  void setEmitObjectSlotMap(bool EmitObjectSlotMap) {
+    mEmitObjectSlotMap = EmitObjectSlotMap;
+  }
+
+  void setFuseASTPasses(bool FuseASTPasses) {
+    mFuseASTPasses = FuseASTPasses;
+  }
+
+  void setElideRedundantRefCount(bool ElideRedundantRefCount) {
+    mElideRedundantRefCount = ElideRedundantRefCount;
+  }
+
+  void setReportRefCountElision(bool ReportRefCountElision) {
+    mReportRefCountElision = ReportRefCountElision;
+  }
+
+  void setODRTypeDB(const std::string &ODRTypeDB) {
+    mODRTypeDB = ODRTypeDB;
+  }
+
+  // How the C++ reflection embeds the bitcode (-reflect-c++ only).
+  void setBitcodeCppEmbedding(BitCodeCppEmbedding Embedding) {
+    mBitcodeCppEmbedding = Embedding;
+  }
+
   virtual void reset();
 
   virtual ~SlangRS();
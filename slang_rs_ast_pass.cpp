@@ -0,0 +1,58 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_ast_pass.h"
+
+#include "clang/AST/Stmt.h"
+
+namespace slang {
+
+void RSFusedASTPass::walk(clang::Stmt *S, const PassList &Passes) {
+  llvm::SmallVector<clang::Stmt*, 8> Children;
+  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
+       I != E;
+       I++) {
+    if (clang::Stmt *Child = *I) {
+      Children.push_back(Child);
+    }
+  }
+
+  PassList Entered;
+  for (PassList::const_iterator I = Passes.begin(), E = Passes.end();
+       I != E;
+       I++) {
+    if ((*I)->enterStmt(S)) {
+      Entered.push_back(*I);
+    }
+  }
+
+  if (Entered.empty()) {
+    return;
+  }
+
+  for (unsigned i = 0, e = Children.size(); i != e; i++) {
+    walk(Children[i], Entered);
+  }
+
+  for (PassList::reverse_iterator I = Entered.rbegin(), E = Entered.rend();
+       I != E;
+       I++) {
+    (*I)->leaveStmt(S);
+  }
+  return;
+}
+
+}  // namespace slang
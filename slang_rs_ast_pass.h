@@ -0,0 +1,68 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_AST_PASS_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_AST_PASS_H_
+
+#include "llvm/ADT/SmallVector.h"
+
+namespace clang {
+  class Stmt;
+}
+
+namespace slang {
+
+// A per-statement RS check or rewrite, run by RSFusedASTPass.
+class RSStmtPass {
+ public:
+  virtual ~RSStmtPass() { }
+
+  // Called on S before any of its children. Return false to skip the children
+  // of S (and leaveStmt(S)) for this pass; the other passes are unaffected.
+  virtual bool enterStmt(clang::Stmt *S) = 0;
+
+  // Called on S after all of its children.
+  virtual void leaveStmt(clang::Stmt *S) { }
+};
+
+// Walks a statement tree once and runs every added pass on each statement,
+// instead of having each pass recurse through the tree with its own
+// StmtVisitor.
+//
+// The children of a statement are taken before any pass enters it, so a pass
+// may rewrite the statement (or replace it in its parent) without the other
+// passes seeing the rewritten tree.
+class RSFusedASTPass {
+ private:
+  typedef llvm::SmallVector<RSStmtPass*, 4> PassList;
+  PassList mPasses;
+
+  void walk(clang::Stmt *S, const PassList &Passes);
+
+ public:
+  void addPass(RSStmtPass *P) {
+    mPasses.push_back(P);
+  }
+
+  void run(clang::Stmt *S) {
+    if (S != NULL && !mPasses.empty())
+      walk(S, mPasses);
+  }
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_AST_PASS_H_  NOLINT
@@ -37,12 +37,18 @@
 
 #include "slang_assert.h"
 #include "slang_rs.h"
+#include "slang_rs_ast_pass.h"
 #include "slang_rs_context.h"
+#include "slang_rs_export_blob.h"
 #include "slang_rs_export_foreach.h"
 #include "slang_rs_export_func.h"
+#include "slang_rs_export_layout.h"
 #include "slang_rs_export_type.h"
 #include "slang_rs_export_var.h"
 #include "slang_rs_metadata.h"
+#include "slang_rs_metadata_spec.h"
+#include "slang_rs_object_slots.h"
+#include "slang_version.h"
 
 namespace slang {
 
@@ -61,6 +67,11 @@ RSBackend::RSBackend(RSContext *Context,
     mSourceMgr(SourceMgr),
     mAllowRSPrefix(AllowRSPrefix),
     mIsFilterscript(IsFilterscript),
+    mEmitExportBlob(false),
+    mEmitSpecMetadata(false),
+    mEmitExportLayout(false),
+    mEmitObjectSlotMap(false),
+    mFuseASTPasses(true),
     mExportVarMetadata(NULL),
     mExportFuncMetadata(NULL),
     mExportForEachNameMetadata(NULL),
@@ -68,8 +79,7 @@ RSBackend::RSBackend(RSContext *Context,
     mExportTypeMetadata(NULL),
     mRSObjectSlotsMetadata(NULL),
     mRefCount(mContext->getASTContext()),
-    mASTChecker(mContext->getASTContext(), mContext->getTargetAPI(),
-                IsFilterscript) {
+    mASTChecker(mContext, IsFilterscript) {
 }
 
 // 1) Add zero initialization of local RS object types
@@ -78,7 +88,9 @@ void RSBackend::AnnotateFunction(clang::FunctionDecl *FD) {
       FD->hasBody() &&
       !SlangRS::IsLocInRSHeaderFile(FD->getLocation(), mSourceMgr)) {
     mRefCount.Init();
-    mRefCount.Visit(FD->getBody());
+    RSFusedASTPass Walker;
+    Walker.addPass(&mRefCount);
+    Walker.run(FD->getBody());
   }
   return;
 }
@@ -133,8 +145,17 @@ bool RSBackend::HandleTopLevelDecl(clang::DeclGroupRef D) {
 void RSBackend::HandleTranslationUnitPre(clang::ASTContext &C) {
   clang::TranslationUnitDecl *TUDecl = C.getTranslationUnitDecl();
 
+  // Global functions were already annotated in HandleTopLevelDecl(), since
+  // code for them is generated right away. Static functions are generated
+  // later, so the walk that validates their bodies can annotate them too.
+  RSStmtPass *StaticFunctionPass = NULL;
+  if (mFuseASTPasses) {
+    mRefCount.Init();
+    StaticFunctionPass = &mRefCount;
+  }
+
   // If we have an invalid RS/FS AST, don't check further.
-  if (!mASTChecker.Validate()) {
+  if (!mASTChecker.Validate(StaticFunctionPass)) {
     return;
   }
 
@@ -172,13 +193,15 @@ void RSBackend::HandleTranslationUnitPre(clang::ASTContext &C) {
   }
 
   // Process any static function declarations
-  for (clang::DeclContext::decl_iterator I = TUDecl->decls_begin(),
-          E = TUDecl->decls_end(); I != E; I++) {
-    if ((I->getKind() >= clang::Decl::firstFunction) &&
-        (I->getKind() <= clang::Decl::lastFunction)) {
-      clang::FunctionDecl *FD = llvm::dyn_cast<clang::FunctionDecl>(*I);
-      if (FD && !FD->isGlobal()) {
-        AnnotateFunction(FD);
+  if (!mFuseASTPasses) {
+    for (clang::DeclContext::decl_iterator I = TUDecl->decls_begin(),
+            E = TUDecl->decls_end(); I != E; I++) {
+      if ((I->getKind() >= clang::Decl::firstFunction) &&
+          (I->getKind() <= clang::Decl::lastFunction)) {
+        clang::FunctionDecl *FD = llvm::dyn_cast<clang::FunctionDecl>(*I);
+        if (FD && !FD->isGlobal()) {
+          AnnotateFunction(FD);
+        }
       }
     }
   }
@@ -187,6 +210,172 @@ void RSBackend::HandleTranslationUnitPre(clang::ASTContext &C) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
+// Emit the exported vars, funcs and record types once more through
+// RSMetadataEncoder (see slang_rs_metadata_spec.h). All names go to one
+// string table and all types to one deduplicated type table. FuncNames are
+// the names the legacy metadata uses for the exported functions.
+void RSBackend::EmitSpecMetadata(llvm::Module *M,
+                                 const std::vector<std::string> &FuncNames) {
+  RSMetadataEncoder *Encoder = CreateRSMetadataEncoder(M);
+  int Res = 0;
+
+  for (RSContext::const_export_var_iterator I = mContext->export_vars_begin(),
+          E = mContext->export_vars_end();
+       I != E && Res == 0;
+       I++) {
+    RSVar V;
+    V.name = (*I)->getName().c_str();
+    V.type = (*I)->getType()->getSpecType();
+    Res = RSEncodeVarMetadata(Encoder, &V);
+  }
+
+  for (size_t i = 0; i < FuncNames.size() && Res == 0; i++) {
+    RSFunction F;
+    F.name = FuncNames[i].c_str();
+    Res = RSEncodeFunctionMetadata(Encoder, &F);
+  }
+
+  for (RSContext::const_export_type_iterator
+          I = mContext->export_types_begin(),
+          E = mContext->export_types_end();
+       I != E && Res == 0;
+       I++) {
+    const RSExportType *ET = I->getValue();
+    if (ET->getClass() == RSExportType::ExportClassRecord)
+      Res = RSEncodeTypeMetadata(Encoder, ET->getSpecType());
+  }
+
+  if (Res == 0) {
+    Res = FinalizeRSMetadataEncoder(Encoder);
+  } else {
+    DestroyRSMetadataEncoder(Encoder);
+  }
+
+  if (Res != 0) {
+    mDiagEngine.Report(
+        mSourceMgr.getLocForEndOfFile(mSourceMgr.getMainFileID()),
+        mDiagEngine.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                                    "failed to encode the export type "
+                                    "information (error %0)"))
+        << Res;
+  }
+  return;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Emit the size, alignment and field offsets of the exports as clang laid
+// them out, after checking them against the struct types clang generated.
+void RSBackend::EmitExportLayout(llvm::Module *M) {
+  RSExportLayout Layout;
+  std::string ErrMsg;
+
+  Layout.collect(mContext);
+  if (!Layout.verify(M, &ErrMsg)) {
+    mDiagEngine.Report(
+        mSourceMgr.getLocForEndOfFile(mSourceMgr.getMainFileID()),
+        mDiagEngine.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                                    "inconsistent export layout: %0"))
+        << ErrMsg;
+    return;
+  }
+
+  Layout.writeToModule(M);
+  return;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Emit the object slots of the NumVars exported vars as RS_OBJECT_SLOT_MAP_MN
+// instead of one RS_OBJECT_SLOTS_MN node per slot, and check that the map
+// reads back as the same slots.
+void RSBackend::EmitObjectSlotMap(llvm::Module *M, unsigned NumVars,
+                                  const std::vector<unsigned> &Slots) {
+  RSObjectSlots SlotMap;
+  SlotMap.NumVars = NumVars;
+  SlotMap.Slots = Slots;
+  SlotMap.writeToModule(M);
+
+  RSObjectSlots ReadBack;
+  std::string ErrMsg;
+  if (!ReadBack.readFromModule(M, &ErrMsg) || ReadBack != SlotMap) {
+    if (ErrMsg.empty())
+      ErrMsg = "slots differ after decoding";
+    mDiagEngine.Report(
+        mSourceMgr.getLocForEndOfFile(mSourceMgr.getMainFileID()),
+        mDiagEngine.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                                    "invalid object slot map: %0"))
+        << ErrMsg;
+  }
+  return;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Create "void .rs.batch_update(i8 *Packet)". For every batch variable i whose
+// bit is set in the dirty masks at the start of the packet, the value stored at
+// its packet offset is copied into the global. See
+// RSContext::computeBatchLayout() for the packet layout.
+void RSBackend::CreateBatchUpdateFunction(llvm::Module *M) {
+  llvm::Type *Int8PtrTy = llvm::Type::getInt8PtrTy(mLLVMContext);
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(mLLVMContext);
+
+  llvm::FunctionType *BatchUpdateType =
+      llvm::FunctionType::get(llvm::Type::getVoidTy(mLLVMContext),
+                              Int8PtrTy,
+                              /* IsVarArgs = */false);
+  llvm::Function *BatchUpdate =
+      llvm::Function::Create(BatchUpdateType,
+                             llvm::GlobalValue::ExternalLinkage,
+                             RS_BATCH_UPDATE_FUNC_NAME,
+                             M);
+  BatchUpdate->addFnAttr(llvm::Attribute::NoInline);
+
+  llvm::Value *Packet = &(*BatchUpdate->arg_begin());
+  llvm::BasicBlock *BB =
+      llvm::BasicBlock::Create(mLLVMContext, "entry", BatchUpdate);
+  llvm::IRBuilder<> IB(BB);
+
+  // Load all the dirty masks up front.
+  llvm::Value *Masks =
+      IB.CreateBitCast(Packet, llvm::PointerType::getUnqual(Int32Ty));
+  std::vector<llvm::Value*> MaskWords;
+  for (size_t i = 0; i < mContext->getNumBatchMaskWords(); i++) {
+    MaskWords.push_back(
+        IB.CreateLoad(IB.CreateConstInBoundsGEP1_32(Masks, i)));
+  }
+
+  size_t Index = 0;
+  for (RSContext::const_batch_var_iterator I = mContext->batch_vars_begin(),
+          E = mContext->batch_vars_end();
+       I != E;
+       I++, Index++) {
+    const RSExportVar *EV = I->first;
+    llvm::GlobalVariable *GV = M->getNamedGlobal(EV->getName());
+    slangAssert(GV && "Variable marked as exported disappeared in Bitcode");
+
+    llvm::BasicBlock *UpdateBB =
+        llvm::BasicBlock::Create(mLLVMContext, "update", BatchUpdate);
+    llvm::BasicBlock *NextBB =
+        llvm::BasicBlock::Create(mLLVMContext, "next", BatchUpdate);
+
+    llvm::Value *Bit = llvm::ConstantInt::get(Int32Ty, 1u << (Index % 32));
+    llvm::Value *IsDirty =
+        IB.CreateICmpNE(IB.CreateAnd(MaskWords[Index / 32], Bit),
+                        llvm::ConstantInt::get(Int32Ty, 0));
+    IB.CreateCondBr(IsDirty, UpdateBB, NextBB);
+
+    IB.SetInsertPoint(UpdateBB);
+    IB.CreateMemCpy(IB.CreateBitCast(GV, Int8PtrTy),
+                    IB.CreateConstInBoundsGEP1_32(Packet, I->second),
+                    RSExportType::GetTypeAllocSize(EV->getType()),
+                    /* Align = */1);
+    IB.CreateBr(NextBB);
+
+    IB.SetInsertPoint(NextBB);
+  }
+
+  IB.CreateRetVoid();
+  return;
+}
+
 void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
   if (!mContext->processExport()) {
     return;
@@ -197,9 +386,15 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
   OptimizationOption.push_back(llvm::ConstantInt::get(
     mLLVMContext, llvm::APInt(32, mCodeGenOpts.OptimizationLevel)));
 
+  // The same export information, collected for -emit-export-blob
+  RSExportBlob ExportBlob;
+
   // Dump export variable info
   if (mContext->hasExportVar()) {
     int slotCount = 0;
+    // Runtimes up to JB MR2 only read the legacy #rs_object_slots.
+    bool UseObjectSlotMap = mEmitObjectSlotMap &&
+        (getTargetAPI() > SLANG_JB_MR2_TARGET_API);
     if (mExportVarMetadata == NULL)
       mExportVarMetadata = M->getOrInsertNamedMetadata(RS_EXPORT_VAR_MN);
 
@@ -215,10 +410,14 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
       const RSExportVar *EV = *I;
       const RSExportType *ET = EV->getType();
       bool countsAsRSObject = false;
+      RSExportBlob::Var BlobVar;
 
       // Variable name
       ExportVarInfo.push_back(
           llvm::MDString::get(mLLVMContext, EV->getName().c_str()));
+      BlobVar.Name = EV->getName();
+      BlobVar.TypeKind = RSExportBlob::VTK_TypeName;
+      BlobVar.DataType = 0;
 
       // Type name
       switch (ET->getClass()) {
@@ -228,52 +427,63 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
           ExportVarInfo.push_back(
               llvm::MDString::get(
                 mLLVMContext, llvm::utostr_32(PT->getType())));
+          BlobVar.TypeKind = RSExportBlob::VTK_DataType;
+          BlobVar.DataType = PT->getType();
           if (PT->isRSObjectType()) {
             countsAsRSObject = true;
           }
           break;
         }
         case RSExportType::ExportClassPointer: {
+          BlobVar.TypeName = "*" + static_cast<const RSExportPointerType*>(ET)
+              ->getPointeeType()->getName();
           ExportVarInfo.push_back(
-              llvm::MDString::get(
-                mLLVMContext, ("*" + static_cast<const RSExportPointerType*>(ET)
-                  ->getPointeeType()->getName()).c_str()));
+              llvm::MDString::get(mLLVMContext, BlobVar.TypeName.c_str()));
           break;
         }
         case RSExportType::ExportClassMatrix: {
+          BlobVar.TypeKind = RSExportBlob::VTK_DataType;
+          BlobVar.DataType =
+              RSExportPrimitiveType::DataTypeRSMatrix2x2 +
+              static_cast<const RSExportMatrixType*>(ET)->getDim() - 2;
           ExportVarInfo.push_back(
               llvm::MDString::get(
-                mLLVMContext, llvm::utostr_32(
-                  RSExportPrimitiveType::DataTypeRSMatrix2x2 +
-                  static_cast<const RSExportMatrixType*>(ET)->getDim() - 2)));
+                mLLVMContext, llvm::utostr_32(BlobVar.DataType)));
           break;
         }
         case RSExportType::ExportClassVector:
         case RSExportType::ExportClassConstantArray:
         case RSExportType::ExportClassRecord: {
+          BlobVar.TypeName = EV->getType()->getName();
           ExportVarInfo.push_back(
               llvm::MDString::get(mLLVMContext,
                 EV->getType()->getName().c_str()));
           break;
         }
       }
+      ExportBlob.Vars.push_back(BlobVar);
 
       mExportVarMetadata->addOperand(
           llvm::MDNode::get(mLLVMContext, ExportVarInfo));
       ExportVarInfo.clear();
 
-      if (mRSObjectSlotsMetadata == NULL) {
+      if (mRSObjectSlotsMetadata == NULL && !UseObjectSlotMap) {
         mRSObjectSlotsMetadata =
             M->getOrInsertNamedMetadata(RS_OBJECT_SLOTS_MN);
       }
 
       if (countsAsRSObject) {
-        mRSObjectSlotsMetadata->addOperand(llvm::MDNode::get(mLLVMContext,
-            llvm::MDString::get(mLLVMContext, llvm::utostr_32(slotCount))));
+        if (!UseObjectSlotMap)
+          mRSObjectSlotsMetadata->addOperand(llvm::MDNode::get(mLLVMContext,
+              llvm::MDString::get(mLLVMContext, llvm::utostr_32(slotCount))));
+        ExportBlob.ObjectSlots.push_back(slotCount);
       }
 
       slotCount++;
     }
+
+    if (UseObjectSlotMap)
+      EmitObjectSlotMap(M, slotCount, ExportBlob.ObjectSlots);
   }
 
   // Dump export function info
@@ -295,6 +505,7 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
       if (!EF->hasParam()) {
         ExportFuncInfo.push_back(llvm::MDString::get(mLLVMContext,
                                                      EF->getName().c_str()));
+        ExportBlob.Funcs.push_back(EF->getName());
       } else {
         llvm::Function *F = M->getFunction(EF->getName());
         llvm::Function *HelperFunction;
@@ -397,6 +608,7 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
 
         ExportFuncInfo.push_back(
             llvm::MDString::get(mLLVMContext, HelperFunctionName.c_str()));
+        ExportBlob.Funcs.push_back(HelperFunctionName);
       }
 
       mExportFuncMetadata->addOperand(
@@ -405,6 +617,22 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
     }
   }
 
+  // Export the batch update helper after the user functions so that the
+  // invokable slots of those stay the same with or without it.
+  if (mContext->hasBatchVar()) {
+    CreateBatchUpdateFunction(M);
+
+    if (mExportFuncMetadata == NULL)
+      mExportFuncMetadata =
+          M->getOrInsertNamedMetadata(RS_EXPORT_FUNC_MN);
+
+    mExportFuncMetadata->addOperand(
+        llvm::MDNode::get(mLLVMContext,
+                          llvm::MDString::get(mLLVMContext,
+                                              RS_BATCH_UPDATE_FUNC_NAME)));
+    ExportBlob.Funcs.push_back(RS_BATCH_UPDATE_FUNC_NAME);
+  }
+
   // Dump export function info
   if (mContext->hasExportForEach()) {
     if (mExportForEachNameMetadata == NULL) {
@@ -440,6 +668,11 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
       mExportForEachSignatureMetadata->addOperand(
           llvm::MDNode::get(mLLVMContext, ExportForEachInfo));
       ExportForEachInfo.clear();
+
+      RSExportBlob::ForEach BlobForEach;
+      BlobForEach.Name = EFE->getName();
+      BlobForEach.Signature = EFE->getSignatureMetadata();
+      ExportBlob.ForEachs.push_back(BlobForEach);
     }
   }
 
@@ -480,6 +713,9 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
 
         slangAssert(StructInfoMetadata->getNumOperands() == 0 &&
                     "Metadata with same name was created before");
+        ExportBlob.Records.push_back(RSExportBlob::Record());
+        RSExportBlob::Record &BlobRecord = ExportBlob.Records.back();
+        BlobRecord.Name = ET->getName();
         for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
                 FE = ERT->fields_end();
              FI != FE;
@@ -498,11 +734,25 @@ void RSBackend::HandleTranslationUnitPost(llvm::Module *M) {
           StructInfoMetadata->addOperand(
               llvm::MDNode::get(mLLVMContext, FieldInfo));
           FieldInfo.clear();
+
+          RSExportBlob::Field BlobField;
+          BlobField.Name = F->getName();
+          BlobField.TypeName = F->getType()->getName();
+          BlobRecord.Fields.push_back(BlobField);
         }
       }   // ET->getClass() == RSExportType::ExportClassRecord
     }
   }
 
+  if (mEmitExportBlob)
+    ExportBlob.writeToModule(M);
+
+  if (mEmitSpecMetadata)
+    EmitSpecMetadata(M, ExportBlob.Funcs);
+
+  if (mEmitExportLayout)
+    EmitExportLayout(M);
+
   return;
 }
 
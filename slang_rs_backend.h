@@ -17,6 +17,9 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_BACKEND_H_  // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_BACKEND_H_
 
+#include <string>
+#include <vector>
+
 #include "slang_backend.h"
 #include "slang_pragma_recorder.h"
 #include "slang_rs_check_ast.h"
@@ -50,6 +53,22 @@ class RSBackend : public Backend {
 
   bool mIsFilterscript;
 
+  // Also emit the export information as one binary blob (RS_EXPORT_BLOB_MN)
+  bool mEmitExportBlob;
+
+  // Also emit the export information through RSMetadataEncoder
+  bool mEmitSpecMetadata;
+
+  // Also emit the layout table of the exports (see slang_rs_export_layout.h)
+  bool mEmitExportLayout;
+
+  // Emit all object slots in one RS_OBJECT_SLOT_MAP_MN node (for target APIs
+  // whose runtimes read it)
+  bool mEmitObjectSlotMap;
+
+  // Annotate static functions in the same walk that validates them
+  bool mFuseASTPasses;
+
   llvm::NamedMDNode *mExportVarMetadata;
   llvm::NamedMDNode *mExportFuncMetadata;
   llvm::NamedMDNode *mExportForEachNameMetadata;
@@ -64,6 +83,16 @@ class RSBackend : public Backend {
 
   void AnnotateFunction(clang::FunctionDecl *FD);
 
+  void CreateBatchUpdateFunction(llvm::Module *M);
+
+  void EmitSpecMetadata(llvm::Module *M,
+                        const std::vector<std::string> &FuncNames);
+
+  void EmitExportLayout(llvm::Module *M);
+
+  void EmitObjectSlotMap(llvm::Module *M, unsigned NumVars,
+                         const std::vector<unsigned> &Slots);
+
  protected:
   virtual unsigned int getTargetAPI() const {
     return mContext->getTargetAPI();
@@ -87,6 +116,34 @@ class RSBackend : public Backend {
             bool AllowRSPrefix,
             bool IsFilterscript);
 
+  void setEmitExportBlob(bool EmitExportBlob) {
+    mEmitExportBlob = EmitExportBlob;
+  }
+
+  void setEmitSpecMetadata(bool EmitSpecMetadata) {
+    mEmitSpecMetadata = EmitSpecMetadata;
+  }
+
+  void setEmitExportLayout(bool EmitExportLayout) {
+    mEmitExportLayout = EmitExportLayout;
+  }
+
+  void setEmitObjectSlotMap(bool EmitObjectSlotMap) {
+    mEmitObjectSlotMap = EmitObjectSlotMap;
+  }
+
+  void setFuseASTPasses(bool FuseASTPasses) {
+    mFuseASTPasses = FuseASTPasses;
+  }
+
+  void setElideRedundantRefCount(bool ElideRedundantRefCount) {
+    mRefCount.setElideRedundant(ElideRedundantRefCount);
+  }
+
+  void setReportRefCountElision(bool ReportRefCountElision) {
+    mRefCount.setReportElision(ReportRefCountElision);
+  }
+
   virtual ~RSBackend();
 };
 }  // namespace slang
@@ -16,6 +16,9 @@
 
 #include "slang_rs_check_ast.h"
 
+#include "clang/AST/Expr.h"
+#include "clang/AST/Stmt.h"
+
 #include "slang_assert.h"
 #include "slang_rs.h"
 #include "slang_rs_export_foreach.h"
@@ -23,20 +26,14 @@
 
 namespace slang {
 
-void RSCheckAST::VisitStmt(clang::Stmt *S) {
-  // This function does the actual iteration through all sub-Stmt's within
-  // a given Stmt. Note that this function is skipped by all of the other
-  // Visit* functions if we have already found a higher-level match.
-  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
-       I != E;
-       I++) {
-    if (clang::Stmt *Child = *I) {
-      Visit(Child);
-    }
-  }
+void RSCheckAST::CheckStmt(clang::Stmt *S) {
+  RSFusedASTPass Walker;
+  Walker.addPass(this);
+  Walker.run(S);
 }
 
-void RSCheckAST::ValidateFunctionDecl(clang::FunctionDecl *FD) {
+void RSCheckAST::ValidateFunctionDecl(clang::FunctionDecl *FD,
+                                      RSStmtPass *BodyPass) {
   if (!FD) {
     return;
   }
@@ -48,17 +45,16 @@ void RSCheckAST::ValidateFunctionDecl(clang::FunctionDecl *FD) {
     clang::QualType resultType = FD->getResultType().getCanonicalType();
 
     // We use FD as our NamedDecl in the case of a bad return type.
-    if (!RSExportType::ValidateType(C, resultType, FD,
-                                    FD->getLocStart(), mTargetAPI,
-                                    mIsFilterscript)) {
+    if (!RSExportType::ValidateType(mContext, resultType, FD,
+                                    FD->getLocStart(), mIsFilterscript)) {
       mValid = false;
     }
 
     for (size_t i = 0; i < numParams; i++) {
       clang::ParmVarDecl *PVD = FD->getParamDecl(i);
       clang::QualType QT = PVD->getType().getCanonicalType();
-      if (!RSExportType::ValidateType(C, QT, PVD, PVD->getLocStart(),
-                                      mTargetAPI, mIsFilterscript)) {
+      if (!RSExportType::ValidateType(mContext, QT, PVD, PVD->getLocStart(),
+                                      mIsFilterscript)) {
         mValid = false;
       }
     }
@@ -68,16 +64,21 @@ void RSCheckAST::ValidateFunctionDecl(clang::FunctionDecl *FD) {
   mInKernel = RSExportForEach::isRSForEachFunc(mTargetAPI, &mDiagEngine, FD);
 
   if (clang::Stmt *Body = FD->getBody()) {
-    Visit(Body);
+    RSFusedASTPass Walker;
+    Walker.addPass(this);
+    if (BodyPass) {
+      Walker.addPass(BodyPass);
+    }
+    Walker.run(Body);
   }
 
   mInKernel = saveKernel;
 }
 
 
-void RSCheckAST::ValidateVarDecl(clang::VarDecl *VD) {
+bool RSCheckAST::ValidateVarDecl(clang::VarDecl *VD) {
   if (!VD) {
-    return;
+    return true;
   }
 
   clang::QualType QT = VD->getType();
@@ -85,7 +86,8 @@ void RSCheckAST::ValidateVarDecl(clang::VarDecl *VD) {
   if (VD->getLinkage() == clang::ExternalLinkage) {
     llvm::StringRef TypeName;
     const clang::Type *T = QT.getTypePtr();
-    if (!RSExportType::NormalizeType(T, TypeName, &mDiagEngine, VD)) {
+    if (!RSExportType::NormalizeType(mContext, T, TypeName, &mDiagEngine,
+                                     VD)) {
       mValid = false;
     }
   }
@@ -103,52 +105,76 @@ void RSCheckAST::ValidateVarDecl(clang::VarDecl *VD) {
     }
   }
 
-  if (!RSExportType::ValidateVarDecl(VD, mTargetAPI, mIsFilterscript)) {
+  if (!RSExportType::ValidateVarDecl(mContext, VD, mIsFilterscript)) {
     mValid = false;
-  } else if (clang::Expr *Init = VD->getInit()) {
-    // Only check the initializer if the decl is already ok.
-    Visit(Init);
+    return false;
   }
+  return true;
 }
 
 
-void RSCheckAST::VisitDeclStmt(clang::DeclStmt *DS) {
-  if (!SlangRS::IsLocInRSHeaderFile(DS->getLocStart(), mSM)) {
-    for (clang::DeclStmt::decl_iterator I = DS->decl_begin(),
-                                        E = DS->decl_end();
-         I != E;
-         ++I) {
-      if (clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(*I)) {
-        ValidateVarDecl(VD);
-      } else if (clang::FunctionDecl *FD =
-            llvm::dyn_cast<clang::FunctionDecl>(*I)) {
-        ValidateFunctionDecl(FD);
+void RSCheckAST::CheckDeclStmt(clang::DeclStmt *DS) {
+  for (clang::DeclStmt::decl_iterator I = DS->decl_begin(),
+                                      E = DS->decl_end();
+       I != E;
+       ++I) {
+    if (clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(*I)) {
+      // Only check the initializer if the decl is already ok.
+      if (!ValidateVarDecl(VD) && VD->getInit()) {
+        mSkippedInits.insert(VD->getInit());
       }
+    } else if (clang::FunctionDecl *FD =
+          llvm::dyn_cast<clang::FunctionDecl>(*I)) {
+      ValidateFunctionDecl(FD);
     }
   }
 }
 
 
-void RSCheckAST::VisitExpr(clang::Expr *E) {
+bool RSCheckAST::CheckExpr(clang::Expr *E) {
   // This is where FS checks for code using pointer and/or 64-bit expressions
   // (i.e. things like casts).
 
   // First we skip implicit casts (things like function calls and explicit
-  // array accesses rely heavily on them and they are valid.
-  E = E->IgnoreImpCasts();
+  // array accesses rely heavily on them and they are valid. The expression
+  // under them is checked when the walk gets there.
+  if (llvm::isa<clang::ImplicitCastExpr>(E)) {
+    return true;
+  }
+
   if (mIsFilterscript &&
       !SlangRS::IsLocInRSHeaderFile(E->getExprLoc(), mSM) &&
-      !RSExportType::ValidateType(C, E->getType(), NULL, E->getExprLoc(),
-                                  mTargetAPI, mIsFilterscript)) {
+      !RSExportType::ValidateType(mContext, E->getType(), NULL,
+                                  E->getExprLoc(), mIsFilterscript)) {
     mValid = false;
-  } else {
-    // Only visit sub-expressions if we haven't already seen a violation.
-    VisitStmt(E);
+    return false;
   }
+  // Only visit sub-expressions if we haven't already seen a violation.
+  return true;
+}
+
+
+bool RSCheckAST::enterStmt(clang::Stmt *S) {
+  if (clang::DeclStmt *DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+    if (SlangRS::IsLocInRSHeaderFile(DS->getLocStart(), mSM)) {
+      return false;
+    }
+    CheckDeclStmt(DS);
+    return true;
+  }
+
+  if (clang::Expr *E = llvm::dyn_cast<clang::Expr>(S)) {
+    if (mSkippedInits.erase(E)) {
+      return false;
+    }
+    return CheckExpr(E);
+  }
+
+  return true;
 }
 
 
-bool RSCheckAST::Validate() {
+bool RSCheckAST::Validate(RSStmtPass *StaticFunctionPass) {
   clang::TranslationUnitDecl *TUDecl = C.getTranslationUnitDecl();
   for (clang::DeclContext::decl_iterator DI = TUDecl->decls_begin(),
           DE = TUDecl->decls_end();
@@ -156,12 +182,14 @@ bool RSCheckAST::Validate() {
        DI++) {
     if (!SlangRS::IsLocInRSHeaderFile(DI->getLocStart(), mSM)) {
       if (clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(*DI)) {
-        ValidateVarDecl(VD);
+        if (ValidateVarDecl(VD)) {
+          CheckStmt(VD->getInit());
+        }
       } else if (clang::FunctionDecl *FD =
             llvm::dyn_cast<clang::FunctionDecl>(*DI)) {
-        ValidateFunctionDecl(FD);
+        ValidateFunctionDecl(FD, FD->isGlobal() ? NULL : StaticFunctionPass);
       } else if (clang::Stmt *Body = (*DI)->getBody()) {
-        Visit(Body);
+        CheckStmt(Body);
       }
     }
   }
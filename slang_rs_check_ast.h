@@ -18,16 +18,19 @@
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_CHECK_AST_H_
 
 #include "slang_assert.h"
+#include "slang_rs_ast_pass.h"
+#include "slang_rs_context.h"
 #include "clang/AST/ASTContext.h"
-#include "clang/AST/StmtVisitor.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 namespace slang {
 
 // This class is designed to walk a Renderscript/Filterscript AST looking for
 // violations. Examples of violations for FS are pointer declarations and
 // casts (i.e. no pointers allowed in FS whatsoever).
-class RSCheckAST : public clang::StmtVisitor<RSCheckAST> {
+class RSCheckAST : public RSStmtPass {
  private:
+  RSContext *mContext;
   clang::ASTContext &C;
   clang::DiagnosticsEngine &mDiagEngine;
   clang::SourceManager &mSM;
@@ -35,27 +38,38 @@ class RSCheckAST : public clang::StmtVisitor<RSCheckAST> {
   unsigned int mTargetAPI;
   bool mIsFilterscript;
   bool mInKernel;
+  // Initializers of invalid local variables, which are not checked
+  llvm::SmallPtrSet<const clang::Expr*, 4> mSkippedInits;
+
+  void CheckStmt(clang::Stmt *S);
+
+  void CheckDeclStmt(clang::DeclStmt *DS);
+
+  bool CheckExpr(clang::Expr *E);
 
  public:
-  explicit RSCheckAST(clang::ASTContext &Con, unsigned int TargetAPI,
-                      bool IsFilterscript)
-      : C(Con), mDiagEngine(Con.getDiagnostics()), mSM(C.getSourceManager()),
-        mValid(true), mTargetAPI(TargetAPI), mIsFilterscript(IsFilterscript),
-        mInKernel(false) {
+  explicit RSCheckAST(RSContext *Context, bool IsFilterscript)
+      : mContext(Context), C(Context->getASTContext()),
+        mDiagEngine(C.getDiagnostics()), mSM(C.getSourceManager()),
+        mValid(true), mTargetAPI(Context->getTargetAPI()),
+        mIsFilterscript(IsFilterscript), mInKernel(false) {
     return;
   }
 
-  void VisitStmt(clang::Stmt *S);
-
-  void VisitExpr(clang::Expr *E);
-
-  void VisitDeclStmt(clang::DeclStmt *DS);
+  virtual bool enterStmt(clang::Stmt *S);
 
-  void ValidateFunctionDecl(clang::FunctionDecl *FD);
+  // Check the signature of FD and its body, running the body through
+  // BodyPass (when given) in the same walk.
+  void ValidateFunctionDecl(clang::FunctionDecl *FD,
+                            RSStmtPass *BodyPass = NULL);
 
-  void ValidateVarDecl(clang::VarDecl *VD);
+  // Return false if VD itself is invalid (its initializer is then not
+  // checked).
+  bool ValidateVarDecl(clang::VarDecl *VD);
 
-  bool Validate();
+  // Check the whole translation unit. The bodies of static functions are also
+  // run through StaticFunctionPass (when given) in the same walk.
+  bool Validate(RSStmtPass *StaticFunctionPass = NULL);
 };
 
 }  // namespace slang
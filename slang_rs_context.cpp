@@ -60,7 +60,10 @@ RSContext::RSContext(clang::Preprocessor &PP,
       mRSPackageName("android.renderscript"),
       version(0),
       mIsCompatLib(false),
-      mMangleCtx(Ctx.createMangleContext()) {
+      mReflectUnsynchronized(false),
+      mReflectBatch(false),
+      mMangleCtx(Ctx.createMangleContext()),
+      mBatchPacketSize(0) {
   slangAssert(mGeneratedFileNames && "Must supply GeneratedFileNames");
 
   // For #pragma rs export_type
@@ -75,6 +78,14 @@ RSContext::RSContext(clang::Preprocessor &PP,
   PP.AddPragmaHandler(
       "rs", RSPragmaHandler::CreatePragmaReflectLicenseHandler(this));
 
+  // For #pragma rs reflect_unsynchronized
+  PP.AddPragmaHandler(
+      "rs", RSPragmaHandler::CreatePragmaReflectUnsynchronizedHandler(this));
+
+  // For #pragma rs reflect_batch
+  PP.AddPragmaHandler(
+      "rs", RSPragmaHandler::CreatePragmaReflectBatchHandler(this));
+
   // For #pragma version
   PP.AddPragmaHandler(RSPragmaHandler::CreatePragmaVersionHandler(this));
 
@@ -93,7 +104,7 @@ bool RSContext::processExportVar(const clang::VarDecl *VD) {
   if (!ET)
     return false;
 
-  RSExportVar *EV = new RSExportVar(this, VD, ET);
+  RSExportVar *EV = new(this) RSExportVar(this, VD, ET);
   if (EV == NULL)
     return false;
   else
@@ -219,6 +230,73 @@ void RSContext::cleanupForEach() {
 }
 
 
+// Returns true if @ET is or holds (in an array or a struct) an RS object.
+static bool ContainsRSObject(const RSExportType *ET) {
+  switch (ET->getClass()) {
+    case RSExportType::ExportClassPrimitive: {
+      return static_cast<const RSExportPrimitiveType*>(ET)->isRSObjectType();
+    }
+    case RSExportType::ExportClassConstantArray: {
+      return ContainsRSObject(
+          static_cast<const RSExportConstantArrayType*>(ET)->getElementType());
+    }
+    case RSExportType::ExportClassRecord: {
+      const RSExportRecordType *ERT =
+          static_cast<const RSExportRecordType*>(ET);
+      for (RSExportRecordType::const_field_iterator I = ERT->fields_begin(),
+               E = ERT->fields_end();
+           I != E;
+           I++) {
+        if (ContainsRSObject((*I)->getType()))
+          return true;
+      }
+      return false;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// Lay out the packet applied by RS_BATCH_UPDATE_FUNC_NAME. Only plain data
+// variables take part: RS objects need reference counting (rsSetObject) and
+// pointers are bound, not set. Every value is placed at its natural alignment
+// so that the FieldPacker in the reflected Java produces the same layout.
+void RSContext::computeBatchLayout() {
+  mBatchVars.clear();
+  mBatchPacketSize = 0;
+
+  if (!mReflectBatch)
+    return;
+
+  for (ExportVarList::const_iterator I = mExportVars.begin(),
+          E = mExportVars.end();
+       I != E;
+       I++) {
+    const RSExportVar *EV = *I;
+    const RSExportType *ET = EV->getType();
+    if (EV->isConst() ||
+        (ET->getClass() == RSExportType::ExportClassPointer) ||
+        ContainsRSObject(ET) ||
+        (RSExportType::GetTypeAllocSize(ET) == 0))
+      continue;
+    mBatchVars.push_back(std::make_pair(EV, 0));
+  }
+
+  size_t Offset = getNumBatchMaskWords() * 4;
+  for (BatchVarList::iterator I = mBatchVars.begin(), E = mBatchVars.end();
+       I != E;
+       I++) {
+    const RSExportType *ET = I->first->getType();
+    size_t Align = mDataLayout->getABITypeAlignment(ET->getLLVMType());
+    Offset = (Offset + Align - 1) / Align * Align;
+    I->second = Offset;
+    Offset += RSExportType::GetTypeAllocSize(ET);
+  }
+  mBatchPacketSize = Offset;
+  return;
+}
+
 bool RSContext::processExport() {
   bool valid = true;
 
@@ -252,6 +330,7 @@ bool RSContext::processExport() {
 
   if (valid) {
     cleanupForEach();
+    computeBatchLayout();
   }
 
   // Finally, export type forcely set to be exported by user
@@ -323,12 +402,12 @@ bool RSContext::reflectToJava(const std::string &OutputPathBase,
 RSContext::~RSContext() {
   delete mLicenseNote;
   delete mDataLayout;
+  // Their memory goes with mExportableAllocator.
   for (ExportableList::iterator I = mExportables.begin(),
           E = mExportables.end();
        I != E;
        I++) {
-    if (!(*I)->isKeep())
-      delete *I;
+    (*I)->~RSExportable();
   }
 }
 
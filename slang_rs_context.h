@@ -21,13 +21,18 @@
 #include <list>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "clang/Lex/Preprocessor.h"
 #include "clang/AST/Mangle.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Allocator.h"
 
 #include "slang_pragma_recorder.h"
 
@@ -37,6 +42,7 @@ namespace llvm {
 }   // namespace llvm
 
 namespace clang {
+  class Type;
   class VarDecl;
   class ASTContext;
   class TargetInfo;
@@ -57,11 +63,32 @@ class RSContext {
   typedef llvm::StringSet<> NeedExportTypeSet;
 
  public:
-  typedef std::list<RSExportable*> ExportableList;
+  typedef std::vector<RSExportable*> ExportableList;
   typedef std::list<RSExportVar*> ExportVarList;
   typedef std::list<RSExportFunc*> ExportFuncList;
   typedef std::list<RSExportForEach*> ExportForEachList;
   typedef llvm::StringMap<RSExportType*> ExportTypeMap;
+  // <exported variable, offset of its value in the batch update packet>
+  typedef std::vector<std::pair<const RSExportVar*, size_t> > BatchVarList;
+
+  // What RSExportType already found out about a canonical clang::Type, so that
+  // the type graph below it is walked only once per file. Only successes are
+  // kept; a type that fails is checked (and reported) again on each use.
+  struct TypeInfo {
+    // Result of RSExportType::NormalizeType(), or NULL
+    const clang::Type *NormalizedType;
+    llvm::StringRef TypeName;
+    // Result of RSExportType::Create(), or NULL
+    RSExportType *ExportType;
+    // Whether RSExportType::ValidateType() passed, for the checks that do not
+    // depend on the declaration being validated
+    bool Valid;
+
+    TypeInfo()
+        : NormalizedType(NULL),
+          ExportType(NULL),
+          Valid(false) { }
+  };
 
  private:
   clang::Preprocessor &mPP;
@@ -74,7 +101,10 @@ class RSContext {
   llvm::DataLayout *mDataLayout;
   llvm::LLVMContext &mLLVMContext;
 
+  // All exportables of this context, in the order they were created. Their
+  // memory comes from mExportableAllocator.
   ExportableList mExportables;
+  llvm::BumpPtrAllocator mExportableAllocator;
 
   NeedExportTypeSet mNeedExportTypes;
 
@@ -88,6 +118,12 @@ class RSContext {
 
   bool mIsCompatLib;
 
+  // Also reflect unsynchronized ScriptField_* element accessors.
+  bool mReflectUnsynchronized;
+
+  // Reflect ScriptC_*.Batch for updating several exported variables at once.
+  bool mReflectBatch;
+
   llvm::OwningPtr<clang::MangleContext> mMangleCtx;
 
   bool processExportVar(const clang::VarDecl *VD);
@@ -95,11 +131,21 @@ class RSContext {
   bool processExportType(const llvm::StringRef &Name);
 
   void cleanupForEach();
+  void computeBatchLayout();
 
   ExportVarList mExportVars;
   ExportFuncList mExportFuncs;
   ExportForEachList mExportForEach;
   ExportTypeMap mExportTypes;
+  BatchVarList mBatchVars;
+  size_t mBatchPacketSize;
+
+  // The target API is the same for the whole context, so the canonical type
+  // alone is the key.
+  typedef llvm::DenseMap<const clang::Type*, TypeInfo> TypeInfoMap;
+  TypeInfoMap mTypeInfos;
+  // Storage for TypeInfo::TypeName
+  llvm::StringSet<> mTypeNames;
 
  public:
   RSContext(clang::Preprocessor &PP,
@@ -153,6 +199,12 @@ class RSContext {
   }
 
   bool processExport();
+  // Memory for an RSExportable of Size bytes, which is released (all at once)
+  // with this context (see RSExportable::operator new).
+  inline void *allocateExportable(size_t Size) {
+    return mExportableAllocator.Allocate(
+        Size, llvm::AlignOf<long double>::Alignment);
+  }
   inline void newExportable(RSExportable *E) {
     if (E != NULL)
       mExportables.push_back(E);
@@ -213,6 +265,16 @@ class RSContext {
     return mExportTypes.find(TypeName);
   }
 
+  // The cached information about the canonical type T. The reference is only
+  // valid until the next call.
+  TypeInfo &getTypeInfo(const clang::Type *T) {
+    return mTypeInfos[T];
+  }
+  // Return a copy of Name that lives as long as this context.
+  llvm::StringRef saveTypeName(const llvm::StringRef &Name) {
+    return mTypeNames.GetOrCreateValue(Name).getKey();
+  }
+
   // Insert the specified Typename/Type pair into the map. If the key already
   // exists in the map, return false and ignore the request, otherwise insert it
   // and return true.
@@ -233,6 +295,32 @@ class RSContext {
 
   bool isCompatLib() const { return mIsCompatLib; }
 
+  void setReflectUnsynchronized(bool B) {
+    mReflectUnsynchronized = B;
+    return;
+  }
+  bool getReflectUnsynchronized() const { return mReflectUnsynchronized; }
+
+  void setReflectBatch(bool B) {
+    mReflectBatch = B;
+    return;
+  }
+
+  // The batch update packet starts with one 32-bit dirty mask per 32 batch
+  // variables, followed by the value of each variable at its offset.
+  typedef BatchVarList::const_iterator const_batch_var_iterator;
+  const_batch_var_iterator batch_vars_begin() const {
+    return mBatchVars.begin();
+  }
+  const_batch_var_iterator batch_vars_end() const {
+    return mBatchVars.end();
+  }
+  inline bool hasBatchVar() const { return !mBatchVars.empty(); }
+  inline size_t getNumBatchMaskWords() const {
+    return (mBatchVars.size() + 31) / 32;
+  }
+  inline size_t getBatchPacketSize() const { return mBatchPacketSize; }
+
   void addPragma(const std::string &T, const std::string &V) {
     mPragmas->push_back(make_pair(T, V));
   }
@@ -0,0 +1,439 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_export_blob.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringExtras.h"
+
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+
+#include "slang_rs_metadata.h"
+#include "slang_rs_metadata_utils.h"
+#include "slang_rs_object_slots.h"
+
+namespace slang {
+
+namespace {
+
+// Number of words in the blob header.
+const unsigned HeaderWords = 9;
+
+class BlobWriter {
+ private:
+  std::vector<uint32_t> mWords;
+  std::string mStrings;
+  std::map<std::string, uint32_t> mStringOffsets;
+
+ public:
+  void addWord(uint32_t W) {
+    mWords.push_back(W);
+  }
+
+  void addString(const std::string &S) {
+    std::map<std::string, uint32_t>::const_iterator I = mStringOffsets.find(S);
+    if (I != mStringOffsets.end()) {
+      addWord(I->second);
+      return;
+    }
+    uint32_t Offset = mStrings.size();
+    mStrings.append(S);
+    mStrings.push_back('\0');
+    mStringOffsets.insert(std::make_pair(S, Offset));
+    addWord(Offset);
+  }
+
+  // Fill in the string table size and write everything out to Blob.
+  void finish(std::string &Blob) {
+    mWords[HeaderWords - 1] = mStrings.size();
+    Blob.clear();
+    Blob.reserve(mWords.size() * 4 + mStrings.size());
+    for (size_t i = 0, e = mWords.size(); i != e; i++) {
+      uint32_t W = mWords[i];
+      Blob.push_back(static_cast<char>(W & 0xff));
+      Blob.push_back(static_cast<char>((W >> 8) & 0xff));
+      Blob.push_back(static_cast<char>((W >> 16) & 0xff));
+      Blob.push_back(static_cast<char>((W >> 24) & 0xff));
+    }
+    Blob.append(mStrings);
+  }
+};
+
+class BlobReader {
+ private:
+  llvm::StringRef mBlob;
+  size_t mPos;
+  llvm::StringRef mStrings;
+  std::string *mErrMsg;
+
+ public:
+  BlobReader(llvm::StringRef Blob, std::string *ErrMsg)
+      : mBlob(Blob), mPos(0), mErrMsg(ErrMsg) {
+  }
+
+  bool error(const std::string &Message) {
+    if (mErrMsg)
+      *mErrMsg = Message;
+    return false;
+  }
+
+  bool readWord(uint32_t &W) {
+    if (mPos + 4 > mBlob.size())
+      return error("truncated export blob");
+    const unsigned char *P =
+        reinterpret_cast<const unsigned char*>(mBlob.data() + mPos);
+    W = P[0] | (P[1] << 8) | (P[2] << 16) | (static_cast<uint32_t>(P[3]) << 24);
+    mPos += 4;
+    return true;
+  }
+
+  // The string table starts after Words more words.
+  bool setStringTable(size_t Words, uint32_t Size) {
+    if (Words > (mBlob.size() - mPos) / 4)
+      return error("truncated export blob");
+    size_t Start = mPos + Words * 4;
+    if (mBlob.size() - Start != Size)
+      return error("export blob string table has the wrong size");
+    mStrings = mBlob.substr(Start);
+    return true;
+  }
+
+  bool readString(std::string &S) {
+    uint32_t Offset;
+    if (!readWord(Offset))
+      return false;
+    if (Offset >= mStrings.size())
+      return error("export blob string offset out of range");
+    size_t End = mStrings.find('\0', Offset);
+    if (End == llvm::StringRef::npos)
+      return error("unterminated string in export blob");
+    S = mStrings.slice(Offset, End).str();
+    return true;
+  }
+};
+
+}  // namespace
+
+void RSExportBlob::clear() {
+  Vars.clear();
+  Funcs.clear();
+  ForEachs.clear();
+  ObjectSlots.clear();
+  Records.clear();
+}
+
+bool RSExportBlob::operator==(const RSExportBlob &Other) const {
+  if (Vars.size() != Other.Vars.size() ||
+      Funcs != Other.Funcs ||
+      ForEachs.size() != Other.ForEachs.size() ||
+      ObjectSlots != Other.ObjectSlots ||
+      Records.size() != Other.Records.size())
+    return false;
+
+  for (size_t i = 0, e = Vars.size(); i != e; i++) {
+    const Var &A = Vars[i], &B = Other.Vars[i];
+    if (A.Name != B.Name || A.TypeKind != B.TypeKind)
+      return false;
+    if ((A.TypeKind == VTK_DataType) ? (A.DataType != B.DataType)
+                                     : (A.TypeName != B.TypeName))
+      return false;
+  }
+
+  for (size_t i = 0, e = ForEachs.size(); i != e; i++)
+    if (ForEachs[i].Name != Other.ForEachs[i].Name ||
+        ForEachs[i].Signature != Other.ForEachs[i].Signature)
+      return false;
+
+  for (size_t i = 0, e = Records.size(); i != e; i++) {
+    const Record &A = Records[i], &B = Other.Records[i];
+    if (A.Name != B.Name || A.Fields.size() != B.Fields.size())
+      return false;
+    for (size_t f = 0, fe = A.Fields.size(); f != fe; f++)
+      if (A.Fields[f].Name != B.Fields[f].Name ||
+          A.Fields[f].TypeName != B.Fields[f].TypeName)
+        return false;
+  }
+
+  return true;
+}
+
+void RSExportBlob::encode(std::string &Blob) const {
+  BlobWriter W;
+
+  size_t NumFields = 0;
+  for (size_t i = 0, e = Records.size(); i != e; i++)
+    NumFields += Records[i].Fields.size();
+
+  W.addWord(Magic);
+  W.addWord(Version);
+  W.addWord(Vars.size());
+  W.addWord(Funcs.size());
+  W.addWord(ForEachs.size());
+  W.addWord(ObjectSlots.size());
+  W.addWord(Records.size());
+  W.addWord(NumFields);
+  W.addWord(0);  // StringTableSize, filled in by finish()
+
+  for (size_t i = 0, e = Vars.size(); i != e; i++) {
+    const Var &V = Vars[i];
+    W.addString(V.Name);
+    W.addWord(V.TypeKind);
+    if (V.TypeKind == VTK_DataType)
+      W.addWord(V.DataType);
+    else
+      W.addString(V.TypeName);
+  }
+
+  for (size_t i = 0, e = Funcs.size(); i != e; i++)
+    W.addString(Funcs[i]);
+
+  for (size_t i = 0, e = ForEachs.size(); i != e; i++) {
+    W.addString(ForEachs[i].Name);
+    W.addWord(ForEachs[i].Signature);
+  }
+
+  for (size_t i = 0, e = ObjectSlots.size(); i != e; i++)
+    W.addWord(ObjectSlots[i]);
+
+  for (size_t i = 0, e = Records.size(); i != e; i++) {
+    W.addString(Records[i].Name);
+    W.addWord(Records[i].Fields.size());
+  }
+
+  for (size_t i = 0, e = Records.size(); i != e; i++) {
+    for (size_t f = 0, fe = Records[i].Fields.size(); f != fe; f++) {
+      W.addString(Records[i].Fields[f].Name);
+      W.addString(Records[i].Fields[f].TypeName);
+    }
+  }
+
+  W.finish(Blob);
+}
+
+bool RSExportBlob::decode(llvm::StringRef Blob, std::string *ErrMsg) {
+  clear();
+
+  BlobReader R(Blob, ErrMsg);
+  uint32_t Header[HeaderWords];
+  for (unsigned i = 0; i < HeaderWords; i++)
+    if (!R.readWord(Header[i]))
+      return false;
+
+  if (Header[0] != Magic)
+    return R.error("not an export blob");
+  if (Header[1] != Version)
+    return R.error("unsupported export blob version " +
+                   llvm::utostr(Header[1]));
+
+  uint32_t NumVars = Header[2], NumFuncs = Header[3], NumForEachs = Header[4],
+           NumObjectSlots = Header[5], NumRecords = Header[6],
+           NumFields = Header[7], StringTableSize = Header[8];
+
+  // Check the counts against the blob size before allocating anything.
+  uint64_t TableWords = 3ULL * NumVars + NumFuncs + 2ULL * NumForEachs +
+                        NumObjectSlots + 2ULL * NumRecords + 2ULL * NumFields;
+  if (TableWords > Blob.size() / 4)
+    return R.error("truncated export blob");
+  if (!R.setStringTable(TableWords, StringTableSize))
+    return false;
+
+  Vars.resize(NumVars);
+  for (uint32_t i = 0; i < NumVars; i++) {
+    Var &V = Vars[i];
+    uint32_t Kind;
+    if (!R.readString(V.Name) || !R.readWord(Kind))
+      return false;
+    if (Kind == VTK_DataType) {
+      V.TypeKind = VTK_DataType;
+      if (!R.readWord(V.DataType))
+        return false;
+    } else if (Kind == VTK_TypeName) {
+      V.TypeKind = VTK_TypeName;
+      V.DataType = 0;
+      if (!R.readString(V.TypeName))
+        return false;
+    } else {
+      return R.error("unknown variable type kind in export blob");
+    }
+  }
+
+  Funcs.resize(NumFuncs);
+  for (uint32_t i = 0; i < NumFuncs; i++)
+    if (!R.readString(Funcs[i]))
+      return false;
+
+  ForEachs.resize(NumForEachs);
+  for (uint32_t i = 0; i < NumForEachs; i++)
+    if (!R.readString(ForEachs[i].Name) ||
+        !R.readWord(ForEachs[i].Signature))
+      return false;
+
+  ObjectSlots.resize(NumObjectSlots);
+  for (uint32_t i = 0; i < NumObjectSlots; i++) {
+    uint32_t Slot;
+    if (!R.readWord(Slot))
+      return false;
+    if (Slot >= NumVars)
+      return R.error("object slot out of range in export blob");
+    ObjectSlots[i] = Slot;
+  }
+
+  Records.resize(NumRecords);
+  uint64_t FieldsLeft = NumFields;
+  for (uint32_t i = 0; i < NumRecords; i++) {
+    uint32_t Count;
+    if (!R.readString(Records[i].Name) || !R.readWord(Count))
+      return false;
+    if (Count > FieldsLeft)
+      return R.error("export blob has more record fields than declared");
+    FieldsLeft -= Count;
+    Records[i].Fields.resize(Count);
+  }
+  if (FieldsLeft != 0)
+    return R.error("export blob has unused record fields");
+
+  for (uint32_t i = 0; i < NumRecords; i++) {
+    std::vector<Field> &Fields = Records[i].Fields;
+    for (size_t f = 0, fe = Fields.size(); f != fe; f++)
+      if (!R.readString(Fields[f].Name) || !R.readString(Fields[f].TypeName))
+        return false;
+  }
+
+  return true;
+}
+
+void RSExportBlob::writeToModule(llvm::Module *M) const {
+  std::string Blob;
+  encode(Blob);
+
+  llvm::LLVMContext &C = M->getContext();
+  llvm::NamedMDNode *BlobMetadata =
+      M->getOrInsertNamedMetadata(RS_EXPORT_BLOB_MN);
+  BlobMetadata->dropAllReferences();
+  llvm::Value *BlobString = llvm::MDString::get(C, Blob);
+  BlobMetadata->addOperand(llvm::MDNode::get(C, BlobString));
+}
+
+bool RSExportBlob::readFromModule(const llvm::Module *M,
+                                  std::string *ErrMsg) {
+  const llvm::NamedMDNode *BlobMetadata =
+      M->getNamedMetadata(RS_EXPORT_BLOB_MN);
+  llvm::StringRef Blob;
+  if (BlobMetadata == NULL || BlobMetadata->getNumOperands() != 1 ||
+      !RSMetadataUtils::GetMDString(BlobMetadata->getOperand(0), 0, Blob))
+    return RSMetadataUtils::Error(ErrMsg, "module has no export blob");
+  return decode(Blob, ErrMsg);
+}
+
+bool RSExportBlob::readLegacyMetadata(const llvm::Module *M,
+                                      std::string *ErrMsg) {
+  clear();
+
+  if (const llvm::NamedMDNode *VarMD = M->getNamedMetadata(RS_EXPORT_VAR_MN)) {
+    Vars.resize(VarMD->getNumOperands());
+    for (unsigned i = 0, e = VarMD->getNumOperands(); i != e; i++) {
+      llvm::StringRef Name, Type;
+      const llvm::MDNode *N = VarMD->getOperand(i);
+      if (!RSMetadataUtils::GetMDString(N, RS_EXPORT_VAR_NAME, Name) ||
+          !RSMetadataUtils::GetMDString(N, RS_EXPORT_VAR_TYPE, Type))
+        return RSMetadataUtils::Error(ErrMsg, "malformed " RS_EXPORT_VAR_MN);
+      Var &V = Vars[i];
+      V.Name = Name.str();
+      if (RSMetadataUtils::ParseUnsigned(Type, V.DataType)) {
+        V.TypeKind = VTK_DataType;
+      } else {
+        V.TypeKind = VTK_TypeName;
+        V.DataType = 0;
+        V.TypeName = Type.str();
+      }
+    }
+  }
+
+  if (const llvm::NamedMDNode *FuncMD =
+          M->getNamedMetadata(RS_EXPORT_FUNC_MN)) {
+    Funcs.resize(FuncMD->getNumOperands());
+    for (unsigned i = 0, e = FuncMD->getNumOperands(); i != e; i++) {
+      llvm::StringRef Name;
+      if (!RSMetadataUtils::GetMDString(FuncMD->getOperand(i),
+                                        RS_EXPORT_FUNC_NAME, Name))
+        return RSMetadataUtils::Error(ErrMsg, "malformed " RS_EXPORT_FUNC_MN);
+      Funcs[i] = Name.str();
+    }
+  }
+
+  const llvm::NamedMDNode *ForEachNameMD =
+      M->getNamedMetadata(RS_EXPORT_FOREACH_NAME_MN);
+  const llvm::NamedMDNode *ForEachMD =
+      M->getNamedMetadata(RS_EXPORT_FOREACH_MN);
+  if (ForEachNameMD && ForEachMD) {
+    if (ForEachNameMD->getNumOperands() != ForEachMD->getNumOperands())
+      return RSMetadataUtils::Error(ErrMsg,
+                                    "mismatched " RS_EXPORT_FOREACH_MN);
+    ForEachs.resize(ForEachMD->getNumOperands());
+    for (unsigned i = 0, e = ForEachMD->getNumOperands(); i != e; i++) {
+      llvm::StringRef Name, Signature;
+      if (!RSMetadataUtils::GetMDString(ForEachNameMD->getOperand(i), 0,
+                                        Name) ||
+          !RSMetadataUtils::GetMDString(ForEachMD->getOperand(i), 0,
+                                        Signature) ||
+          !RSMetadataUtils::ParseUnsigned(Signature, ForEachs[i].Signature))
+        return RSMetadataUtils::Error(ErrMsg,
+                                      "malformed " RS_EXPORT_FOREACH_MN);
+      ForEachs[i].Name = Name.str();
+    }
+  }
+
+  // Either the legacy RS_OBJECT_SLOTS_MN or RS_OBJECT_SLOT_MAP_MN
+  RSObjectSlots Slots;
+  if (!Slots.readFromModule(M, ErrMsg))
+    return false;
+  ObjectSlots = Slots.Slots;
+
+  if (const llvm::NamedMDNode *TypeMD =
+          M->getNamedMetadata(RS_EXPORT_TYPE_MN)) {
+    Records.resize(TypeMD->getNumOperands());
+    for (unsigned i = 0, e = TypeMD->getNumOperands(); i != e; i++) {
+      llvm::StringRef Name;
+      if (!RSMetadataUtils::GetMDString(TypeMD->getOperand(i), 0, Name))
+        return RSMetadataUtils::Error(ErrMsg, "malformed " RS_EXPORT_TYPE_MN);
+      Record &R = Records[i];
+      R.Name = Name.str();
+
+      const llvm::NamedMDNode *FieldMD = M->getNamedMetadata("%" + R.Name);
+      if (FieldMD == NULL)
+        continue;
+      R.Fields.resize(FieldMD->getNumOperands());
+      for (unsigned f = 0, fe = FieldMD->getNumOperands(); f != fe; f++) {
+        llvm::StringRef FieldName, FieldType;
+        const llvm::MDNode *N = FieldMD->getOperand(f);
+        if (!RSMetadataUtils::GetMDString(N, 0, FieldName) ||
+            !RSMetadataUtils::GetMDString(N, 1, FieldType))
+          return RSMetadataUtils::Error(ErrMsg,
+                                        "malformed field list of " + R.Name);
+        R.Fields[f].Name = FieldName.str();
+        R.Fields[f].TypeName = FieldType.str();
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace slang
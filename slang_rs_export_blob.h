@@ -0,0 +1,117 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_BLOB_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_BLOB_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class Module;
+}
+
+namespace slang {
+
+// All the export information RSBackend emits as named metadata
+// (RS_EXPORT_*_MN, RS_OBJECT_SLOTS_MN and the "%<struct>" field lists), in a
+// form that can also be written as one binary blob (-emit-export-blob).
+//
+// The blob is stored as the only MDString of RS_EXPORT_BLOB_MN. It is a
+// sequence of little-endian 32-bit words, followed by a string table:
+//
+//   header:   Magic, Version, NumVars, NumFuncs, NumForEachs,
+//             NumObjectSlots, NumRecords, NumFields, StringTableSize
+//   vars:     [Name, TypeKind, Type] x NumVars
+//   funcs:    [Name] x NumFuncs
+//   forEachs: [Name, Signature] x NumForEachs
+//   slots:    [VarIndex] x NumObjectSlots
+//   records:  [Name, NumFields] x NumRecords
+//   fields:   [Name, TypeName] x NumFields, in record order
+//   strings:  StringTableSize bytes of NUL-terminated strings
+//
+// Name, TypeName and Type (for VTK_TypeName) are byte offsets into the string
+// table. Type is the RSExportPrimitiveType::DataType for VTK_DataType.
+class RSExportBlob {
+ public:
+  enum {
+    Magic = 0x42585352,  // "RSXB"
+    Version = 1
+  };
+
+  enum VarTypeKind {
+    // Primitive and matrix types, given by their data type number.
+    VTK_DataType = 0,
+    // Any other type, given by its name ("*<pointee>" for pointers).
+    VTK_TypeName = 1
+  };
+
+  struct Var {
+    std::string Name;
+    VarTypeKind TypeKind;
+    unsigned DataType;
+    std::string TypeName;
+  };
+
+  struct ForEach {
+    std::string Name;
+    unsigned Signature;
+  };
+
+  struct Field {
+    std::string Name;
+    std::string TypeName;
+  };
+
+  struct Record {
+    std::string Name;
+    std::vector<Field> Fields;
+  };
+
+  std::vector<Var> Vars;
+  std::vector<std::string> Funcs;
+  std::vector<ForEach> ForEachs;
+  // Indices into Vars of the variables holding RS objects.
+  std::vector<unsigned> ObjectSlots;
+  std::vector<Record> Records;
+
+  void clear();
+
+  bool operator==(const RSExportBlob &Other) const;
+  bool operator!=(const RSExportBlob &Other) const {
+    return !(*this == Other);
+  }
+
+  // Encode this into the binary form described above.
+  void encode(std::string &Blob) const;
+
+  // Decode a blob produced by encode(). Return false (and set *ErrMsg when
+  // given) if Blob is truncated, malformed or of another version.
+  bool decode(llvm::StringRef Blob, std::string *ErrMsg);
+
+  // Store/load the encoded blob as RS_EXPORT_BLOB_MN of M.
+  void writeToModule(llvm::Module *M) const;
+  bool readFromModule(const llvm::Module *M, std::string *ErrMsg);
+
+  // Fill this in from the legacy string metadata of M, as a device would.
+  bool readLegacyMetadata(const llvm::Module *M, std::string *ErrMsg);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_BLOB_H_  NOLINT
@@ -395,7 +395,7 @@ RSExportForEach *RSExportForEach::Create(RSContext *Context,
 
   slangAssert(!Name.empty() && "Function must have a name");
 
-  FE = new RSExportForEach(Context, Name);
+  FE = new(Context) RSExportForEach(Context, Name);
 
   if (!FE->validateAndConstructParams(Context, FD)) {
     return NULL;
@@ -484,7 +484,7 @@ RSExportForEach *RSExportForEach::Create(RSContext *Context,
 RSExportForEach *RSExportForEach::CreateDummyRoot(RSContext *Context) {
   slangAssert(Context);
   llvm::StringRef Name = "root";
-  RSExportForEach *FE = new RSExportForEach(Context, Name);
+  RSExportForEach *FE = new(Context) RSExportForEach(Context, Name);
   FE->mDummyRoot = true;
   return FE;
 }
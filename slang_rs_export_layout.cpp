@@ -0,0 +1,326 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_export_layout.h"
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+
+#include "slang_rs_context.h"
+#include "slang_rs_export_type.h"
+#include "slang_rs_export_var.h"
+#include "slang_rs_metadata.h"
+#include "slang_rs_metadata_utils.h"
+
+namespace slang {
+
+namespace {
+
+// Number of bytes an object of type ET occupies, for exported variables and
+// record fields alike. Records and arrays use the size clang gave them, since
+// the LLVM type of an RSExportRecordType carries none of the padding clang may
+// have added. Other types take their alloc size if WithTailPadding is set, and
+// their store size otherwise (fields record their padding separately).
+size_t GetLayoutSize(const RSExportType *ET, bool WithTailPadding) {
+  switch (ET->getClass()) {
+    case RSExportType::ExportClassRecord:
+      return static_cast<const RSExportRecordType*>(ET)->getAllocSize();
+    case RSExportType::ExportClassConstantArray: {
+      const RSExportConstantArrayType *CAT =
+          static_cast<const RSExportConstantArrayType*>(ET);
+      // Array elements are laid out at their alloc size.
+      return CAT->getSize() *
+             GetLayoutSize(CAT->getElementType(), /* WithTailPadding = */true);
+    }
+    default:
+      return WithTailPadding ? RSExportType::GetTypeAllocSize(ET) :
+                               RSExportType::GetTypeStoreSize(ET);
+  }
+}
+
+llvm::Value *GetInt32(llvm::LLVMContext &C, unsigned Value) {
+  return llvm::ConstantInt::get(llvm::Type::getInt32Ty(C), Value);
+}
+
+// Read the {<name>, i32 Size, i32 Align, ...} part common to vars and records.
+bool ReadEntry(const llvm::MDNode *N, RSExportLayout::Entry &E) {
+  llvm::StringRef Name;
+  if (!RSMetadataUtils::GetMDString(N, 0, Name) ||
+      !RSMetadataUtils::GetInt32(N, 1, E.Size) ||
+      !RSMetadataUtils::GetInt32(N, 2, E.Align))
+    return false;
+  E.Name = Name.str();
+  return true;
+}
+
+}  // namespace
+
+void RSExportLayout::clear() {
+  DataLayout.clear();
+  Vars.clear();
+  Records.clear();
+}
+
+void RSExportLayout::collect(const RSContext *Context) {
+  clear();
+  DataLayout = Context->getDataLayout()->getStringRepresentation();
+
+  for (RSContext::const_export_var_iterator I = Context->export_vars_begin(),
+          E = Context->export_vars_end();
+       I != E;
+       I++) {
+    const RSExportVar *EV = *I;
+    Entry V;
+    V.Name = EV->getName();
+    V.Size = GetLayoutSize(EV->getType(), /* WithTailPadding = */true);
+    V.Align = EV->getAlignment();
+    Vars.push_back(V);
+  }
+
+  // Same order as RS_EXPORT_TYPE_MN
+  for (RSContext::const_export_type_iterator
+          I = Context->export_types_begin(),
+          E = Context->export_types_end();
+       I != E;
+       I++) {
+    const RSExportType *ET = I->getValue();
+    if (ET->getClass() != RSExportType::ExportClassRecord)
+      continue;
+
+    const RSExportRecordType *ERT =
+        static_cast<const RSExportRecordType*>(ET);
+    Records.push_back(Entry());
+    Entry &R = Records.back();
+    R.Name = ERT->getName();
+    R.Size = ERT->getAllocSize();
+    R.Align = ERT->getAlignment();
+
+    for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
+            FE = ERT->fields_end();
+         FI != FE;
+         FI++) {
+      Field F;
+      F.Offset = (*FI)->getOffsetInParent();
+      F.Size = GetLayoutSize((*FI)->getType(), /* WithTailPadding = */false);
+      F.Padding = 0;
+      R.Fields.push_back(F);
+    }
+
+    // The padding of a field runs up to the next field, or the end of the
+    // record for the last one.
+    for (size_t i = 0, e = R.Fields.size(); i != e; i++) {
+      unsigned End = R.Fields[i].Offset + R.Fields[i].Size;
+      unsigned Next = (i + 1 < e) ? R.Fields[i + 1].Offset : R.Size;
+      if (Next > End)
+        R.Fields[i].Padding = Next - End;
+    }
+  }
+}
+
+bool RSExportLayout::verify(const llvm::Module *M,
+                            std::string *ErrMsg) const {
+  if (M->getDataLayout() != DataLayout)
+    return RSMetadataUtils::Error(
+        ErrMsg, "layout table was computed for data layout \"" + DataLayout +
+                "\", not \"" + M->getDataLayout() + "\"");
+
+  llvm::DataLayout DL(M);
+
+  for (size_t i = 0, e = Vars.size(); i != e; i++) {
+    const Entry &V = Vars[i];
+    const llvm::GlobalVariable *GV = M->getNamedGlobal(V.Name);
+    if (GV == NULL)
+      return RSMetadataUtils::Error(
+          ErrMsg, "no global for exported variable '" + V.Name + "'");
+
+    llvm::Type *T = GV->getType()->getElementType();
+    uint64_t Size = DL.getTypeAllocSize(T);
+    unsigned Align = GV->getAlignment();
+    if (Align == 0)
+      Align = DL.getPreferredAlignment(GV);
+
+    if (Size != V.Size)
+      return RSMetadataUtils::Error(
+          ErrMsg, "size of '" + V.Name + "' is " + llvm::utostr(V.Size) +
+                  " in the layout table, " + llvm::utostr(Size) +
+                  " in the module");
+    if (Align != V.Align)
+      return RSMetadataUtils::Error(
+          ErrMsg, "alignment of '" + V.Name + "' is " + llvm::utostr(V.Align) +
+                  " in the layout table, " + llvm::utostr(Align) +
+                  " in the module");
+  }
+
+  for (size_t i = 0, e = Records.size(); i != e; i++) {
+    const Entry &R = Records[i];
+    llvm::StructType *ST = M->getTypeByName("struct." + R.Name);
+    if (ST == NULL || ST->isOpaque())
+      continue;
+
+    const llvm::StructLayout *SL = DL.getStructLayout(ST);
+    uint64_t Size = DL.getTypeAllocSize(ST);
+    if (Size != R.Size)
+      return RSMetadataUtils::Error(
+          ErrMsg, "size of struct '" + R.Name + "' is " +
+                  llvm::utostr(R.Size) + " in the layout table, " +
+                  llvm::utostr(Size) + " in the module");
+    // clang may align a record more strictly than its LLVM type requires
+    // (e.g. vectors), but never less.
+    unsigned Align = SL->getAlignment();
+    if (R.Align < Align || (R.Align % Align) != 0)
+      return RSMetadataUtils::Error(
+          ErrMsg, "alignment of struct '" + R.Name + "' is " +
+                  llvm::utostr(R.Align) + " in the layout table, " +
+                  "which does not satisfy " + llvm::utostr(Align));
+
+    for (size_t f = 0, fe = R.Fields.size(); f != fe; f++) {
+      const Field &F = R.Fields[f];
+      std::string Where =
+          "field " + llvm::utostr(f) + " of struct '" + R.Name + "'";
+      unsigned Next = (f + 1 < fe) ? R.Fields[f + 1].Offset : R.Size;
+      if (F.Offset + F.Size + F.Padding != Next)
+        return RSMetadataUtils::Error(
+            ErrMsg, Where + " does not end where the next begins");
+      if (F.Size == 0)
+        continue;
+
+      // clang lowers every field to its own element, possibly between
+      // padding elements, so some element must start at the field offset.
+      if (F.Offset >= SL->getSizeInBytes())
+        return RSMetadataUtils::Error(ErrMsg,
+                                      Where + " is outside of the struct");
+      unsigned Index = SL->getElementContainingOffset(F.Offset);
+      uint64_t ElementOffset = SL->getElementOffset(Index);
+      uint64_t ElementSize = DL.getTypeAllocSize(ST->getElementType(Index));
+      if (ElementOffset != F.Offset)
+        return RSMetadataUtils::Error(
+            ErrMsg, Where + " is at offset " + llvm::utostr(F.Offset) +
+                    " in the layout table, " + llvm::utostr(ElementOffset) +
+                    " in the module");
+      if (F.Size > ElementSize)
+        return RSMetadataUtils::Error(
+            ErrMsg, Where + " is " + llvm::utostr(F.Size) +
+                    " bytes in the layout table, " +
+                    llvm::utostr(ElementSize) + " in the module");
+    }
+  }
+
+  return true;
+}
+
+void RSExportLayout::writeToModule(llvm::Module *M) const {
+  llvm::LLVMContext &C = M->getContext();
+
+  llvm::NamedMDNode *ABIMetadata =
+      M->getOrInsertNamedMetadata(RS_EXPORT_LAYOUT_ABI_MN);
+  ABIMetadata->dropAllReferences();
+  ABIMetadata->addOperand(
+      llvm::MDNode::get(C, llvm::MDString::get(C, DataLayout)));
+
+  llvm::SmallVector<llvm::Value*, 12> Info;
+
+  if (!Vars.empty()) {
+    llvm::NamedMDNode *VarMetadata =
+        M->getOrInsertNamedMetadata(RS_EXPORT_VAR_LAYOUT_MN);
+    VarMetadata->dropAllReferences();
+    for (size_t i = 0, e = Vars.size(); i != e; i++) {
+      Info.clear();
+      Info.push_back(llvm::MDString::get(C, Vars[i].Name));
+      Info.push_back(GetInt32(C, Vars[i].Size));
+      Info.push_back(GetInt32(C, Vars[i].Align));
+      VarMetadata->addOperand(llvm::MDNode::get(C, Info));
+    }
+  }
+
+  if (!Records.empty()) {
+    llvm::NamedMDNode *RecordMetadata =
+        M->getOrInsertNamedMetadata(RS_EXPORT_RECORD_LAYOUT_MN);
+    RecordMetadata->dropAllReferences();
+    for (size_t i = 0, e = Records.size(); i != e; i++) {
+      const Entry &R = Records[i];
+      Info.clear();
+      Info.push_back(llvm::MDString::get(C, R.Name));
+      Info.push_back(GetInt32(C, R.Size));
+      Info.push_back(GetInt32(C, R.Align));
+      for (size_t f = 0, fe = R.Fields.size(); f != fe; f++) {
+        Info.push_back(GetInt32(C, R.Fields[f].Offset));
+        Info.push_back(GetInt32(C, R.Fields[f].Size));
+        Info.push_back(GetInt32(C, R.Fields[f].Padding));
+      }
+      RecordMetadata->addOperand(llvm::MDNode::get(C, Info));
+    }
+  }
+}
+
+bool RSExportLayout::readFromModule(const llvm::Module *M,
+                                    std::string *ErrMsg) {
+  clear();
+
+  const llvm::NamedMDNode *ABIMetadata =
+      M->getNamedMetadata(RS_EXPORT_LAYOUT_ABI_MN);
+  llvm::StringRef Layout;
+  if (ABIMetadata == NULL || ABIMetadata->getNumOperands() != 1 ||
+      !RSMetadataUtils::GetMDString(ABIMetadata->getOperand(0), 0, Layout))
+    return RSMetadataUtils::Error(ErrMsg, "module has no export layout table");
+  DataLayout = Layout.str();
+
+  if (const llvm::NamedMDNode *VarMetadata =
+          M->getNamedMetadata(RS_EXPORT_VAR_LAYOUT_MN)) {
+    Vars.resize(VarMetadata->getNumOperands());
+    for (unsigned i = 0, e = VarMetadata->getNumOperands(); i != e; i++) {
+      const llvm::MDNode *N = VarMetadata->getOperand(i);
+      if (N->getNumOperands() != 3 || !ReadEntry(N, Vars[i]))
+        return RSMetadataUtils::Error(ErrMsg,
+                                      "malformed " RS_EXPORT_VAR_LAYOUT_MN);
+    }
+  }
+
+  if (const llvm::NamedMDNode *RecordMetadata =
+          M->getNamedMetadata(RS_EXPORT_RECORD_LAYOUT_MN)) {
+    Records.resize(RecordMetadata->getNumOperands());
+    for (unsigned i = 0, e = RecordMetadata->getNumOperands(); i != e; i++) {
+      const llvm::MDNode *N = RecordMetadata->getOperand(i);
+      Entry &R = Records[i];
+      if (N->getNumOperands() < 3 || (N->getNumOperands() - 3) % 3 != 0 ||
+          !ReadEntry(N, R))
+        return RSMetadataUtils::Error(ErrMsg,
+                                      "malformed " RS_EXPORT_RECORD_LAYOUT_MN);
+
+      R.Fields.resize((N->getNumOperands() - 3) / 3);
+      for (unsigned f = 0, fe = R.Fields.size(); f != fe; f++) {
+        if (!RSMetadataUtils::GetInt32(N, 3 + f * 3, R.Fields[f].Offset) ||
+            !RSMetadataUtils::GetInt32(N, 4 + f * 3, R.Fields[f].Size) ||
+            !RSMetadataUtils::GetInt32(N, 5 + f * 3, R.Fields[f].Padding))
+          return RSMetadataUtils::Error(ErrMsg,
+                                        "malformed layout of struct " + R.Name);
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace slang
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_LAYOUT_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_LAYOUT_H_
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class Module;
+}
+
+namespace slang {
+
+class RSContext;
+
+// The memory layout of every exported variable and record type for the ABI
+// the module was compiled for (-emit-export-layout). With it, the runtime can
+// bind the globals and pack records without parsing the type names in
+// RS_EXPORT_VAR_MN and the "%<struct>" field lists.
+//
+// The table is stored as three named metadata (see slang_rs_metadata.h):
+//
+//   RS_EXPORT_LAYOUT_ABI_MN:    !{<data layout string>}
+//   RS_EXPORT_VAR_LAYOUT_MN:    !{<name>, i32 Size, i32 Align} for each var,
+//                               in the order of RS_EXPORT_VAR_MN
+//   RS_EXPORT_RECORD_LAYOUT_MN: !{<name>, i32 Size, i32 Align,
+//                                 [i32 Offset, i32 Size, i32 Padding] x fields}
+//                               for each record, in the order of
+//                               RS_EXPORT_TYPE_MN
+//
+// Sizes are in bytes. Size of a var or record is its allocation size. Size of
+// a field is its store size, and Padding is the number of bytes between the
+// end of the field and the next field (or the end of the record).
+class RSExportLayout {
+ public:
+  struct Field {
+    unsigned Offset;
+    unsigned Size;
+    unsigned Padding;
+  };
+
+  struct Entry {
+    std::string Name;
+    unsigned Size;
+    unsigned Align;
+    // Empty for vars
+    std::vector<Field> Fields;
+  };
+
+  std::string DataLayout;
+  std::vector<Entry> Vars;
+  std::vector<Entry> Records;
+
+  void clear();
+
+  // Fill this in from the exported vars and record types of Context, as clang
+  // laid them out.
+  void collect(const RSContext *Context);
+
+  // Cross-check this against the globals and struct types of M, laid out by
+  // the DataLayout of M. Return false (and set *ErrMsg when given) on the
+  // first mismatch. Records whose struct type is not in M are not checked.
+  bool verify(const llvm::Module *M, std::string *ErrMsg) const;
+
+  void writeToModule(llvm::Module *M) const;
+  bool readFromModule(const llvm::Module *M, std::string *ErrMsg);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORT_LAYOUT_H_  NOLINT
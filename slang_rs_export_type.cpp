@@ -570,6 +570,39 @@ bool RSExportType::NormalizeType(const clang::Type *&T,
   return true;
 }
 
+bool RSExportType::NormalizeType(RSContext *Context,
+                                 const clang::Type *&T,
+                                 llvm::StringRef &TypeName,
+                                 clang::DiagnosticsEngine *DiagEngine,
+                                 const clang::VarDecl *VD) {
+  const clang::Type *CT = GET_CANONICAL_TYPE(T);
+  if (CT == NULL) {
+    return false;
+  }
+
+  const RSContext::TypeInfo &Info = Context->getTypeInfo(CT);
+  if (Info.NormalizedType != NULL) {
+    T = Info.NormalizedType;
+    TypeName = Info.TypeName;
+    return true;
+  }
+
+  llvm::StringRef Name;
+  if (!NormalizeType(T, Name, DiagEngine, VD)) {
+    return false;
+  }
+  TypeName = Context->saveTypeName(Name);
+  if (T->getTypeClass() == clang::Type::Pointer) {
+    // Allocated in RSExportType::GetTypeName()
+    delete [] Name.data();
+  }
+
+  RSContext::TypeInfo &NewInfo = Context->getTypeInfo(CT);
+  NewInfo.NormalizedType = T;
+  NewInfo.TypeName = TypeName;
+  return true;
+}
+
 bool RSExportType::ValidateType(clang::ASTContext &C, clang::QualType QT,
     clang::NamedDecl *ND, clang::SourceLocation Loc, unsigned int TargetAPI,
     bool IsFilterscript) {
@@ -582,10 +615,33 @@ bool RSExportType::ValidateType(clang::ASTContext &C, clang::QualType QT,
   return true;
 }
 
-bool RSExportType::ValidateVarDecl(clang::VarDecl *VD, unsigned int TargetAPI,
+bool RSExportType::ValidateType(RSContext *Context, clang::QualType QT,
+    clang::NamedDecl *ND, clang::SourceLocation Loc, bool IsFilterscript) {
+  unsigned int TargetAPI = Context->getTargetAPI();
+  const clang::Type *T = GET_CANONICAL_TYPE(QT.getTypePtr());
+
+  // For older targets and for Filterscript, whether a type passes also depends
+  // on ND (see ValidateTypeHelper()).
+  if (T == NULL || IsFilterscript || TargetAPI < SLANG_JB_TARGET_API) {
+    return ValidateType(Context->getASTContext(), QT, ND, Loc, TargetAPI,
+                        IsFilterscript);
+  }
+
+  if (Context->getTypeInfo(T).Valid) {
+    return true;
+  }
+  if (!ValidateType(Context->getASTContext(), QT, ND, Loc, TargetAPI,
+                    IsFilterscript)) {
+    return false;
+  }
+  Context->getTypeInfo(T).Valid = true;
+  return true;
+}
+
+bool RSExportType::ValidateVarDecl(RSContext *Context, clang::VarDecl *VD,
                                    bool IsFilterscript) {
-  return ValidateType(VD->getASTContext(), VD->getType(), VD,
-                      VD->getLocation(), TargetAPI, IsFilterscript);
+  return ValidateType(Context, VD->getType(), VD, VD->getLocation(),
+                      IsFilterscript);
 }
 
 const clang::Type
@@ -753,8 +809,6 @@ RSExportType *RSExportType::Create(RSContext *Context,
     case clang::Type::Pointer: {
       ET = RSExportPointerType::Create(Context,
                UNSAFE_CAST_TYPE(const clang::PointerType, T), TypeName);
-      // FIXME: free the name (allocated in RSExportType::GetTypeName)
-      delete [] TypeName.data();
       break;
     }
     case clang::Type::ExtVector: {
@@ -782,12 +836,27 @@ RSExportType *RSExportType::Create(RSContext *Context,
 }
 
 RSExportType *RSExportType::Create(RSContext *Context, const clang::Type *T) {
+  // Variables, parameters and fields mostly share a few types, so look for one
+  // already created before walking T again.
+  const clang::Type *CT = GET_CANONICAL_TYPE(T);
+  if (CT != NULL) {
+    if (RSExportType *ET = Context->getTypeInfo(CT).ExportType) {
+      return ET;
+    }
+  }
+
   llvm::StringRef TypeName;
-  if (NormalizeType(T, TypeName, Context->getDiagnostics(), NULL)) {
-    return Create(Context, T, TypeName);
-  } else {
+  if (!NormalizeType(Context, T, TypeName, Context->getDiagnostics(), NULL)) {
     return NULL;
   }
+
+  RSExportType *ET = Create(Context, T, TypeName);
+  // NormalizeType() may have changed T, so store under the canonical type
+  // the lookup above uses.
+  if (ET != NULL && CT != NULL) {
+    Context->getTypeInfo(CT).ExportType = ET;
+  }
+  return ET;
 }
 
 RSExportType *RSExportType::CreateFromDecl(RSContext *Context,
@@ -827,14 +896,6 @@ RSExportType::RSExportType(RSContext *Context,
   return;
 }
 
-bool RSExportType::keep() {
-  if (!RSExportable::keep())
-    return false;
-  // Invalidate converted LLVM type.
-  mLLVMType = NULL;
-  return true;
-}
-
 bool RSExportType::equals(const RSExportable *E) const {
   CHECK_PARENT_EQUALITY(RSExportable, E);
   return (static_cast<const RSExportType*>(E)->getClass() == getClass());
@@ -1026,15 +1087,16 @@ RSExportPrimitiveType
   if ((DT == DataTypeUnknown) || TypeName.empty())
     return NULL;
   else
-    return new RSExportPrimitiveType(Context, ExportClassPrimitive, TypeName,
-                                     DT, Normalized);
+    return new(Context) RSExportPrimitiveType(Context, ExportClassPrimitive,
+                                              TypeName, DT, Normalized);
 }
 
 RSExportPrimitiveType *RSExportPrimitiveType::Create(RSContext *Context,
                                                      const clang::Type *T) {
   llvm::StringRef TypeName;
-  if (RSExportType::NormalizeType(T, TypeName, Context->getDiagnostics(), NULL)
-      && IsPrimitiveType(T)) {
+  if (RSExportType::NormalizeType(Context, T, TypeName,
+                                  Context->getDiagnostics(), NULL) &&
+      IsPrimitiveType(T)) {
     return Create(Context, T, TypeName);
   } else {
     return NULL;
@@ -1106,7 +1168,7 @@ llvm::Type *RSExportPrimitiveType::convertToLLVMType() const {
 }
 
 union RSType *RSExportPrimitiveType::convertToSpecType() const {
-  llvm::OwningPtr<union RSType> ST(new union RSType);
+  llvm::OwningPtr<union RSType> ST(new union RSType());
   RS_TYPE_SET_CLASS(ST, RS_TC_Primitive);
   // enum RSExportPrimitiveType::DataType is synced with enum RSDataType in
   // slang_rs_type_spec.h
@@ -1149,7 +1211,7 @@ RSExportPointerType
     return NULL;
   }
 
-  return new RSExportPointerType(Context, TypeName, PointeeET);
+  return new(Context) RSExportPointerType(Context, TypeName, PointeeET);
 }
 
 llvm::Type *RSExportPointerType::convertToLLVMType() const {
@@ -1158,7 +1220,7 @@ llvm::Type *RSExportPointerType::convertToLLVMType() const {
 }
 
 union RSType *RSExportPointerType::convertToSpecType() const {
-  llvm::OwningPtr<union RSType> ST(new union RSType);
+  llvm::OwningPtr<union RSType> ST(new union RSType());
 
   RS_TYPE_SET_CLASS(ST, RS_TC_Pointer);
   RS_POINTER_TYPE_SET_POINTEE_TYPE(ST, getPointeeType()->getSpecType());
@@ -1169,13 +1231,6 @@ union RSType *RSExportPointerType::convertToSpecType() const {
     return NULL;
 }
 
-bool RSExportPointerType::keep() {
-  if (!RSExportType::keep())
-    return false;
-  const_cast<RSExportType*>(mPointeeType)->keep();
-  return true;
-}
-
 bool RSExportPointerType::equals(const RSExportable *E) const {
   CHECK_PARENT_EQUALITY(RSExportType, E);
   return (static_cast<const RSExportPointerType*>(E)
@@ -1223,11 +1278,11 @@ RSExportVectorType *RSExportVectorType::Create(RSContext *Context,
       RSExportPrimitiveType::GetDataType(Context, ElementType);
 
   if (DT != RSExportPrimitiveType::DataTypeUnknown)
-    return new RSExportVectorType(Context,
-                                  TypeName,
-                                  DT,
-                                  Normalized,
-                                  EVT->getNumElements());
+    return new(Context) RSExportVectorType(Context,
+                                           TypeName,
+                                           DT,
+                                           Normalized,
+                                           EVT->getNumElements());
   else
     return NULL;
 }
@@ -1238,7 +1293,7 @@ llvm::Type *RSExportVectorType::convertToLLVMType() const {
 }
 
 union RSType *RSExportVectorType::convertToSpecType() const {
-  llvm::OwningPtr<union RSType> ST(new union RSType);
+  llvm::OwningPtr<union RSType> ST(new union RSType());
 
   RS_TYPE_SET_CLASS(ST, RS_TC_Vector);
   RS_VECTOR_TYPE_SET_ELEMENT_TYPE(ST, getType());
@@ -1329,7 +1384,7 @@ RSExportMatrixType *RSExportMatrixType::Create(RSContext *Context,
     }
   }
 
-  return new RSExportMatrixType(Context, TypeName, Dim);
+  return new(Context) RSExportMatrixType(Context, TypeName, Dim);
 }
 
 llvm::Type *RSExportMatrixType::convertToLLVMType() const {
@@ -1345,7 +1400,7 @@ llvm::Type *RSExportMatrixType::convertToLLVMType() const {
 }
 
 union RSType *RSExportMatrixType::convertToSpecType() const {
-  llvm::OwningPtr<union RSType> ST(new union RSType);
+  llvm::OwningPtr<union RSType> ST(new union RSType());
   RS_TYPE_SET_CLASS(ST, RS_TC_Matrix);
   switch (getDim()) {
     case 2: RS_MATRIX_TYPE_SET_DATA_TYPE(ST, RS_DT_RSMatrix2x2); break;
@@ -1379,9 +1434,9 @@ RSExportConstantArrayType
     return NULL;
   }
 
-  return new RSExportConstantArrayType(Context,
-                                       ElementET,
-                                       Size);
+  return new(Context) RSExportConstantArrayType(Context,
+                                                ElementET,
+                                                Size);
 }
 
 llvm::Type *RSExportConstantArrayType::convertToLLVMType() const {
@@ -1389,7 +1444,7 @@ llvm::Type *RSExportConstantArrayType::convertToLLVMType() const {
 }
 
 union RSType *RSExportConstantArrayType::convertToSpecType() const {
-  llvm::OwningPtr<union RSType> ST(new union RSType);
+  llvm::OwningPtr<union RSType> ST(new union RSType());
 
   RS_TYPE_SET_CLASS(ST, RS_TC_ConstantArray);
   RS_CONSTANT_ARRAY_TYPE_SET_ELEMENT_TYPE(
@@ -1402,13 +1457,6 @@ union RSType *RSExportConstantArrayType::convertToSpecType() const {
     return NULL;
 }
 
-bool RSExportConstantArrayType::keep() {
-  if (!RSExportType::keep())
-    return false;
-  const_cast<RSExportType*>(mElementType)->keep();
-  return true;
-}
-
 bool RSExportConstantArrayType::equals(const RSExportable *E) const {
   CHECK_PARENT_EQUALITY(RSExportType, E);
   const RSExportConstantArrayType *RHS =
@@ -1441,11 +1489,12 @@ RSExportRecordType *RSExportRecordType::Create(RSContext *Context,
       "Failed to retrieve the struct layout from Clang.");
 
   RSExportRecordType *ERT =
-      new RSExportRecordType(Context,
-                             TypeName,
-                             RD->hasAttr<clang::PackedAttr>(),
-                             mIsArtificial,
-                             RL->getSize().getQuantity());
+      new(Context) RSExportRecordType(Context,
+                                      TypeName,
+                                      RD->hasAttr<clang::PackedAttr>(),
+                                      mIsArtificial,
+                                      RL->getSize().getQuantity(),
+                                      RL->getAlignment().getQuantity());
   unsigned int Index = 0;
 
   for (clang::RecordDecl::field_iterator FI = RD->field_begin(),
@@ -1537,18 +1586,6 @@ union RSType *RSExportRecordType::convertToSpecType() const {
   return ST.take();
 }
 
-bool RSExportRecordType::keep() {
-  if (!RSExportType::keep())
-    return false;
-  for (std::list<const Field*>::iterator I = mFields.begin(),
-          E = mFields.end();
-       I != E;
-       I++) {
-    const_cast<RSExportType*>((*I)->getType())->keep();
-  }
-  return true;
-}
-
 bool RSExportRecordType::equals(const RSExportable *E) const {
   CHECK_PARENT_EQUALITY(RSExportType, E);
 
@@ -156,6 +156,13 @@ class RSExportType : public RSExportable {
                             llvm::StringRef &TypeName,
                             clang::DiagnosticsEngine *Diags,
                             const clang::VarDecl *VD);
+  // Same as above, but the result is remembered in Context, and TypeName
+  // lives as long as Context.
+  static bool NormalizeType(RSContext *Context,
+                            const clang::Type *&T,
+                            llvm::StringRef &TypeName,
+                            clang::DiagnosticsEngine *Diags,
+                            const clang::VarDecl *VD);
 
   // This function checks whether the specified type can be handled by RS/FS.
   // If it cannot, this function returns false. Otherwise it returns true.
@@ -163,11 +170,16 @@ class RSExportType : public RSExportable {
   static bool ValidateType(clang::ASTContext &C, clang::QualType QT,
                            clang::NamedDecl *ND, clang::SourceLocation Loc,
                            unsigned int TargetAPI, bool IsFilterscript);
+  // Same as above for the target API of Context, remembering the types that
+  // pass in Context when the checks do not depend on ND.
+  static bool ValidateType(RSContext *Context, clang::QualType QT,
+                           clang::NamedDecl *ND, clang::SourceLocation Loc,
+                           bool IsFilterscript);
 
   // This function ensures that the VarDecl can be properly handled by RS.
   // If it cannot, this function returns false. Otherwise it returns true.
   // Filterscript has additional restrictions on supported types.
-  static bool ValidateVarDecl(clang::VarDecl *VD, unsigned int TargetAPI,
+  static bool ValidateVarDecl(RSContext *Context, clang::VarDecl *VD,
                               bool IsFilterscript);
 
   // @T may not be normalized
@@ -206,7 +218,6 @@ class RSExportType : public RSExportable {
     return "@@INVALID@@";
   }
 
-  virtual bool keep();
   virtual bool equals(const RSExportable *E) const;
 };  // RSExportType
 
@@ -351,8 +362,6 @@ class RSExportPointerType : public RSExportType {
   virtual union RSType *convertToSpecType() const;
 
  public:
-  virtual bool keep();
-
   inline const RSExportType *getPointeeType() const { return mPointeeType; }
 
   virtual bool equals(const RSExportable *E) const;
@@ -472,7 +481,6 @@ class RSExportConstantArrayType : public RSExportType {
     return mElementType->getElementName();
   }
 
-  virtual bool keep();
   virtual bool equals(const RSExportable *E) const;
 };
 
@@ -523,16 +531,19 @@ class RSExportRecordType : public RSExportType {
   // get reflected)
   bool mIsArtificial;
   size_t mAllocSize;
+  size_t mAlignment;
 
   RSExportRecordType(RSContext *Context,
                      const llvm::StringRef &Name,
                      bool IsPacked,
                      bool IsArtificial,
-                     size_t AllocSize)
+                     size_t AllocSize,
+                     size_t Alignment)
       : RSExportType(Context, ExportClassRecord, Name),
         mIsPacked(IsPacked),
         mIsArtificial(IsArtificial),
-        mAllocSize(AllocSize) {
+        mAllocSize(AllocSize),
+        mAlignment(Alignment) {
     return;
   }
 
@@ -553,12 +564,12 @@ class RSExportRecordType : public RSExportType {
   inline bool isPacked() const { return mIsPacked; }
   inline bool isArtificial() const { return mIsArtificial; }
   inline size_t getAllocSize() const { return mAllocSize; }
+  inline size_t getAlignment() const { return mAlignment; }
 
   virtual std::string getElementName() const {
     return "ScriptField_" + getName();
   }
 
-  virtual bool keep();
   virtual bool equals(const RSExportable *E) const;
 
   ~RSExportRecordType() {
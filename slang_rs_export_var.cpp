@@ -48,7 +48,8 @@ RSExportVar::RSExportVar(RSContext *Context,
       mIsConst(false),
       mIsUnsigned(false),
       mArraySize(0),
-      mNumInits(0) {
+      mNumInits(0),
+      mAlignment(Context->getASTContext().getDeclAlign(VD).getQuantity()) {
   // mInit - Evaluate initializer expression
   const clang::Expr *Initializer = VD->getAnyInitializer();
   if (Initializer != NULL) {
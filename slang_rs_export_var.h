@@ -45,6 +45,9 @@ class RSExportVar : public RSExportable {
   size_t mNumInits;
   llvm::SmallVector<clang::Expr::EvalResult, 0> mInitArray;
 
+  // Alignment of the variable in bytes, as laid out by clang
+  size_t mAlignment;
+
   RSExportVar(RSContext *Context,
               const clang::VarDecl *VD,
               const RSExportType *ET);
@@ -54,6 +57,7 @@ class RSExportVar : public RSExportable {
   inline const RSExportType *getType() const { return mET; }
   inline bool isConst() const { return mIsConst; }
   inline bool isUnsigned() const { return mIsUnsigned; }
+  inline size_t getAlignment() const { return mAlignment; }
 
   inline const clang::APValue &getInit() const { return mInit.Val; }
 
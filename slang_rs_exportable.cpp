@@ -18,14 +18,6 @@
 
 namespace slang {
 
-bool RSExportable::keep() {
-  if (isKeep())
-    return false;
-  // Invalidate associated Context.
-  mContext = NULL;
-  return true;
-}
-
 bool RSExportable::equals(const RSExportable *E) const {
   return ((E == NULL) ? false : (mK == E->mK));
 }
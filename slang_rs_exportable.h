@@ -17,10 +17,18 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORTABLE_H_  // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_EXPORTABLE_H_
 
+#include <cstddef>
+
 #include "slang_rs_context.h"
 
 namespace slang {
 
+// RSExportables are allocated in the arena of their RSContext, with
+//
+//   new(Context) RSExportFoo(Context, ...)
+//
+// and all of them are destroyed (and their memory released at once) with the
+// context.
 class RSExportable {
  public:
   enum Kind {
@@ -43,21 +51,25 @@ class RSExportable {
     return;
   }
 
+  // Only RSContext::~RSContext() destroys exportables, and the arena owns
+  // their memory.
+  void operator delete(void *) { }
+  virtual ~RSExportable() { }
+
+  friend class RSContext;
+
  public:
-  inline Kind getKind() const { return mK; }
+  void *operator new(size_t Size, RSContext *Context) {
+    return Context->allocateExportable(Size);
+  }
+  // Only called if the constructor throws.
+  void operator delete(void *, RSContext *) { }
 
-  // When keep() is invoked, mKeep will set to true and the associated RSContext
-  // won't free this RSExportable object in its destructor. The deallcation
-  // responsibility is then transferred to the object who invoked this function.
-  // Return false if the exportable is kept or failed to keep.
-  virtual bool keep();
-  inline bool isKeep() const { return (mContext == NULL); }
+  inline Kind getKind() const { return mK; }
 
   virtual bool equals(const RSExportable *E) const;
 
   inline RSContext *getRSContext() const { return mContext; }
-
-  virtual ~RSExportable() { }
 };
 }  // namespace slang
 
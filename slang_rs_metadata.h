@@ -18,19 +18,36 @@
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_H_
 
 // MN stands for "metadata name"
-#define RS_EXPORT_VAR_MN  "#rs_export_var"
+
+// RS_EXPORT_VAR_MN, RS_EXPORT_FUNC_MN and RS_EXPORT_FOREACH_NAME_MN are shared
+// with the bitcode writers.
+#include "BitWriter_common/ExportMetadataNames.h"
+
 #define RS_EXPORT_VAR_NAME  0
 #define RS_EXPORT_VAR_TYPE  1
 
-#define RS_EXPORT_FUNC_MN "#rs_export_func"
 #define RS_EXPORT_FUNC_NAME 0
 
+// Exported helper that applies a ScriptC_*.Batch packet (see
+// RSContext::computeBatchLayout()). It is always the last exported function.
+#define RS_BATCH_UPDATE_FUNC_NAME ".rs.batch_update"
+
 #define RS_EXPORT_TYPE_MN "#rs_export_type"
 
 #define RS_OBJECT_SLOTS_MN "#rs_object_slots"
 
-#define RS_EXPORT_FOREACH_NAME_MN "#rs_export_foreach_name"
+// All object slots in one node (see slang_rs_object_slots.h)
+#define RS_OBJECT_SLOT_MAP_MN "#rs_object_slot_map"
 
 #define RS_EXPORT_FOREACH_MN "#rs_export_foreach"
 
+// Binary encoding of all the above (see slang_rs_export_blob.h)
+#define RS_EXPORT_BLOB_MN "#rs_export_blob"
+
+// Precomputed layout of the exported vars and records for the ABI of the
+// module (see slang_rs_export_layout.h)
+#define RS_EXPORT_LAYOUT_ABI_MN "#rs_export_layout_abi"
+#define RS_EXPORT_VAR_LAYOUT_MN "#rs_export_var_layout"
+#define RS_EXPORT_RECORD_LAYOUT_MN "#rs_export_record_layout"
+
 #endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_H_  NOLINT
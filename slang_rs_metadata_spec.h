@@ -33,6 +33,17 @@
 //
 // 5. RSVar => an string table index plus RSType array index
 // 6. RSFunction => an string table index
+//
+// The names below don't overlap with those of slang_rs_metadata.h, so this
+// encoding can be emitted alongside the legacy one (-emit-spec-metadata).
+
+// MN stands for "metadata name"
+#define RS_SPEC_STRTAB_MN       "#rs_metadata_strtab"
+#define RS_SPEC_TYPE_INFO_MN    "#rs_type_info"
+#define RS_SPEC_EXPORT_VAR_MN   "#rs_spec_export_var"
+#define RS_SPEC_EXPORT_FUNC_MN  "#rs_spec_export_func"
+// Field list of a record type: [field name index, field type index] pairs.
+#define RS_SPEC_RECORD_TYPE_NAME_MN_PREFIX  "#rs_spec_record%"
 
 namespace llvm {
   class Module;
@@ -60,6 +71,9 @@ RSMetadataEncoder *CreateRSMetadataEncoder(llvm::Module *M);
 int RSEncodeVarMetadata(RSMetadataEncoder *E, const RSVar *V);
 // Encode F as a metadata in M. Return 0 if every thing goes well.
 int RSEncodeFunctionMetadata(RSMetadataEncoder *E, const RSFunction *F);
+// Encode T (and the types it refers to) in the type info of M, without an
+// exported variable of that type. Return 0 if every thing goes well.
+int RSEncodeTypeMetadata(RSMetadataEncoder *E, const union RSType *T);
 
 // Release the memory allocation of Encoder without flushing things.
 void DestroyRSMetadataEncoder(RSMetadataEncoder *E);
@@ -68,18 +82,24 @@ void DestroyRSMetadataEncoder(RSMetadataEncoder *E);
 // every thing goes well. This will also call the DestroyRSMetadataEncoder().
 int FinalizeRSMetadataEncoder(RSMetadataEncoder *E);
 
-// TODO(slang): Decoder
 struct RSMetadata {
   unsigned num_vars;
   unsigned num_funcs;
+  unsigned num_types;
 
   RSVar *vars;
   RSFunction *funcs;
+  // Every type in the type info, in encoding order. Record types are found
+  // here even if no exported variable uses them.
+  const union RSType **types;
 
   void *context;
 };
 
-// struct RSMetadata *RSDecodeMetadata(llvm::Module *M);
-// void RSReleaseMetadata(struct RSMetadata *MD);
+// Decode the metadata written by an RSMetadataEncoder into M. Return NULL if
+// M has none or it is malformed. All the strings and types are owned by the
+// result.
+struct RSMetadata *RSDecodeMetadata(const llvm::Module *M);
+void RSReleaseMetadata(struct RSMetadata *MD);
 
 #endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_SPEC_H_  NOLINT
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_metadata_spec.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+
+#include "slang_rs_metadata_utils.h"
+#include "slang_rs_type_spec.h"
+
+namespace {
+
+using slang::RSMetadataUtils;
+
+// Owns everything an RSMetadata returned by RSDecodeMetadata() points to.
+struct RSMetadataContext {
+  RSMetadata MD;
+
+  std::string StrTab;
+  std::vector<const char*> Strings;
+  std::vector<union RSType*> Types;
+  std::vector<RSVar> Vars;
+  std::vector<RSFunction> Funcs;
+
+  RSMetadataContext() {
+    ::memset(&MD, 0, sizeof(MD));
+    MD.context = this;
+  }
+
+  ~RSMetadataContext() {
+    for (size_t i = 0, e = Types.size(); i != e; i++)
+      operator delete(Types[i]);
+  }
+
+  bool getString(unsigned Index, const char *&S) const {
+    if (Index >= Strings.size())
+      return false;
+    S = Strings[Index];
+    return true;
+  }
+
+  bool getType(unsigned Index, const union RSType *&T) const {
+    if (Index >= Types.size())
+      return false;
+    T = Types[Index];
+    return true;
+  }
+};
+
+// Counterpart of EncodeInteger() in slang_rs_metadata_spec_encoder.cpp.
+bool GetEncodedInteger(const llvm::MDNode *N, unsigned I, unsigned &Value) {
+  llvm::StringRef S;
+  if (!RSMetadataUtils::GetMDString(N, I, S) ||
+      S.size() != sizeof(Value))
+    return false;
+  ::memcpy(&Value, S.data(), sizeof(Value));
+  return true;
+}
+
+bool DecodeStringTable(const llvm::Module *M, RSMetadataContext &C) {
+  const llvm::NamedMDNode *StrTabMD = M->getNamedMetadata(RS_SPEC_STRTAB_MN);
+  if (StrTabMD == NULL)
+    return true;  // No strings at all
+
+  llvm::StringRef StrTab, StrIdx;
+  if (StrTabMD->getNumOperands() != 1 ||
+      !RSMetadataUtils::GetMDString(StrTabMD->getOperand(0), 0, StrTab) ||
+      !RSMetadataUtils::GetMDString(StrTabMD->getOperand(0), 1, StrIdx) ||
+      (StrIdx.size() % sizeof(unsigned)) != 0)
+    return false;
+  // Every string, and so the table, ends with a '\0'.
+  if (!StrTab.empty() && StrTab.back() != '\0')
+    return false;
+
+  C.StrTab = StrTab.str();
+  unsigned NumStrings = StrIdx.size() / sizeof(unsigned);
+  C.Strings.resize(NumStrings);
+  for (unsigned i = 0; i < NumStrings; i++) {
+    unsigned Offset;
+    ::memcpy(&Offset, StrIdx.data() + i * sizeof(unsigned), sizeof(Offset));
+    if (Offset >= C.StrTab.size())
+      return false;
+    C.Strings[i] = C.StrTab.data() + Offset;
+  }
+  return true;
+}
+
+bool DecodeTypeInfo(const llvm::Module *M, RSMetadataContext &C) {
+  const llvm::NamedMDNode *TypeInfoMD =
+      M->getNamedMetadata(RS_SPEC_TYPE_INFO_MN);
+  if (TypeInfoMD == NULL)
+    return true;  // No types at all
+
+  llvm::StringRef TypeInfo;
+  if (TypeInfoMD->getNumOperands() != 1 ||
+      !RSMetadataUtils::GetMDString(TypeInfoMD->getOperand(0), 0, TypeInfo) ||
+      (TypeInfo.size() % sizeof(unsigned)) != 0)
+    return false;
+
+  std::vector<unsigned> Words(TypeInfo.size() / sizeof(unsigned));
+  if (!Words.empty())
+    ::memcpy(&Words[0], TypeInfo.data(), TypeInfo.size());
+
+  // First pass: find where each type starts and allocate it, so that the
+  // second pass can resolve references to types encoded after the referrer
+  // (e.g. the fields of a record).
+  std::vector<unsigned> Offsets;
+  for (unsigned i = 0, e = Words.size(); i < e; ) {
+    struct RSTypeBase Base;
+    Base.bits = Words[i];
+    unsigned NumExtraWords = 0;
+    size_t Size = sizeof(union RSType);
+
+    switch (Base.b[0]) {
+      case RS_TC_Primitive:
+      case RS_TC_Vector:
+      case RS_TC_Matrix:
+        break;
+      case RS_TC_Pointer:
+      case RS_TC_ConstantArray:
+        NumExtraWords = 1;
+        break;
+      case RS_TC_Record:
+        NumExtraWords = 1;
+        Size += sizeof(struct RSRecordField) * (Base.bits >> 16);
+        break;
+      default:
+        return false;
+    }
+    if (NumExtraWords > e - i - 1)
+      return false;
+
+    union RSType *T = reinterpret_cast<union RSType*>(operator new(Size));
+    ::memset(T, 0, Size);
+    RS_GET_TYPE_BASE(T)->bits = Base.bits;
+    C.Types.push_back(T);
+    Offsets.push_back(i);
+
+    i += 1 + NumExtraWords;
+  }
+
+  // Second pass: fill in the references.
+  for (unsigned t = 0, e = C.Types.size(); t != e; t++) {
+    union RSType *T = C.Types[t];
+    unsigned Extra = (Offsets[t] + 1 < Words.size()) ? Words[Offsets[t] + 1]
+                                                     : 0;
+    switch (RS_TYPE_GET_CLASS(T)) {
+      case RS_TC_Pointer: {
+        const union RSType *Pointee;
+        if (!C.getType(Extra, Pointee))
+          return false;
+        RS_POINTER_TYPE_SET_POINTEE_TYPE(T, Pointee);
+        break;
+      }
+      case RS_TC_ConstantArray: {
+        const union RSType *Element;
+        if (!C.getType(Extra, Element))
+          return false;
+        RS_CONSTANT_ARRAY_TYPE_SET_ELEMENT_TYPE(T, Element);
+        break;
+      }
+      case RS_TC_Record: {
+        const char *MetadataName;
+        if (!C.getString(Extra, MetadataName))
+          return false;
+        llvm::StringRef Name(MetadataName);
+        if (!Name.startswith(RS_SPEC_RECORD_TYPE_NAME_MN_PREFIX))
+          return false;
+        RS_RECORD_TYPE_SET_NAME(T, MetadataName +
+                                   strlen(RS_SPEC_RECORD_TYPE_NAME_MN_PREFIX));
+
+        const llvm::NamedMDNode *FieldsMD = M->getNamedMetadata(Name);
+        unsigned NumFields = RS_RECORD_TYPE_GET_NUM_FIELDS(T);
+        if (NumFields == 0)
+          break;
+        if (FieldsMD == NULL || FieldsMD->getNumOperands() != NumFields)
+          return false;
+        for (unsigned f = 0; f < NumFields; f++) {
+          unsigned FieldName, FieldType;
+          const char *FieldNameStr;
+          const union RSType *FieldTypePtr;
+          if (!GetEncodedInteger(FieldsMD->getOperand(f), 0, FieldName) ||
+              !GetEncodedInteger(FieldsMD->getOperand(f), 1, FieldType) ||
+              !C.getString(FieldName, FieldNameStr) ||
+              !C.getType(FieldType, FieldTypePtr))
+            return false;
+          RS_RECORD_TYPE_SET_FIELD_NAME(T, f, FieldNameStr);
+          RS_RECORD_TYPE_SET_FIELD_TYPE(T, f, FieldTypePtr);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  return true;
+}
+
+bool DecodeVars(const llvm::Module *M, RSMetadataContext &C) {
+  const llvm::NamedMDNode *VarMD = M->getNamedMetadata(RS_SPEC_EXPORT_VAR_MN);
+  if (VarMD == NULL)
+    return true;
+
+  C.Vars.resize(VarMD->getNumOperands());
+  for (unsigned i = 0, e = VarMD->getNumOperands(); i != e; i++) {
+    unsigned Name, Type;
+    if (!GetEncodedInteger(VarMD->getOperand(i), 0, Name) ||
+        !GetEncodedInteger(VarMD->getOperand(i), 1, Type) ||
+        !C.getString(Name, C.Vars[i].name) ||
+        !C.getType(Type, C.Vars[i].type))
+      return false;
+  }
+  return true;
+}
+
+bool DecodeFuncs(const llvm::Module *M, RSMetadataContext &C) {
+  const llvm::NamedMDNode *FuncMD =
+      M->getNamedMetadata(RS_SPEC_EXPORT_FUNC_MN);
+  if (FuncMD == NULL)
+    return true;
+
+  C.Funcs.resize(FuncMD->getNumOperands());
+  for (unsigned i = 0, e = FuncMD->getNumOperands(); i != e; i++) {
+    unsigned Name;
+    if (!GetEncodedInteger(FuncMD->getOperand(i), 0, Name) ||
+        !C.getString(Name, C.Funcs[i].name))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+struct RSMetadata *RSDecodeMetadata(const llvm::Module *M) {
+  if (M->getNamedMetadata(RS_SPEC_TYPE_INFO_MN) == NULL &&
+      M->getNamedMetadata(RS_SPEC_EXPORT_FUNC_MN) == NULL)
+    return NULL;
+
+  RSMetadataContext *C = new RSMetadataContext();
+  if (!DecodeStringTable(M, *C) ||
+      !DecodeTypeInfo(M, *C) ||
+      !DecodeVars(M, *C) ||
+      !DecodeFuncs(M, *C)) {
+    delete C;
+    return NULL;
+  }
+
+  C->MD.num_vars = C->Vars.size();
+  C->MD.num_funcs = C->Funcs.size();
+  C->MD.num_types = C->Types.size();
+  C->MD.vars = C->Vars.empty() ? NULL : &C->Vars[0];
+  C->MD.funcs = C->Funcs.empty() ? NULL : &C->Funcs[0];
+  C->MD.types = C->Types.empty() ? NULL :
+      const_cast<const union RSType**>(&C->Types[0]);
+
+  return &C->MD;
+}
+
+void RSReleaseMetadata(struct RSMetadata *MD) {
+  if (MD == NULL)
+    return;
+  delete static_cast<RSMetadataContext*>(MD->context);
+  return;
+}
@@ -17,6 +17,7 @@
 #include "slang_rs_metadata_spec.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <list>
 #include <map>
 #include <string>
@@ -24,18 +25,12 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 
-#include "llvm/Metadata.h"
-#include "llvm/Module.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
 
 #include "slang_assert.h"
 #include "slang_rs_type_spec.h"
 
-#define RS_METADATA_STRTAB_MN   "#rs_metadata_strtab"
-#define RS_TYPE_INFO_MN         "#rs_type_info"
-#define RS_EXPORT_VAR_MN        "#rs_export_var"
-#define RS_EXPORT_FUNC_MN       "#rs_export_func"
-#define RS_EXPORT_RECORD_TYPE_NAME_MN_PREFIX  "%"
-
 ///////////////////////////////////////////////////////////////////////////////
 // Useful utility functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -107,6 +102,7 @@ RS_DATA_TYPE_CLASS_ENUMS
 
   int encodeRSVar(const RSVar *V);
   int encodeRSFunc(const RSFunction *F);
+  int encodeType(const union RSType *T);
 
   int finalize();
 };
@@ -183,7 +179,9 @@ unsigned RSMetadataEncoderInternal::encodePointerType(const union RSType *T) {
   if (!checkReturnIndex(&PointeeType))
     return 0;
 
-  unsigned Res = encodeTypeBaseAsKey(RS_GET_TYPE_BASE(T));
+  // The base of a pointer type doesn't tell its pointee, so it cannot be used
+  // as a key for deduplication.
+  unsigned Res = encodeTypeBase(RS_GET_TYPE_BASE(T));
   // Push PointeeType after the base type
   mEncodedRSTypeInfo.push_back(PointeeType);
   return Res;
@@ -213,7 +211,7 @@ RSMetadataEncoderInternal::encodeConstantArrayType(const union RSType *T) {
 
 unsigned RSMetadataEncoderInternal::encodeRecordType(const union RSType *T) {
   // Construct record name
-  std::string RecordInfoMetadataName(RS_EXPORT_RECORD_TYPE_NAME_MN_PREFIX);
+  std::string RecordInfoMetadataName(RS_SPEC_RECORD_TYPE_NAME_MN_PREFIX);
   RecordInfoMetadataName.append(RS_RECORD_TYPE_GET_NAME(T));
 
   // Try to find it in mRecordTypes
@@ -314,6 +312,9 @@ int RSMetadataEncoderInternal::encodeRSVar(const RSVar *V) {
 
   // 2. type
   unsigned Type = encodeRSType(V->type);
+  if (!checkReturnIndex(&Type)) {
+    return -2;
+  }
 
   llvm::SmallVector<llvm::Value*, 1> VarInfo;
 
@@ -325,7 +326,8 @@ int RSMetadataEncoderInternal::encodeRSVar(const RSVar *V) {
   }
 
   if (mVarInfoMetadata == NULL)
-    mVarInfoMetadata = mModule->getOrInsertNamedMetadata(RS_EXPORT_VAR_MN);
+    mVarInfoMetadata =
+        mModule->getOrInsertNamedMetadata(RS_SPEC_EXPORT_VAR_MN);
 
   mVarInfoMetadata->addOperand(llvm::MDNode::get(mModule->getContext(),
                                                  VarInfo));
@@ -351,7 +353,8 @@ int RSMetadataEncoderInternal::encodeRSFunc(const RSFunction *F) {
   }
 
   if (mFuncInfoMetadata == NULL)
-    mFuncInfoMetadata = mModule->getOrInsertNamedMetadata(RS_EXPORT_FUNC_MN);
+    mFuncInfoMetadata =
+        mModule->getOrInsertNamedMetadata(RS_SPEC_EXPORT_FUNC_MN);
 
   mFuncInfoMetadata->addOperand(llvm::MDNode::get(mModule->getContext(),
                                                   FuncInfo));
@@ -359,6 +362,17 @@ int RSMetadataEncoderInternal::encodeRSFunc(const RSFunction *F) {
   return 0;
 }
 
+int RSMetadataEncoderInternal::encodeType(const union RSType *T) {
+  if (T == NULL)
+    return -1;
+
+  unsigned Type = encodeRSType(T);
+  if (!checkReturnIndex(&Type))
+    return -2;
+
+  return 0;
+}
+
 // Write string table and string index table
 int RSMetadataEncoderInternal::flushStringTable() {
   slangAssert((mCurStringIndex == mEncodedStrings.size()));
@@ -369,7 +383,7 @@ int RSMetadataEncoderInternal::flushStringTable() {
 
   // Prepare named MDNode for string table and string index table.
   llvm::NamedMDNode *RSMetadataStrTab =
-      mModule->getOrInsertNamedMetadata(RS_METADATA_STRTAB_MN);
+      mModule->getOrInsertNamedMetadata(RS_SPEC_STRTAB_MN);
   RSMetadataStrTab->dropAllReferences();
 
   unsigned StrTabSize = 0;
@@ -424,7 +438,7 @@ int RSMetadataEncoderInternal::flushStringTable() {
 
   if ((StrTabMDS == NULL) || (StrIdxMDS == NULL)) {
     free(StrIdx);
-    free(StrTab);
+    free(const_cast<char*>(StrTabData.data()));
     return -1;
   }
 
@@ -434,6 +448,10 @@ int RSMetadataEncoderInternal::flushStringTable() {
   RSMetadataStrTab->addOperand(llvm::MDNode::get(mModule->getContext(),
                                                  StrTabVal));
 
+  // MDString keeps its own copy.
+  free(StrIdx);
+  free(const_cast<char*>(StrTabData.data()));
+
   return 0;
 }
 
@@ -445,7 +463,7 @@ int RSMetadataEncoderInternal::flushTypeInfo() {
   }
 
   llvm::NamedMDNode *RSTypeInfo =
-      mModule->getOrInsertNamedMetadata(RS_TYPE_INFO_MN);
+      mModule->getOrInsertNamedMetadata(RS_SPEC_TYPE_INFO_MN);
   RSTypeInfo->dropAllReferences();
 
   unsigned *TypeInfos =
@@ -507,6 +525,10 @@ int RSEncodeFunctionMetadata(RSMetadataEncoder *E, const RSFunction *F) {
   return reinterpret_cast<RSMetadataEncoderInternal*>(E)->encodeRSFunc(F);
 }
 
+int RSEncodeTypeMetadata(RSMetadataEncoder *E, const union RSType *T) {
+  return reinterpret_cast<RSMetadataEncoderInternal*>(E)->encodeType(T);
+}
+
 void DestroyRSMetadataEncoder(RSMetadataEncoder *E) {
   RSMetadataEncoderInternal *C =
       reinterpret_cast<RSMetadataEncoderInternal*>(E);
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_metadata_utils.h"
+
+#include <string>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+
+namespace slang {
+
+bool RSMetadataUtils::Error(std::string *ErrMsg, const std::string &Message) {
+  if (ErrMsg)
+    *ErrMsg = Message;
+  return false;
+}
+
+bool RSMetadataUtils::GetMDString(const llvm::MDNode *N, unsigned I,
+                                  llvm::StringRef &S) {
+  if (N == NULL || I >= N->getNumOperands())
+    return false;
+  const llvm::MDString *MDS =
+      llvm::dyn_cast_or_null<llvm::MDString>(N->getOperand(I));
+  if (MDS == NULL)
+    return false;
+  S = MDS->getString();
+  return true;
+}
+
+bool RSMetadataUtils::GetInt32(const llvm::MDNode *N, unsigned I,
+                               unsigned &Value) {
+  if (N == NULL || I >= N->getNumOperands())
+    return false;
+  const llvm::ConstantInt *CI =
+      llvm::dyn_cast_or_null<llvm::ConstantInt>(N->getOperand(I));
+  if (CI == NULL || CI->getBitWidth() != 32)
+    return false;
+  Value = static_cast<unsigned>(CI->getZExtValue());
+  return true;
+}
+
+bool RSMetadataUtils::ParseUnsigned(llvm::StringRef S, unsigned &Value) {
+  // getAsInteger() also accepts other radixes, so insist on plain digits.
+  if (S.empty() || S.find_first_not_of("0123456789") != llvm::StringRef::npos)
+    return false;
+  return !S.getAsInteger(10, Value);
+}
+
+}  // namespace slang
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_UTILS_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_UTILS_H_
+
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class MDNode;
+}
+
+namespace slang {
+
+// Helpers shared by the readers of the RS metadata that slang emits (the
+// export blob, the layout table, the object slots and the spec tables).
+class RSMetadataUtils {
+ private:
+  RSMetadataUtils() {}
+
+ public:
+  // Set *ErrMsg (if ErrMsg is not NULL) to Message and return false.
+  static bool Error(std::string *ErrMsg, const std::string &Message);
+
+  // Get operand I of N, which has to be an MDString. Returns false if N is
+  // NULL, has no operand I or the operand is not an MDString.
+  static bool GetMDString(const llvm::MDNode *N, unsigned I,
+                          llvm::StringRef &S);
+
+  // Get operand I of N, which has to be an i32 ConstantInt.
+  static bool GetInt32(const llvm::MDNode *N, unsigned I, unsigned &Value);
+
+  // Parse S as an unsigned decimal number made of plain digits only.
+  static bool ParseUnsigned(llvm::StringRef S, unsigned &Value);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_METADATA_UTILS_H_  NOLINT
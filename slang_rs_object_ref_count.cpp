@@ -16,18 +16,17 @@
 
 #include "slang_rs_object_ref_count.h"
 
-#include <list>
+#include <vector>
 
 #include "clang/AST/DeclGroup.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/NestedNameSpecifier.h"
 #include "clang/AST/OperationKinds.h"
 #include "clang/AST/Stmt.h"
-#include "clang/AST/StmtVisitor.h"
+#include "clang/Basic/Diagnostic.h"
 
 #include "slang_assert.h"
 #include "slang_rs.h"
-#include "slang_rs_ast_replace.h"
 #include "slang_rs_export_type.h"
 
 namespace slang {
@@ -92,275 +91,8 @@ namespace {
 
 // This function constructs a new CompoundStmt from the input StmtList.
 static clang::CompoundStmt* BuildCompoundStmt(clang::ASTContext &C,
-      std::list<clang::Stmt*> &StmtList, clang::SourceLocation Loc) {
-  unsigned NewStmtCount = StmtList.size();
-  unsigned CompoundStmtCount = 0;
-
-  clang::Stmt **CompoundStmtList;
-  CompoundStmtList = new clang::Stmt*[NewStmtCount];
-
-  std::list<clang::Stmt*>::const_iterator I = StmtList.begin();
-  std::list<clang::Stmt*>::const_iterator E = StmtList.end();
-  for ( ; I != E; I++) {
-    CompoundStmtList[CompoundStmtCount++] = *I;
-  }
-  slangAssert(CompoundStmtCount == NewStmtCount);
-
-  clang::CompoundStmt *CS = new(C) clang::CompoundStmt(
-      C, llvm::makeArrayRef(CompoundStmtList, CompoundStmtCount), Loc, Loc);
-
-  delete [] CompoundStmtList;
-
-  return CS;
-}
-
-static void AppendAfterStmt(clang::ASTContext &C,
-                            clang::CompoundStmt *CS,
-                            clang::Stmt *S,
-                            std::list<clang::Stmt*> &StmtList) {
-  slangAssert(CS);
-  clang::CompoundStmt::body_iterator bI = CS->body_begin();
-  clang::CompoundStmt::body_iterator bE = CS->body_end();
-  clang::Stmt **UpdatedStmtList =
-      new clang::Stmt*[CS->size() + StmtList.size()];
-
-  unsigned UpdatedStmtCount = 0;
-  unsigned Once = 0;
-  for ( ; bI != bE; bI++) {
-    if (!S && ((*bI)->getStmtClass() == clang::Stmt::ReturnStmtClass)) {
-      // If we come across a return here, we don't have anything we can
-      // reasonably replace. We should have already inserted our destructor
-      // code in the proper spot, so we just clean up and return.
-      delete [] UpdatedStmtList;
-
-      return;
-    }
-
-    UpdatedStmtList[UpdatedStmtCount++] = *bI;
-
-    if ((*bI == S) && !Once) {
-      Once++;
-      std::list<clang::Stmt*>::const_iterator I = StmtList.begin();
-      std::list<clang::Stmt*>::const_iterator E = StmtList.end();
-      for ( ; I != E; I++) {
-        UpdatedStmtList[UpdatedStmtCount++] = *I;
-      }
-    }
-  }
-  slangAssert(Once <= 1);
-
-  // When S is NULL, we are appending to the end of the CompoundStmt.
-  if (!S) {
-    slangAssert(Once == 0);
-    std::list<clang::Stmt*>::const_iterator I = StmtList.begin();
-    std::list<clang::Stmt*>::const_iterator E = StmtList.end();
-    for ( ; I != E; I++) {
-      UpdatedStmtList[UpdatedStmtCount++] = *I;
-    }
-  }
-
-  CS->setStmts(C, UpdatedStmtList, UpdatedStmtCount);
-
-  delete [] UpdatedStmtList;
-
-  return;
-}
-
-// This class visits a compound statement and inserts DtorStmt
-// in proper locations. This includes inserting it before any
-// return statement in any sub-block, at the end of the logical enclosing
-// scope (compound statement), and/or before any break/continue statement that
-// would resume outside the declared scope. We will not handle the case for
-// goto statements that leave a local scope.
-//
-// To accomplish these goals, it collects a list of sub-Stmt's that
-// correspond to scope exit points. It then uses an RSASTReplace visitor to
-// transform the AST, inserting appropriate destructors before each of those
-// sub-Stmt's (and also before the exit of the outermost containing Stmt for
-// the scope).
-class DestructorVisitor : public clang::StmtVisitor<DestructorVisitor> {
- private:
-  clang::ASTContext &mCtx;
-
-  // The loop depth of the currently visited node.
-  int mLoopDepth;
-
-  // The switch statement depth of the currently visited node.
-  // Note that this is tracked separately from the loop depth because
-  // SwitchStmt-contained ContinueStmt's should have destructors for the
-  // corresponding loop scope.
-  int mSwitchDepth;
-
-  // The outermost statement block that we are currently visiting.
-  // This should always be a CompoundStmt.
-  clang::Stmt *mOuterStmt;
-
-  // The destructor to execute for this scope/variable.
-  clang::Stmt* mDtorStmt;
-
-  // The stack of statements which should be replaced by a compound statement
-  // containing the new destructor call followed by the original Stmt.
-  std::stack<clang::Stmt*> mReplaceStmtStack;
-
-  // The source location for the variable declaration that we are trying to
-  // insert destructors for. Note that InsertDestructors() will not generate
-  // destructor calls for source locations that occur lexically before this
-  // location.
-  clang::SourceLocation mVarLoc;
-
- public:
-  DestructorVisitor(clang::ASTContext &C,
-                    clang::Stmt* OuterStmt,
-                    clang::Stmt* DtorStmt,
-                    clang::SourceLocation VarLoc);
-
-  // This code walks the collected list of Stmts to replace and actually does
-  // the replacement. It also finishes up by appending the destructor to the
-  // current outermost CompoundStmt.
-  void InsertDestructors() {
-    clang::Stmt *S = NULL;
-    clang::SourceManager &SM = mCtx.getSourceManager();
-    std::list<clang::Stmt *> StmtList;
-    StmtList.push_back(mDtorStmt);
-
-    while (!mReplaceStmtStack.empty()) {
-      S = mReplaceStmtStack.top();
-      mReplaceStmtStack.pop();
-
-      // Skip all source locations that occur before the variable's
-      // declaration, since it won't have been initialized yet.
-      if (SM.isBeforeInTranslationUnit(S->getLocStart(), mVarLoc)) {
-        continue;
-      }
-
-      StmtList.push_back(S);
-      clang::CompoundStmt *CS =
-          BuildCompoundStmt(mCtx, StmtList, S->getLocEnd());
-      StmtList.pop_back();
-
-      RSASTReplace R(mCtx);
-      R.ReplaceStmt(mOuterStmt, S, CS);
-    }
-    clang::CompoundStmt *CS =
-      llvm::dyn_cast<clang::CompoundStmt>(mOuterStmt);
-    slangAssert(CS);
-    AppendAfterStmt(mCtx, CS, NULL, StmtList);
-  }
-
-  void VisitStmt(clang::Stmt *S);
-  void VisitCompoundStmt(clang::CompoundStmt *CS);
-
-  void VisitBreakStmt(clang::BreakStmt *BS);
-  void VisitCaseStmt(clang::CaseStmt *CS);
-  void VisitContinueStmt(clang::ContinueStmt *CS);
-  void VisitDefaultStmt(clang::DefaultStmt *DS);
-  void VisitDoStmt(clang::DoStmt *DS);
-  void VisitForStmt(clang::ForStmt *FS);
-  void VisitIfStmt(clang::IfStmt *IS);
-  void VisitReturnStmt(clang::ReturnStmt *RS);
-  void VisitSwitchCase(clang::SwitchCase *SC);
-  void VisitSwitchStmt(clang::SwitchStmt *SS);
-  void VisitWhileStmt(clang::WhileStmt *WS);
-};
-
-DestructorVisitor::DestructorVisitor(clang::ASTContext &C,
-                         clang::Stmt *OuterStmt,
-                         clang::Stmt *DtorStmt,
-                         clang::SourceLocation VarLoc)
-  : mCtx(C),
-    mLoopDepth(0),
-    mSwitchDepth(0),
-    mOuterStmt(OuterStmt),
-    mDtorStmt(DtorStmt),
-    mVarLoc(VarLoc) {
-  return;
-}
-
-void DestructorVisitor::VisitStmt(clang::Stmt *S) {
-  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
-       I != E;
-       I++) {
-    if (clang::Stmt *Child = *I) {
-      Visit(Child);
-    }
-  }
-  return;
-}
-
-void DestructorVisitor::VisitCompoundStmt(clang::CompoundStmt *CS) {
-  VisitStmt(CS);
-  return;
-}
-
-void DestructorVisitor::VisitBreakStmt(clang::BreakStmt *BS) {
-  VisitStmt(BS);
-  if ((mLoopDepth == 0) && (mSwitchDepth == 0)) {
-    mReplaceStmtStack.push(BS);
-  }
-  return;
-}
-
-void DestructorVisitor::VisitCaseStmt(clang::CaseStmt *CS) {
-  VisitStmt(CS);
-  return;
-}
-
-void DestructorVisitor::VisitContinueStmt(clang::ContinueStmt *CS) {
-  VisitStmt(CS);
-  if (mLoopDepth == 0) {
-    // Switch statements can have nested continues.
-    mReplaceStmtStack.push(CS);
-  }
-  return;
-}
-
-void DestructorVisitor::VisitDefaultStmt(clang::DefaultStmt *DS) {
-  VisitStmt(DS);
-  return;
-}
-
-void DestructorVisitor::VisitDoStmt(clang::DoStmt *DS) {
-  mLoopDepth++;
-  VisitStmt(DS);
-  mLoopDepth--;
-  return;
-}
-
-void DestructorVisitor::VisitForStmt(clang::ForStmt *FS) {
-  mLoopDepth++;
-  VisitStmt(FS);
-  mLoopDepth--;
-  return;
-}
-
-void DestructorVisitor::VisitIfStmt(clang::IfStmt *IS) {
-  VisitStmt(IS);
-  return;
-}
-
-void DestructorVisitor::VisitReturnStmt(clang::ReturnStmt *RS) {
-  mReplaceStmtStack.push(RS);
-  return;
-}
-
-void DestructorVisitor::VisitSwitchCase(clang::SwitchCase *SC) {
-  slangAssert(false && "Both case and default have specialized handlers");
-  VisitStmt(SC);
-  return;
-}
-
-void DestructorVisitor::VisitSwitchStmt(clang::SwitchStmt *SS) {
-  mSwitchDepth++;
-  VisitStmt(SS);
-  mSwitchDepth--;
-  return;
-}
-
-void DestructorVisitor::VisitWhileStmt(clang::WhileStmt *WS) {
-  mLoopDepth++;
-  VisitStmt(WS);
-  mLoopDepth--;
-  return;
+      llvm::ArrayRef<clang::Stmt*> StmtList, clang::SourceLocation Loc) {
+  return new(C) clang::CompoundStmt(C, StmtList, Loc, Loc);
 }
 
 clang::Expr *ClearSingleRSObject(clang::ASTContext &C,
@@ -1113,7 +845,7 @@ static clang::Stmt *CreateStructRSSetObject(clang::ASTContext &C,
 
 }  // namespace
 
-void RSObjectRefCount::Scope::ReplaceRSObjectAssignment(
+clang::Stmt *RSObjectRefCount::CreateRSObjectAssignment(
     clang::BinaryOperator *AS) {
 
   clang::QualType QT = AS->getType();
@@ -1134,20 +866,17 @@ void RSObjectRefCount::Scope::ReplaceRSObjectAssignment(
         CreateSingleRSSetObject(C, AS->getLHS(), AS->getRHS(), StartLoc, Loc);
   }
 
-  RSASTReplace R(C);
-  R.ReplaceStmt(mCS, AS, UpdatedStmt);
-  return;
+  return UpdatedStmt;
 }
 
-void RSObjectRefCount::Scope::AppendRSObjectInit(
+clang::Stmt *RSObjectRefCount::CreateRSObjectInit(
     clang::VarDecl *VD,
-    clang::DeclStmt *DS,
     RSExportPrimitiveType::DataType DT,
     clang::Expr *InitExpr) {
   slangAssert(VD);
 
   if (!InitExpr) {
-    return;
+    return NULL;
   }
 
   clang::ASTContext &C = RSObjectRefCount::GetRSSetObjectFD(
@@ -1170,13 +899,7 @@ void RSObjectRefCount::Scope::AppendRSObjectInit(
                                    clang::VK_RValue,
                                    NULL);
 
-    clang::Stmt *RSSetObjectOps =
-        CreateStructRSSetObject(C, RefRSVar, InitExpr, StartLoc, Loc);
-
-    std::list<clang::Stmt*> StmtList;
-    StmtList.push_back(RSSetObjectOps);
-    AppendAfterStmt(C, mCS, DS, StmtList);
-    return;
+    return CreateStructRSSetObject(C, RefRSVar, InitExpr, StartLoc, Loc);
   }
 
   clang::FunctionDecl *SetObjectFD = RSObjectRefCount::GetRSSetObjectFD(DT);
@@ -1236,28 +959,14 @@ void RSObjectRefCount::Scope::AppendRSObjectInit(
                              clang::VK_RValue,
                              Loc);
 
-  std::list<clang::Stmt*> StmtList;
-  StmtList.push_back(RSSetObjectCall);
-  AppendAfterStmt(C, mCS, DS, StmtList);
-
-  return;
+  return RSSetObjectCall;
 }
 
-void RSObjectRefCount::Scope::InsertLocalVarDestructors() {
-  for (std::list<clang::VarDecl*>::const_iterator I = mRSO.begin(),
-          E = mRSO.end();
-        I != E;
-        I++) {
-    clang::VarDecl *VD = *I;
-    clang::Stmt *RSClearObjectCall = ClearRSObject(VD, VD->getDeclContext());
-    if (RSClearObjectCall) {
-      DestructorVisitor DV((*mRSO.begin())->getASTContext(),
-                           mCS,
-                           RSClearObjectCall,
-                           VD->getSourceRange().getBegin());
-      DV.Visit(mCS);
-      DV.InsertDestructors();
-    }
+void RSObjectRefCount::Scope::addRSObject(clang::VarDecl *VD) {
+  // The same call is used at every exit of the scope.
+  if (clang::Stmt *RSClearObjectCall =
+          ClearRSObject(VD, VD->getDeclContext())) {
+    mDtors.push_back(RSClearObjectCall);
   }
   return;
 }
@@ -1457,6 +1166,186 @@ clang::Expr *RSObjectRefCount::CreateZeroInitializerForRSSpecificType(
   return Res;
 }
 
+static const char DeadStoreMessage[] =
+    "removed rsSetObject() of '%0', which is overwritten before any use";
+
+RSObjectRefCount::StmtEdit &RSObjectRefCount::getEdit(clang::Stmt *S) {
+  slangAssert(!mParentStack.empty() && "Edit outside of any statement!");
+  mParentStack.back().HasEdits = true;
+  return mEdits[S];
+}
+
+clang::Stmt *RSObjectRefCount::TakeEditedStmt(clang::Stmt *S) {
+  StmtEditMap::iterator I = mEdits.find(S);
+  if (I == mEdits.end()) {
+    return S;
+  }
+
+  StmtEdit &Edit = I->second;
+  clang::Stmt *NewStmt = Edit.Replacement ? Edit.Replacement : S;
+  if (!Edit.Before.empty() || !Edit.After.empty()) {
+    llvm::SmallVector<clang::Stmt*, 8> StmtList(Edit.Before.begin(),
+                                                Edit.Before.end());
+    StmtList.push_back(NewStmt);
+    StmtList.append(Edit.After.begin(), Edit.After.end());
+    NewStmt = BuildCompoundStmt(mCtx, StmtList, S->getLocEnd());
+  }
+  mEdits.erase(I);
+  return NewStmt;
+}
+
+clang::Expr *RSObjectRefCount::TakeEditedExpr(clang::Expr *E) {
+  StmtEditMap::iterator I = mEdits.find(E);
+  if (I == mEdits.end()) {
+    return E;
+  }
+
+  // Only a replacing expression fits in an expression slot.
+  clang::Expr *NewExpr =
+      llvm::dyn_cast_or_null<clang::Expr>(I->second.Replacement);
+  mEdits.erase(I);
+  return NewExpr ? NewExpr : E;
+}
+
+void RSObjectRefCount::RewriteChildren(clang::Stmt *S) {
+  if (clang::CaseStmt *CS = llvm::dyn_cast<clang::CaseStmt>(S)) {
+    CS->setSubStmt(TakeEditedStmt(CS->getSubStmt()));
+  } else if (clang::DefaultStmt *DS = llvm::dyn_cast<clang::DefaultStmt>(S)) {
+    DS->setSubStmt(TakeEditedStmt(DS->getSubStmt()));
+  } else if (clang::DoStmt *DS = llvm::dyn_cast<clang::DoStmt>(S)) {
+    DS->setCond(TakeEditedExpr(DS->getCond()));
+    DS->setBody(TakeEditedStmt(DS->getBody()));
+  } else if (clang::ForStmt *FS = llvm::dyn_cast<clang::ForStmt>(S)) {
+    // Statements can not be inserted around the init statement, so only a
+    // replacement applies there.
+    StmtEditMap::iterator I = mEdits.find(FS->getInit());
+    if ((I != mEdits.end()) && I->second.Replacement) {
+      FS->setInit(I->second.Replacement);
+      mEdits.erase(I);
+    }
+    if (FS->getCond()) {
+      FS->setCond(TakeEditedExpr(FS->getCond()));
+    }
+    if (FS->getInc()) {
+      FS->setInc(TakeEditedExpr(FS->getInc()));
+    }
+    FS->setBody(TakeEditedStmt(FS->getBody()));
+  } else if (clang::IfStmt *IS = llvm::dyn_cast<clang::IfStmt>(S)) {
+    IS->setCond(TakeEditedExpr(IS->getCond()));
+    IS->setThen(TakeEditedStmt(IS->getThen()));
+    if (IS->getElse()) {
+      IS->setElse(TakeEditedStmt(IS->getElse()));
+    }
+  } else if (clang::SwitchStmt *SS = llvm::dyn_cast<clang::SwitchStmt>(S)) {
+    SS->setCond(TakeEditedExpr(SS->getCond()));
+  } else if (clang::WhileStmt *WS = llvm::dyn_cast<clang::WhileStmt>(S)) {
+    WS->setCond(TakeEditedExpr(WS->getCond()));
+    WS->setBody(TakeEditedStmt(WS->getBody()));
+  }
+
+  // Any other slot (e.g. an operand of an expression) is left as it is.
+  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
+       I != E;
+       I++) {
+    if (clang::Stmt *Child = *I) {
+      mEdits.erase(Child);
+    }
+  }
+  return;
+}
+
+void RSObjectRefCount::RewriteCompoundStmt(
+    clang::CompoundStmt *CS,
+    bool HasEdits,
+    const std::vector<clang::Stmt*> &Dtors) {
+  bool AppendDtors = !Dtors.empty();
+  if (!HasEdits && !AppendDtors) {
+    return;
+  }
+
+  llvm::SmallVector<clang::Stmt*, 16> StmtList;
+  StmtList.reserve(CS->size() + Dtors.size());
+  for (clang::CompoundStmt::body_iterator I = CS->body_begin(),
+          E = CS->body_end();
+       I != E;
+       I++) {
+    clang::Stmt *S = *I;
+    if (llvm::isa<clang::ReturnStmt>(S)) {
+      // The destructors are already in place before the return.
+      AppendDtors = false;
+    }
+
+    StmtEditMap::iterator EI = HasEdits ? mEdits.find(S) : mEdits.end();
+    if (EI == mEdits.end()) {
+      StmtList.push_back(S);
+      continue;
+    }
+
+    StmtEdit &Edit = EI->second;
+    StmtList.append(Edit.Before.begin(), Edit.Before.end());
+    StmtList.push_back(Edit.Replacement ? Edit.Replacement : S);
+    StmtList.append(Edit.After.begin(), Edit.After.end());
+    mEdits.erase(EI);
+  }
+
+  if (AppendDtors) {
+    StmtList.append(Dtors.begin(), Dtors.end());
+  }
+
+  // setStmts() copies the new body into the ASTContext.
+  CS->setStmts(mCtx, StmtList.data(), StmtList.size());
+  return;
+}
+
+void RSObjectRefCount::ReportElision(const clang::SourceLocation &Loc,
+                                     const char *Message,
+                                     const clang::VarDecl *VD,
+                                     const clang::VarDecl *Source) {
+  if (!mReportElision) {
+    return;
+  }
+
+  clang::DiagnosticsEngine &DiagEngine = mCtx.getDiagnostics();
+  clang::DiagnosticBuilder DB = DiagEngine.Report(
+      Loc,
+      DiagEngine.getCustomDiagID(clang::DiagnosticsEngine::Warning, Message));
+  DB << VD->getName();
+  if (Source) {
+    DB << Source->getName();
+  }
+  return;
+}
+
+void RSObjectRefCount::VisitScopeExit(clang::Stmt *S) {
+  bool IsReturn = llvm::isa<clang::ReturnStmt>(S);
+  bool IsBreak = llvm::isa<clang::BreakStmt>(S);
+
+  // Only the RS objects declared so far (i.e., before S) are destroyed.
+  // Destructors of inner scopes run first.
+  llvm::SmallVector<clang::Stmt*, 8> Dtors;
+  for (std::vector<Scope*>::reverse_iterator I = mScopeStack.rbegin(),
+          E = mScopeStack.rend();
+       I != E;
+       I++) {
+    const Scope *ExitedScope = *I;
+    // A break or continue only leaves the scopes within its loop (or, for a
+    // break, switch).
+    if (!IsReturn &&
+        ((ExitedScope->getLoopDepth() != mLoopDepth) ||
+         (IsBreak && (ExitedScope->getSwitchDepth() != mSwitchDepth)))) {
+      break;
+    }
+    Dtors.append(ExitedScope->getDtors().begin(),
+                 ExitedScope->getDtors().end());
+  }
+
+  if (!Dtors.empty()) {
+    StmtEdit &Edit = getEdit(S);
+    Edit.Before.append(Dtors.begin(), Dtors.end());
+  }
+  return;
+}
+
 void RSObjectRefCount::VisitDeclStmt(clang::DeclStmt *DS) {
   for (clang::DeclStmt::decl_iterator I = DS->decl_begin(), E = DS->decl_end();
        I != E;
@@ -1464,12 +1353,42 @@ void RSObjectRefCount::VisitDeclStmt(clang::DeclStmt *DS) {
     clang::Decl *D = *I;
     if (D->getKind() == clang::Decl::Var) {
       clang::VarDecl *VD = static_cast<clang::VarDecl*>(D);
+
+      // A variable without a reference of its own keeps its initializer as
+      // it is, and is not destroyed.
+      switch (mElision.getKind(VD)) {
+        case RSRefCountElision::VK_Counted: {
+          break;
+        }
+        case RSRefCountElision::VK_Unused: {
+          ReportElision(VD->getLocation(),
+                        "not reference counting '%0', which is never read",
+                        VD);
+          continue;
+        }
+        case RSRefCountElision::VK_Borrowed: {
+          const clang::VarDecl *Source = mElision.getSource(VD);
+          ReportElision(VD->getLocation(),
+                        Source->hasLocalStorage() ?
+                            "not reference counting '%0', which borrows the "
+                            "reference of '%1'" :
+                            "not reference counting '%0', which borrows the "
+                            "reference of global '%1'",
+                        VD, Source);
+          continue;
+        }
+      }
+
       RSExportPrimitiveType::DataType DT =
           RSExportPrimitiveType::DataTypeUnknown;
       clang::Expr *InitExpr = NULL;
       if (InitializeRSObject(VD, &DT, &InitExpr)) {
         // We need to zero-init all RS object types (including matrices), ...
-        getCurrentScope()->AppendRSObjectInit(VD, DS, DT, InitExpr);
+        if (mElision.isDeadStore(DS)) {
+          ReportElision(VD->getLocation(), DeadStoreMessage, VD);
+        } else if (clang::Stmt *Init = CreateRSObjectInit(VD, DT, InitExpr)) {
+          getEdit(DS).After.push_back(Init);
+        }
         // ... but, only add to the list of RS objects if we have some
         // non-matrix RS object fields.
         if (CountRSObjectTypes(mCtx, VD->getType().getTypePtr(),
@@ -1482,40 +1401,108 @@ void RSObjectRefCount::VisitDeclStmt(clang::DeclStmt *DS) {
   return;
 }
 
-void RSObjectRefCount::VisitCompoundStmt(clang::CompoundStmt *CS) {
-  if (!CS->body_empty()) {
-    // Push a new scope
-    Scope *S = new Scope(CS);
-    mScopeStack.push(S);
 
-    VisitStmt(CS);
+void RSObjectRefCount::VisitBinAssign(clang::BinaryOperator *AS) {
+  clang::QualType QT = AS->getType();
 
-    // Destroy the scope
-    slangAssert((getCurrentScope() == S) && "Corrupted scope stack!");
-    S->InsertLocalVarDestructors();
-    mScopeStack.pop();
-    delete S;
+  if (!CountRSObjectTypes(mCtx, QT.getTypePtr(), AS->getExprLoc())) {
+    return;
   }
-  return;
-}
 
-void RSObjectRefCount::VisitBinAssign(clang::BinaryOperator *AS) {
-  clang::QualType QT = AS->getType();
+  // Only the right-hand side of an elided assignment is evaluated.
+  if (mElision.isDeadStore(AS)) {
+    const clang::DeclRefExpr *DRE =
+        llvm::cast<clang::DeclRefExpr>(AS->getLHS()->IgnoreParens());
+    ReportElision(AS->getLocStart(), DeadStoreMessage,
+                  llvm::cast<clang::VarDecl>(DRE->getDecl()));
+    getEdit(AS).Replacement = AS->getRHS();
+    return;
+  }
 
-  if (CountRSObjectTypes(mCtx, QT.getTypePtr(), AS->getExprLoc())) {
-    getCurrentScope()->ReplaceRSObjectAssignment(AS);
+  const clang::DeclRefExpr *DRE =
+      llvm::dyn_cast<clang::DeclRefExpr>(AS->getLHS()->IgnoreParens());
+  const clang::VarDecl *VD =
+      DRE ? llvm::dyn_cast<clang::VarDecl>(DRE->getDecl()) : NULL;
+  if (VD && mElision.getKind(VD) == RSRefCountElision::VK_Unused) {
+    getEdit(AS).Replacement = AS->getRHS();
+    return;
   }
 
+  getEdit(AS).Replacement = CreateRSObjectAssignment(AS);
+
   return;
 }
 
-void RSObjectRefCount::VisitStmt(clang::Stmt *S) {
-  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
-       I != E;
-       I++) {
-    if (clang::Stmt *Child = *I) {
-      Visit(Child);
+bool RSObjectRefCount::enterStmt(clang::Stmt *S) {
+  if (clang::CompoundStmt *CS = llvm::dyn_cast<clang::CompoundStmt>(S)) {
+    if (CS->body_empty()) {
+      return false;
+    }
+    // The first scope is the function body.
+    if (mScopeStack.empty()) {
+      if (mElideRedundant) {
+        mElision.analyze(CS);
+      } else {
+        mElision.clear();
+      }
+    }
+    // Push a new scope
+    mScopeStack.push_back(new Scope(CS, mLoopDepth, mSwitchDepth));
+  } else if (clang::DeclStmt *DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+    // Declarations and assignments are rewritten as a whole, so their
+    // sub-expressions are not visited.
+    VisitDeclStmt(DS);
+    return false;
+  } else if (clang::BinaryOperator *BO =
+                 llvm::dyn_cast<clang::BinaryOperator>(S)) {
+    if (BO->getOpcode() == clang::BO_Assign) {
+      VisitBinAssign(BO);
+      return false;
     }
+  } else if (llvm::isa<clang::DoStmt>(S) ||
+             llvm::isa<clang::ForStmt>(S) ||
+             llvm::isa<clang::WhileStmt>(S)) {
+    mLoopDepth++;
+  } else if (llvm::isa<clang::SwitchStmt>(S)) {
+    mSwitchDepth++;
+  } else if (llvm::isa<clang::ReturnStmt>(S) ||
+             llvm::isa<clang::BreakStmt>(S) ||
+             llvm::isa<clang::ContinueStmt>(S)) {
+    VisitScopeExit(S);
+  }
+
+  ParentStmt P = { S, false };
+  mParentStack.push_back(P);
+  return true;
+}
+
+void RSObjectRefCount::leaveStmt(clang::Stmt *S) {
+  slangAssert(!mParentStack.empty() && (mParentStack.back().S == S) &&
+              "Corrupted parent stack!");
+  bool HasEdits = mParentStack.back().HasEdits;
+  mParentStack.pop_back();
+
+  if (clang::CompoundStmt *CS = llvm::dyn_cast<clang::CompoundStmt>(S)) {
+    // Destroy the scope
+    Scope *CurrentScope = getCurrentScope();
+    slangAssert((CurrentScope->getCompoundStmt() == CS) &&
+                "Corrupted scope stack!");
+    RewriteCompoundStmt(CS, HasEdits, CurrentScope->getDtors());
+    mScopeStack.pop_back();
+    delete CurrentScope;
+    return;
+  }
+
+  if (llvm::isa<clang::DoStmt>(S) ||
+      llvm::isa<clang::ForStmt>(S) ||
+      llvm::isa<clang::WhileStmt>(S)) {
+    mLoopDepth--;
+  } else if (llvm::isa<clang::SwitchStmt>(S)) {
+    mSwitchDepth--;
+  }
+
+  if (HasEdits) {
+    RewriteChildren(S);
   }
   return;
 }
@@ -1539,7 +1526,7 @@ clang::FunctionDecl *RSObjectRefCount::CreateStaticGlobalDtor() {
 
   // Generate rsClearObject() call chains for every global variable
   // (whether static or extern).
-  std::list<clang::Stmt *> StmtList;
+  llvm::SmallVector<clang::Stmt*, 16> StmtList;
   for (clang::DeclContext::decl_iterator I = DC->decls_begin(),
           E = DC->decls_end(); I != E; I++) {
     clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(*I);
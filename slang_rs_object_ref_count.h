@@ -17,17 +17,27 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_OBJECT_REF_COUNT_H_  // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_OBJECT_REF_COUNT_H_
 
-#include <list>
-#include <stack>
+#include <vector>
 
-#include "clang/AST/StmtVisitor.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 
 #include "slang_assert.h"
+#include "slang_rs_ast_pass.h"
 #include "slang_rs_export_type.h"
+#include "slang_rs_refcount_elision.h"
 
 namespace clang {
+  class ASTContext;
+  class BinaryOperator;
+  class CompoundStmt;
+  class DeclContext;
+  class DeclStmt;
   class Expr;
+  class FunctionDecl;
+  class SourceLocation;
   class Stmt;
+  class VarDecl;
 }
 
 namespace slang {
@@ -42,49 +52,129 @@ namespace slang {
 // appropriate (possibly a series of) rsSetObject() calls.
 // 3) Finally, each local object must call rsClearObject() when it goes out
 // of scope.
-class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
+//
+// It is an RSStmtPass, so that it can share the walk over a function body with
+// RSCheckAST (see RSFusedASTPass).
+class RSObjectRefCount : public RSStmtPass {
  private:
   class Scope {
    private:
     clang::CompoundStmt *mCS;      // Associated compound statement ({ ... })
-    std::list<clang::VarDecl*> mRSO;  // Declared RS objects in this scope
+    unsigned mLoopDepth;           // Loops and switches around mCS
+    unsigned mSwitchDepth;
+    // rsClearObject() calls for the RS objects declared in this scope, in
+    // declaration order
+    std::vector<clang::Stmt*> mDtors;
 
    public:
-    explicit Scope(clang::CompoundStmt *CS) : mCS(CS) {
+    Scope(clang::CompoundStmt *CS, unsigned LoopDepth, unsigned SwitchDepth)
+        : mCS(CS),
+          mLoopDepth(LoopDepth),
+          mSwitchDepth(SwitchDepth) {
       return;
     }
 
-    inline void addRSObject(clang::VarDecl* VD) {
-      mRSO.push_back(VD);
-      return;
+    inline clang::CompoundStmt *getCompoundStmt() const {
+      return mCS;
+    }
+
+    inline unsigned getLoopDepth() const {
+      return mLoopDepth;
     }
 
-    void ReplaceRSObjectAssignment(clang::BinaryOperator *AS);
+    inline unsigned getSwitchDepth() const {
+      return mSwitchDepth;
+    }
 
-    void AppendRSObjectInit(clang::VarDecl *VD,
-                            clang::DeclStmt *DS,
-                            RSExportPrimitiveType::DataType DT,
-                            clang::Expr *InitExpr);
+    inline const std::vector<clang::Stmt*> &getDtors() const {
+      return mDtors;
+    }
 
-    void InsertLocalVarDestructors();
+    void addRSObject(clang::VarDecl* VD);
 
     static clang::Stmt *ClearRSObject(clang::VarDecl *VD,
                                       clang::DeclContext *DC);
   };
 
+  // The statements to insert before (destructors at a scope exit), to put in
+  // place of (an RS object assignment) or to insert after (RS object
+  // initializations of a declaration) a statement. Edits are collected during
+  // the walk and applied to all children of a statement at once, when the walk
+  // leaves it, so that each CompoundStmt is rebuilt at most once.
+  struct StmtEdit {
+    llvm::SmallVector<clang::Stmt*, 4> Before;
+    clang::Stmt *Replacement;
+    llvm::SmallVector<clang::Stmt*, 2> After;
+
+    StmtEdit() : Replacement(NULL) { }
+  };
+
+  typedef llvm::DenseMap<clang::Stmt*, StmtEdit> StmtEditMap;
+
+  // A statement that the walk is in, and whether any of its children have
+  // edits.
+  struct ParentStmt {
+    clang::Stmt *S;
+    bool HasEdits;
+  };
+
   clang::ASTContext &mCtx;
-  std::stack<Scope*> mScopeStack;
+  std::vector<Scope*> mScopeStack;
+  std::vector<ParentStmt> mParentStack;
+  StmtEditMap mEdits;
+  unsigned mLoopDepth;
+  unsigned mSwitchDepth;
   bool RSInitFD;
 
+  // Leave out the calls that RSRefCountElision finds redundant, and report
+  // each such site with a warning.
+  bool mElideRedundant;
+  bool mReportElision;
+  RSRefCountElision mElision;
+
   // RSSetObjectFD and RSClearObjectFD holds FunctionDecl of rsSetObject()
   // and rsClearObject() in the current ASTContext.
   static clang::FunctionDecl *RSSetObjectFD[];
   static clang::FunctionDecl *RSClearObjectFD[];
 
   inline Scope *getCurrentScope() {
-    return mScopeStack.top();
+    return mScopeStack.back();
   }
 
+  // The edit of S, a child of the innermost statement of the walk.
+  StmtEdit &getEdit(clang::Stmt *S);
+
+  // Take the edit of S (if any) and return what should be in its place in a
+  // statement (or, for TakeEditedExpr, an expression) slot of its parent.
+  clang::Stmt *TakeEditedStmt(clang::Stmt *S);
+  clang::Expr *TakeEditedExpr(clang::Expr *E);
+
+  // Apply the edits of the children of S.
+  void RewriteChildren(clang::Stmt *S);
+
+  // Warn about an elided call with Message, whose %0 (and %1) is the name of
+  // VD (and Source), in -report-refcount-elision mode.
+  void ReportElision(const clang::SourceLocation &Loc,
+                     const char *Message,
+                     const clang::VarDecl *VD,
+                     const clang::VarDecl *Source = NULL);
+
+  // Rebuild the body of CS with the edits of its children and, unless it
+  // returns, the destructors of its scope at the end.
+  void RewriteCompoundStmt(clang::CompoundStmt *CS, bool HasEdits,
+                           const std::vector<clang::Stmt*> &Dtors);
+
+  // Run the destructors of all scopes that S (a return, break or continue)
+  // leaves before it.
+  void VisitScopeExit(clang::Stmt *S);
+
+  static clang::Stmt *CreateRSObjectAssignment(clang::BinaryOperator *AS);
+
+  // Return the rsSetObject() calls that initialize VD with InitExpr, or NULL.
+  static clang::Stmt *CreateRSObjectInit(clang::VarDecl *VD,
+                                         RSExportPrimitiveType::DataType DT,
+                                         clang::Expr *InitExpr);
+
   // Initialize RSSetObjectFD and RSClearObjectFD.
   static void GetRSRefCountingFunctions(clang::ASTContext &C);
 
@@ -104,10 +194,22 @@ class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
  public:
   explicit RSObjectRefCount(clang::ASTContext &C)
       : mCtx(C),
-        RSInitFD(false) {
+        mLoopDepth(0),
+        mSwitchDepth(0),
+        RSInitFD(false),
+        mElideRedundant(false),
+        mReportElision(false) {
     return;
   }
 
+  void setElideRedundant(bool ElideRedundant) {
+    mElideRedundant = ElideRedundant;
+  }
+
+  void setReportElision(bool ReportElision) {
+    mReportElision = ReportElision;
+  }
+
   void Init() {
     if (!RSInitFD) {
       GetRSRefCountingFunctions(mCtx);
@@ -136,9 +238,10 @@ class RSObjectRefCount : public clang::StmtVisitor<RSObjectRefCount> {
     return GetRSClearObjectFD(RSExportPrimitiveType::GetRSSpecificType(T));
   }
 
-  void VisitStmt(clang::Stmt *S);
+  virtual bool enterStmt(clang::Stmt *S);
+  virtual void leaveStmt(clang::Stmt *S);
+
   void VisitDeclStmt(clang::DeclStmt *DS);
-  void VisitCompoundStmt(clang::CompoundStmt *CS);
   void VisitBinAssign(clang::BinaryOperator *AS);
   // We believe that RS objects are never involved in CompoundAssignOperator.
   // I.e., rs_allocation foo; foo += bar;
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_object_slots.h"
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+
+#include "slang_rs_metadata.h"
+#include "slang_rs_metadata_utils.h"
+
+namespace slang {
+
+namespace {
+
+void AppendULEB128(std::string &Data, unsigned Value) {
+  do {
+    unsigned char Byte = Value & 0x7f;
+    Value >>= 7;
+    if (Value != 0)
+      Byte |= 0x80;
+    Data.push_back(static_cast<char>(Byte));
+  } while (Value != 0);
+}
+
+bool ReadULEB128(llvm::StringRef Data, size_t &Pos, unsigned &Value) {
+  Value = 0;
+  for (unsigned Shift = 0; Pos < Data.size() && Shift < 32; Shift += 7) {
+    unsigned char Byte = static_cast<unsigned char>(Data[Pos++]);
+    Value |= static_cast<unsigned>(Byte & 0x7f) << Shift;
+    if ((Byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+size_t ULEB128Size(unsigned Value) {
+  size_t Size = 1;
+  while (Value >= 0x80) {
+    Value >>= 7;
+    Size++;
+  }
+  return Size;
+}
+
+}  // namespace
+
+void RSObjectSlots::clear() {
+  NumVars = 0;
+  Slots.clear();
+}
+
+RSObjectSlots::Encoding RSObjectSlots::getBestEncoding() const {
+  size_t BitmapSize = (NumVars + 7) / 8;
+  size_t RunsSize = 0;
+  unsigned Next = 0;
+  for (size_t i = 0, e = Slots.size(); i != e; ) {
+    // A run of other variables, then one of RS objects
+    size_t RunEnd = i + 1;
+    while (RunEnd != e && Slots[RunEnd] == Slots[RunEnd - 1] + 1)
+      RunEnd++;
+    RunsSize += ULEB128Size(Slots[i] - Next) + ULEB128Size(RunEnd - i);
+    Next = Slots[RunEnd - 1] + 1;
+    i = RunEnd;
+  }
+  return (RunsSize < BitmapSize) ? ENC_Runs : ENC_Bitmap;
+}
+
+void RSObjectSlots::encode(Encoding E, std::string &Data) const {
+  Data.clear();
+  if (E == ENC_Bitmap) {
+    Data.assign((NumVars + 7) / 8, '\0');
+    for (size_t i = 0, e = Slots.size(); i != e; i++)
+      Data[Slots[i] / 8] |= static_cast<char>(1 << (Slots[i] % 8));
+    return;
+  }
+
+  unsigned Next = 0;
+  for (size_t i = 0, e = Slots.size(); i != e; ) {
+    size_t RunEnd = i + 1;
+    while (RunEnd != e && Slots[RunEnd] == Slots[RunEnd - 1] + 1)
+      RunEnd++;
+    AppendULEB128(Data, Slots[i] - Next);
+    AppendULEB128(Data, RunEnd - i);
+    Next = Slots[RunEnd - 1] + 1;
+    i = RunEnd;
+  }
+  return;
+}
+
+bool RSObjectSlots::decode(Encoding E, unsigned Vars, llvm::StringRef Data,
+                           std::string *ErrMsg) {
+  clear();
+  NumVars = Vars;
+
+  if (E == ENC_Bitmap) {
+    if (Data.size() != (NumVars + 7) / 8)
+      return RSMetadataUtils::Error(ErrMsg,
+                                    "object slot bitmap has the wrong size");
+    for (unsigned i = 0; i < NumVars; i++)
+      if (Data[i / 8] & (1 << (i % 8)))
+        Slots.push_back(i);
+    // Bits past the last variable have to be clear.
+    if ((NumVars % 8) != 0 &&
+        (static_cast<unsigned char>(Data.back()) >> (NumVars % 8)) != 0)
+      return RSMetadataUtils::Error(
+          ErrMsg, "object slot bitmap marks unknown variables");
+    return true;
+  }
+
+  if (E != ENC_Runs)
+    return RSMetadataUtils::Error(ErrMsg, "unknown object slot encoding");
+
+  size_t Pos = 0;
+  unsigned Next = 0;
+  while (Pos < Data.size()) {
+    unsigned Skip, Count;
+    if (!ReadULEB128(Data, Pos, Skip) || !ReadULEB128(Data, Pos, Count))
+      return RSMetadataUtils::Error(ErrMsg, "truncated object slot runs");
+    if (Count == 0 || Skip > NumVars - Next || Count > NumVars - Next - Skip)
+      return RSMetadataUtils::Error(
+          ErrMsg, "object slot runs exceed the exported variables");
+    Next += Skip;
+    for (unsigned i = 0; i < Count; i++)
+      Slots.push_back(Next++);
+  }
+  return true;
+}
+
+void RSObjectSlots::writeToModule(llvm::Module *M) const {
+  Encoding E = getBestEncoding();
+  std::string Data;
+  encode(E, Data);
+
+  llvm::LLVMContext &C = M->getContext();
+  llvm::Type *Int32Ty = llvm::Type::getInt32Ty(C);
+  llvm::SmallVector<llvm::Value*, 3> Info;
+  Info.push_back(llvm::ConstantInt::get(Int32Ty, E));
+  Info.push_back(llvm::ConstantInt::get(Int32Ty, NumVars));
+  Info.push_back(llvm::MDString::get(C, Data));
+
+  llvm::NamedMDNode *SlotMapMetadata =
+      M->getOrInsertNamedMetadata(RS_OBJECT_SLOT_MAP_MN);
+  SlotMapMetadata->dropAllReferences();
+  SlotMapMetadata->addOperand(llvm::MDNode::get(C, Info));
+  return;
+}
+
+bool RSObjectSlots::readFromModule(const llvm::Module *M,
+                                   std::string *ErrMsg) {
+  clear();
+
+  if (const llvm::NamedMDNode *SlotMapMetadata =
+          M->getNamedMetadata(RS_OBJECT_SLOT_MAP_MN)) {
+    const llvm::MDNode *N = (SlotMapMetadata->getNumOperands() == 1) ?
+        SlotMapMetadata->getOperand(0) : NULL;
+    unsigned E, Vars;
+    llvm::StringRef Data;
+    if (N == NULL || N->getNumOperands() != 3 ||
+        !RSMetadataUtils::GetInt32(N, 0, E) ||
+        !RSMetadataUtils::GetInt32(N, 1, Vars) ||
+        !RSMetadataUtils::GetMDString(N, 2, Data))
+      return RSMetadataUtils::Error(ErrMsg,
+                                    "malformed " RS_OBJECT_SLOT_MAP_MN);
+    return decode(static_cast<Encoding>(E), Vars, Data, ErrMsg);
+  }
+
+  if (const llvm::NamedMDNode *VarMetadata =
+          M->getNamedMetadata(RS_EXPORT_VAR_MN))
+    NumVars = VarMetadata->getNumOperands();
+
+  if (const llvm::NamedMDNode *SlotsMetadata =
+          M->getNamedMetadata(RS_OBJECT_SLOTS_MN)) {
+    Slots.resize(SlotsMetadata->getNumOperands());
+    for (unsigned i = 0, e = SlotsMetadata->getNumOperands(); i != e; i++) {
+      const llvm::MDNode *N = SlotsMetadata->getOperand(i);
+      llvm::StringRef Slot;
+      if (N->getNumOperands() != 1 ||
+          !RSMetadataUtils::GetMDString(N, 0, Slot) ||
+          !RSMetadataUtils::ParseUnsigned(Slot, Slots[i]) ||
+          Slots[i] >= NumVars || (i > 0 && Slots[i] <= Slots[i - 1]))
+        return RSMetadataUtils::Error(ErrMsg,
+                                      "malformed " RS_OBJECT_SLOTS_MN);
+    }
+  }
+  return true;
+}
+
+}  // namespace slang
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_OBJECT_SLOTS_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_OBJECT_SLOTS_H_
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+  class Module;
+}
+
+namespace slang {
+
+// Which of the exported variables hold RS objects.
+//
+// RS_OBJECT_SLOTS_MN stores one node with a decimal string per such variable.
+// RS_OBJECT_SLOT_MAP_MN (-emit-object-slot-map) stores them all in one node:
+//
+//   !{i32 Encoding, i32 NumVars, <data>}
+//
+// where <data> is, for ENC_Bitmap, one bit per exported variable (bit i % 8 of
+// byte i / 8 is set for an RS object), and for ENC_Runs, the lengths of the
+// alternating runs of other variables and RS objects, starting with the
+// former, as ULEB128 numbers. A trailing run of other variables is left out.
+class RSObjectSlots {
+ public:
+  enum Encoding {
+    ENC_Bitmap = 0,
+    ENC_Runs = 1
+  };
+
+  // Number of exported variables
+  unsigned NumVars;
+  // Indices of the variables holding RS objects, in increasing order
+  std::vector<unsigned> Slots;
+
+  RSObjectSlots() : NumVars(0) { }
+
+  void clear();
+
+  bool operator==(const RSObjectSlots &Other) const {
+    return NumVars == Other.NumVars && Slots == Other.Slots;
+  }
+  bool operator!=(const RSObjectSlots &Other) const {
+    return !(*this == Other);
+  }
+
+  // The encoding that gives the shorter data for this.
+  Encoding getBestEncoding() const;
+
+  void encode(Encoding E, std::string &Data) const;
+
+  // Decode Data produced by encode(E). Return false (and set *ErrMsg when
+  // given) if Data is malformed or does not describe Vars variables.
+  bool decode(Encoding E, unsigned Vars, llvm::StringRef Data,
+              std::string *ErrMsg);
+
+  // Store this as RS_OBJECT_SLOT_MAP_MN of M, in the best encoding.
+  void writeToModule(llvm::Module *M) const;
+
+  // Load RS_OBJECT_SLOT_MAP_MN of M or, for modules without it, the legacy
+  // RS_OBJECT_SLOTS_MN (NumVars then comes from RS_EXPORT_VAR_MN).
+  bool readFromModule(const llvm::Module *M, std::string *ErrMsg);
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_OBJECT_SLOTS_H_  NOLINT
@@ -0,0 +1,329 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_odr_store.h"
+
+#include <sys/stat.h>
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+#include "slang_assert.h"
+#include "slang_rs_export_type.h"
+
+namespace slang {
+
+// Each type starts with a letter for its class, and composite types list
+// their parts after it, so that the string can be read back unambiguously:
+//
+//   P<data type>                  primitive type
+//   V<data type>,<elements>       vector type
+//   M<dimension>                  matrix type
+//   *<pointee>                    pointer type
+//   A<size>,<element>             constant array type
+//   R<fields>{<field>...}         record type
+//
+// Names of nested records and their fields are left out, as equals() does not
+// compare them either.
+void RSODRStore::AppendTypeLayout(const RSExportType *ET,
+                                  std::string &Layout) {
+  switch (ET->getClass()) {
+    case RSExportType::ExportClassPrimitive: {
+      const RSExportPrimitiveType *EPT =
+          static_cast<const RSExportPrimitiveType*>(ET);
+      Layout += 'P';
+      Layout += llvm::utostr(EPT->getType());
+      break;
+    }
+    case RSExportType::ExportClassVector: {
+      const RSExportVectorType *EVT =
+          static_cast<const RSExportVectorType*>(ET);
+      Layout += 'V';
+      Layout += llvm::utostr(EVT->getType());
+      Layout += ',';
+      Layout += llvm::utostr(EVT->getNumElement());
+      break;
+    }
+    case RSExportType::ExportClassMatrix: {
+      const RSExportMatrixType *EMT =
+          static_cast<const RSExportMatrixType*>(ET);
+      Layout += 'M';
+      Layout += llvm::utostr(EMT->getDim());
+      break;
+    }
+    case RSExportType::ExportClassPointer: {
+      Layout += '*';
+      AppendTypeLayout(
+          static_cast<const RSExportPointerType*>(ET)->getPointeeType(),
+          Layout);
+      break;
+    }
+    case RSExportType::ExportClassConstantArray: {
+      const RSExportConstantArrayType *ECAT =
+          static_cast<const RSExportConstantArrayType*>(ET);
+      Layout += 'A';
+      Layout += llvm::utostr(ECAT->getSize());
+      Layout += ',';
+      AppendTypeLayout(ECAT->getElementType(), Layout);
+      break;
+    }
+    case RSExportType::ExportClassRecord: {
+      const RSExportRecordType *ERT =
+          static_cast<const RSExportRecordType*>(ET);
+      Layout += 'R';
+      Layout += llvm::utostr(ERT->getFields().size());
+      Layout += '{';
+      for (RSExportRecordType::const_field_iterator I = ERT->fields_begin(),
+              E = ERT->fields_end();
+           I != E;
+           I++) {
+        AppendTypeLayout((*I)->getType(), Layout);
+      }
+      Layout += '}';
+      break;
+    }
+    default: {
+      slangAssert(false && "Unknown class of type");
+    }
+  }
+  return;
+}
+
+// Two records A and B have the same definition iff:
+//
+//  Cond. #1. They have same number of fields;
+//  Cond. #2. Type(ai) = Type(bi) holds for each field (see equals());
+//  Cond. #3. Name(ai) = Name(bi) holds for each field.
+//
+// The layout of the record (Cond. #1 and #2) is followed by the names of its
+// fields, each ended by ';'.
+void RSODRStore::GetLayout(const RSExportRecordType *ERT,
+                           std::string &Layout) {
+  Layout.clear();
+  AppendTypeLayout(ERT, Layout);
+  for (RSExportRecordType::const_field_iterator I = ERT->fields_begin(),
+          E = ERT->fields_end();
+       I != E;
+       I++) {
+    Layout += (*I)->getName();
+    Layout += ';';
+  }
+  return;
+}
+
+uint64_t RSODRStore::GetFingerprint(const RSExportRecordType *ERT) {
+  std::string Layout;
+  GetLayout(ERT, Layout);
+
+  uint64_t Hash = 14695981039346656037ULL;
+  for (size_t i = 0, e = Layout.size(); i != e; i++) {
+    Hash ^= static_cast<unsigned char>(Layout[i]);
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+namespace {
+
+const char DatabaseHeader[] = "# llvm-rs-cc ODR type database 2";
+
+// The modification time of File in seconds since the epoch, or 0 if it can
+// not be found
+uint64_t GetModificationTime(const std::string &File) {
+  struct stat Stat;
+  if (stat(File.c_str(), &Stat) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(Stat.st_mtime);
+}
+
+}  // namespace
+
+void RSODRStore::addFile(const char *File) {
+  // The database is shared by invocations run from different directories.
+  llvm::SmallString<256> Path(File);
+  llvm::sys::fs::make_absolute(Path);
+  std::string AbsPath = Path.str();
+
+  mCurrentFile = &mFiles.GetOrCreateValue(AbsPath,
+                                          GetModificationTime(AbsPath));
+  return;
+}
+
+bool RSODRStore::check(const RSExportRecordType *ERT, const char *File,
+                       const Definition **Other) {
+  slangAssert(mCurrentFile != NULL && "addFile() must be called first");
+  uint64_t Fingerprint = GetFingerprint(ERT);
+
+  DefinitionMap::value_type &Entry =
+      mDefinitions.GetOrCreateValue(ERT->getName());
+  Definition &D = Entry.getValue();
+  if (D.File == NULL) {
+    // First seen
+    D.Fingerprint = Fingerprint;
+    D.File = File;
+  } else if (D.Fingerprint != Fingerprint) {
+    *Other = &D;
+    return false;
+  }
+
+  mRecords.push_back(std::make_pair(&Entry, mCurrentFile));
+  return true;
+}
+
+bool RSODRStore::syncLocked(const std::string &Path,
+                            std::vector<Conflict> &Conflicts,
+                            std::string *ErrMsg) const {
+  llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::error_code EC = llvm::MemoryBuffer::getFile(Path, Buffer)) {
+    if (EC != llvm::errc::no_such_file_or_directory) {
+      *ErrMsg = EC.message();
+      return false;
+    }
+  }
+
+  // The lines of the other input files that are not stale, which are kept
+  std::vector<std::string> Kept;
+  if (Buffer && Buffer->getBufferSize() != 0) {
+    llvm::SmallVector<llvm::StringRef, 64> Lines;
+    Buffer->getBuffer().split(Lines, "\n", -1, /* KeepEmpty = */true);
+    if (Lines[0].rtrim("\r") != DatabaseHeader) {
+      *ErrMsg = "not a type database of this version (expected '" +
+                std::string(DatabaseHeader) + "' on line 1)";
+      return false;
+    }
+    for (unsigned i = 1, e = Lines.size(); i != e; i++) {
+      llvm::StringRef Line = Lines[i].rtrim("\r");
+      if (Line.empty() || Line.startswith("#")) {
+        continue;
+      }
+
+      // The input file comes last, as it may contain spaces.
+      std::pair<llvm::StringRef, llvm::StringRef> FP = Line.split(' ');
+      std::pair<llvm::StringRef, llvm::StringRef> MTime =
+          FP.second.split(' ');
+      std::pair<llvm::StringRef, llvm::StringRef> NameFile =
+          MTime.second.split(' ');
+      uint64_t Fingerprint;
+      uint64_t ModificationTime;
+      if (FP.first.getAsInteger(16, Fingerprint) ||
+          MTime.first.getAsInteger(10, ModificationTime) ||
+          NameFile.first.empty() || NameFile.second.empty()) {
+        *ErrMsg = "malformed line " + llvm::utostr(i + 1);
+        return false;
+      }
+
+      // Replaced by the entries of this invocation
+      if (mFiles.count(NameFile.second)) {
+        continue;
+      }
+      // Stale: the input file changed since, and it will be checked again
+      // when it is compiled next (see RSODRStore).
+      uint64_t CurrentTime = GetModificationTime(NameFile.second);
+      if (CurrentTime == 0 || CurrentTime != ModificationTime) {
+        continue;
+      }
+      Kept.push_back(Line);
+
+      DefinitionMap::const_iterator I = mDefinitions.find(NameFile.first);
+      if ((I != mDefinitions.end()) &&
+          (I->getValue().Fingerprint != Fingerprint)) {
+        Conflict C;
+        C.Name = NameFile.first;
+        C.File = I->getValue().File;
+        C.OtherFile = NameFile.second;
+        Conflicts.push_back(C);
+      }
+    }
+  }
+
+  if (!Conflicts.empty()) {
+    return true;
+  }
+  // Kept is a copy, and the file may be mapped.
+  Buffer.reset();
+
+  // Write the new database next to the old one and move it over it, so that
+  // an invocation that fails or is killed meanwhile leaves the old one.
+  std::string TmpPath = Path + ".tmp";
+  std::string Error;
+  llvm::raw_fd_ostream OS(TmpPath.c_str(), Error);
+  if (!Error.empty()) {
+    *ErrMsg = Error;
+    return false;
+  }
+
+  OS << DatabaseHeader << '\n';
+  for (unsigned i = 0, e = Kept.size(); i != e; i++) {
+    OS << Kept[i] << '\n';
+  }
+  for (RecordList::const_iterator I = mRecords.begin(), E = mRecords.end();
+       I != E;
+       I++) {
+    OS << llvm::format("%016llx", static_cast<unsigned long long>(
+                                      I->first->getValue().Fingerprint))
+       << ' ' << I->second->getValue()
+       << ' ' << I->first->getKey()
+       << ' ' << I->second->getKey() << '\n';
+  }
+
+  OS.close();
+  bool Existed;
+  if (OS.has_error()) {
+    OS.clear_error();
+    llvm::sys::fs::remove(TmpPath, Existed);
+    *ErrMsg = "write error";
+    return false;
+  }
+
+  if (llvm::error_code EC = llvm::sys::fs::rename(TmpPath, Path)) {
+    llvm::sys::fs::remove(TmpPath, Existed);
+    *ErrMsg = EC.message();
+    return false;
+  }
+  return true;
+}
+
+bool RSODRStore::sync(const std::string &Path,
+                      std::vector<Conflict> &Conflicts,
+                      std::string *ErrMsg) const {
+  // Parallel invocations take turns through <Path>.lock.
+  while (true) {
+    llvm::LockFileManager Locker(Path);
+    switch (Locker) {
+      case llvm::LockFileManager::LFS_Error: {
+        *ErrMsg = "cannot lock it";
+        return false;
+      }
+      case llvm::LockFileManager::LFS_Owned: {
+        return syncLocked(Path, Conflicts, ErrMsg);
+      }
+      case llvm::LockFileManager::LFS_Shared: {
+        Locker.waitForUnlock();
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace slang
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_ODR_STORE_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_ODR_STORE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace slang {
+
+class RSExportRecordType;
+class RSExportType;
+
+// The definitions of the record types reflected so far by one llvm-rs-cc
+// invocation, for checking that all of its input files agree on them (the ODR).
+//
+// The RSExportRecordTypes go away with the RSContext of their file, so each
+// definition is kept as the fingerprint of its layout string: what
+// RSExportType::equals() compares (recursively) plus the names of the fields
+// of the record. Two records have the same definition iff their layout
+// strings are equal, which is taken to be iff their fingerprints are.
+//
+// The definitions can also be checked against, and added to, a type database
+// file shared with other (possibly parallel) invocations (-odr-type-db):
+//
+//   # llvm-rs-cc ODR type database 2
+//   <fingerprint> <mtime> <record name> <input file>
+//   ...
+//
+// with one line per record and input file: the fingerprint as 16 hexadecimal
+// digits, the modification time of the input file when it was compiled (in
+// seconds since the epoch) and the absolute path of the input file.
+//
+// The entries of the input files of an invocation replace all older entries
+// of the same files. An entry whose input file has been changed or removed
+// since is stale. It is dropped without being checked, and the file is
+// checked again when it is next compiled. So the database can be kept across
+// incremental builds. Entries of files that are still there, unchanged, but
+// are no longer part of the build are kept; remove the database to forget
+// them.
+class RSODRStore {
+ public:
+  struct Definition {
+    uint64_t Fingerprint;
+    // The first input file with this definition (valid until compile() ends)
+    const char *File;
+
+    Definition() : Fingerprint(0), File(NULL) { }
+  };
+
+  // A record whose definition differs from the one in the database
+  struct Conflict {
+    std::string Name;
+    const char *File;
+    std::string OtherFile;
+  };
+
+ private:
+  typedef llvm::StringMap<Definition> DefinitionMap;
+  DefinitionMap mDefinitions;
+  // The absolute paths of the input files checked so far, and their
+  // modification times
+  typedef llvm::StringMap<uint64_t> FileMap;
+  FileMap mFiles;
+  // The input file being checked
+  const FileMap::value_type *mCurrentFile;
+  // Each record checked so far and its input file
+  typedef std::vector<std::pair<const DefinitionMap::value_type*,
+                                const FileMap::value_type*> > RecordList;
+  RecordList mRecords;
+
+  static void AppendTypeLayout(const RSExportType *ET, std::string &Layout);
+
+  bool syncLocked(const std::string &Path, std::vector<Conflict> &Conflicts,
+                  std::string *ErrMsg) const;
+
+ public:
+  static void GetLayout(const RSExportRecordType *ERT, std::string &Layout);
+
+  // FNV-1a hash of the layout string of ERT
+  static uint64_t GetFingerprint(const RSExportRecordType *ERT);
+
+  RSODRStore() : mCurrentFile(NULL) { }
+
+  // Note that all records of File are checked next (the database entries of
+  // File are then replaced by sync()).
+  void addFile(const char *File);
+
+  // Check the definition of ERT from File, the last file passed to addFile(),
+  // against the one of the same name seen before, if any (which is then
+  // returned in *Other). Otherwise, keep the one of ERT. Return false if the
+  // two differ.
+  bool check(const RSExportRecordType *ERT, const char *File,
+             const Definition **Other);
+
+  // Check the definitions kept so far against the ones from the other input
+  // files in the database at Path that are not stale, adding those that
+  // differ to Conflicts. If there are none, write the kept definitions to the
+  // database in place of the old ones of their files, and drop the stale
+  // ones. The database is locked meanwhile, and replaced as a whole, so that
+  // it is never left half written. Return false (and set *ErrMsg) if it can
+  // not be read, locked or written.
+  bool sync(const std::string &Path, std::vector<Conflict> &Conflicts,
+            std::string *ErrMsg) const;
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_ODR_STORE_H_  NOLINT
@@ -138,6 +138,35 @@ class RSReflectLicensePragmaHandler : public RSPragmaHandler {
   }
 };
 
+class RSReflectUnsynchronizedPragmaHandler : public RSPragmaHandler {
+ public:
+  RSReflectUnsynchronizedPragmaHandler(llvm::StringRef Name,
+                                       RSContext *Context)
+      : RSPragmaHandler(Name, Context) { return; }
+
+  void HandlePragma(clang::Preprocessor &PP,
+                    clang::PragmaIntroducerKind Introducer,
+                    clang::Token &FirstToken) {
+    this->handleNonParamPragma(PP, FirstToken);
+    mContext->addPragma(this->getName(), "");
+    mContext->setReflectUnsynchronized(true);
+  }
+};
+
+class RSReflectBatchPragmaHandler : public RSPragmaHandler {
+ public:
+  RSReflectBatchPragmaHandler(llvm::StringRef Name, RSContext *Context)
+      : RSPragmaHandler(Name, Context) { return; }
+
+  void HandlePragma(clang::Preprocessor &PP,
+                    clang::PragmaIntroducerKind Introducer,
+                    clang::Token &FirstToken) {
+    this->handleNonParamPragma(PP, FirstToken);
+    mContext->addPragma(this->getName(), "");
+    mContext->setReflectBatch(true);
+  }
+};
+
 class RSVersionPragmaHandler : public RSPragmaHandler {
  private:
   void handleInt(clang::Preprocessor &PP,
@@ -185,6 +214,17 @@ RSPragmaHandler::CreatePragmaReflectLicenseHandler(RSContext *Context) {
   return new RSReflectLicensePragmaHandler("set_reflect_license", Context);
 }
 
+RSPragmaHandler *
+RSPragmaHandler::CreatePragmaReflectUnsynchronizedHandler(RSContext *Context) {
+  return new RSReflectUnsynchronizedPragmaHandler("reflect_unsynchronized",
+                                                  Context);
+}
+
+RSPragmaHandler *
+RSPragmaHandler::CreatePragmaReflectBatchHandler(RSContext *Context) {
+  return new RSReflectBatchPragmaHandler("reflect_batch", Context);
+}
+
 RSPragmaHandler *
 RSPragmaHandler::CreatePragmaVersionHandler(RSContext *Context) {
   return new RSVersionPragmaHandler("version", Context);
@@ -69,6 +69,9 @@ class RSPragmaHandler : public clang::PragmaHandler {
   static RSPragmaHandler *CreatePragmaJavaPackageNameHandler(
       RSContext *Context);
   static RSPragmaHandler *CreatePragmaReflectLicenseHandler(RSContext *Context);
+  static RSPragmaHandler *CreatePragmaReflectUnsynchronizedHandler(
+      RSContext *Context);
+  static RSPragmaHandler *CreatePragmaReflectBatchHandler(RSContext *Context);
   static RSPragmaHandler *CreatePragmaVersionHandler(RSContext *Context);
 
   virtual void HandlePragma(clang::Preprocessor &PP,
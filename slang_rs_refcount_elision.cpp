@@ -0,0 +1,353 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "slang_rs_refcount_elision.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/Expr.h"
+#include "clang/AST/Stmt.h"
+
+#include "llvm/Support/Casting.h"
+
+#include "slang_rs.h"
+#include "slang_rs_export_type.h"
+
+namespace slang {
+
+namespace {
+
+// Whether VD is a single RS object (not an array or a structure of them).
+bool IsSingleRSObject(const clang::VarDecl *VD) {
+  return RSExportPrimitiveType::IsRSObjectType(
+      RSExportType::GetTypeOfDecl(VD));
+}
+
+// Whether E is an RS object or a structure containing one.
+bool HasRSObjectType(const clang::Expr *E) {
+  const clang::Type *T = E->getType().getTypePtr();
+  return RSExportPrimitiveType::IsRSObjectType(T) ||
+         RSExportPrimitiveType::IsStructureTypeWithRSObject(T);
+}
+
+bool ReferencesVar(const clang::Stmt *S, const clang::VarDecl *VD) {
+  if (const clang::DeclRefExpr *DRE =
+          llvm::dyn_cast<clang::DeclRefExpr>(S)) {
+    return DRE->getDecl() == VD;
+  }
+
+  for (clang::Stmt::const_child_iterator I = S->child_begin(),
+          E = S->child_end();
+       I != E;
+       I++) {
+    if (*I && ReferencesVar(*I, VD)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+RSRefCountElision::VarInfo *RSRefCountElision::getTrackedVar(
+    const clang::Expr *E) {
+  const clang::DeclRefExpr *DRE =
+      llvm::dyn_cast<clang::DeclRefExpr>(E->IgnoreParens());
+  const clang::VarDecl *VD =
+      DRE ? llvm::dyn_cast<clang::VarDecl>(DRE->getDecl()) : NULL;
+  if (VD == NULL) {
+    return NULL;
+  }
+
+  if (!VD->hasLocalStorage()) {
+    // Globals are only followed for changes (see isStableGlobal()).
+    return NULL;
+  }
+
+  VarInfoMap::iterator I = mVars.find(VD);
+  if (I != mVars.end()) {
+    return &I->second;
+  }
+
+  // Parameters are not declared in the body, so they are added on first use.
+  if (llvm::isa<clang::ParmVarDecl>(VD) && IsSingleRSObject(VD)) {
+    return &mVars[VD];
+  }
+  return NULL;
+}
+
+const clang::VarDecl *RSRefCountElision::getAssignedVar(
+    const clang::Stmt *S) {
+  const clang::BinaryOperator *BO = llvm::dyn_cast<clang::BinaryOperator>(S);
+  if (BO == NULL || BO->getOpcode() != clang::BO_Assign) {
+    return NULL;
+  }
+
+  const clang::DeclRefExpr *DRE =
+      llvm::dyn_cast<clang::DeclRefExpr>(BO->getLHS()->IgnoreParens());
+  const clang::VarDecl *VD =
+      DRE ? llvm::dyn_cast<clang::VarDecl>(DRE->getDecl()) : NULL;
+  if (VD == NULL || llvm::isa<clang::ParmVarDecl>(VD) || !mVars.count(VD)) {
+    return NULL;
+  }
+  return VD;
+}
+
+void RSRefCountElision::collect(clang::Stmt *S) {
+  if (S == NULL) {
+    return;
+  }
+
+  if (llvm::isa<clang::GotoStmt>(S) || llvm::isa<clang::IndirectGotoStmt>(S)) {
+    mHasGotos = true;
+    return;
+  }
+
+  if (clang::DeclStmt *DS = llvm::dyn_cast<clang::DeclStmt>(S)) {
+    for (clang::DeclStmt::decl_iterator I = DS->decl_begin(),
+            E = DS->decl_end();
+         I != E;
+         I++) {
+      clang::VarDecl *VD = llvm::dyn_cast<clang::VarDecl>(*I);
+      if (VD == NULL) {
+        continue;
+      }
+      if (VD->hasLocalStorage() && IsSingleRSObject(VD)) {
+        mVars[VD] = VarInfo();
+      }
+      collect(VD->getInit());
+    }
+    return;
+  }
+
+  if (clang::BinaryOperator *BO = llvm::dyn_cast<clang::BinaryOperator>(S)) {
+    if (BO->getOpcode() == clang::BO_Assign) {
+      if (VarInfo *Info = getTrackedVar(BO->getLHS())) {
+        Info->Writes++;
+        collect(BO->getRHS());
+        return;
+      }
+      // E.g. '*p = x' or 's.a = x'; p might point to any global.
+      if (!llvm::isa<clang::DeclRefExpr>(BO->getLHS()->IgnoreParens()) &&
+          HasRSObjectType(BO->getLHS())) {
+        mHasIndirectStores = true;
+      }
+    }
+  }
+
+  if (clang::ImplicitCastExpr *ICE =
+          llvm::dyn_cast<clang::ImplicitCastExpr>(S)) {
+    if (ICE->getCastKind() == clang::CK_LValueToRValue) {
+      if (VarInfo *Info = getTrackedVar(ICE->getSubExpr())) {
+        Info->Reads++;
+        return;
+      }
+      // Reading a global leaves it as it is.
+      if (llvm::isa<clang::DeclRefExpr>(ICE->getSubExpr()->IgnoreParens())) {
+        return;
+      }
+    }
+  }
+
+  if (clang::CallExpr *CE = llvm::dyn_cast<clang::CallExpr>(S)) {
+    const clang::FunctionDecl *FD = CE->getDirectCallee();
+    if (FD == NULL ||
+        !SlangRS::IsLocInRSHeaderFile(
+            FD->getLocation(), FD->getASTContext().getSourceManager()) ||
+        FD->getName().startswith("rsForEach")) {
+      mHasUnknownCalls = true;
+    } else if (FD->getName() == "rsSetObject" ||
+               FD->getName() == "rsClearObject") {
+      // The object pointer might be the address of any global.
+      mHasIndirectStores = true;
+    }
+  }
+
+  if (clang::ReturnStmt *RS = llvm::dyn_cast<clang::ReturnStmt>(S)) {
+    // A returned RS object has to be referenced until the caller takes it.
+    clang::Expr *RetValue = RS->getRetValue();
+    if (RetValue && RetValue->getType()->isRecordType()) {
+      markEscapes(RetValue);
+      return;
+    }
+  }
+
+  if (clang::DeclRefExpr *DRE = llvm::dyn_cast<clang::DeclRefExpr>(S)) {
+    // Any other use, e.g. assigning it or taking its address
+    markEscapes(DRE);
+    return;
+  }
+
+  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
+       I != E;
+       I++) {
+    collect(*I);
+  }
+  return;
+}
+
+void RSRefCountElision::markEscapes(clang::Stmt *S) {
+  if (clang::DeclRefExpr *DRE = llvm::dyn_cast<clang::DeclRefExpr>(S)) {
+    if (VarInfo *Info = getTrackedVar(DRE)) {
+      Info->Escapes = true;
+    } else if (const clang::VarDecl *VD =
+                   llvm::dyn_cast<clang::VarDecl>(DRE->getDecl())) {
+      if (!VD->hasLocalStorage()) {
+        mChangedGlobals.insert(VD);
+      }
+    }
+    return;
+  }
+
+  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
+       I != E;
+       I++) {
+    if (*I) {
+      markEscapes(*I);
+    }
+  }
+  return;
+}
+
+void RSRefCountElision::findDeadStores(clang::Stmt *S) {
+  if (clang::CompoundStmt *CS = llvm::dyn_cast<clang::CompoundStmt>(S)) {
+    clang::CompoundStmt::body_iterator E = CS->body_end();
+    for (clang::CompoundStmt::body_iterator I = CS->body_begin();
+         I != E && (I + 1) != E;
+         I++) {
+      const clang::VarDecl *VD = NULL;
+      if (clang::DeclStmt *DS = llvm::dyn_cast<clang::DeclStmt>(*I)) {
+        // The initializer is dropped, so it may not have side effects.
+        const clang::VarDecl *D = DS->isSingleDecl() ?
+            llvm::dyn_cast<clang::VarDecl>(DS->getSingleDecl()) : NULL;
+        if (D && mVars.count(D) && D->getInit() &&
+            !D->getInit()->HasSideEffects(D->getASTContext())) {
+          VD = D;
+        }
+      } else {
+        VD = getAssignedVar(*I);
+      }
+      // The store might be read through a pointer to the variable, e.g.
+      // 'p = &a; a = x; a = *p;'.
+      if (VD && isEscaped(VD)) {
+        VD = NULL;
+      }
+
+      const clang::BinaryOperator *Next =
+          llvm::dyn_cast<clang::BinaryOperator>(*(I + 1));
+      if (VD && Next && (getAssignedVar(Next) == VD) &&
+          !ReferencesVar(Next->getRHS(), VD)) {
+        mDeadStores[*I] = VD;
+      }
+    }
+  }
+
+  for (clang::Stmt::child_iterator I = S->child_begin(), E = S->child_end();
+       I != E;
+       I++) {
+    if (*I) {
+      findDeadStores(*I);
+    }
+  }
+  return;
+}
+
+bool RSRefCountElision::isEscaped(const clang::VarDecl *VD) const {
+  VarInfoMap::const_iterator I = mVars.find(VD);
+  return (I != mVars.end()) && I->second.Escapes;
+}
+
+bool RSRefCountElision::isStableGlobal(const clang::VarDecl *VD) const {
+  return VD->hasGlobalStorage() &&
+         !VD->getType().isVolatileQualified() &&
+         IsSingleRSObject(VD) &&
+         !mHasUnknownCalls &&
+         !mHasIndirectStores &&
+         !mChangedGlobals.count(VD);
+}
+
+void RSRefCountElision::clear() {
+  mVars.clear();
+  mDeadStores.clear();
+  mChangedGlobals.clear();
+  mHasUnknownCalls = false;
+  mHasIndirectStores = false;
+  mHasGotos = false;
+  return;
+}
+
+void RSRefCountElision::analyze(clang::Stmt *Body) {
+  clear();
+  collect(Body);
+  if (mHasGotos) {
+    clear();
+    return;
+  }
+  findDeadStores(Body);
+
+  for (VarInfoMap::iterator I = mVars.begin(), E = mVars.end(); I != E; I++) {
+    const clang::VarDecl *VD = I->first;
+    VarInfo &Info = I->second;
+    if (llvm::isa<clang::ParmVarDecl>(VD) || Info.Escapes) {
+      continue;
+    }
+
+    if (Info.Reads == 0) {
+      Info.Kind = VK_Unused;
+      continue;
+    }
+
+    // Borrow from a variable that keeps the same reference all along.
+    const clang::Expr *Init = VD->getInit();
+    if (Info.Writes != 0 || Init == NULL) {
+      continue;
+    }
+    const clang::DeclRefExpr *DRE =
+        llvm::dyn_cast<clang::DeclRefExpr>(Init->IgnoreParenImpCasts());
+    const clang::VarDecl *Source =
+        DRE ? llvm::dyn_cast<clang::VarDecl>(DRE->getDecl()) : NULL;
+    if (Source == NULL || Source == VD) {
+      continue;
+    }
+    VarInfoMap::iterator SI = mVars.find(Source);
+    if ((SI != E) ? (SI->second.Writes == 0 && !SI->second.Escapes)
+                  : isStableGlobal(Source)) {
+      Info.Kind = VK_Borrowed;
+      Info.Source = Source;
+    }
+  }
+  return;
+}
+
+RSRefCountElision::VarKind RSRefCountElision::getKind(
+    const clang::VarDecl *VD) const {
+  VarInfoMap::const_iterator I = mVars.find(VD);
+  return (I != mVars.end()) ? I->second.Kind : VK_Counted;
+}
+
+const clang::VarDecl *RSRefCountElision::getSource(
+    const clang::VarDecl *VD) const {
+  VarInfoMap::const_iterator I = mVars.find(VD);
+  return (I != mVars.end()) ? I->second.Source : NULL;
+}
+
+bool RSRefCountElision::isDeadStore(const clang::Stmt *S) const {
+  StoreMap::const_iterator I = mDeadStores.find(S);
+  return (I != mDeadStores.end()) && (getKind(I->second) == VK_Counted) &&
+         !isEscaped(I->second);
+}
+
+}  // namespace slang
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2013, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_REFCOUNT_ELISION_H_  // NOLINT
+#define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_REFCOUNT_ELISION_H_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace clang {
+  class Expr;
+  class Stmt;
+  class VarDecl;
+}
+
+namespace slang {
+
+// Finds the rsSetObject()/rsClearObject() calls that RSObjectRefCount can
+// leave out of a function body (-elide-redundant-refcount):
+//
+// 1) A local RS object that is never read needs no reference at all.
+// 2) A local RS object that is initialized from a parameter or a local RS
+//    object, and that neither of them is ever assigned or has its address
+//    taken, can borrow the reference of that variable.
+//    It can also borrow from a global (or static local) RS object that the
+//    function does not assign or take the address of, provided that it calls
+//    nothing but RS runtime functions (other than rsForEach()), which can
+//    not change the global without its address, and that it never stores an
+//    RS object through a pointer (including rsSetObject()/rsClearObject()),
+//    as the pointer might be the address of the global, taken by a caller.
+//    The global then keeps its reference for the whole call, as other
+//    kernels that assign it would already race with the function.
+// 3) An assignment (or initialization) of a local RS object that does not
+//    escape and is immediately followed by another assignment of it is
+//    overwritten before any use.
+//
+// Only RS objects that are not arrays or structures are considered, and only
+// reads by value keep a variable eligible; anything else (e.g. taking its
+// address, or returning it) makes it escape. Functions with gotos are left
+// alone.
+class RSRefCountElision {
+ public:
+  enum VarKind {
+    VK_Counted,   // Reference counted as usual
+    VK_Unused,    // Never read
+    VK_Borrowed   // Borrows the reference of another variable
+  };
+
+ private:
+  struct VarInfo {
+    unsigned Reads;
+    unsigned Writes;  // Assignments, not counting the initialization
+    bool Escapes;
+    VarKind Kind;
+    const clang::VarDecl *Source;  // For VK_Borrowed
+
+    VarInfo()
+        : Reads(0),
+          Writes(0),
+          Escapes(false),
+          Kind(VK_Counted),
+          Source(NULL) { }
+  };
+
+  typedef llvm::DenseMap<const clang::VarDecl*, VarInfo> VarInfoMap;
+  VarInfoMap mVars;
+
+  // Assignments and declarations that are overwritten before any use, and
+  // the variable they store to
+  typedef llvm::DenseMap<const clang::Stmt*, const clang::VarDecl*>
+      StoreMap;
+  StoreMap mDeadStores;
+
+  // Global RS objects that the function assigns or takes the address of
+  llvm::SmallPtrSet<const clang::VarDecl*, 8> mChangedGlobals;
+
+  // Whether the function calls anything that might change a global
+  bool mHasUnknownCalls;
+
+  // Whether the function stores an RS object through a pointer, or calls
+  // rsSetObject()/rsClearObject(), which might change any global
+  bool mHasIndirectStores;
+
+  bool mHasGotos;
+
+  bool isEscaped(const clang::VarDecl *VD) const;
+  bool isStableGlobal(const clang::VarDecl *VD) const;
+
+  VarInfo *getTrackedVar(const clang::Expr *E);
+  const clang::VarDecl *getAssignedVar(const clang::Stmt *S);
+
+  void collect(clang::Stmt *S);
+  void markEscapes(clang::Stmt *S);
+  void findDeadStores(clang::Stmt *S);
+
+ public:
+  RSRefCountElision()
+      : mHasUnknownCalls(false), mHasIndirectStores(false), mHasGotos(false) {
+  }
+
+  void clear();
+
+  // Analyze the function body Body. This has to be done before any of it is
+  // rewritten.
+  void analyze(clang::Stmt *Body);
+
+  VarKind getKind(const clang::VarDecl *VD) const;
+
+  // The variable (a local, a parameter or a global) that VD borrows its
+  // reference from (if VK_Borrowed).
+  const clang::VarDecl *getSource(const clang::VarDecl *VD) const;
+
+  // Whether S, an assignment or a declaration of a counted RS object, stores a
+  // value that is overwritten before any use.
+  bool isDeadStore(const clang::Stmt *S) const;
+};
+
+}  // namespace slang
+
+#endif  // _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_REFCOUNT_ELISION_H_  NOLINT
@@ -16,11 +16,15 @@
 
 #include "slang_rs_reflect_utils.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <string>
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compression.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "os_sep.h"
 #include "slang_utils.h"
@@ -103,6 +107,28 @@ std::string RSSlangReflectUtils::BCFileNameFromRSFileName(
     return InternalFileNameConvert(rsFileName, true);
 }
 
+bool RSSlangReflectUtils::IsValidABIName(const std::string &abi) {
+    if (abi.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < abi.length(); ++i) {
+        if (!isalnum(abi[i]) && (abi[i] != '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string RSSlangReflectUtils::BundledBCFileName(const char *bcFileName,
+                                                   const char *abi) {
+    string stem(bcFileName);
+    if ((stem.length() > 3) &&
+        (stem.compare(stem.length() - 3, 3, ".bc") == 0)) {
+        stem.erase(stem.length() - 3);
+    }
+    return stem + "_" + abi + ".bc";
+}
+
 static bool GenerateAccessorHeader(
     const RSSlangReflectUtils::BitCodeAccessorContext &context, FILE *pfout) {
     fprintf(pfout, "/*\n");
@@ -120,6 +146,9 @@ static bool GenerateAccessorMethodSignature(
     const RSSlangReflectUtils::BitCodeAccessorContext &context, FILE *pfout) {
     // the prototype of the accessor method
     fprintf(pfout, "  // return byte array representation of the bitcode.\n");
+    fprintf(pfout, "  // The bitcode is decoded once and every call returns "
+                   "the same array:\n");
+    fprintf(pfout, "  // callers must not modify it.\n");
     fprintf(pfout, "  public static byte[] getBitCode() {\n");
     return true;
 }
@@ -127,9 +156,10 @@ static bool GenerateAccessorMethodSignature(
 // Java method size must not exceed 64k,
 // so we have to split the bitcode into multiple segments.
 static bool GenerateSegmentMethod(
-    const char *buff, int blen, int seg_num, FILE *pfout) {
+    const char *buff, int blen, const char *suffix, int seg_num, FILE *pfout) {
 
-    fprintf(pfout, "  private static byte[] getSegment_%d() {\n", seg_num);
+    fprintf(pfout, "  private static byte[] getSegment%s_%d() {\n", suffix,
+            seg_num);
     fprintf(pfout, "    byte[] data = {\n");
 
     static const int LINE_BYTE_NUM = 16;
@@ -158,19 +188,150 @@ static bool GenerateSegmentMethod(
     return true;
 }
 
-static bool GenerateJavaCodeAccessorMethod(
-    const RSSlangReflectUtils::BitCodeAccessorContext &context, FILE *pfout) {
-    FILE *pfin = fopen(context.bcFileName, "rb");
+// Like GenerateSegmentMethod(), but the segment is a String constant with one
+// char per byte. Its modified UTF-8 form in the class file takes at most two
+// bytes per char, so a segment must stay below 32K chars.
+static void GenerateLatin1Segment(
+    const char *buff, int blen, const char *suffix, int seg_num, FILE *pfout) {
+    fprintf(pfout, "  private static final String SEGMENT%s_%d =\n", suffix,
+            seg_num);
+
+    static const int LINE_CHAR_NUM = 72;
+    int line_length = 0;
+    fprintf(pfout, "      \"");
+    for (int i = 0; i < blen; ++i) {
+        unsigned char c = static_cast<unsigned char>(buff[i]);
+        if ((c >= 0x20) && (c < 0x7f) && (c != '"') && (c != '\\')) {
+            fputc(c, pfout);
+            line_length += 1;
+        } else {
+            // Always use 3 octal digits, so that a following digit is not
+            // taken as part of the escape.
+            fprintf(pfout, "\\%03o", c);
+            line_length += 4;
+        }
+        if ((line_length >= LINE_CHAR_NUM) && (i != blen - 1)) {
+            fprintf(pfout, "\" +\n      \"");
+            line_length = 0;
+        }
+    }
+    fprintf(pfout, "\";\n\n");
+}
+
+// String.getBytes(int, int, byte[], int) is deprecated because it drops the
+// high byte of each char, which is exactly what is needed here.
+static void GenerateLatin1DecodeMethod(FILE *pfout) {
+    fprintf(pfout, "  @SuppressWarnings(\"deprecation\")\n");
+    fprintf(pfout, "  private static int decodeSegment(String seg, byte[] bc, "
+                   "int offset) {\n");
+    fprintf(pfout, "    seg.getBytes(0, seg.length(), bc, offset);\n");
+    fprintf(pfout, "    return offset + seg.length();\n");
+    fprintf(pfout, "  }\n\n");
+}
+
+// Emit the segments as String constants, which the JVM loads from the
+// constant pool without running any code. getBitCodeInternal() copies them
+// into the byte[] in one pass each, and inflates the result for BCJE_DEFLATE.
+static bool GenerateLatin1AccessorMethod(
+    const RSSlangReflectUtils::BitCodeAccessorContext &context,
+    const char *suffix, FILE *pfout, FILE *pfin) {
+    std::string data;
+    static const int READ_SIZE = 0x4000;
+    char *buff = new char[READ_SIZE];
+    int read_length;
+    while ((read_length = fread(buff, 1, READ_SIZE, pfin)) > 0) {
+        data.append(buff, read_length);
+    }
+    delete []buff;
+
+    int bitcode_length = data.size();
+    bool compressed = false;
+    if (context.bcEncoding == BCJE_DEFLATE) {
+        llvm::OwningPtr<llvm::MemoryBuffer> deflated;
+        if (llvm::zlib::compress(data, deflated,
+                                 llvm::zlib::BestSizeCompression) ==
+            llvm::zlib::StatusOK) {
+            data.assign(deflated->getBufferStart(), deflated->getBufferSize());
+            compressed = true;
+        } else {
+            fprintf(stderr, "Warning: zlib compression is not available, the "
+                            "bitcode of %s is stored uncompressed\n",
+                    context.rsFileName);
+        }
+    }
+
+    static const int SEG_SIZE = 0x4000;
+    int seg_num = 0;
+    for (size_t offset = 0; offset < data.size(); offset += SEG_SIZE) {
+        int length = std::min(data.size() - offset,
+                              static_cast<size_t>(SEG_SIZE));
+        GenerateLatin1Segment(data.data() + offset, length, suffix, seg_num,
+                              pfout);
+        ++seg_num;
+    }
+
+    fprintf(pfout, "  private static int bitCodeLength%s = %d;\n\n", suffix,
+        bitcode_length);
+
+    fprintf(pfout, "  private static byte[] getBitCodeInternal%s() {\n",
+            suffix);
+    if (compressed) {
+    fprintf(pfout, "    byte[] z = new byte[%d];\n",
+            static_cast<int>(data.size()));
+    } else {
+    fprintf(pfout, "    byte[] bc = new byte[bitCodeLength%s];\n", suffix);
+    }
+    fprintf(pfout, "    int offset = 0;\n");
+    for (int i = 0; i < seg_num; ++i) {
+    fprintf(pfout, "    offset = decodeSegment(SEGMENT%s_%d, %s, offset);\n",
+            suffix, i, (compressed ? "z" : "bc"));
+    }
+    if (compressed) {
+    fprintf(pfout, "    byte[] bc = new byte[bitCodeLength%s];\n", suffix);
+    fprintf(pfout, "    java.util.zip.Inflater inflater = "
+                   "new java.util.zip.Inflater();\n");
+    fprintf(pfout, "    try {\n");
+    fprintf(pfout, "      inflater.setInput(z);\n");
+    fprintf(pfout, "      if (inflater.inflate(bc) != bitCodeLength%s) {\n",
+            suffix);
+    fprintf(pfout, "        throw new RuntimeException("
+                   "\"Truncated bitcode\");\n");
+    fprintf(pfout, "      }\n");
+    fprintf(pfout, "    } catch (java.util.zip.DataFormatException e) {\n");
+    fprintf(pfout, "      throw new RuntimeException(e);\n");
+    fprintf(pfout, "    } finally {\n");
+    fprintf(pfout, "      inflater.end();\n");
+    fprintf(pfout, "    }\n");
+    }
+    fprintf(pfout, "    return bc;\n");
+    fprintf(pfout, "  }\n\n");
+
+    return true;
+}
+
+// Emit getBitCodeInternal<suffix>() and the data it decodes for the bitcode in
+// bcFileName, and the lazily initialized BitCodeHolder<suffix> caching it.
+static bool GenerateBitCodeData(
+    const RSSlangReflectUtils::BitCodeAccessorContext &context,
+    const char *bcFileName, const char *suffix, FILE *pfout) {
+    FILE *pfin = fopen(bcFileName, "rb");
     if (pfin == NULL) {
-        fprintf(stderr, "Error: could not read file %s\n", context.bcFileName);
+        fprintf(stderr, "Error: could not read file %s\n", bcFileName);
         return false;
     }
 
-    // start the accessor method
-    GenerateAccessorMethodSignature(context, pfout);
-    fprintf(pfout, "    return getBitCodeInternal();\n");
-    // end the accessor method
-    fprintf(pfout, "  };\n\n");
+    // The JVM initializes BitCodeHolder, and thus decodes the bitcode, on the
+    // first access only, and does so thread-safely.
+    fprintf(pfout, "  private static class BitCodeHolder%s {\n", suffix);
+    fprintf(pfout, "    static final byte[] BITCODE = "
+                   "getBitCodeInternal%s();\n", suffix);
+    fprintf(pfout, "  }\n\n");
+
+    if (context.bcEncoding != BCJE_BYTE_ARRAY) {
+        bool ret = GenerateLatin1AccessorMethod(context, suffix, pfout, pfin);
+        fclose(pfin);
+        return ret;
+    }
 
     // output the data
     // make sure the generated function for a segment won't break the Javac
@@ -181,7 +342,7 @@ static bool GenerateJavaCodeAccessorMethod(
     int seg_num = 0;
     int total_length = 0;
     while ((read_length = fread(buff, 1, SEG_SIZE, pfin)) > 0) {
-        GenerateSegmentMethod(buff, read_length, seg_num, pfout);
+        GenerateSegmentMethod(buff, read_length, suffix, seg_num, pfout);
         ++seg_num;
         total_length += read_length;
     }
@@ -189,14 +350,15 @@ static bool GenerateJavaCodeAccessorMethod(
     fclose(pfin);
 
     // output the internal accessor method
-    fprintf(pfout, "  private static int bitCodeLength = %d;\n\n",
+    fprintf(pfout, "  private static int bitCodeLength%s = %d;\n\n", suffix,
         total_length);
-    fprintf(pfout, "  private static byte[] getBitCodeInternal() {\n");
-    fprintf(pfout, "    byte[] bc = new byte[bitCodeLength];\n");
+    fprintf(pfout, "  private static byte[] getBitCodeInternal%s() {\n",
+            suffix);
+    fprintf(pfout, "    byte[] bc = new byte[bitCodeLength%s];\n", suffix);
     fprintf(pfout, "    int offset = 0;\n");
     fprintf(pfout, "    byte[] seg;\n");
     for (int i = 0; i < seg_num; ++i) {
-    fprintf(pfout, "    seg = getSegment_%d();\n", i);
+    fprintf(pfout, "    seg = getSegment%s_%d();\n", suffix, i);
     fprintf(pfout, "    System.arraycopy(seg, 0, bc, offset, seg.length);\n");
     fprintf(pfout, "    offset += seg.length;\n");
     }
@@ -206,6 +368,64 @@ static bool GenerateJavaCodeAccessorMethod(
     return true;
 }
 
+static bool GenerateJavaCodeAccessorMethod(
+    const RSSlangReflectUtils::BitCodeAccessorContext &context, FILE *pfout) {
+    // start the accessor method
+    GenerateAccessorMethodSignature(context, pfout);
+    fprintf(pfout, "    return BitCodeHolder.BITCODE;\n");
+    // end the accessor method
+    fprintf(pfout, "  };\n\n");
+
+    fprintf(pfout, "  // return a read-only view of the bitcode, without "
+                   "copying it.\n");
+    fprintf(pfout, "  public static java.nio.ByteBuffer getBitCodeBuffer() "
+                   "{\n");
+    fprintf(pfout, "    return java.nio.ByteBuffer.wrap(BitCodeHolder.BITCODE)"
+                   ".asReadOnlyBuffer();\n");
+    fprintf(pfout, "  }\n\n");
+
+    // Bitcode compiled for other ABIs in the same invocation is selected by
+    // the ABI name; any other name gets the default bitcode. The ABI names
+    // were checked with IsValidABIName(), so they are used verbatim.
+    if (context.bundledBitCode != NULL) {
+        fprintf(pfout, "  // return the bitcode compiled for the given ABI.\n");
+        fprintf(pfout, "  // Like getBitCode(), the array is shared: callers "
+                       "must not modify it.\n");
+        fprintf(pfout, "  public static byte[] getBitCode(String abi) {\n");
+        for (size_t i = 0; i < context.bundledBitCode->size(); ++i) {
+            const std::string &abi = (*context.bundledBitCode)[i].first;
+            fprintf(pfout, "    if (\"%s\".equals(abi)) {\n", abi.c_str());
+            fprintf(pfout, "      return BitCodeHolder_%s.BITCODE;\n",
+                    abi.c_str());
+            fprintf(pfout, "    }\n");
+        }
+        fprintf(pfout, "    return getBitCode();\n");
+        fprintf(pfout, "  }\n\n");
+    }
+
+    if (context.bcEncoding != BCJE_BYTE_ARRAY) {
+        GenerateLatin1DecodeMethod(pfout);
+    }
+
+    if (!GenerateBitCodeData(context, context.bcFileName, "", pfout)) {
+        return false;
+    }
+
+    if (context.bundledBitCode != NULL) {
+        for (size_t i = 0; i < context.bundledBitCode->size(); ++i) {
+            const std::pair<std::string, std::string> &bc =
+                (*context.bundledBitCode)[i];
+            std::string suffix("_" + bc.first);
+            if (!GenerateBitCodeData(context, bc.second.c_str(),
+                                     suffix.c_str(), pfout)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 static bool GenerateAccessorClass(
     const RSSlangReflectUtils::BitCodeAccessorContext &context,
     const char *clazz_name, FILE *pfout) {
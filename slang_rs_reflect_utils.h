@@ -18,6 +18,8 @@
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_REFLECT_UTILS_H_
 
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace slang {
 
@@ -28,6 +30,25 @@ enum BitCodeStorageType {
   BCST_CPP_CODE
 };
 
+// How the bitcode is encoded in the generated Java source (BCST_JAVA_CODE)
+enum BitCodeJavaEncoding {
+  // byte[] initializers, one decimal literal per byte
+  BCJE_BYTE_ARRAY,
+  // String constants holding one char (0-255) per byte
+  BCJE_LATIN1,
+  // Like BCJE_LATIN1, but the bitcode is DEFLATE-compressed (zlib format)
+  BCJE_DEFLATE
+};
+
+// How the bitcode is embedded in the reflected C++ (BCST_CPP_CODE)
+enum BitCodeCppEmbedding {
+  // static const unsigned char[] initializer in ScriptC_*.cpp
+  BCCE_ARRAY,
+  // ScriptC_*_bc.S pulling in the .bc file with .incbin, and ScriptC_*_bc.h
+  // declaring the symbols it defines
+  BCCE_INCBIN
+};
+
 class RSSlangReflectUtils {
  public:
   // Encode a binary bitcode file into a Java source file.
@@ -36,6 +57,8 @@ class RSSlangReflectUtils {
   // reflectPath: where to output the generated Java file, no package name in
   // it.
   // packageName: the package of the output Java file.
+  // bundledBitCode: <ABI name, bit code file> of the bit code compiled for
+  // other ABIs, reachable with getBitCode(abi). May be NULL.
   struct BitCodeAccessorContext {
     const char *rsFileName;
     const char *bcFileName;
@@ -43,6 +66,8 @@ class RSSlangReflectUtils {
     const char *packageName;
 
     BitCodeStorageType bcStorage;
+    BitCodeJavaEncoding bcEncoding;
+    const std::vector<std::pair<std::string, std::string> > *bundledBitCode;
   };
 
   // Return the stem of the file name, i.e., remove the dir and the extension.
@@ -75,6 +100,17 @@ class RSSlangReflectUtils {
   // rsFileName: the input .rs file name (with or without path).
   static std::string BCFileNameFromRSFileName(const char *rsFileName);
 
+  // Check that abi can be used as is in file names, Java/C++ identifiers and
+  // string literals, i.e. that it is non-empty and only has alnum and
+  // underscore characters.
+  static bool IsValidABIName(const std::string &abi);
+
+  // Compute the name of the bit code file compiled for the bundled ABI abi
+  // (see IsValidABIName()) next to the default bit code file bcFileName.
+  // E.g. with bcFileName=./out/foo.bc and abi=x86 it returns "./out/foo_x86.bc"
+  static std::string BundledBCFileName(const char *bcFileName,
+                                       const char *abi);
+
   // Generate the bit code accessor Java source file.
   static bool GenerateBitCodeAccessor(const BitCodeAccessorContext &context);
 };
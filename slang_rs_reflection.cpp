@@ -50,12 +50,16 @@
 #define RS_TYPE_ITEM_BUFFER_NAME         "mItemArray"
 #define RS_TYPE_ITEM_BUFFER_PACKER_NAME  "mIOBuffer"
 #define RS_TYPE_ELEMENT_REF_NAME         "mElementCache"
+#define RS_TYPE_COPY_BUFFER_NAME         "mCopyBuffer"
+
+#define RS_TYPE_UNSYNC_ACCESSOR_PREFIX   "unsync"
 
 #define RS_EXPORT_VAR_INDEX_PREFIX       "mExportVarIdx_"
 #define RS_EXPORT_VAR_PREFIX             "mExportVar_"
 #define RS_EXPORT_VAR_ELEM_PREFIX        "mExportVarElem_"
 #define RS_EXPORT_VAR_DIM_PREFIX         "mExportVarDim_"
 #define RS_EXPORT_VAR_CONST_PREFIX       "const_"
+#define RS_EXPORT_VAR_FP_PREFIX          "mExportVarFP_"
 
 #define RS_ELEM_PREFIX                   "__"
 
@@ -65,6 +69,12 @@
 
 #define RS_EXPORT_FUNC_INDEX_PREFIX      "mExportFuncIdx_"
 #define RS_EXPORT_FOREACH_INDEX_PREFIX   "mExportForEachIdx_"
+#define RS_EXPORT_FUNC_FP_PREFIX         "mExportFuncFP_"
+#define RS_EXPORT_FOREACH_FP_PREFIX      "mExportForEachFP_"
+#define RS_EXPORT_BATCH_FUNC_INDEX       "mExportBatchFuncIdx"
+#define RS_EXPORT_BATCH_CLASS_NAME       "Batch"
+#define RS_EXPORT_BATCH_PACKET_NAME      "mPacket"
+#define RS_EXPORT_BATCH_DIRTY_PREFIX     "mDirty"
 
 #define RS_EXPORT_VAR_ALLOCATION_PREFIX  "mAlloction_"
 #define RS_EXPORT_VAR_DATA_STORAGE_PREFIX "mData_"
@@ -263,6 +273,56 @@ static std::string GetBuiltinElementConstruct(const RSExportType *ET) {
   return "";
 }
 
+// Returns true if every field of @ERT is a 32-bit int/float scalar or vector.
+// The elements of such records are plain arrays of 32-bit words (padding
+// included), so they can be copied in bulk from/to int[] and float[].
+static bool IsBulkCopyableRecord(const RSExportRecordType *ERT) {
+  for (RSExportRecordType::const_field_iterator I = ERT->fields_begin(),
+           E = ERT->fields_end();
+       I != E;
+       I++) {
+    const RSExportType *FT = (*I)->getType();
+    if ((FT->getClass() != RSExportType::ExportClassPrimitive) &&
+        (FT->getClass() != RSExportType::ExportClassVector))
+      return false;
+
+    switch (static_cast<const RSExportPrimitiveType*>(FT)->getType()) {
+      case RSExportPrimitiveType::DataTypeFloat32:
+      case RSExportPrimitiveType::DataTypeSigned32:
+      case RSExportPrimitiveType::DataTypeUnsigned32: {
+        break;
+      }
+      default: {
+        return false;
+      }
+    }
+  }
+  return ((RSExportType::GetTypeAllocSize(ERT) % 4) == 0);
+}
+
+// Returns the Java expression that reads the 32-bit value of type @EPT at
+// byte @Pos of the little-endian ByteBuffer @Buffer.
+static std::string GetBulkReadExpr(const RSExportPrimitiveType *EPT,
+                                   const char *Buffer,
+                                   const std::string &Pos) {
+  switch (EPT->getType()) {
+    case RSExportPrimitiveType::DataTypeFloat32: {
+      return std::string(Buffer) + ".getFloat(" + Pos + ")";
+    }
+    case RSExportPrimitiveType::DataTypeSigned32: {
+      return std::string(Buffer) + ".getInt(" + Pos + ")";
+    }
+    case RSExportPrimitiveType::DataTypeUnsigned32: {
+      // uint is reflected as long
+      return "(" + std::string(Buffer) + ".getInt(" + Pos + ") & 0xffffffffL)";
+    }
+    default: {
+      slangAssert(false && "GetBulkReadExpr : Not a 32-bit type");
+      return "";
+    }
+  }
+}
+
 // Replace all instances of "\" with "\\" in a single string to prevent
 // formatting errors due to unicode.
 static std::string SanitizeString(std::string s) {
@@ -311,6 +371,10 @@ bool RSReflection::genScriptClass(Context &C,
        I != E; I++)
     genExportFunction(C, *I);
 
+  // Reflect batch update of export variables (#pragma rs reflect_batch)
+  if (mRSContext->hasBatchVar())
+    genExportBatch(C);
+
   C.endClass();
 
   return true;
@@ -616,6 +680,12 @@ void RSReflection::genExportFunction(Context &C, const RSExportFunc *EF) {
     }
   }
 
+  if (EF->hasParam()) {
+    genReusableFieldPackerDecl(C, EF->getParamPacketType(),
+                               RS_EXPORT_FUNC_FP_PREFIX + EF->getName(),
+                               /* ThreadLocal = */true);
+  }
+
   C.startFunction(Context::AM_Public,
                   false,
                   "void",
@@ -631,7 +701,10 @@ void RSReflection::genExportFunction(Context &C, const RSExportFunc *EF) {
     const RSExportRecordType *ERT = EF->getParamPacketType();
     std::string FieldPackerName = EF->getName() + "_fp";
 
-    if (genCreateFieldPacker(C, ERT, FieldPackerName.c_str()))
+    // invoke_*() is not synchronized, so each thread gets its own packer.
+    if (genReuseFieldPacker(C, ERT, FieldPackerName.c_str(),
+                            RS_EXPORT_FUNC_FP_PREFIX + EF->getName(),
+                            /* ThreadLocal = */true))
       genPackVarOfType(C, ERT, NULL, FieldPackerName.c_str());
 
     C.indent() << "invoke("RS_EXPORT_FUNC_INDEX_PREFIX << EF->getName() << ", "
@@ -732,6 +805,12 @@ void RSReflection::genExportForEach(Context &C, const RSExportForEach *EF) {
     Args.push_back(std::make_pair("Script.LaunchOptions", "sc"));
   }
 
+  if (ERT) {
+    genReusableFieldPackerDecl(C, ERT,
+                               RS_EXPORT_FOREACH_FP_PREFIX + EF->getName(),
+                               /* ThreadLocal = */true);
+  }
+
   C.startFunction(Context::AM_Public,
                   false,
                   "void",
@@ -763,7 +842,10 @@ void RSReflection::genExportForEach(Context &C, const RSExportForEach *EF) {
 
   std::string FieldPackerName = EF->getName() + "_fp";
   if (ERT) {
-    if (genCreateFieldPacker(C, ERT, FieldPackerName.c_str())) {
+    // forEach_*() is not synchronized, so each thread gets its own packer.
+    if (genReuseFieldPacker(C, ERT, FieldPackerName.c_str(),
+                            RS_EXPORT_FOREACH_FP_PREFIX + EF->getName(),
+                            /* ThreadLocal = */true)) {
       genPackVarOfType(C, ERT, NULL, FieldPackerName.c_str());
     }
   }
@@ -1029,6 +1111,9 @@ void RSReflection::genMatrixTypeExportVariable(Context &C,
   // set_*()
   if (!EV->isConst()) {
     const char *FieldPackerName = "fp";
+    // set_*() is synchronized, so a single cached packer can be shared.
+    genReusableFieldPackerDecl(C, ET, RS_EXPORT_VAR_FP_PREFIX + VarName,
+                               /* ThreadLocal = */false);
     C.startFunction(Context::AM_PublicSynchronized,
                     false,
                     "void",
@@ -1037,7 +1122,9 @@ void RSReflection::genMatrixTypeExportVariable(Context &C,
                     TypeName.c_str(), "v");
     C.indent() << RS_EXPORT_VAR_PREFIX << VarName << " = v;" << std::endl;
 
-    if (genCreateFieldPacker(C, ET, FieldPackerName))
+    if (genReuseFieldPacker(C, ET, FieldPackerName,
+                            RS_EXPORT_VAR_FP_PREFIX + VarName,
+                            /* ThreadLocal = */false))
       genPackVarOfType(C, ET, "v", FieldPackerName);
     C.indent() << "setVar("RS_EXPORT_VAR_INDEX_PREFIX << VarName << ", "
                << FieldPackerName << ");" << std::endl;
@@ -1097,6 +1184,18 @@ void RSReflection::genSetExportVariable(Context &C,
     const char *FieldPackerName = "fp";
     std::string VarName = EV->getName();
     const RSExportType *ET = EV->getType();
+
+    if (mRSContext->getTargetAPI() >= SLANG_JB_TARGET_API) {
+      // We only have support for one-dimensional array reflection today,
+      // but the entry point (i.e. setVar()) takes an array of dimensions.
+      // The dimensions never change, so build the array only once.
+      C.indent() << "private final static int[] " RS_EXPORT_VAR_DIM_PREFIX
+                 << VarName << " = { " << ET->getSize() << " };" << std::endl;
+    }
+    // set_*() is synchronized, so a single cached packer can be shared.
+    genReusableFieldPackerDecl(C, ET, RS_EXPORT_VAR_FP_PREFIX + VarName,
+                               /* ThreadLocal = */false);
+
     C.startFunction(Context::AM_PublicSynchronized,
                     false,
                     "void",
@@ -1105,7 +1204,9 @@ void RSReflection::genSetExportVariable(Context &C,
                     TypeName.c_str(), "v");
     C.indent() << RS_EXPORT_VAR_PREFIX << VarName << " = v;" << std::endl;
 
-    if (genCreateFieldPacker(C, ET, FieldPackerName))
+    if (genReuseFieldPacker(C, ET, FieldPackerName,
+                            RS_EXPORT_VAR_FP_PREFIX + VarName,
+                            /* ThreadLocal = */false))
       genPackVarOfType(C, ET, "v", FieldPackerName);
 
     if (mRSContext->getTargetAPI() < SLANG_JB_TARGET_API) {
@@ -1113,13 +1214,10 @@ void RSReflection::genSetExportVariable(Context &C,
       C.indent() << "setVar("RS_EXPORT_VAR_INDEX_PREFIX << VarName
                  << ", " << FieldPackerName << ");" << std::endl;
     } else {
-      // We only have support for one-dimensional array reflection today,
-      // but the entry point (i.e. setVar()) takes an array of dimensions.
-      C.indent() << "int []__dimArr = new int[1];" << std::endl;
-      C.indent() << "__dimArr[0] = " << ET->getSize() << ";" << std::endl;
       C.indent() << "setVar("RS_EXPORT_VAR_INDEX_PREFIX << VarName << ", "
                  << FieldPackerName << ", " RS_ELEM_PREFIX
-                 << ET->getElementName() << ", __dimArr);" << std::endl;
+                 << ET->getElementName() << ", " RS_EXPORT_VAR_DIM_PREFIX
+                 << VarName << ");" << std::endl;
     }
 
     C.endFunction();
@@ -1157,17 +1255,180 @@ void RSReflection::genGetFieldID(Context &C, const std::string &VarName) {
   }
 }
 
+void RSReflection::genExportBatch(Context &C) {
+  // The batch update helper is exported after all the user functions (see
+  // RSBackend::HandleTranslationUnitPost()).
+  C.indent() << "private final static int "RS_EXPORT_BATCH_FUNC_INDEX" = "
+             << C.getNextExportFuncSlot() << ";" << std::endl;
+  C.out() << std::endl;
+
+  C.indent() << "/**" << std::endl;
+  C.indent() << " * Collects new values for several exported variables and "
+                "applies them" << std::endl;
+  C.indent() << " * to the script in a single transaction. Values are packed "
+                "when set_*()" << std::endl;
+  C.indent() << " * is called; apply() sends only those set since the last "
+                "apply()." << std::endl;
+  C.indent() << " */" << std::endl;
+  C.indent() << "public class "RS_EXPORT_BATCH_CLASS_NAME;
+  C.startBlock();
+
+  C.indent() << "private FieldPacker "RS_EXPORT_BATCH_PACKET_NAME" = "
+                "new FieldPacker(" << mRSContext->getBatchPacketSize() << ");"
+             << std::endl;
+  for (size_t i = 0; i < mRSContext->getNumBatchMaskWords(); i++)
+    C.indent() << "private int "RS_EXPORT_BATCH_DIRTY_PREFIX << i << ";"
+               << std::endl;
+  for (RSContext::const_batch_var_iterator I = mRSContext->batch_vars_begin(),
+           E = mRSContext->batch_vars_end();
+       I != E;
+       I++) {
+    const RSExportVar *EV = I->first;
+    genPrivateExportVariable(C, GetTypeName(EV->getType()), EV->getName());
+  }
+
+  // set_*()
+  size_t Index = 0;
+  for (RSContext::const_batch_var_iterator I = mRSContext->batch_vars_begin(),
+           E = mRSContext->batch_vars_end();
+       I != E;
+       I++, Index++) {
+    const RSExportVar *EV = I->first;
+    const RSExportType *ET = EV->getType();
+
+    C.startFunction(Context::AM_Public,
+                    false,
+                    RS_EXPORT_BATCH_CLASS_NAME,
+                    "set_" + EV->getName(),
+                    1,
+                    GetTypeName(ET).c_str(), "v");
+    C.indent() << RS_EXPORT_VAR_PREFIX << EV->getName() << " = v;"
+               << std::endl;
+    C.indent() << RS_EXPORT_BATCH_PACKET_NAME".reset(" << I->second << ");"
+               << std::endl;
+    genPackVarOfType(C, ET, "v", RS_EXPORT_BATCH_PACKET_NAME);
+    C.indent() << RS_EXPORT_BATCH_DIRTY_PREFIX << (Index / 32) << " |= (1 << "
+               << (Index % 32) << ");" << std::endl;
+    C.indent() << "return this;" << std::endl;
+    C.endFunction();
+  }
+
+  // apply()
+  C.startFunction(Context::AM_Public, false, "void", "apply", 0);
+  C.indent() << "if (";
+  for (size_t i = 0; i < mRSContext->getNumBatchMaskWords(); i++) {
+    if (i != 0)
+      C.out() << " | ";
+    C.out() << RS_EXPORT_BATCH_DIRTY_PREFIX << i;
+  }
+  C.out() << ") == 0) {" << std::endl;
+  C.incIndentLevel();
+  C.indent() << "return;" << std::endl;
+  C.decIndentLevel();
+  C.indent() << "}" << std::endl;
+
+  // Hold the script lock so that set_*() on the script itself cannot
+  // interleave with the transaction.
+  C.indent() << "synchronized (" << C.getClassName() << ".this)";
+  C.startBlock();
+  C.indent() << RS_EXPORT_BATCH_PACKET_NAME".reset();" << std::endl;
+  for (size_t i = 0; i < mRSContext->getNumBatchMaskWords(); i++)
+    C.indent() << RS_EXPORT_BATCH_PACKET_NAME".addI32("
+                  RS_EXPORT_BATCH_DIRTY_PREFIX << i << ");" << std::endl;
+  C.indent() << "invoke("RS_EXPORT_BATCH_FUNC_INDEX", "
+                RS_EXPORT_BATCH_PACKET_NAME");" << std::endl;
+
+  Index = 0;
+  for (RSContext::const_batch_var_iterator I = mRSContext->batch_vars_begin(),
+           E = mRSContext->batch_vars_end();
+       I != E;
+       I++, Index++) {
+    const std::string &VarName = I->first->getName();
+    C.indent() << "if ((" RS_EXPORT_BATCH_DIRTY_PREFIX << (Index / 32)
+               << " & (1 << " << (Index % 32) << ")) != 0) {" << std::endl;
+    C.incIndentLevel();
+    C.indent() << C.getClassName() << ".this."RS_EXPORT_VAR_PREFIX << VarName
+               << " = "RS_EXPORT_VAR_PREFIX << VarName << ";" << std::endl;
+    C.decIndentLevel();
+    C.indent() << "}" << std::endl;
+  }
+  C.endBlock();
+
+  for (size_t i = 0; i < mRSContext->getNumBatchMaskWords(); i++)
+    C.indent() << RS_EXPORT_BATCH_DIRTY_PREFIX << i << " = 0;" << std::endl;
+  C.endFunction();
+
+  // end Batch class
+  C.endBlock();
+
+  C.startFunction(Context::AM_Public,
+                  false,
+                  RS_EXPORT_BATCH_CLASS_NAME,
+                  "createBatch",
+                  0);
+  C.indent() << "return new "RS_EXPORT_BATCH_CLASS_NAME"();" << std::endl;
+  C.endFunction();
+  return;
+}
+
 /******************* Methods to generate script class /end *******************/
 
-bool RSReflection::genCreateFieldPacker(Context &C,
-                                        const RSExportType *ET,
-                                        const char *FieldPackerName) {
-  size_t AllocSize = RSExportType::GetTypeAllocSize(ET);
-  if (AllocSize > 0)
-    C.indent() << "FieldPacker " << FieldPackerName << " = new FieldPacker("
-               << AllocSize << ");" << std::endl;
+void RSReflection::genReusableFieldPackerDecl(Context &C,
+                                              const RSExportType *ET,
+                                              const std::string &CacheName,
+                                              bool ThreadLocal) {
+  if (RSExportType::GetTypeAllocSize(ET) == 0)
+    return;
+
+  if (ThreadLocal)
+    C.indent() << "private final ThreadLocal<FieldPacker> " << CacheName
+               << " = new ThreadLocal<FieldPacker>();" << std::endl;
   else
+    C.indent() << "private FieldPacker " << CacheName << ";" << std::endl;
+  return;
+}
+
+bool RSReflection::genReuseFieldPacker(Context &C,
+                                       const RSExportType *ET,
+                                       const char *FieldPackerName,
+                                       const std::string &CacheName,
+                                       bool ThreadLocal) {
+  size_t AllocSize = RSExportType::GetTypeAllocSize(ET);
+  if (AllocSize == 0)
     return false;
+
+  // The runtime copies the packed data out of the FieldPacker before
+  // setVar()/invoke()/forEach() returns, so the packer may be reset and
+  // refilled on the next call instead of being allocated again.
+  if (ThreadLocal) {
+    C.indent() << "FieldPacker " << FieldPackerName << " = " << CacheName
+               << ".get();" << std::endl;
+    C.indent() << "if (" << FieldPackerName << " != null) {" << std::endl;
+    C.incIndentLevel();
+    C.indent() << FieldPackerName << ".reset();" << std::endl;
+    C.decIndentLevel();
+    C.indent() << "} else {" << std::endl;
+    C.incIndentLevel();
+    C.indent() << FieldPackerName << " = new FieldPacker(" << AllocSize
+               << ");" << std::endl;
+    C.indent() << CacheName << ".set(" << FieldPackerName << ");"
+               << std::endl;
+    C.decIndentLevel();
+    C.indent() << "}" << std::endl;
+  } else {
+    C.indent() << "if (" << CacheName << " != null) {" << std::endl;
+    C.incIndentLevel();
+    C.indent() << CacheName << ".reset();" << std::endl;
+    C.decIndentLevel();
+    C.indent() << "} else {" << std::endl;
+    C.incIndentLevel();
+    C.indent() << CacheName << " = new FieldPacker(" << AllocSize << ");"
+               << std::endl;
+    C.decIndentLevel();
+    C.indent() << "}" << std::endl;
+    C.indent() << "FieldPacker " << FieldPackerName << " = " << CacheName
+               << ";" << std::endl;
+  }
   return true;
 }
 
@@ -1392,11 +1653,22 @@ bool RSReflection::genTypeClass(Context &C,
   genTypeClassConstructor(C, ERT);
   genTypeClassCopyToArrayLocal(C, ERT);
   genTypeClassCopyToArray(C, ERT);
-  genTypeClassItemSetter(C, ERT);
-  genTypeClassItemGetter(C, ERT);
-  genTypeClassComponentSetter(C, ERT);
-  genTypeClassComponentGetter(C, ERT);
+  genTypeClassItemSetter(C, ERT, /* Synchronized = */true);
+  genTypeClassItemGetter(C, ERT, /* Synchronized = */true);
+  genTypeClassComponentSetter(C, ERT, /* Synchronized = */true);
+  genTypeClassComponentGetter(C, ERT, /* Synchronized = */true);
+  if (mRSContext->getReflectUnsynchronized()) {
+    // #pragma rs reflect_unsynchronized: also reflect accessors that do not
+    // take the monitor of this ScriptField_*, for single-threaded callers.
+    genTypeClassItemSetter(C, ERT, /* Synchronized = */false);
+    genTypeClassItemGetter(C, ERT, /* Synchronized = */false);
+    genTypeClassComponentSetter(C, ERT, /* Synchronized = */false);
+    genTypeClassComponentGetter(C, ERT, /* Synchronized = */false);
+  }
   genTypeClassCopyAll(C, ERT);
+  if (IsBulkCopyableRecord(ERT)) {
+    genTypeClassBulkCopy(C, ERT);
+  }
   if (!mRSContext->isCompatLib()) {
     // Skip the resize method if we are targeting a compatibility library.
     genTypeClassResize(C);
@@ -1665,11 +1937,14 @@ void RSReflection::genTypeClassCopyToArrayLocal(Context &C,
 }
 
 void RSReflection::genTypeClassItemSetter(Context &C,
-                                          const RSExportRecordType *ERT) {
-  C.startFunction(Context::AM_PublicSynchronized,
+                                          const RSExportRecordType *ERT,
+                                          bool Synchronized) {
+  genAccessorThreadSafetyNote(C, Synchronized);
+  C.startFunction(Synchronized ? Context::AM_PublicSynchronized
+                               : Context::AM_Public,
                   false,
                   "void",
-                  "set",
+                  Synchronized ? "set" : RS_TYPE_UNSYNC_ACCESSOR_PREFIX "Set",
                   3,
                   RS_TYPE_ITEM_CLASS_NAME, "i",
                   "int", "index",
@@ -1694,11 +1969,14 @@ void RSReflection::genTypeClassItemSetter(Context &C,
 }
 
 void RSReflection::genTypeClassItemGetter(Context &C,
-                                          const RSExportRecordType *ERT) {
-  C.startFunction(Context::AM_PublicSynchronized,
+                                          const RSExportRecordType *ERT,
+                                          bool Synchronized) {
+  genAccessorThreadSafetyNote(C, Synchronized);
+  C.startFunction(Synchronized ? Context::AM_PublicSynchronized
+                               : Context::AM_Public,
                   false,
                   RS_TYPE_ITEM_CLASS_NAME,
-                  "get",
+                  Synchronized ? "get" : RS_TYPE_UNSYNC_ACCESSOR_PREFIX "Get",
                   1,
                   "int", "index");
   C.indent() << "if ("RS_TYPE_ITEM_BUFFER_NAME" == null) return null;"
@@ -1709,7 +1987,10 @@ void RSReflection::genTypeClassItemGetter(Context &C,
 }
 
 void RSReflection::genTypeClassComponentSetter(Context &C,
-                                               const RSExportRecordType *ERT) {
+                                               const RSExportRecordType *ERT,
+                                               bool Synchronized) {
+  const char *Prefix = Synchronized ? "set_"
+                                    : RS_TYPE_UNSYNC_ACCESSOR_PREFIX "Set_";
   for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
            FE = ERT->fields_end();
        FI != FE;
@@ -1719,10 +2000,12 @@ void RSReflection::genTypeClassComponentSetter(Context &C,
     size_t FieldStoreSize = RSExportType::GetTypeStoreSize(F->getType());
     unsigned FieldIndex = C.getFieldIndex(F);
 
-    C.startFunction(Context::AM_PublicSynchronized,
+    genAccessorThreadSafetyNote(C, Synchronized);
+    C.startFunction(Synchronized ? Context::AM_PublicSynchronized
+                                 : Context::AM_Public,
                     false,
                     "void",
-                    "set_" + F->getName(), 3,
+                    Prefix + F->getName(), 3,
                     "int", "index",
                     GetTypeName(F->getType()).c_str(), "v",
                     "boolean", "copyNow");
@@ -1760,16 +2043,21 @@ void RSReflection::genTypeClassComponentSetter(Context &C,
 }
 
 void RSReflection::genTypeClassComponentGetter(Context &C,
-                                               const RSExportRecordType *ERT) {
+                                               const RSExportRecordType *ERT,
+                                               bool Synchronized) {
+  const char *Prefix = Synchronized ? "get_"
+                                    : RS_TYPE_UNSYNC_ACCESSOR_PREFIX "Get_";
   for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
            FE = ERT->fields_end();
        FI != FE;
        FI++) {
     const RSExportRecordType::Field *F = *FI;
-    C.startFunction(Context::AM_PublicSynchronized,
+    genAccessorThreadSafetyNote(C, Synchronized);
+    C.startFunction(Synchronized ? Context::AM_PublicSynchronized
+                                 : Context::AM_Public,
                     false,
                     GetTypeName(F->getType()).c_str(),
-                    "get_" + F->getName(),
+                    Prefix + F->getName(),
                     1,
                     "int", "index");
     C.indent() << "if ("RS_TYPE_ITEM_BUFFER_NAME" == null) return "
@@ -1781,13 +2069,41 @@ void RSReflection::genTypeClassComponentGetter(Context &C,
   return;
 }
 
+// Document the thread-safety contract of an element accessor. This is only
+// needed when both the synchronized and the unsynchronized variants are
+// reflected; otherwise every accessor is synchronized and nothing is emitted.
+void RSReflection::genAccessorThreadSafetyNote(Context &C, bool Synchronized) {
+  if (!mRSContext->getReflectUnsynchronized())
+    return;
+
+  C.indent() << "/**" << std::endl;
+  if (Synchronized) {
+    C.indent() << " * Thread-safe: holds the monitor of this "
+               << C.getClassName() << " for the whole call." << std::endl;
+  } else {
+    C.indent() << " * NOT thread-safe: does not take the monitor of this "
+               << C.getClassName() << "." << std::endl;
+    C.indent() << " * The caller must ensure that no other thread accesses "
+                  "this object" << std::endl;
+    C.indent() << " * (through either accessor variant) concurrently."
+               << std::endl;
+  }
+  C.indent() << " */" << std::endl;
+  return;
+}
+
 void RSReflection::genTypeClassCopyAll(Context &C,
                                        const RSExportRecordType *ERT) {
   C.startFunction(Context::AM_PublicSynchronized, false, "void", "copyAll", 0);
 
+  // Elements that were never set have no Item; leave their bytes in the item
+  // buffer packer as they are.
   C.indent() << "for (int ct = 0; ct < "RS_TYPE_ITEM_BUFFER_NAME".length; ct++)"
-                  " copyToArray("RS_TYPE_ITEM_BUFFER_NAME"[ct], ct);"
              << std::endl;
+  C.incIndentLevel();
+  C.indent() << "if ("RS_TYPE_ITEM_BUFFER_NAME"[ct] != null) "
+                "copyToArray("RS_TYPE_ITEM_BUFFER_NAME"[ct], ct);" << std::endl;
+  C.decIndentLevel();
   C.indent() << "mAllocation.setFromFieldPacker(0, "
                   RS_TYPE_ITEM_BUFFER_PACKER_NAME");"
              << std::endl;
@@ -1796,6 +2112,174 @@ void RSReflection::genTypeClassCopyAll(Context &C,
   return;
 }
 
+void RSReflection::genTypeClassBulkCopy(Context &C,
+                                        const RSExportRecordType *ERT) {
+  // Java type of the bulk array -> FieldPacker view of it
+  static const char *BulkTypes[][2] = {
+    { "float[]", ".asFloatBuffer()" },
+    { "int[]", ".asIntBuffer()" },
+    { "byte[]", "" },
+  };
+  std::string Words =
+      "count * " + llvm::utostr_32(RSExportType::GetTypeAllocSize(ERT) / 4);
+
+  // Little-endian view of the elements [offset, offset + count) in the item
+  // buffer packer, which mirrors what was copied to the allocation.
+  C.startFunction(Context::AM_Private,
+                  false,
+                  "java.nio.ByteBuffer",
+                  "getItemBufferRange",
+                  2,
+                  "int", "offset",
+                  "int", "count");
+  genNewItemBufferPackerIfNull(C);
+  C.indent() << "java.nio.ByteBuffer b = java.nio.ByteBuffer.wrap("
+                RS_TYPE_ITEM_BUFFER_PACKER_NAME".getData(), offset * "
+                RS_TYPE_ITEM_CLASS_NAME".sizeof, count * "
+                RS_TYPE_ITEM_CLASS_NAME".sizeof);" << std::endl;
+  C.indent() << "return b.slice().order(java.nio.ByteOrder.LITTLE_ENDIAN);"
+             << std::endl;
+  C.endFunction();
+
+  // Refresh the Items of the elements [offset, offset + count) from the item
+  // buffer packer, so that get(), get_*(), set_*() and copyAll() see what
+  // copyFrom() wrote.
+  C.startFunction(Context::AM_Private,
+                  false,
+                  "void",
+                  "unpackItems",
+                  2,
+                  "int", "offset",
+                  "int", "count");
+  genNewItemBufferIfNull(C, NULL);
+  C.indent() << "java.nio.ByteBuffer b = getItemBufferRange(offset, count);"
+             << std::endl;
+  C.indent() << "for (int ct = 0; ct < count; ct++) ";
+  C.startBlock();
+  genNewItemBufferIfNull(C, "offset + ct");
+  C.indent() << RS_TYPE_ITEM_CLASS_NAME" i = "RS_TYPE_ITEM_BUFFER_NAME
+                "[offset + ct];" << std::endl;
+  C.indent() << "int base = ct * "RS_TYPE_ITEM_CLASS_NAME".sizeof;"
+             << std::endl;
+  for (RSExportRecordType::const_field_iterator FI = ERT->fields_begin(),
+           FE = ERT->fields_end();
+       FI != FE;
+       FI++) {
+    const RSExportRecordType::Field *F = *FI;
+    const RSExportType *FT = F->getType();
+    const RSExportPrimitiveType *EPT =
+        static_cast<const RSExportPrimitiveType*>(FT);
+    size_t FieldOffset = F->getOffsetInParent();
+
+    // A scalar is read as a vector of one element without an accessor.
+    unsigned NumElements = 1;
+    if (FT->getClass() == RSExportType::ExportClassVector)
+      NumElements = static_cast<const RSExportVectorType*>(FT)->getNumElement();
+
+    for (unsigned i = 0; i < NumElements; i++) {
+      size_t ByteOffset = FieldOffset + i * 4;
+      std::string Pos = "base";
+      if (ByteOffset > 0)
+        Pos += " + " + llvm::utostr_32(ByteOffset);
+
+      C.indent() << "i." << F->getName();
+      if (FT->getClass() == RSExportType::ExportClassVector)
+        C.out() << "." << GetVectorAccessor(i);
+      C.out() << " = " << GetBulkReadExpr(EPT, "b", Pos) << ";" << std::endl;
+    }
+  }
+  C.endBlock();
+  C.endFunction();
+
+  for (size_t i = 0; i < sizeof(BulkTypes) / sizeof(BulkTypes[0]); i++) {
+    const char *ArrayType = BulkTypes[i][0];
+    const char *View = BulkTypes[i][1];
+    std::string Length = (*View == '\0') ? "count * "RS_TYPE_ITEM_CLASS_NAME
+                                            ".sizeof" : Words;
+
+    C.indent() << "/**" << std::endl;
+    C.indent() << " * Copy count elements from d, laid out as in the "
+                  "allocation (padding" << std::endl;
+    C.indent() << " * included), to the allocation starting at element "
+                  "offset in a single" << std::endl;
+    C.indent() << " * call. The Items of these elements are then updated "
+                  "from d, so get()," << std::endl;
+    C.indent() << " * get_*() and copyAll() see the copied values."
+               << std::endl;
+    C.indent() << " */" << std::endl;
+    C.startFunction(Context::AM_PublicSynchronized,
+                    false,
+                    "void",
+                    "copyFrom",
+                    3,
+                    ArrayType, "d",
+                    "int", "offset",
+                    "int", "count");
+    C.indent() << "mAllocation.copy1DRangeFromUnchecked(offset, count, d);"
+               << std::endl;
+    C.indent() << "getItemBufferRange(offset, count)" << View << ".put(d, 0, "
+               << Length << ");" << std::endl;
+    C.indent() << "unpackItems(offset, count);" << std::endl;
+    C.endFunction();
+
+    // There is no typed readback of user-defined Elements in the Allocation
+    // API, so read back the copy kept in the item buffer packer.
+    C.indent() << "/**" << std::endl;
+    C.indent() << " * Copy count elements, starting at element offset, to d "
+                  "without creating" << std::endl;
+    C.indent() << " * Item objects. This returns the values last copied to "
+                  "the allocation" << std::endl;
+    C.indent() << " * through this object, not values written by a script."
+               << std::endl;
+    C.indent() << " */" << std::endl;
+    C.startFunction(Context::AM_PublicSynchronized,
+                    false,
+                    "void",
+                    "copyTo",
+                    3,
+                    ArrayType, "d",
+                    "int", "offset",
+                    "int", "count");
+    C.indent() << "getItemBufferRange(offset, count)" << View << ".get(d, 0, "
+               << Length << ");" << std::endl;
+    C.endFunction();
+  }
+
+  // ByteBuffer variants
+  C.indent() << "private byte[] "RS_TYPE_COPY_BUFFER_NAME";" << std::endl;
+  C.startFunction(Context::AM_PublicSynchronized,
+                  false,
+                  "void",
+                  "copyFrom",
+                  3,
+                  "java.nio.ByteBuffer", "src",
+                  "int", "offset",
+                  "int", "count");
+  // Stage the bytes in a scratch array that is kept across calls, so the
+  // copy does not allocate unless it is larger than any previous one.
+  C.indent() << "int size = count * "RS_TYPE_ITEM_CLASS_NAME".sizeof;"
+             << std::endl;
+  C.indent() << "if ("RS_TYPE_COPY_BUFFER_NAME" == null || "
+                RS_TYPE_COPY_BUFFER_NAME".length < size) "
+                RS_TYPE_COPY_BUFFER_NAME" = new byte[size];" << std::endl;
+  C.indent() << "src.get("RS_TYPE_COPY_BUFFER_NAME", 0, size);" << std::endl;
+  C.indent() << "copyFrom("RS_TYPE_COPY_BUFFER_NAME", offset, count);"
+             << std::endl;
+  C.endFunction();
+
+  C.startFunction(Context::AM_PublicSynchronized,
+                  false,
+                  "void",
+                  "copyTo",
+                  3,
+                  "java.nio.ByteBuffer", "dst",
+                  "int", "offset",
+                  "int", "count");
+  C.indent() << "dst.put(getItemBufferRange(offset, count));" << std::endl;
+  C.endFunction();
+  return;
+}
+
 void RSReflection::genTypeClassResize(Context &C) {
   C.startFunction(Context::AM_PublicSynchronized,
                   false,
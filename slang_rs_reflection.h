@@ -268,6 +268,8 @@ class RSReflection {
   void genExportForEach(Context &C,
                         const RSExportForEach *EF);
 
+  void genExportBatch(Context &C);
+
   static void genTypeCheck(Context &C,
                            const RSExportType *ET,
                            const char *VarName);
@@ -288,11 +290,17 @@ class RSReflection {
   void genTypeClassConstructor(Context &C, const RSExportRecordType *ERT);
   void genTypeClassCopyToArray(Context &C, const RSExportRecordType *ERT);
   void genTypeClassCopyToArrayLocal(Context &C, const RSExportRecordType *ERT);
-  void genTypeClassItemSetter(Context &C, const RSExportRecordType *ERT);
-  void genTypeClassItemGetter(Context &C, const RSExportRecordType *ERT);
-  void genTypeClassComponentSetter(Context &C, const RSExportRecordType *ERT);
-  void genTypeClassComponentGetter(Context &C, const RSExportRecordType *ERT);
+  void genTypeClassItemSetter(Context &C, const RSExportRecordType *ERT,
+                              bool Synchronized);
+  void genTypeClassItemGetter(Context &C, const RSExportRecordType *ERT,
+                              bool Synchronized);
+  void genTypeClassComponentSetter(Context &C, const RSExportRecordType *ERT,
+                                   bool Synchronized);
+  void genTypeClassComponentGetter(Context &C, const RSExportRecordType *ERT,
+                                   bool Synchronized);
+  void genAccessorThreadSafetyNote(Context &C, bool Synchronized);
   void genTypeClassCopyAll(Context &C, const RSExportRecordType *ERT);
+  void genTypeClassBulkCopy(Context &C, const RSExportRecordType *ERT);
   void genTypeClassResize(Context &C);
 
   void genBuildElement(Context &C,
@@ -311,9 +319,19 @@ class RSReflection {
                                     const char *ElementBuilderName,
                                     const char *RenderScriptVar);
 
-  bool genCreateFieldPacker(Context &C,
-                            const RSExportType *T,
-                            const char *FieldPackerName);
+  // Each set_*(), invoke_*() and forEach_*() reuses one cached FieldPacker
+  // member. The synchronized set_*() methods cache it in a plain field; the
+  // unsynchronized invoke_*() and forEach_*() keep it in a ThreadLocal so
+  // that concurrent callers never share a packer.
+  void genReusableFieldPackerDecl(Context &C,
+                                  const RSExportType *T,
+                                  const std::string &CacheName,
+                                  bool ThreadLocal);
+  bool genReuseFieldPacker(Context &C,
+                           const RSExportType *T,
+                           const char *FieldPackerName,
+                           const std::string &CacheName,
+                           bool ThreadLocal);
   void genPackVarOfType(Context &C,
                         const RSExportType *T,
                         const char *VarName,
@@ -26,6 +26,9 @@
 #include <string>
 #include <utility>
 
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+
 #include "os_sep.h"
 #include "slang_rs_context.h"
 #include "slang_rs_export_var.h"
@@ -108,8 +111,11 @@ static std::string GetTypeName(const RSExportType *ET, bool Brackets = true) {
 }
 
 
-RSReflectionCpp::RSReflectionCpp(const RSContext *con)
-    : RSReflectionBase(con) {
+RSReflectionCpp::RSReflectionCpp(
+    const RSContext *con,
+    BitCodeCppEmbedding BCEmbedding,
+    const std::vector<std::pair<std::string, std::string> > *BundledBC)
+    : RSReflectionBase(con), mBCEmbedding(BCEmbedding), mBundledBC(BundledBC) {
   clear();
 }
 
@@ -184,6 +190,14 @@ bool RSReflectionCpp::makeHeader(const std::string &baseClass) {
           " const char *cacheDir, size_t cacheDirLength);");
   write("virtual ~" + mClassName + "();");
   write("");
+  if (mBundledBC != NULL) {
+    write("// Bitcode compiled for the given ABI (the default bitcode if the "
+          "ABI");
+    write("// was not bundled).");
+    write("static const unsigned char *getBitCode(const char *abi, "
+          "size_t *length);");
+    write("");
+  }
 
 
   // Reflect export variable
@@ -248,38 +262,150 @@ bool RSReflectionCpp::makeHeader(const std::string &baseClass) {
   return true;
 }
 
+// Suffix of the names of the bitcode compiled for the bundled ABI @ABI. The
+// driver only accepts ABI names that are valid in identifiers (see
+// RSSlangReflectUtils::IsValidABIName()).
+static std::string GetABISuffix(const std::string &ABI) {
+  return "_" + ABI;
+}
+
 bool RSReflectionCpp::writeBC() {
-  FILE *pfin = fopen(mOutputBCFileName.c_str(), "rb");
+  if (mBCEmbedding == BCCE_INCBIN)
+    return writeBCIncbin();
+
+  if (!writeBCArray(mOutputBCFileName, "__txt"))
+    return false;
+
+  if (mBundledBC != NULL) {
+    for (size_t i = 0; i < mBundledBC->size(); i++) {
+      if (!writeBCArray((*mBundledBC)[i].second,
+                        "__txt" + GetABISuffix((*mBundledBC)[i].first)))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool RSReflectionCpp::writeBCArray(const std::string &BCFileName,
+                                   const std::string &VarName) {
+  FILE *pfin = fopen(BCFileName.c_str(), "rb");
   if (pfin == NULL) {
-    fprintf(stderr, "Error: could not read file %s\n",
-            mOutputBCFileName.c_str());
+    fprintf(stderr, "Error: could not read file %s\n", BCFileName.c_str());
     return false;
   }
 
+  static const char HexDigits[] = "0123456789abcdef";
   unsigned char buf[16];
   int read_length;
-  write("static const unsigned char __txt[] = {");
+  write("static const unsigned char " + VarName + "[] = {");
   incIndent();
   while ((read_length = fread(buf, 1, sizeof(buf), pfin)) > 0) {
-    string s;
+    // "0xNN," per byte
+    char line[sizeof(buf) * 5];
+    char *p = line;
     for (int i = 0; i < read_length; i++) {
-      char buf2[16];
-      snprintf(buf2, sizeof(buf2), "0x%02x,", buf[i]);
-      s += buf2;
+      *p++ = '0';
+      *p++ = 'x';
+      *p++ = HexDigits[buf[i] >> 4];
+      *p++ = HexDigits[buf[i] & 0xf];
+      *p++ = ',';
     }
-    write(s);
+    write(string(line, p - line));
   }
   decIndent();
   write("};");
+  write("static const size_t " + VarName + "_len = sizeof(" + VarName + ");");
   write("");
+  fclose(pfin);
   return true;
 }
 
+// Leave the bitcode to the assembler: ScriptC_*_bc.S includes the .bc file
+// verbatim, so the size of the reflected sources does not depend on the size
+// of the script. The symbols follow the slangdata.py convention (<name> for
+// the data and <name>_size for its length).
+bool RSReflectionCpp::writeBCIncbin() {
+  string FileBaseName = mClassName + "_bc";
+
+  // <symbol suffix, bitcode file>
+  std::vector<std::pair<std::string, std::string> > Blobs;
+  Blobs.push_back(std::make_pair("", mOutputBCFileName));
+  if (mBundledBC != NULL) {
+    for (size_t i = 0; i < mBundledBC->size(); i++) {
+      Blobs.push_back(std::make_pair(GetABISuffix((*mBundledBC)[i].first),
+                                     (*mBundledBC)[i].second));
+    }
+  }
+
+  std::vector< std::string > Asm;
+  std::vector< std::string > Header;
+  Asm.push_back("/* This file is auto-generated. DO NOT MODIFY! */");
+  Header.push_back("/* This file is auto-generated. DO NOT MODIFY! */");
+  Header.push_back("#include <stddef.h>");
+  Header.push_back("");
+
+  for (size_t b = 0; b < Blobs.size(); b++) {
+    string SymbolName = mClassName + "_bitcode" + Blobs[b].first;
+    // The assembler resolves a relative .incbin path against its working
+    // directory, not against the .S file, so always give it an absolute one.
+    llvm::SmallString<256> BCFileName(Blobs[b].second);
+    llvm::sys::fs::make_absolute(BCFileName);
+
+    string IncbinPath;
+    for (size_t i = 0; i < BCFileName.size(); i++) {
+      if ((BCFileName[i] == '"') || (BCFileName[i] == '\\'))
+        IncbinPath += '\\';
+      IncbinPath += BCFileName[i];
+    }
+
+    Asm.push_back("#ifdef __APPLE_CC__");
+    Asm.push_back(".globl _" + SymbolName);
+    Asm.push_back(".globl _" + SymbolName + "_size");
+    Asm.push_back("  .section .rodata,");
+    Asm.push_back("  .align 8");
+    Asm.push_back("_" + SymbolName + ":");
+    Asm.push_back("#else");
+    Asm.push_back(".globl " + SymbolName);
+    Asm.push_back(".globl " + SymbolName + "_size");
+    Asm.push_back("  .section .rodata");
+    Asm.push_back("  .align 8");
+    Asm.push_back(SymbolName + ":");
+    Asm.push_back("#endif");
+    Asm.push_back("0:");
+    Asm.push_back("  .incbin \"" + IncbinPath + "\"");
+    Asm.push_back("1:");
+    Asm.push_back("  .align 4");
+    Asm.push_back("#ifdef __APPLE_CC__");
+    Asm.push_back("_" + SymbolName + "_size:");
+    Asm.push_back("#else");
+    Asm.push_back(SymbolName + "_size:");
+    Asm.push_back("#endif");
+    Asm.push_back("  .long 1b - 0b");
+
+    Header.push_back("extern \"C\" const unsigned char " + SymbolName + "[];");
+    Header.push_back("extern \"C\" const unsigned int " + SymbolName +
+                     "_size;");
+
+    if (b == 0)
+      write("#include \"" + FileBaseName + ".h\"");
+    write("static const unsigned char *const __txt" + Blobs[b].first + " = " +
+          SymbolName + ";");
+    write("static const size_t __txt" + Blobs[b].first + "_len = " +
+          SymbolName + "_size;");
+  }
+  write("");
+
+  return writeFile(FileBaseName + ".S", Asm) &&
+         writeFile(FileBaseName + ".h", Header);
+}
+
 bool RSReflectionCpp::makeImpl(const std::string &baseClass) {
   startFile(mClassName + ".cpp");
 
   write("");
   write("#include \"" + mClassName + ".h\"");
+  if (mBundledBC != NULL)
+    write("#include <string.h>");
   write("");
 
   writeBC();
@@ -294,7 +420,7 @@ bool RSReflectionCpp::makeImpl(const std::string &baseClass) {
   ss << mClassName << "::" << mClassName
      << "(android::sp<android::RSC::RS> rs, const char *cacheDir, "
         "size_t cacheDirLength) :\n"
-        "        ScriptC(rs, __txt, sizeof(__txt), \""
+        "        ScriptC(rs, __txt, __txt_len, \""
      << mClassName << "\", " << mClassName.length()
      << ", cacheDir, cacheDirLength) {";
   write(ss);
@@ -308,6 +434,26 @@ bool RSReflectionCpp::makeImpl(const std::string &baseClass) {
   write("}");
   write("");
 
+  if (mBundledBC != NULL) {
+    write("const unsigned char *" + mClassName +
+          "::getBitCode(const char *abi, size_t *length) {");
+    incIndent();
+    for (size_t i = 0; i < mBundledBC->size(); i++) {
+      const string &ABI = (*mBundledBC)[i].first;
+      write("if (!strcmp(abi, \"" + ABI + "\")) {");
+      incIndent();
+      write("*length = __txt" + GetABISuffix(ABI) + "_len;");
+      write("return __txt" + GetABISuffix(ABI) + ";");
+      decIndent();
+      write("}");
+    }
+    write("*length = __txt_len;");
+    write("return __txt;");
+    decIndent();
+    write("}");
+    write("");
+  }
+
   // Reflect export for each functions
   uint32_t slot = 0;
   for (RSContext::const_export_foreach_iterator
@@ -17,13 +17,20 @@
 #ifndef _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_REFLECTION_CPP_H_  // NOLINT
 #define _FRAMEWORKS_COMPILE_SLANG_SLANG_RS_REFLECTION_CPP_H_
 
+#include "slang_rs_reflect_utils.h"
 #include "slang_rs_reflection_base.h"
 
 namespace slang {
 
 class RSReflectionCpp : public RSReflectionBase {
  public:
-  explicit RSReflectionCpp(const RSContext *);
+  // @BundledBC lists <ABI name, bitcode file> of the bitcode compiled for
+  // other ABIs, which getBitCode(abi) returns. May be NULL.
+  explicit RSReflectionCpp(
+      const RSContext *,
+      BitCodeCppEmbedding BCEmbedding = BCCE_ARRAY,
+      const std::vector<std::pair<std::string, std::string> > *BundledBC =
+          NULL);
   virtual ~RSReflectionCpp();
 
   bool reflect(const std::string &OutputPathBase,
@@ -36,6 +43,9 @@ class RSReflectionCpp : public RSReflectionBase {
   unsigned int mNextExportFuncSlot;
   unsigned int mNextExportForEachSlot;
 
+  BitCodeCppEmbedding mBCEmbedding;
+  const std::vector<std::pair<std::string, std::string> > *mBundledBC;
+
   inline void clear() {
     mNextExportVarSlot = 0;
     mNextExportFuncSlot = 0;
@@ -59,6 +69,9 @@ class RSReflectionCpp : public RSReflectionBase {
   void makeFunctionSignature(std::stringstream &ss, bool isDefinition,
                              const RSExportFunc *ef);
   bool writeBC();
+  bool writeBCArray(const std::string &BCFileName,
+                    const std::string &VarName);
+  bool writeBCIncbin();
 
   bool startScriptHeader();
 
@@ -0,0 +1,5 @@
+// -bundle-abi arm_v7=armv7-none-linux-gnueabi -bundle-abi ARM_v7=armv7-none-linux-gnueabi
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// The bundled bitcode files of these two ABIs would only differ in case.
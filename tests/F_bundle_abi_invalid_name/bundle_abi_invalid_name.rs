@@ -0,0 +1,6 @@
+// -bundle-abi arm-v7=armv7-none-linux-gnueabi
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// '-' is not valid in a Java/C++ identifier, so the name is rejected rather
+// than mangled (which would make 'arm-v7' and 'armv7' the same ABI).
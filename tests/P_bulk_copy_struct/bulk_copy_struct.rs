@@ -0,0 +1,11 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Only 32-bit int/float fields: ScriptField_Sample gets copyFrom()/copyTo().
+typedef struct Sample {
+    float3 accel;
+    int timestamp;
+    uint flags;
+} Sample_t;
+
+Sample_t *samples;
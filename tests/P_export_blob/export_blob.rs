@@ -0,0 +1,28 @@
+// -emit-export-blob
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct point {
+  float x;
+  float y;
+  int id;
+} point_t;
+
+point_t gPoint;
+point_t *gPoints;
+rs_allocation gAlloc;
+rs_matrix4x4 gMatrix;
+float4 gColor;
+int gCount;
+
+void reset(int count) {
+  gCount = count;
+}
+
+void bump() {
+  gCount++;
+}
+
+float4 __attribute__((kernel)) tint(float4 in) {
+  return in * gColor;
+}
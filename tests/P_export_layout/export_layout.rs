@@ -0,0 +1,28 @@
+// -emit-export-layout
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Every field but the last is followed by padding.
+typedef struct particle {
+  char kind;
+  float3 pos;
+  short age;
+  float4 color;
+  double mass;
+  uchar2 flags;
+} particle_t;
+
+particle_t gParticle;
+// Sized from the padded record, like an array field would be.
+particle_t gParticles[4];
+float gWeights[8];
+particle_t *gParticleBuf;
+rs_allocation gAlloc;
+rs_matrix3x3 gMatrix;
+float3 gOffset;
+char gTag;
+long gSeed;
+
+void reset(long seed) {
+  gSeed = seed;
+}
@@ -0,0 +1,23 @@
+// -emit-function-index
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+int gScale = 2;
+float gTable[16];
+static int sCounter;
+
+static int scale(int v) {
+  sCounter++;
+  return v * gScale;
+}
+
+int __attribute__((kernel)) root(int ain) {
+  return scale(ain);
+}
+
+void __attribute__((kernel)) clear(int ain) {
+}
+
+void setScale(int s) {
+  gScale = s;
+}
@@ -0,0 +1,21 @@
+// -emit-object-slot-map
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Runs of RS objects between plain variables
+rs_allocation gIn;
+rs_allocation gOut;
+rs_allocation gTmp;
+int gWidth;
+int gHeight;
+rs_sampler gSampler;
+float gScale;
+rs_script gScript;
+rs_element gElem;
+rs_type gType;
+float4 gColor;
+
+void setup(int width, int height) {
+  gWidth = width;
+  gHeight = height;
+}
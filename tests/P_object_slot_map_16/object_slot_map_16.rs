@@ -0,0 +1,12 @@
+// -emit-object-slot-map -target-api 16
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+// Runtimes for API 16 only read the legacy #rs_object_slots.
+rs_allocation gIn;
+int gCount;
+rs_allocation gOut;
+
+void setCount(int count) {
+  gCount = count;
+}
@@ -0,0 +1,36 @@
+// -elide-redundant-refcount -report-refcount-elision
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation gIn;
+rs_allocation gOut;
+rs_sampler gSampler;
+
+static void bump() {
+}
+
+void root(const float4 *in, float4 *out, uint32_t x, uint32_t y) {
+    rs_allocation alloc = gIn;
+    *out = *in * (float)rsAllocationGetDimX(alloc);
+}
+
+void notBorrowed() {
+    rs_allocation alloc = gIn;
+    bump();
+    rsDebug("dim", (int)rsAllocationGetDimX(alloc));
+}
+
+void writes() {
+    rs_allocation alloc = gOut;
+    gOut = gIn;
+    rsDebug("dim", (int)rsAllocationGetDimX(alloc));
+}
+
+static bool hasSampler() {
+    rs_sampler s = gSampler;
+    return rsIsObject(s);
+}
+
+void check() {
+    rsDebug("sampler", hasSampler() ? 1 : 0);
+}
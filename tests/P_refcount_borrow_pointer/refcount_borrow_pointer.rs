@@ -0,0 +1,30 @@
+// -elide-redundant-refcount -report-refcount-elision
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation gIn;
+rs_allocation gOther;
+
+// p may be &gIn, so 'alloc' has to keep its own reference.
+static uint32_t clearThenRead(rs_allocation *p) {
+    rs_allocation alloc = gIn;
+    rsClearObject(p);
+    return rsAllocationGetDimX(alloc);
+}
+
+static uint32_t storeThenRead(rs_allocation *p, rs_allocation other) {
+    rs_allocation alloc = gIn;
+    *p = other;
+    return rsAllocationGetDimX(alloc);
+}
+
+static uint32_t readOnly() {
+    rs_allocation alloc = gIn;
+    return rsAllocationGetDimX(alloc);
+}
+
+void run() {
+    uint32_t dims = clearThenRead(&gIn) + storeThenRead(&gIn, gOther) +
+                    readOnly();
+    rsDebug("dims", (int)dims);
+}
@@ -0,0 +1,36 @@
+// -elide-redundant-refcount -report-refcount-elision
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation gAlloc;
+rs_allocation gOther;
+
+static uint32_t count(rs_allocation a) {
+    rs_allocation copy = a;
+    return rsAllocationGetDimX(copy);
+}
+
+static void unused() {
+    rs_allocation tmp = gAlloc;
+    tmp = gOther;
+}
+
+static uint32_t overwrite() {
+    rs_allocation a = gAlloc;
+    a = gOther;
+    a = gAlloc;
+    return rsAllocationGetDimX(a);
+}
+
+static rs_allocation escapes(rs_allocation p) {
+    rs_allocation mine = p;
+    rs_allocation copy = mine;
+    rs_allocation *ptr = &mine;
+    return copy;
+}
+
+uint32_t run() {
+    unused();
+    return count(gAlloc) + overwrite() +
+           rsAllocationGetDimX(escapes(gOther));
+}
@@ -0,0 +1,32 @@
+// -elide-redundant-refcount -report-refcount-elision
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+rs_allocation gAlloc;
+
+// 'a' has its address taken, so 'a = x' is read back through 'p' and must
+// not be removed as overwritten before any use.
+static uint32_t readThroughPointer(rs_allocation x) {
+    rs_allocation a;
+    rs_allocation *p = &a;
+    a = x;
+    a = *p;
+    return rsAllocationGetDimX(a);
+}
+
+static rs_allocation deref(rs_allocation *p) {
+    return *p;
+}
+
+// Same when the pointer is passed to a function that reads it.
+static uint32_t readByCall(rs_allocation x) {
+    rs_allocation a;
+    rs_allocation *p = &a;
+    a = x;
+    a = deref(p);
+    return rsAllocationGetDimX(a);
+}
+
+uint32_t run() {
+    return readThroughPointer(gAlloc) + readByCall(gAlloc);
+}
@@ -0,0 +1,16 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+#pragma rs reflect_batch
+
+typedef struct Light {
+    float3 position;
+    uchar4 color;
+} Light_t;
+
+float gain;
+int2 offset;
+rs_matrix4x4 transform;
+Light_t light;
+float weights[5];
+const int kMode = 1;
+rs_allocation output;
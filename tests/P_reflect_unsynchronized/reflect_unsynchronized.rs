@@ -0,0 +1,11 @@
+#pragma version(1)
+#pragma rs java_package_name(foo)
+#pragma rs reflect_unsynchronized
+
+typedef struct Point {
+    float2 position;
+    uchar4 color;
+    int id;
+} Point_t;
+
+Point_t *points;
@@ -0,0 +1,25 @@
+// -emit-spec-metadata
+#pragma version(1)
+#pragma rs java_package_name(foo)
+
+typedef struct node {
+  float4 pos;
+  int ids[4];
+  rs_matrix2x2 m;
+} node_t;
+
+node_t gNode;
+float gTable[16];
+node_t *gNodes;
+int *gInts;
+float *gFloats;
+float4 gColor;
+int gCount;
+
+void reset(int count) {
+  gCount = count;
+}
+
+void bump() {
+  gCount++;
+}
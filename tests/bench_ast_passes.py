@@ -0,0 +1,91 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renderscript Compiler AST Pass Benchmark.
+
+Generates scripts with thousands of statements in static functions and times
+llvm-rs-cc on each of them, once with the fused RSCheckAST/RSObjectRefCount
+walk and once with -separate-ast-passes, to show what the fused walk saves.
+"""
+
+import os
+import sys
+
+import bench_util
+
+__author__ = 'Android'
+
+
+def GenerateScript(path, size, statements_per_function):
+  """Writes a script with about size statements spread over static functions.
+
+  Every function declares and assigns RS objects, so that RSObjectRefCount
+  has work to do in each scope, and nests loops so that the walk is deep.
+  """
+  f = open(path, 'w')
+  f.write('#pragma version(1)\n'
+          '#pragma rs java_package_name(foo)\n\n'
+          'rs_allocation gAlloc;\n'
+          'int gTotal;\n\n')
+
+  functions = max(1, size / statements_per_function)
+  for i in xrange(functions):
+    f.write('static int helper%d(int x) {\n'
+            '  rs_allocation a = gAlloc;\n'
+            '  int sum = x;\n' % i)
+    for j in xrange(statements_per_function / 4):
+      f.write('  for (int k%d = 0; k%d < x; k%d++) {\n'
+              '    rs_allocation b;\n'
+              '    b = a;\n'
+              '    sum += k%d * %d;\n'
+              '  }\n' % (j, j, j, j, j))
+    f.write('  return sum;\n'
+            '}\n\n')
+
+  f.write('void run(int x) {\n'
+          '  int total = 0;\n')
+  for i in xrange(functions):
+    f.write('  total += helper%d(x);\n' % i)
+  f.write('  gTotal = total;\n'
+          '}\n')
+  f.close()
+
+
+class AstPassBenchmark(bench_util.Benchmark):
+  title = 'Renderscript Compiler AST Pass Benchmark'
+  sizeHelp = ('Times llvm-rs-cc on scripts of about SIZE statements '
+              '(1000, 10000 and 50000 by default)')
+  header = '%10s %10s %10s %8s' % ('Statements', 'Fused', 'Separate', 'Saved')
+  runs = 5
+  sizes = [1000, 10000, 50000]
+  statementsPerFunction = 100
+
+  def RunSize(self, work_dir, size):
+    script = os.path.join(work_dir, 'ast_%d.rs' % size)
+    GenerateScript(script, size, self.statementsPerFunction)
+    out_dir = os.path.join(work_dir, 'out_%d' % size)
+    fused = self.TimeCompile(script, out_dir, [])
+    separate = self.TimeCompile(script, out_dir, ['-separate-ast-passes'])
+    if fused is None or separate is None:
+      print '%10d %10s' % (size, 'FAILED')
+      return 1
+    print '%10d %10.3f %10.3f %7.1f%%' % (size, fused, separate,
+                                          (separate - fused) * 100 / separate)
+    return 0
+
+
+if __name__ == '__main__':
+  sys.exit(bench_util.Main(AstPassBenchmark()))
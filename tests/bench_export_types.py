@@ -0,0 +1,88 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renderscript Compiler Export Type Benchmark.
+
+Generates scripts with a chain of structures that each nest the previous one,
+and exports many variables and invokable functions that all use them. Times
+llvm-rs-cc on each of them. Since every type is normalized, validated and
+created once per file, the time per use should stay about the same as the
+scripts grow, whatever the depth of the structures.
+"""
+
+import os
+import sys
+
+import bench_util
+
+__author__ = 'Android'
+
+
+def GenerateScript(path, size, depth):
+  """Writes a script with about size uses of nested structures."""
+  f = open(path, 'w')
+  f.write('#pragma version(1)\n'
+          '#pragma rs java_package_name(foo)\n\n'
+          'typedef struct S0 {\n'
+          '  float4 v;\n'
+          '  int i;\n'
+          '} S0_t;\n\n')
+  for level in xrange(1, depth):
+    f.write('typedef struct S%d {\n'
+            '  S%d_t a;\n'
+            '  S%d_t b[2];\n'
+            '  float3 v;\n'
+            '  uchar4 c;\n'
+            '} S%d_t;\n\n' % (level, level - 1, level - 1, level))
+
+  # Spread the uses over all levels, so that each structure is shared.
+  uses = 0
+  for i in xrange(size / 2):
+    level = i % depth
+    f.write('S%d_t gVar%d;\n' % (level, i))
+    f.write('void set%d(S%d_t s) {\n'
+            '  gVar%d = s;\n'
+            '}\n' % (i, level, i))
+    uses += 2
+  f.close()
+  return uses
+
+
+class ExportTypeBenchmark(bench_util.Benchmark):
+  title = 'Renderscript Compiler Export Type Benchmark'
+  sizeHelp = ('Times llvm-rs-cc on scripts with about SIZE exported variables '
+              'and function parameters of nested structure types '
+              '(100, 1000 and 5000 by default)')
+  header = '%10s %10s %12s' % ('Uses', 'Time', 'us per use')
+  runs = 5
+  sizes = [100, 1000, 5000]
+  depthHelp = 'Nest structures N deep (default 8)'
+  depth = 8
+
+  def RunSize(self, work_dir, size):
+    script = os.path.join(work_dir, 'types_%d.rs' % size)
+    uses = GenerateScript(script, size, self.depth)
+    out_dir = os.path.join(work_dir, 'out_%d' % size)
+    elapsed = self.TimeCompile(script, out_dir, [])
+    if elapsed is None:
+      print '%10d %10s' % (uses, 'FAILED')
+      return 1
+    print '%10d %10.3f %12.1f' % (uses, elapsed, elapsed * 1e6 / uses)
+    return 0
+
+
+if __name__ == '__main__':
+  sys.exit(bench_util.Main(ExportTypeBenchmark()))
@@ -0,0 +1,96 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renderscript Compiler Initializer Benchmark.
+
+Generates scripts with very large global initializers and times llvm-rs-cc on
+each of them, to track how bitcode writing scales with the number of
+constants.
+"""
+
+import os
+import sys
+
+import bench_util
+
+__author__ = 'Android'
+
+
+def GenerateScript(path, size):
+  """Writes a script with int, float and struct initializers of size elements.
+
+  The elements are distinct so that the constant pool does not collapse, and
+  the arrays are static so that reflection does not have to emit them too.
+  """
+  f = open(path, 'w')
+  f.write('#pragma version(1)\n'
+          '#pragma rs java_package_name(foo)\n\n'
+          'typedef struct elem { int i; float f; } elem_t;\n\n')
+
+  f.write('static int ints[%d] = {\n' % size)
+  for i in xrange(size):
+    f.write('%d,\n' % i)
+  f.write('};\n\n')
+
+  f.write('static float floats[%d] = {\n' % size)
+  for i in xrange(size):
+    f.write('%d.5f,\n' % i)
+  f.write('};\n\n')
+
+  structs = size / 10
+  f.write('static elem_t elems[%d] = {\n' % structs)
+  for i in xrange(structs):
+    f.write('{%d, %d.25f},\n' % (i, i))
+  f.write('};\n\n')
+
+  f.write('int total;\n\n'
+          'void sum() {\n'
+          '  total = ints[0] + (int) floats[0] + elems[0].i;\n'
+          '}\n')
+  f.close()
+
+
+class InitializerBenchmark(bench_util.Benchmark):
+  title = 'Renderscript Compiler Initializer Benchmark'
+  sizeHelp = ('Times llvm-rs-cc on initializers of SIZE elements '
+              '(10000, 100000 and 1000000 by default)')
+  header = '%10s %10s %10s %12s' % ('Elements', 'Target', 'Seconds',
+                                    'Bitcode')
+  runs = 3
+  sizes = [10000, 100000, 1000000]
+  targetApis = ['16', '17']
+
+  def RunSize(self, work_dir, size):
+    failed = 0
+    script = os.path.join(work_dir, 'init_%d.rs' % size)
+    GenerateScript(script, size)
+    for target_api in self.targetApis:
+      out_dir = os.path.join(work_dir, 'out_%d_%s' % (size, target_api))
+      elapsed = self.TimeCompile(script, out_dir, ['-target-api', target_api])
+      if elapsed is None:
+        print '%10d %10s %10s' % (size, target_api, 'FAILED')
+        failed += 1
+        continue
+      bc_file = os.path.join(out_dir, 'init_%d.bc' % size)
+      bc_size = 0
+      if os.path.isfile(bc_file):
+        bc_size = os.path.getsize(bc_file)
+      print '%10d %10s %10.2f %12d' % (size, target_api, elapsed, bc_size)
+    return failed
+
+
+if __name__ == '__main__':
+  sys.exit(bench_util.Main(InitializerBenchmark()))
@@ -0,0 +1,141 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renderscript Compiler Java Bitcode Accessor Benchmark.
+
+Generates scripts with a growing number of invokable functions and reflects
+their bitcode into <Script>BitCode.java with each of the '-s jc' encodings.
+For every encoding, reports the size of the generated .java file, the time
+javac takes to compile it and the time the first getBitCode() call takes in
+a fresh JVM, which includes loading the class and decoding the bitcode.
+javac and java are looked up on the PATH; their columns are left empty
+without them.
+"""
+
+import os
+import subprocess
+import sys
+
+import bench_util
+
+__author__ = 'Android'
+
+
+ENCODINGS = ['bytes', 'latin1', 'deflate']
+PACKAGE = 'foo'
+
+HARNESS = """public class Harness {
+  public static void main(String[] args) {
+    long start = System.nanoTime();
+    byte[] bc = %s.%s.getBitCode();
+    long elapsed = System.nanoTime() - start;
+    System.out.println((elapsed / 1000) + " " + bc.length);
+  }
+}
+"""
+
+
+def GenerateScript(path, size):
+  """Writes a script with size invokable functions."""
+  f = open(path, 'w')
+  f.write('#pragma version(1)\n'
+          '#pragma rs java_package_name(%s)\n\n'
+          'float gOut[16];\n\n' % PACKAGE)
+  for i in xrange(size):
+    f.write('void invoke%d(float a, int b) {\n'
+            '  for (int i = 0; i < 16; i++) {\n'
+            '    gOut[i] = gOut[i] * a + (float) (b + i + %d);\n'
+            '  }\n'
+            '}\n\n' % (i, i))
+  f.close()
+
+
+def TimeAccessor(class_dir, runs):
+  """Returns the best time in us of the first getBitCode() call, or None."""
+  best = None
+  for _ in xrange(runs):
+    try:
+      p = subprocess.Popen(['java', '-cp', class_dir, 'Harness'],
+                           stdout=subprocess.PIPE)
+      out = p.communicate()[0]
+    except OSError:
+      return None
+    if p.returncode != 0 or not out.split():
+      return None
+    elapsed = int(out.split()[0])
+    if best is None or elapsed < best:
+      best = elapsed
+  return best
+
+
+class JavaBitcodeBenchmark(bench_util.Benchmark):
+  title = 'Renderscript Compiler Java Bitcode Accessor Benchmark'
+  sizeHelp = ('Reflects the bitcode of scripts with SIZE invokable functions '
+              'with each -bitcode-accessor-encoding (10, 100 and 1000 by '
+              'default)')
+  header = '%8s %8s %10s %12s %10s %12s' % ('Funcs', 'Encoding', 'Compile',
+                                           'Java bytes', 'javac', 'Decode us')
+  runs = 3
+  sizes = [10, 100, 1000]
+
+  def RunSize(self, work_dir, size):
+    name = 'bitcode_%d' % size
+    script = os.path.join(work_dir, name + '.rs')
+    GenerateScript(script, size)
+
+    failed = 0
+    for encoding in ENCODINGS:
+      out_dir = os.path.join(work_dir, 'out_%d_%s' % (size, encoding))
+      elapsed = self.TimeCompile(script, out_dir,
+                                 ['-s', 'jc',
+                                  '-bitcode-accessor-encoding', encoding])
+      if elapsed is None:
+        print '%8d %8s %10s' % (size, encoding, 'FAILED')
+        failed += 1
+        continue
+
+      java_file = os.path.join(out_dir, PACKAGE, name + 'BitCode.java')
+      java_size = os.path.getsize(java_file)
+
+      class_dir = os.path.join(out_dir, 'classes')
+      os.mkdir(class_dir)
+      harness = os.path.join(out_dir, 'Harness.java')
+      f = open(harness, 'w')
+      f.write(HARNESS % (PACKAGE, name + 'BitCode'))
+      f.close()
+      javac = bench_util.TimeCommand(['javac', '-d', class_dir, java_file],
+                                     self.runs)
+      decode = None
+      if javac is not None:
+        harness_built = bench_util.TimeCommand(['javac', '-cp', class_dir,
+                                                '-d', class_dir, harness], 1)
+        if harness_built is not None:
+          decode = TimeAccessor(class_dir, self.runs)
+
+      javac_col = '-'
+      if javac is not None:
+        javac_col = '%.3f' % javac
+      decode_col = '-'
+      if decode is not None:
+        decode_col = '%d' % decode
+      print '%8d %8s %10.3f %12d %10s %12s' % (size, encoding, elapsed,
+                                               java_size, javac_col,
+                                               decode_col)
+    return failed
+
+
+if __name__ == '__main__':
+  sys.exit(bench_util.Main(JavaBitcodeBenchmark()))
@@ -0,0 +1,105 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Renderscript Compiler Reference Counting Benchmark.
+
+Generates scripts with deeply nested scopes that declare, assign and leave
+(through returns, breaks and continues) many RS object locals, and times
+llvm-rs-cc on each of them. The time per local should stay about the same as
+the scripts grow, since RSObjectRefCount rebuilds every CompoundStmt at most
+once.
+"""
+
+import os
+import sys
+
+import bench_util
+
+__author__ = 'Android'
+
+
+def GenerateScope(f, level, depth, indent):
+  """Writes the body of a loop scope and the loops nested inside of it."""
+  pad = '  ' * indent
+  f.write('%srs_allocation a%d = gAlloc;\n'
+          '%sif (x == %d) return sum;\n'
+          '%sif (x == k%d) continue;\n'
+          '%ssum += k%d;\n' % (pad, level, pad, level, pad, level, pad, level))
+  if level + 1 < depth:
+    f.write('%sfor (int k%d = 0; k%d < x; k%d++) {\n' %
+            (pad, level + 1, level + 1, level + 1))
+    GenerateScope(f, level + 1, depth, indent + 1)
+    f.write('%s}\n' % pad)
+  f.write('%srs_allocation b%d;\n'
+          '%sb%d = a%d;\n'
+          '%sif (sum > %d) break;\n' % (pad, level, pad, level, level, pad,
+                                         level * 100))
+  return
+
+
+def GenerateScript(path, size, depth):
+  """Writes a script with about size RS object locals in nested scopes."""
+  f = open(path, 'w')
+  f.write('#pragma version(1)\n'
+          '#pragma rs java_package_name(foo)\n\n'
+          'rs_allocation gAlloc;\n'
+          'int gTotal;\n\n')
+
+  functions = max(1, size / (2 * depth))
+  for i in xrange(functions):
+    f.write('static int helper%d(int x) {\n'
+            '  int sum = 0;\n'
+            '  for (int k0 = 0; k0 < x; k0++) {\n' % i)
+    GenerateScope(f, 0, depth, 2)
+    f.write('  }\n'
+            '  return sum;\n'
+            '}\n\n')
+
+  f.write('void run(int x) {\n'
+          '  int total = 0;\n')
+  for i in xrange(functions):
+    f.write('  total += helper%d(x);\n' % i)
+  f.write('  gTotal = total;\n'
+          '}\n')
+  f.close()
+  return functions * 2 * depth
+
+
+class RefCountBenchmark(bench_util.Benchmark):
+  title = 'Renderscript Compiler Reference Counting Benchmark'
+  sizeHelp = ('Times llvm-rs-cc on scripts with about SIZE RS object locals '
+              '(100, 1000 and 5000 by default)')
+  header = '%10s %10s %14s' % ('Locals', 'Time', 'us per local')
+  runs = 5
+  sizes = [100, 1000, 5000]
+  depthHelp = 'Nest scopes N deep (default 8)'
+  depth = 8
+
+  def RunSize(self, work_dir, size):
+    script = os.path.join(work_dir, 'scopes_%d.rs' % size)
+    num_locals = GenerateScript(script, size, self.depth)
+    out_dir = os.path.join(work_dir, 'out_%d' % size)
+    elapsed = self.TimeCompile(script, out_dir, [])
+    if elapsed is None:
+      print '%10d %10s' % (num_locals, 'FAILED')
+      return 1
+    print '%10d %10.3f %14.1f' % (num_locals, elapsed,
+                                  elapsed * 1e6 / num_locals)
+    return 0
+
+
+if __name__ == '__main__':
+  sys.exit(bench_util.Main(RefCountBenchmark()))
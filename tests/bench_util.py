@@ -0,0 +1,131 @@
+#!/usr/bin/python2.4
+#
+# Copyright 2013 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Shared driver for the Renderscript Compiler benchmarks.
+
+Each bench_*.py script only describes how to generate its inputs and what to
+print for them; timing llvm-rs-cc and parsing the command line live here.
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+__author__ = 'Android'
+
+
+LLVM_RS_CC = '../../../../../out/host/linux-x86/bin/llvm-rs-cc'
+INCLUDES = ['-I', '../../../../../frameworks/rs/scriptc/',
+            '-I', '../../../../../external/clang/lib/Headers/']
+
+
+def TimeCommand(args, runs):
+  """Returns the best wall clock time of runs runs of args, or None."""
+  best = None
+  devnull = open(os.devnull, 'w')
+  for _ in xrange(runs):
+    start = time.time()
+    try:
+      ret = subprocess.call(args, stdout=devnull, stderr=devnull)
+    except OSError:
+      ret = 1
+    elapsed = time.time() - start
+    if ret != 0:
+      devnull.close()
+      return None
+    if best is None or elapsed < best:
+      best = elapsed
+  devnull.close()
+  return best
+
+
+def TimeCompile(script, out_dir, extra_args, runs):
+  """Returns the best wall clock time of runs compiles of script, or None."""
+  args = ([LLVM_RS_CC, '-o', out_dir, '-p', out_dir] + INCLUDES + extra_args +
+          [script])
+  return TimeCommand(args, runs)
+
+
+class Benchmark(object):
+  """Describes a benchmark to Main().
+
+  Subclasses set the class attributes below and implement RunSize(), which
+  generates the input of the given size under work_dir, prints one or more
+  rows of results and returns the number of failed compiles.
+  """
+  title = ''
+  sizeHelp = ''
+  header = ''
+  runs = 5
+  sizes = []
+  # Set to a help string to accept -d/--depth N and store it in self.depth.
+  depthHelp = None
+  depth = 1
+
+  def RunSize(self, work_dir, size):
+    raise NotImplementedError
+
+  def TimeCompile(self, script, out_dir, extra_args):
+    return TimeCompile(script, out_dir, extra_args, self.runs)
+
+
+def Usage(bench):
+  """Print out usage information."""
+  print ('Usage: %s [OPTION]... [SIZE]...\n'
+         '%s\n'
+         '%s\n'
+         'Available Options:\n'
+         '  -h, --help          Help message\n'
+         '  -r, --runs N        Best of N runs (default %d)\n'
+        ) % (sys.argv[0], bench.title, bench.sizeHelp, bench.runs),
+  if bench.depthHelp:
+    print '  -d, --depth N       %s' % bench.depthHelp
+  return
+
+
+def Main(bench):
+  """Runs bench for the sizes given on the command line."""
+  sizes = []
+  args = sys.argv[1:]
+  while args:
+    arg = args.pop(0)
+    if arg in ('-h', '--help'):
+      Usage(bench)
+      return 0
+    elif arg in ('-r', '--runs') and args:
+      bench.runs = int(args.pop(0))
+    elif bench.depthHelp and arg in ('-d', '--depth') and args:
+      bench.depth = max(1, int(args.pop(0)))
+    elif arg.isdigit():
+      sizes.append(int(arg))
+    else:
+      print >> sys.stderr, 'Invalid size or option: %s' % arg
+      return 1
+
+  if not sizes:
+    sizes = bench.sizes
+
+  failed = 0
+  work_dir = tempfile.mkdtemp()
+  print bench.header
+  for size in sizes:
+    failed += bench.RunSize(work_dir, size)
+
+  shutil.rmtree(work_dir)
+  return failed != 0
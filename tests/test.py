@@ -18,12 +18,111 @@ import sys
 __author__ = 'Android'
 
 
+# Flags that replace legacy export metadata with a new encoding. Tests marked
+# with a COMPARE_LEGACY file are also compiled without them for comparison.
+NEW_ENCODING_FLAGS = ('-emit-object-slot-map', '-emit-export-blob')
+
+
 class Options(object):
   def __init__(self):
     return
   verbose = 0
   cleanup = 1
   updateCTS = 0
+  checkBitcode = 0
+  bitcodeSize = 0
+  metadataReport = 0
+  metadataReportLines = []
+  # legacy bytes, nodes, decode us; spec bytes, nodes, decode us
+  metadataTotals = [0, 0, 0.0, 0, 0, 0.0]
+
+
+def CheckBitcode(bc_file):
+  """Verifies that bc_file can be read back and disassembled."""
+  llvm_dis = '../../../../../out/host/linux-x86/bin/llvm-dis'
+  devnull = open(os.devnull, 'w')
+  try:
+    ret = subprocess.call([llvm_dis, bc_file, '-o', os.devnull],
+                          stdout=devnull, stderr=devnull)
+  except:
+    ret = 1
+  devnull.close()
+  return ret == 0
+
+
+METADATA_REPORT_RE = re.compile(r'spec metadata: legacy (\d+) bytes in (\d+) '
+                                r'nodes, ([\d.]+) us; spec (\d+) bytes in '
+                                r'(\d+) nodes, ([\d.]+) us')
+
+
+def ReportMetadata(bc_file):
+  """Compares the spec and legacy export metadata of bc_file."""
+  bench = '../../../../../out/host/linux-x86/bin/slang-bitwriter-bench'
+  try:
+    p = subprocess.Popen([bench, '-metadata-only', '-iterations=100',
+                          bc_file], stdout=subprocess.PIPE)
+    out = p.communicate()[0]
+  except (IOError, OSError), e:
+    Options.metadataReportLines.append('%s: could not run %s: %s' %
+                                       (bc_file, bench, e))
+    return
+  for line in out.splitlines():
+    match = METADATA_REPORT_RE.search(line)
+    if match:
+      Options.metadataReportLines.append(line)
+      totals = Options.metadataTotals
+      for i in xrange(len(totals)):
+        totals[i] += float(match.group(i + 1))
+
+
+def PrintMetadataTotals():
+  """Prints the size difference and decode cost summed over all files."""
+  (legacy_bytes, legacy_nodes, legacy_us,
+   spec_bytes, spec_nodes, spec_us) = Options.metadataTotals
+  print ('Export metadata: legacy %d bytes in %d nodes, %.2f us to decode; '
+         'spec %d bytes in %d nodes, %.2f us to decode' %
+         (legacy_bytes, legacy_nodes, legacy_us,
+          spec_bytes, spec_nodes, spec_us))
+  if legacy_bytes:
+    print ('Export metadata: spec encoding is %+.1f%% in size' %
+           ((spec_bytes - legacy_bytes) * 100 / legacy_bytes))
+  if legacy_us:
+    print ('Export metadata: spec decoding is %+.1f%% in time' %
+           ((spec_us - legacy_us) * 100 / legacy_us))
+
+
+def CompareWithLegacy(base_args, extra_args, rs_files):
+  """Checks the new metadata encodings of tmp/*.bc against the legacy ones.
+
+  The scripts are compiled again into tmp/legacy/ without the flags that
+  select the new encodings, and slang-bitwriter-bench decodes the object slots
+  and export blob of each module and compares them with the legacy metadata.
+  """
+  bench = '../../../../../out/host/linux-x86/bin/slang-bitwriter-bench'
+  legacy_dir = 'tmp/legacy/'
+  args = [legacy_dir if arg == 'tmp/' else arg for arg in base_args]
+  args += [arg for arg in extra_args if arg not in NEW_ENCODING_FLAGS]
+  args += rs_files
+
+  devnull = open(os.devnull, 'w')
+  output = devnull
+  if Options.verbose:
+    output = None
+  try:
+    if subprocess.call(args, stdout=devnull, stderr=devnull) != 0:
+      devnull.close()
+      return False
+    for bc_file in glob.glob('tmp/*.bc'):
+      legacy_bc = os.path.join(legacy_dir, os.path.basename(bc_file))
+      if subprocess.call([bench, '-compare-legacy', legacy_bc, bc_file],
+                         stdout=output, stderr=output) != 0:
+        devnull.close()
+        return False
+  except OSError:
+    devnull.close()
+    return False
+  devnull.close()
+  return True
 
 
 def CompareFiles(actual, expect):
@@ -88,6 +187,8 @@ def ExecTest(dirname):
   extra_args = extra_args_str.split()
 
   args = base_args + extra_args + rs_files
+  if Options.metadataReport:
+    args.insert(1, '-emit-spec-metadata')
 
   if Options.verbose > 1:
     print 'Executing:',
@@ -119,6 +220,22 @@ def ExecTest(dirname):
   stdout_file.close()
   stderr_file.close()
 
+  if dirname[0:2] == 'P_' and ret == 0:
+    for bc_file in glob.glob('tmp/*.bc'):
+      Options.bitcodeSize += os.path.getsize(bc_file)
+      if Options.checkBitcode and not CheckBitcode(bc_file):
+        passed = False
+        if Options.verbose:
+          print 'Could not read back %s' % bc_file
+      if Options.metadataReport:
+        ReportMetadata(bc_file)
+    if glob.glob('COMPARE_LEGACY') and not CompareWithLegacy(base_args,
+                                                             extra_args,
+                                                             rs_files):
+      passed = False
+      if Options.verbose:
+        print 'Export metadata differs from the legacy encoding'
+
   if dirname[0:2] == 'F_':
     if ret == 0:
       passed = False
@@ -174,7 +291,10 @@ def Usage():
          'Renderscript Compiler Test Harness\n'
          'Runs TESTNAMEs (all tests by default)\n'
          'Available Options:\n'
+         '  -b, --check-bitcode Read back every emitted .bc file\n'
          '  -h, --help          Help message\n'
+         '  -m, --metadata-report Compare -emit-spec-metadata with the legacy\n'
+         '                      export metadata of every emitted .bc file\n'
          '  -n, --no-cleanup    Don\'t clean up after running tests\n'
          '  -u, --update-cts    Update CTS test versions\n'
          '  -v, --verbose       Verbose output\n'
@@ -192,6 +312,10 @@ def main():
     if arg in ('-h', '--help'):
       Usage()
       return 0
+    elif arg in ('-b', '--check-bitcode'):
+      Options.checkBitcode = 1
+    elif arg in ('-m', '--metadata-report'):
+      Options.metadataReport = 1
     elif arg in ('-n', '--no-cleanup'):
       Options.cleanup = 0
     elif arg in ('-u', '--update-cts'):
@@ -224,6 +348,11 @@ def main():
 
   print 'Tests Passed: %d\n' % passed,
   print 'Tests Failed: %d\n' % failed,
+  print 'Bitcode Size: %d bytes\n' % Options.bitcodeSize,
+  for line in Options.metadataReportLines:
+    print line
+  if Options.metadataReport:
+    PrintMetadataTotals()
   if failed:
     print 'Failures:',
     for t in failed_tests: